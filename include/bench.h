@@ -0,0 +1,31 @@
+/*
+ * bench.h
+ *
+ * @brief On-device micro-benchmarks. Only built when the
+ * THERMAL_CAMERA_BENCH option is on; results are printed over stdio.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include "mlx90640/MLX90640_API.h"
+
+/*
+ * bench_run
+ *
+ * @brief Run every benchmark once and print the results.
+ */
+void bench_run(void);
+/*
+ * bench_run_sensor
+ *
+ * @brief Run the benchmarks that need a real frame and calibration, i.e. the
+ * To calculation. Called from core0 once the first frame is in.
+ */
+void bench_run_sensor(uint16_t *frameData, const paramsMLX90640 *params);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * capture.h
+ *
+ * @brief On-demand captures in between continuous frames. A trigger (a
+ * GPIO edge, or "capture" on the console) asks the sensor loop for one
+ * image taken after the trigger, and the time from trigger to result is
+ * measured and reported.
+ *
+ * Two ways to get it: step mode stops the sensors free-running and starts
+ * a measurement of each subpage on demand, so nothing measured before the
+ * trigger has to be waited out. Free mode leaves them running, skips the
+ * subpage that was already under way and takes the next two. "capture
+ * bench" runs both for comparison.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "sensor.h"
+
+typedef enum {
+  CAPTURE_STEP,
+  CAPTURE_FREE,
+} capture_mode_t;
+
+typedef struct {
+  capture_mode_t mode;
+  bool ok;
+  uint32_t trigger_us;     // when the trigger came in
+  // the rest are microseconds after the trigger
+  uint32_t start_us;       // the sensor loop picked it up
+  uint32_t first_data_us;  // first subpage read
+  uint32_t data_us;        // both subpages of every sensor read
+  uint32_t result_us;      // To done
+} capture_result_t;
+
+/*
+ * capture_init
+ *
+ * @brief Captures use the n sensors given, which compute into their own
+ * temps as usual. trigger_pin < 0 means console triggers only, otherwise a
+ * falling edge on it triggers (pulled up). Call from the sensor loop's core.
+ */
+void capture_init(sensor_t *sensors, uint n, float emissivity, int trigger_pin);
+/*
+ * capture_request
+ *
+ * @brief Ask for a capture, triggered now.
+ */
+void capture_request(capture_mode_t mode);
+/*
+ * capture_pending
+ *
+ * @brief Whether a trigger is waiting for the sensor loop.
+ */
+bool capture_pending(void);
+/*
+ * capture_run
+ *
+ * @brief Sensor loop: take the pending capture, leaving continuous mode as
+ * it was after. Returns false if there was none or it failed; r says how
+ * long each part took either way.
+ */
+bool capture_run(capture_result_t *r);
+/*
+ * capture_print
+ *
+ * @brief Log a result.
+ */
+void capture_print(const capture_result_t *r);
+
+#endif
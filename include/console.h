@@ -0,0 +1,42 @@
+/*
+ * console.h
+ *
+ * @brief Line based commands over stdio. Modules register what they can
+ * report or change; console_poll picks up whatever characters have come in
+ * without waiting, and runs a command once its line is complete. "help"
+ * lists them.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _CONSOLE_H
+#define _CONSOLE_H
+
+#include <stdbool.h>
+
+#define CONSOLE_MAX_COMMANDS 16
+#define CONSOLE_LINE_LEN 64
+
+/*
+ * @brief Runs a command, args is the rest of the line after its name (no
+ * leading spaces, maybe empty).
+ */
+typedef void (*console_fn_t)(const char *args);
+
+/*
+ * console_register
+ *
+ * @brief Add a command. name and help must outlive the console. Returns
+ * false if the table is full.
+ */
+bool console_register(const char *name, const char *help, console_fn_t fn);
+/*
+ * console_poll
+ *
+ * @brief Handle any input that has arrived. Never blocks, call it from a
+ * loop.
+ */
+void console_poll(void);
+
+#endif
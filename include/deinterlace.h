@@ -0,0 +1,67 @@
+/*
+ * deinterlace.h
+ *
+ * @brief Fills in the half of the image a subpage didn't measure. In chess
+ * mode each subpage updates every other pixel, so anything moving shows up
+ * as a checkerboard of new and stale values. For each stale pixel this
+ * looks at how much its measured neighbours (all from the current subpage)
+ * changed since they were last read: where nothing moved it keeps the
+ * stale value, which is the sharper one, and where things moved it takes
+ * the average of the neighbours instead, blending in between. Every
+ * subpage then gives a whole coherent image.
+ *
+ * This assumes the subpages alternate. If one is dropped (a failed read,
+ * or a capture that only got one), the next image's stale half is from
+ * the frame before; it is never kept, the whole half is interpolated
+ * from the neighbours until the other subpage arrives.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _DEINTERLACE_H
+#define _DEINTERLACE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_sched.h"
+
+/*
+ * @brief Mean change of the neighbours, in degrees C, below which a stale
+ * pixel is kept and above which it is interpolated.
+ */
+#define DEINTERLACE_MOTION_LOW 0.5f
+#define DEINTERLACE_MOTION_HIGH 1.5f
+
+/*
+ * deinterlace_init
+ *
+ * @brief Register the "deinterlace" console command. enabled is whether it
+ * starts on.
+ */
+void deinterlace_init(bool enabled);
+/*
+ * deinterlace_enable
+ *
+ * @brief Turn it on or off. Turning it on forgets what the neighbours were.
+ */
+void deinterlace_enable(bool enabled);
+bool deinterlace_enabled(void);
+/*
+ * deinterlace_reset
+ *
+ * @brief Forget the previous values and which subpage came last, the next
+ * subpage of each kind is interpolated everywhere.
+ */
+void deinterlace_reset(void);
+/*
+ * deinterlace_apply
+ *
+ * @brief Run on the image at frame[first] (MLX90640_PIXEL_NUM pixels, one
+ * sensor) after subpage has been calculated into it. Writes the estimates
+ * over the pixels of the other subpage, which the next subpage overwrites
+ * with measurements anyway. Does nothing while off.
+ */
+void deinterlace_apply(float *frame, size_t first, int subpage);
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * flash_log.h
+ *
+ * @brief A log of records in a region of NOR flash, used as a ring: pages
+ * are programmed one after another and the oldest sector is erased ahead
+ * of the writer, so every sector is erased once per trip round the region
+ * and wear is spread evenly without any bookkeeping.
+ *
+ * Records are appended to a queue of pages in RAM and only reach flash
+ * when flash_log_step is called, one page program or one sector erase at
+ * a time, so the caller decides when the flash may be busy. A record can
+ * span pages; each page says where the first record starting in it is, so
+ * a reader that finds a gap (a page lost to a power cut, or overwritten)
+ * picks up again at the next record.
+ *
+ * Page: 12 byte header then FLASH_LOG_PAGE_PAYLOAD bytes of records.
+ *
+ * | offset | size | field                                             |
+ * |--------|------|---------------------------------------------------|
+ * | 0      | 4    | sequence number, one more than the page before,   |
+ * |        |      | two more after a restart                          |
+ * | 4      | 2    | magic, FLASH_LOG_MAGIC                            |
+ * | 6      | 2    | offset in the payload of the first record start,  |
+ * |        |      | 0xFFFF if the page only continues one             |
+ * | 8      | 2    | payload bytes used                                |
+ * | 10     | 2    | CRC-16/CCITT of bytes 0 to 9 and the used payload |
+ *
+ * Record: type, sensor, payload length (2 bytes), time_us (4 bytes), then
+ * the payload. Everything is little-endian.
+ *
+ * Plain C over a backend that erases and programs, with no SDK
+ * dependencies, so the host tools decode dumps (and test it over a RAM
+ * stand-in) with the same code. See logger.h for the camera's side.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _FLASH_LOG_H
+#define _FLASH_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_LOG_PAGE_SIZE 256
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_PAGES_PER_SECTOR (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_PAGE_SIZE)
+#define FLASH_LOG_PAGE_HEADER 12
+#define FLASH_LOG_PAGE_PAYLOAD (FLASH_LOG_PAGE_SIZE - FLASH_LOG_PAGE_HEADER)
+#define FLASH_LOG_MAGIC 0x474C
+#define FLASH_LOG_RECORD_HEADER 8
+/*
+ * @brief Largest record payload: a raw frame stored by frame_codec.h.
+ */
+#define FLASH_LOG_MAX_PAYLOAD 1672
+/*
+ * @brief Pages that can wait in RAM for the flash, enough for a couple of
+ * the largest records.
+ */
+#define FLASH_LOG_QUEUE_PAGES 16
+/*
+ * @brief Sectors kept erased ahead of the writer (counting the one it is
+ * in), so a page never waits on an erase at a sector boundary.
+ */
+#define FLASH_LOG_ERASE_AHEAD 2
+/*
+ * @brief Queued pages at which a waiting erase can't wait any longer: past
+ * this, the largest record might not fit.
+ */
+#define FLASH_LOG_QUEUE_URGENT \
+  (FLASH_LOG_QUEUE_PAGES - 2 - \
+   (FLASH_LOG_RECORD_HEADER + FLASH_LOG_MAX_PAYLOAD + FLASH_LOG_PAGE_PAYLOAD - 1) / FLASH_LOG_PAGE_PAYLOAD)
+/*
+ * @brief Smallest region, in sectors.
+ */
+#define FLASH_LOG_MIN_SECTORS 4
+
+typedef enum {
+  FLASH_LOG_BOOT = 1,    // the camera started: sensors, then mode
+  FLASH_LOG_STATS = 2,   // flash_log_stats_t of a sensor over a period
+  FLASH_LOG_FRAME = 3,   // a raw frame through frame_codec.h
+  FLASH_LOG_EEPROM = 4,  // a sensor's 832 words of calibration EEPROM
+} flash_log_type_t;
+
+/*
+ * @brief Payload of FLASH_LOG_STATS, To in hundredths of a degree C.
+ */
+typedef struct {
+  int16_t min;
+  int16_t max;
+  int16_t avg;       // of the frames' means
+  uint16_t hottest;  // pixel index of max
+  uint16_t frames;   // in the period
+} flash_log_stats_t;
+
+#define FLASH_LOG_STATS_SIZE 10
+
+/*
+ * @brief Where the log lives. base is the region, readable in place (XIP
+ * on the camera); offsets are from there. erase clears a sector to 0xFF,
+ * program writes a whole page into an erased one.
+ */
+typedef struct {
+  const uint8_t *base;
+  uint32_t size;  // a multiple of FLASH_LOG_SECTOR_SIZE
+  bool (*erase)(void *ctx, uint32_t offset);
+  bool (*program)(void *ctx, uint32_t offset, const uint8_t *page);
+  void *ctx;
+} flash_log_backend_t;
+
+typedef struct {
+  uint32_t records;   // appended
+  uint32_t dropped;   // found the queue full
+  uint32_t pages;     // programmed
+  uint32_t erases;
+  uint32_t failures;  // erases or programs the backend failed
+  uint32_t wraps;     // times the writer went round the region
+} flash_log_counters_t;
+
+typedef struct {
+  const flash_log_backend_t *backend;
+  uint32_t n_pages;
+  uint32_t n_sectors;
+  uint32_t head;          // next page to program
+  uint32_t seq;           // sequence number it gets
+  uint32_t erased_ahead;  // sectors ready from the head's
+  // pages waiting, in order from queue_head; the slot after the last is
+  // the one being filled, so there are never more than
+  // FLASH_LOG_QUEUE_PAGES - 1
+  uint8_t queue[FLASH_LOG_QUEUE_PAGES][FLASH_LOG_PAGE_SIZE];
+  uint32_t queue_head;
+  uint32_t queue_count;
+  uint16_t fill_used;
+  uint16_t fill_first;
+  flash_log_counters_t counters;
+} flash_log_t;
+
+typedef struct {
+  uint8_t type;
+  uint8_t sensor;
+  uint16_t len;
+  uint32_t time_us;
+} flash_log_record_t;
+
+/*
+ * @brief Reads the records in flash, oldest first. Records still queued in
+ * RAM aren't seen, flush first.
+ */
+typedef struct {
+  const flash_log_t *log;
+  uint32_t page;      // next page to look at
+  uint32_t left;      // pages not yet looked at
+  uint32_t seq;       // of the page being read
+  bool have_seq;
+  const uint8_t *data;
+  uint16_t pos;
+  uint16_t used;
+  uint32_t have;      // bytes of the record so far
+  uint32_t need;      // its whole length, once the header is in
+  uint32_t broken;    // records lost to gaps
+  uint8_t record[FLASH_LOG_RECORD_HEADER + FLASH_LOG_MAX_PAYLOAD];
+} flash_log_reader_t;
+
+/*
+ * flash_log_init
+ *
+ * @brief Find where the log in the region left off and carry on from
+ * there; a region with no log in it starts a new one. Reads the region but
+ * doesn't write it. Returns false if the region is too small.
+ */
+bool flash_log_init(flash_log_t *log, const flash_log_backend_t *backend);
+/*
+ * flash_log_fits
+ *
+ * @brief Whether the queue has room for a record of len payload bytes.
+ */
+bool flash_log_fits(const flash_log_t *log, uint16_t len);
+/*
+ * flash_log_append
+ *
+ * @brief Queue a record. Returns false, and counts it dropped, if the
+ * queue hasn't room for it.
+ */
+bool flash_log_append(flash_log_t *log, uint8_t type, uint8_t sensor, uint32_t time_us, const void *payload,
+  uint16_t len);
+/*
+ * flash_log_flush
+ *
+ * @brief Let the page being filled go to flash as it is. The rest of it is
+ * wasted.
+ */
+void flash_log_flush(flash_log_t *log);
+/*
+ * flash_log_pending
+ *
+ * @brief Whether flash_log_step has something to do, and if it's an erase.
+ */
+bool flash_log_pending(const flash_log_t *log, bool *erase);
+/*
+ * flash_log_urgent
+ *
+ * @brief Whether the queue is stuck behind an erase and nearly full, so the
+ * erase should be done now, time for it or not, rather than drop records.
+ */
+bool flash_log_urgent(const flash_log_t *log);
+/*
+ * flash_log_step
+ *
+ * @brief Do at most one flash operation, of the kinds allowed: program the
+ * oldest queued page, or erase the next sector ahead. Returns whether it
+ * did one.
+ */
+bool flash_log_step(flash_log_t *log, bool may_program, bool may_erase);
+/*
+ * flash_log_page_valid
+ *
+ * @brief Whether page n holds a page of the log.
+ */
+bool flash_log_page_valid(const flash_log_t *log, uint32_t n, uint32_t *seq);
+/*
+ * flash_log_page_fn_t
+ *
+ * @brief Given each page flash_log_dump walks, as it is in the flash.
+ */
+typedef void (*flash_log_page_fn_t)(void *ctx, const uint8_t *page);
+/*
+ * flash_log_valid_pages
+ *
+ * @brief How many pages of the region hold pages of the log.
+ */
+uint32_t flash_log_valid_pages(const flash_log_t *log);
+/*
+ * flash_log_dump
+ *
+ * @brief Call fn on the newest max_pages pages of the log (all of them for
+ * 0), oldest first, the order tools/log_decode wants them in. Returns how
+ * many.
+ */
+uint32_t flash_log_dump(const flash_log_t *log, uint32_t max_pages, flash_log_page_fn_t fn, void *ctx);
+/*
+ * flash_log_reader_init
+ *
+ * @brief Start at the head: past it are the erased pages, then the oldest
+ * records, round to the newest just behind it.
+ */
+void flash_log_reader_init(flash_log_reader_t *r, const flash_log_t *log);
+/*
+ * flash_log_read
+ *
+ * @brief The next record and its payload (in the reader), or false at the
+ * end.
+ */
+bool flash_log_read(flash_log_reader_t *r, flash_log_record_t *h, const uint8_t **payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
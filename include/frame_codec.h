@@ -0,0 +1,106 @@
+/*
+ * frame_codec.h
+ *
+ * @brief Lossless compression of raw MLX90640 frames (the 834 words
+ * MLX90640_GetFrameData returns), for the stream and for recordings.
+ *
+ * Each word is predicted and the residual Golomb-Rice coded, with the Rice
+ * parameter adapting separately for measured pixels, stale pixels and the
+ * aux words. Against the previous frame (inter frames):
+ *  - pixels of the subpage that wasn't measured are still what the sensor
+ *    RAM held last time, so they are predicted as the previous value, and
+ *    if they all are (the usual case) a single bit says so;
+ *  - measured pixels are predicted as their previous value plus the median
+ *    change of their already coded neighbours of the same subpage, which
+ *    follows Ta and gain drift without coding each pixel's fixed offset;
+ *  - aux words as their previous value.
+ * Key frames stand alone, predicting pixels from the median of their
+ * neighbours of the same subpage, and come every key_interval frames so a
+ * decoder that lost a frame picks up again. A frame that would come out
+ * bigger than it went in is stored as it is.
+ *
+ * Encoded frame: a flags byte, a count byte (frame number mod 256, so a
+ * decoder that missed a frame knows), then the bit stream, MSB first. The
+ * subpage and control words are coded first (they say which pixels were
+ * measured), then the pixels in raster order, then the aux words.
+ *
+ * Plain C with fixed memory (a frame of history) and no SDK dependencies,
+ * so the host tools decode with the same code.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _FRAME_CODEC_H
+#define _FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_CODEC_WORDS 834
+#define FRAME_CODEC_HEADER_BYTES 2
+/*
+ * @brief Output room encode needs: the header and a stored frame.
+ */
+#define FRAME_CODEC_MAX_BYTES (FRAME_CODEC_HEADER_BYTES + 2 * FRAME_CODEC_WORDS)
+#define FRAME_CODEC_KEY_INTERVAL 16
+
+/*
+ * @brief Bits of the flags byte.
+ */
+#define FRAME_CODEC_KEY 0x01         // doesn't depend on the previous frame
+#define FRAME_CODEC_STORED 0x02      // the words follow as they are, little-endian
+#define FRAME_CODEC_STALE_SAME 0x04  // unmeasured pixels are all as before, not coded
+
+typedef enum {
+  FRAME_CODEC_OK = 0,
+  // an inter frame without the frame it depends on (none, or one was
+  // missed), wait for a key frame
+  FRAME_CODEC_NEED_KEY = -1,
+  // ran out of input or doesn't make sense
+  FRAME_CODEC_CORRUPT = -2,
+} frame_codec_status_t;
+
+/*
+ * @brief One per stream of frames (per sensor), on each end.
+ */
+typedef struct {
+  uint16_t prev[FRAME_CODEC_WORDS];
+  bool have_prev;
+  uint16_t key_interval;
+  uint16_t since_key;
+  uint8_t count;  // of the next frame
+} frame_codec_t;
+
+/*
+ * frame_codec_init
+ *
+ * @brief Start a stream. The encoder sends a key frame first and then every
+ * key_interval frames (0 for only the first); the decoder ignores it.
+ */
+void frame_codec_init(frame_codec_t *c, uint16_t key_interval);
+/*
+ * frame_codec_encode
+ *
+ * @brief Encode frame into out, which needs room for FRAME_CODEC_MAX_BYTES.
+ * Returns the encoded length, or 0 if out is too small.
+ */
+size_t frame_codec_encode(frame_codec_t *c, const uint16_t *frame, uint8_t *out, size_t cap);
+/*
+ * frame_codec_decode
+ *
+ * @brief Decode len bytes from in into frame. After an error the stream
+ * waits for the next key frame.
+ */
+frame_codec_status_t frame_codec_decode(frame_codec_t *c, const uint8_t *in, size_t len, uint16_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
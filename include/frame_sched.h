@@ -0,0 +1,92 @@
+/*
+ * frame_sched.h
+ *
+ * @brief Hands temperature frames from the sensor loop (core0) to the
+ * display loop (core1) without tying their rates together. The sensor side
+ * publishes whenever a subpage is ready; the display side runs on its own
+ * tick and either holds the newest frame or blends between the last two.
+ * Frames the display never got to are counted, not silently lost.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _FRAME_SCHED_H
+#define _FRAME_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "mlx90640/MLX90640_API.h"
+#include "sensor.h"
+
+/*
+ * @brief Floats in a frame, a whole panorama when there are several sensors.
+ */
+#define FRAME_SCHED_PIXELS SENSOR_PANORAMA_PIXELS(THERMAL_CAMERA_SENSORS)
+
+typedef enum {
+  // show each sensor frame as it is, until the next one arrives
+  FRAME_SCHED_HOLD,
+  // fade from the previous sensor frame to the newest over one sensor period
+  FRAME_SCHED_INTERPOLATE,
+} frame_sched_mode_t;
+
+typedef struct {
+  float temps[FRAME_SCHED_PIXELS];
+  uint32_t time_us;  // when the sensor finished the frame
+  uint32_t seq;      // counts up from 1 with each published frame
+} frame_sched_frame_t;
+
+typedef struct {
+  uint32_t produced;   // frames published by the sensor loop
+  uint32_t consumed;   // frames picked up by the display loop
+  uint32_t dropped;    // frames replaced before the display picked them up
+  uint32_t displayed;  // display ticks that drew something
+  uint32_t idle;       // display ticks with nothing new to draw
+  uint32_t late;       // display ticks that started after the next one was due
+} frame_sched_stats_t;
+
+/*
+ * frame_sched_init
+ *
+ * @brief Set up the scheduler for a display running at display_hz. Call
+ * before either core uses it.
+ */
+void frame_sched_init(uint display_hz, frame_sched_mode_t mode);
+/*
+ * frame_sched_publish
+ *
+ * @brief Sensor side: copy out a finished frame of FRAME_SCHED_PIXELS,
+ * captured at time_us. Never blocks on the display; an unconsumed earlier
+ * frame is dropped.
+ */
+void frame_sched_publish(const float *temps, uint32_t time_us);
+/*
+ * frame_sched_wait_display
+ *
+ * @brief Display side: sleep until the next display tick.
+ */
+void frame_sched_wait_display(void);
+/*
+ * frame_sched_next_display_us
+ *
+ * @brief Display side: time_us_64() of the next display tick, for doing
+ * other work until then instead of sleeping.
+ */
+uint64_t frame_sched_next_display_us(void);
+/*
+ * frame_sched_display_frame
+ *
+ * @brief Display side: write the frame to show at now_us into out. Returns
+ * false if it would be the same as what was last shown.
+ */
+bool frame_sched_display_frame(float *out, uint32_t now_us);
+/*
+ * frame_sched_get_stats
+ *
+ * @brief Snapshot of the counters.
+ */
+void frame_sched_get_stats(frame_sched_stats_t *stats);
+
+#endif
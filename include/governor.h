@@ -0,0 +1,72 @@
+/*
+ * governor.h
+ *
+ * @brief Picks the MLX90640 refresh rate and ADC resolution at runtime. It
+ * watches how much of each subpage period goes to acquisition, To and
+ * rendering, and steps the refresh rate down when that gets too close to
+ * the period and back up once there is room for twice the rate. Resolution
+ * follows the measured temporal noise.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _GOVERNOR_H
+#define _GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+typedef struct {
+  uint8_t min_rate;  // MLX90640 refresh rate codes, 0 (0.5Hz) to 7 (64Hz)
+  uint8_t max_rate;
+  uint8_t min_res;   // MLX90640 resolution codes, 0 (16 bit) to 3 (19 bit)
+  uint8_t max_res;
+} governor_config_t;
+
+typedef struct {
+  uint8_t rate;      // current refresh rate code
+  uint8_t res;       // current resolution code
+  float load;        // busiest stage over the subpage period, last window
+  float noise;       // temporal noise floor in degrees C, last window
+  uint32_t changes;  // how many times a setting was changed
+} governor_state_t;
+
+/*
+ * governor_init
+ *
+ * @brief Start governing from the given rate and resolution, which the
+ * sensor should already be set to.
+ */
+void governor_init(const governor_config_t *config, uint8_t rate, uint8_t res);
+/*
+ * governor_note_render
+ *
+ * @brief Display side: how long the last frame took to render and flush.
+ */
+void governor_note_render(uint32_t render_us);
+/*
+ * governor_update
+ *
+ * @brief Sensor side, once per subpage: acq_us is how long
+ * MLX90640_GetFrameData took (including any wait for data), calc_us the
+ * processing after it. Returns true if the sensor settings were changed.
+ */
+bool governor_update(uint8_t slave_addr, uint32_t acq_us, uint32_t calc_us, const float *temps, int subpage);
+/*
+ * governor_reset
+ *
+ * @brief Sensor side, after the loop has been away from the sensors (a
+ * capture): start the window again, so the gap isn't taken for a late
+ * subpage, and skip the first subpages as after a change.
+ */
+void governor_reset(void);
+/*
+ * governor_get_state
+ *
+ * @brief Snapshot of what the governor settled on and why.
+ */
+void governor_get_state(governor_state_t *state);
+
+#endif
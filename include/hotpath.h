@@ -0,0 +1,26 @@
+/*
+ * hotpath.h
+ *
+ * @brief Tags the kernels that run every frame so they can be linked into
+ * SRAM instead of executing from flash through the XIP cache. Controlled by
+ * the THERMAL_CAMERA_HOT_IN_RAM CMake option; with it off everything stays in
+ * flash, which is handy for comparing the two with the benchmarks. With it
+ * on, the SDK's float and double wrappers go into SRAM too, so a kernel's
+ * libm and soft-float calls don't go back out to flash.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _HOTPATH_H
+#define _HOTPATH_H
+
+#include "pico/stdlib.h"
+
+#if THERMAL_CAMERA_HOT_IN_RAM
+#define HOT_FUNC(f) __not_in_flash_func(f)
+#else
+#define HOT_FUNC(f) f
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * logger.h
+ *
+ * @brief History for cameras left on their own: per-sensor To statistics
+ * (min, max, mean and where the hottest pixel was) over each period, and
+ * in "frames" mode a raw frame per sensor per period through frame_codec.h,
+ * kept in a flash_log.h ring in the top of the Pico's flash. Each boot adds
+ * a boot record and the sensors' EEPROM dumps, so logged frames can be
+ * calculated later (tools/log_decode).
+ *
+ * The sensor loop (core0) only queues records. The flash is written from
+ * the same loop, between subpages: a page program or sector erase is only
+ * started when the time it takes fits before the next subpage is due,
+ * going by the interval logger_frame has been seeing, so a read is never
+ * held up. While the flash is busy core1 is paused (flash_safe_execute),
+ * which the display rides out.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _LOGGER_H
+#define _LOGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+/*
+ * @brief Worst cases the scheduling allows for, the W25Q16 on the Pico W
+ * takes about 0.4ms to program a page and 45ms to erase a sector. An erase
+ * only fits between subpages up to 8Hz or so; faster than that, records
+ * queue up until the queue is nearly full, and then the erase is done
+ * anyway, at the cost of a subpage or so.
+ */
+#define LOGGER_PROGRAM_US 1000
+#define LOGGER_ERASE_US 60000
+/*
+ * @brief A partly filled page still goes to flash after this long.
+ */
+#define LOGGER_FLUSH_MS 30000
+
+typedef enum {
+  LOGGER_OFF,
+  LOGGER_STATS,   // statistics each period
+  LOGGER_FRAMES,  // and a raw frame per sensor
+} logger_mode_t;
+
+/*
+ * logger_init
+ *
+ * @brief Pick up the log where it left off, add a boot record and register
+ * the "log" console command. Run before the sensors are set up, so their
+ * EEPROM dumps go in.
+ */
+void logger_init(logger_mode_t mode, uint32_t period_ms);
+/*
+ * logger_eeprom
+ *
+ * @brief Log a sensor's EEPROM dump, after sensor_init. May wait for the
+ * flash, it's only done at start-up.
+ */
+void logger_eeprom(uint8_t sensor, const uint16_t *ee_data);
+/*
+ * logger_frame
+ *
+ * @brief Once a sensor's subpage is calculated: fold it into the period's
+ * statistics, and log it if a frame is due.
+ */
+void logger_frame(uint8_t sensor, uint32_t time_us, const uint16_t *frame_data, const float *temps);
+/*
+ * logger_service
+ *
+ * @brief From the sensor loop: write to the flash if there is time before
+ * the next subpage.
+ */
+void logger_service(void);
+
+#endif
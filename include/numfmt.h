@@ -0,0 +1,38 @@
+/*
+ * numfmt.h
+ *
+ * @brief Integer-only number formatting for the HUD. The RP2040 has no FPU,
+ * so going through snprintf's %f path every frame is far more expensive than
+ * formatting a pre-scaled fixed-point integer by hand.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _NUMFMT_H
+#define _NUMFMT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * numfmt_float_to_fixed
+ *
+ * @brief Convert a float to a fixed-point integer with the given number of
+ * decimal places, rounding half away from zero. Saturates on overflow and
+ * maps NaN to 0.
+ */
+int32_t numfmt_float_to_fixed(float f, unsigned int decimals);
+/*
+ * numfmt_fixed
+ *
+ * @brief Format the fixed-point value (value / 10^decimals) into buf the way
+ * printf("% *.*f") would: right-aligned to width, with a leading space in
+ * place of the sign for non-negative values when sign_space is set.
+ *
+ * @return The number of characters written, not counting the terminating NUL.
+ */
+size_t numfmt_fixed(char *buf, size_t len, int32_t value, unsigned int decimals, unsigned int width, bool sign_space);
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * sensor.h
+ *
+ * @brief One MLX90640 and everything that goes with it: which bus and
+ * address it answers on, its calibration, and its raw and To buffers. Any
+ * number of them can be read from the same loop; each one free-runs, so
+ * they all integrate at the same time and only the reads take turns.
+ *
+ * Frames from several sensors are handled as one panorama: sensor k's To
+ * is MLX90640_PIXEL_NUM floats at k * MLX90640_PIXEL_NUM, and the images
+ * sit side by side along the sensors' x axes, sensor 0 on the A side (see
+ * st7789.c). Neighbours may see the same overlap columns, which are then
+ * taken from the lower numbered sensor.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _SENSOR_H
+#define _SENSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "mlx90640/MLX90640_API.h"
+
+/*
+ * @brief How many sensors make up a frame, and how many columns each one
+ * shares with the one before it.
+ */
+#ifndef THERMAL_CAMERA_SENSORS
+#define THERMAL_CAMERA_SENSORS 1
+#endif
+#ifndef THERMAL_CAMERA_PANORAMA_OVERLAP
+#define THERMAL_CAMERA_PANORAMA_OVERLAP 0
+#endif
+// a panorama this wide is as much as st7789_render_scale takes
+#define SENSOR_MAX 4
+#if THERMAL_CAMERA_SENSORS < 1 || THERMAL_CAMERA_SENSORS > SENSOR_MAX
+#error "THERMAL_CAMERA_SENSORS must be 1 to SENSOR_MAX"
+#endif
+
+/*
+ * @brief Floats in a panorama frame, and its width in sensor columns once
+ * the overlap is cut out.
+ */
+#define SENSOR_PANORAMA_PIXELS(n) ((n) * MLX90640_PIXEL_NUM)
+#define SENSOR_PANORAMA_W(n, overlap) (MLX90640_LINE_SIZE + ((n) - 1) * (MLX90640_LINE_SIZE - (overlap)))
+
+/*
+ * @brief After this many failed reads in a row, only try again every
+ * SENSOR_RETRY_US instead of straight away.
+ */
+#define SENSOR_RETRY_AFTER 3
+#define SENSOR_RETRY_US 100000
+
+/*
+ * @brief sensor_init's goes at setting a sensor up before giving up, and
+ * how long to leave one that didn't come up before trying again.
+ */
+#define SENSOR_INIT_TRIES 3
+#define SENSOR_INIT_RETRY_US 1000000
+
+typedef struct {
+  uint32_t nack;        // the sensor didn't answer
+  uint32_t timeout;     // the bus hung
+  uint32_t frame;       // pixel data failed ValidateFrameData
+  uint32_t aux;         // aux data failed ValidateAuxData
+  uint32_t other;
+  uint32_t recoveries;  // bus clears and re-syncs after a NACK or timeout
+} sensor_errors_t;
+
+typedef struct {
+  uint8_t slave_addr;  // bus and address, see MLX90640_I2C_ADDR
+  bool ok;             // calibration read, taking part in frames
+  int subpage;         // subpage of the last read
+  uint32_t frame_time_us;
+  uint32_t subpages;   // subpages read
+  uint32_t errors;     // failed reads
+  sensor_errors_t error_counts;
+  uint32_t errors_in_row;
+  uint32_t retry_at_us;  // when a sensor that keeps failing, or didn't come up, gets tried again
+  float *temps;        // To lands here, MLX90640_PIXEL_NUM floats
+  paramsMLX90640 params;
+  uint16_t frame_data[MLX90640_PIXEL_NUM + 64 + 2];
+} sensor_t;
+
+/*
+ * sensor_init
+ *
+ * @brief Set up the sensor at slave_addr: chess mode, the refresh rate,
+ * and its calibration from EEPROM. Run with the bus at 400kHz, which the
+ * EEPROM needs. Tries SENSOR_INIT_TRIES times, clearing the bus in
+ * between; returns false if none of them got through, which also leaves
+ * s->ok false and s->retry_at_us SENSOR_INIT_RETRY_US from now.
+ */
+bool sensor_init(sensor_t *s, uint8_t slave_addr, uint8_t rate, float *temps);
+/*
+ * sensor_eeprom
+ *
+ * @brief The MLX90640_EEPROM_DUMP_NUM words of EEPROM the last sensor_init
+ * read, which are only good until the next sensor_init.
+ */
+const uint16_t *sensor_eeprom(void);
+/*
+ * sensor_can_read
+ *
+ * @brief False while a sensor that keeps failing is being left alone.
+ */
+bool sensor_can_read(const sensor_t *s);
+/*
+ * sensor_data_ready
+ *
+ * @brief Whether a new subpage is waiting (1 or 0), from a single status
+ * read, or a negative MLX90640 error. A failed read is counted and
+ * recovered from as in sensor_read, and counts towards backing off.
+ */
+int sensor_data_ready(sensor_t *s);
+/*
+ * sensor_read
+ *
+ * @brief Read the waiting subpage. Returns it (0 or 1), or a negative
+ * MLX90640 error. A NACK or timeout clears the bus and re-syncs the
+ * sensor before returning, so the next subpage can be read as usual; a
+ * garbled frame is only dropped.
+ */
+int sensor_read(sensor_t *s);
+/*
+ * sensor_set_step_mode
+ *
+ * @brief In step mode the sensor only measures when triggered
+ * (MLX90640_TriggerMeasurement) instead of free-running.
+ */
+int sensor_set_step_mode(sensor_t *s, bool step);
+/*
+ * sensor_error_name
+ *
+ * @brief Short name of a sensor_read error, for logs.
+ */
+const char *sensor_error_name(int error);
+/*
+ * sensor_calculate
+ *
+ * @brief To for the pixels of the subpage just read, into s->temps.
+ */
+void sensor_calculate(sensor_t *s, float emissivity);
+
+#endif
@@ -28,6 +28,15 @@
 #define RED   RGB565(255, 0,   0)
 #define BLUE  RGB565(0,   0,   255)
 
+/*
+ * @brief Pixel format the st7789 is fed in (COLMOD, datasheet: p 224).
+ * RGB444 packs two pixels into three bytes, a quarter less on the wire.
+ */
+typedef enum {
+  ST7789_PIXEL_FORMAT_RGB565,
+  ST7789_PIXEL_FORMAT_RGB444,
+} st7789_pixel_format_t;
+
 // command definitions (source: Shifeng Li <https://github.com/libdriver/st7789/blob/main/src/driver_st7789.c#L61-L124>)
 #define ST7789_CMD_NOP             0x00        // no operation command
 #define ST7789_CMD_SWRESET         0x01        // software reset command
@@ -94,16 +103,162 @@
 #define ST7789_CMD_NVMSET          0xFC        // nvm setting command
 #define ST7789_CMD_PROMACT         0xFE        // program action command
 
+/*
+ * @brief A recorded sequence of command and data segments that goes out to
+ * the st7789 under a single chip select. Commands and small parameters are
+ * copied into the list; bulk data is referenced and must stay alive (and
+ * unmodified) until st7789_cmdlist_execute returns. Don't copy a list once
+ * something has been recorded into it.
+ */
+#define ST7789_CMDLIST_MAX_SEGMENTS 16
+#define ST7789_CMDLIST_INLINE_SIZE 32
+
+typedef struct {
+  bool dc;           // false for command, true for data
+  uint8_t bits;      // spi frame size, 8 or 16
+  const void *buf;
+  size_t len;        // in frames, not bytes
+} st7789_segment_t;
+
+typedef struct {
+  st7789_segment_t segments[ST7789_CMDLIST_MAX_SEGMENTS];
+  size_t n_segments;
+  uint8_t inline_buf[ST7789_CMDLIST_INLINE_SIZE];
+  size_t inline_len;
+} st7789_cmdlist_t;
+
 /*
  * st7789_init
  *
  * @brief Initialize the screen.
  */
 void st7789_init(void);
+/*
+ * st7789_set_refresh_rate
+ *
+ * @brief Set the panel refresh rate (FRCTRL2) to the supported rate closest
+ * to hz, 23 to 119Hz, and return that rate. Below 39Hz the porches
+ * (PORCTRL) are lengthened.
+ */
+uint st7789_set_refresh_rate(uint hz);
+/*
+ * st7789_te_enable
+ *
+ * @brief Turn the tearing effect output on (one pulse per V-blank) and
+ * track its rising edges on the TE pin, or turn it back off.
+ */
+void st7789_te_enable(bool enable);
+/*
+ * st7789_wait_vsync
+ *
+ * @brief Block until the next V-blank pulse. Returns false if none came
+ * within timeout_us, e.g. TE is off or not wired up.
+ */
+bool st7789_wait_vsync(uint32_t timeout_us);
+/*
+ * st7789_set_idle
+ *
+ * @brief Something to run over and over while a flush waits on its DMA or
+ * on V-blank, on the core drawing, or NULL for nothing. It holds up the
+ * next chunk, so it has to be quick.
+ */
+void st7789_set_idle(void (*idle)(void));
+/*
+ * st7789_refresh_period_us
+ *
+ * @brief Measured time between the last two V-blank pulses, 0 until two
+ * have been seen.
+ */
+uint32_t st7789_refresh_period_us(void);
+/*
+ * st7789_cmdlist_init
+ *
+ * @brief Reset a command list to empty.
+ */
+void st7789_cmdlist_init(st7789_cmdlist_t *cl);
+/*
+ * st7789_cmdlist_command
+ *
+ * @brief Record a command byte followed by its parameters.
+ */
+bool st7789_cmdlist_command(st7789_cmdlist_t *cl, uint8_t cmd, const uint8_t *params, size_t n_params);
+/*
+ * st7789_cmdlist_window
+ *
+ * @brief Record CASET and RASET for the window with corners (x0,y0) and (x1,y1).
+ */
+bool st7789_cmdlist_window(st7789_cmdlist_t *cl, uint x0, uint y0, uint x1, uint y1);
+/*
+ * st7789_cmdlist_data
+ *
+ * @brief Record a reference to a byte payload.
+ */
+bool st7789_cmdlist_data(st7789_cmdlist_t *cl, const uint8_t *buf, size_t len);
+/*
+ * st7789_cmdlist_data_words
+ *
+ * @brief Record a reference to len RGB565 words, sent big-endian as 16-bit frames.
+ */
+bool st7789_cmdlist_data_words(st7789_cmdlist_t *cl, const uint16_t *buf, size_t len);
+/*
+ * st7789_cmdlist_ramwr
+ *
+ * @brief Record RAMWR, preceded by COLMOD if the panel isn't already taking
+ * pixels in format. The panel's format is tracked as lists are recorded,
+ * so execute the list before recording another.
+ */
+bool st7789_cmdlist_ramwr(st7789_cmdlist_t *cl, st7789_pixel_format_t format);
+/*
+ * st7789_cmdlist_execute
+ *
+ * @brief Send the whole list in one transaction, toggling DC only between
+ * command and data segments. Long payloads go out over DMA.
+ */
+void st7789_cmdlist_execute(const st7789_cmdlist_t *cl);
+/*
+ * st7789_stream_begin
+ *
+ * @brief Open a RAMWR of pixels in format into the window with corners
+ * (x0,y0) and (x1,y1) and keep the chip selected, so pixel data can follow
+ * in chunks.
+ */
+void st7789_stream_begin(uint x0, uint y0, uint x1, uint y1, st7789_pixel_format_t format);
+/*
+ * st7789_stream_begin_scan
+ *
+ * @brief Like st7789_stream_begin for the whole screen, taking pixels in
+ * the order the panel scans them out: column by column, x = 0 first (or
+ * x = ST7789_LINE_SIZE-1 if reversed), each top to bottom. One RAMWR, so
+ * a flush can run behind the scan. st7789_stream_end puts the usual
+ * addressing back.
+ */
+void st7789_stream_begin_scan(st7789_pixel_format_t format, bool reversed);
+/*
+ * st7789_stream_data
+ *
+ * @brief Queue a chunk of pixel data (bits is the spi frame size, 8 or 16)
+ * behind the previous one. Returns as soon as the chunk's DMA has started,
+ * so buf must stay untouched until the next st7789_stream_data or
+ * st7789_stream_end call returns.
+ */
+void st7789_stream_data(const void *buf, size_t len, uint bits);
+/*
+ * st7789_stream_end
+ *
+ * @brief Wait for the last chunk to go out and release the chip.
+ */
+void st7789_stream_end(void);
+/*
+ * st7789_pack_rgb444
+ *
+ * @brief Pack n RGB565 pixels into RGB444 as the st7789 takes it over 8-bit
+ * frames, two pixels per three bytes. dst needs room for (3n+1)/2 bytes.
+ */
+void st7789_pack_rgb444(uint8_t *dst, const uint16_t *src, size_t n);
 /*
  * st7789_write_data_words
  *
- * @brief Mutate buffer into big-endian and send to st7789_write_data.
+ * @brief Send words to the st7789 big-endian. The buffer is left untouched.
  */
 void st7789_write_data_words(uint16_t *buf, uint len);
 /*
@@ -145,9 +300,21 @@ void st7789_loading_ani_tick(void);
 /*
  * st7789_fill_32_24
  *
- * @brief Fill the entire screen given frame data from the MLX90640.
+ * @brief Fill the entire screen given frame data from the MLX90640. The
+ * color scale runs from the coldest finite pixel to the hottest; a flat
+ * scene is drawn all in the coldest color.
  */
 void st7789_fill_32_24(float *frame);
+/*
+ * st7789_fill_panorama
+ *
+ * @brief Like st7789_fill_32_24 for a frame from n_sensors sensors side by
+ * side, neighbours sharing overlap columns, laid out as in sensor.h. Up to
+ * THERMAL_CAMERA_SENSORS of them. A sensor whose pixels are all NaN or inf,
+ * such as one that never came up, is left out of the scale and drawn as
+ * no data.
+ */
+void st7789_fill_panorama(float *frame, uint n_sensors, uint overlap);
 /*
  * st7789_fill_circ
  *
@@ -3,7 +3,8 @@
  *
  * @brief Supports buffering of frames to the ST7789 display. This file expects
  * that the user have an extra 153kB to play around with. Otherwise, do not do
- * frame buffering.
+ * frame buffering, or build with ST7789_FRAMEBUF_INDEXED, which keeps one
+ * palette index per pixel (76.8kB) and expands to RGB565 while flushing.
  *
  * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
  * Licensed under the Apache License, Version 2.0.
@@ -14,6 +15,23 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include "pico/stdlib.h"
+#include "st7789.h"
+
+#if ST7789_FRAMEBUF_INDEXED
+/*
+ * @brief In indexed mode a pixel is an index into a 256 entry RGB565
+ * palette. The draw routines still take RGB565 colors and hand out palette
+ * entries for them; the first ST7789_FRAMEBUF_PALETTE_RESERVED entries are
+ * left for st7789_framebuf_set_palette, so content drawn with them (the
+ * heatmap) can be recolored without drawing it again.
+ */
+typedef uint8_t st7789_pixel_t;
+#define ST7789_FRAMEBUF_PALETTE_SIZE 256
+#define ST7789_FRAMEBUF_PALETTE_RESERVED 32
+#else
+typedef uint16_t st7789_pixel_t;
+#endif
 
 /*
  * st7789_framebuf_flush
@@ -21,6 +39,48 @@
  * @brief Flush the frame buffer by writing to the st7789.
  */
 void st7789_framebuf_flush(void);
+/*
+ * st7789_framebuf_set_pixel_format
+ *
+ * @brief Choose the format st7789_framebuf_flush sends pixels to the panel
+ * in. RGB444 moves 25% fewer bytes, packing each line on the way out.
+ * Defaults to RGB444 when built with ST7789_FRAMEBUF_RGB444, else RGB565.
+ */
+void st7789_framebuf_set_pixel_format(st7789_pixel_format_t format);
+/*
+ * st7789_framebuf_get_pixel_format
+ *
+ * @brief Format st7789_framebuf_flush currently sends pixels in.
+ */
+st7789_pixel_format_t st7789_framebuf_get_pixel_format(void);
+/*
+ * st7789_framebuf_set_paced
+ *
+ * @brief Pace flushes to the panel refresh: wait for V-blank (see
+ * st7789_te_enable) and write in scan order, so the write stays ahead of the
+ * scan whenever a flush fits in one refresh period.
+ */
+void st7789_framebuf_set_paced(bool paced);
+/*
+ * st7789_framebuf_last_flush_us
+ *
+ * @brief How long the last flush spent writing, not counting the wait for V-blank.
+ */
+uint32_t st7789_framebuf_last_flush_us(void);
+/*
+ * st7789_framebuf_set_palette
+ *
+ * @brief Set reserved palette entries first..first+n-1 (indexed mode only,
+ * otherwise a no-op). Takes effect on the next flush.
+ */
+void st7789_framebuf_set_palette(uint first, const uint16_t *colors, size_t n);
+/*
+ * st7789_framebuf_expand
+ *
+ * @brief Write the RGB565 value of n frame buffer pixels, starting at pixel
+ * first (row-major), to dst.
+ */
+void st7789_framebuf_expand(uint16_t *dst, size_t first, size_t n);
 /*
  * st7789_framebuf_draw_pixel
  *
@@ -36,9 +96,17 @@ void st7789_framebuf_set_window(size_t x0, size_t y0, size_t x1, size_t y1);
 /*
  * st7789_framebuf_write_data_words
  *
- * @brief Set the window of the frame buffer. Intended to be a drop-in replacement for st7789_set_window.
+ * @brief Write words into the window row by row, like RAMWR does on the
+ * st7789. Intended to be a drop-in replacement for st7789_write_data_words.
  */
 void st7789_framebuf_write_data_words(uint16_t *words, size_t len);
+/*
+ * st7789_framebuf_blit
+ *
+ * @brief Copy a w by h block of frame buffer pixels to (x0,y0). Rows in src are
+ * src_stride pixels apart. The block is clipped to the screen.
+ */
+void st7789_framebuf_blit(uint x0, uint y0, uint w, uint h, const st7789_pixel_t *src, size_t src_stride);
 /*
  * st7789_framebuf_write_char
  *
@@ -60,7 +128,7 @@ void st7789_framebuf_draw_line(uint x0, uint y0, uint x1, uint y1, uint16_t colo
 /*
  * st7789_framebuf_fill_rect
  *
- * @brief Fill a rect in the framebuffer.
+ * @brief Fill a rect in the framebuffer. Both corners are inclusive.
  */
 void st7789_framebuf_fill_rect(uint x0, uint y0, uint x1, uint y1, uint16_t color);
 
@@ -0,0 +1,52 @@
+/*
+ * st7789_render.h
+ *
+ * @brief Heatmap render backend: maps temperatures to palette colors and
+ * upscales the small sensor image into the frame buffer. On the RP2040 the
+ * palette lookup and the source stepping run on the per-core interpolators;
+ * everywhere else a plain C path with the exact same arithmetic is used, so
+ * the two produce bit-identical output. Images and palettes are in frame
+ * buffer pixels, so in indexed mode the palette holds palette indices.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _ST7789_RENDER_H
+#define _ST7789_RENDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/stdlib.h"
+#include "st7789_framebuf.h"
+
+/*
+ * @brief Fractional bits of the fixed-point palette index and source coordinates.
+ */
+#define ST7789_RENDER_FRAC_BITS 16
+
+/*
+ * @brief Widest source image st7789_render_scale accepts.
+ */
+#define ST7789_RENDER_MAX_SRC_W 128
+
+/*
+ * st7789_render_map
+ *
+ * @brief For each i < n, set dst[i] to the palette color of src[order[i]],
+ * where min_temp maps to palette[0] and max_temp to palette[n_colors-1].
+ * order may be NULL for the identity. n_colors must be at most 256.
+ * Temperatures past either end, inf among them, take that end's color;
+ * NaN takes palette[0], as does everything if max_temp <= min_temp.
+ */
+void st7789_render_map(const float *src, const uint16_t *order, size_t n, float min_temp, float max_temp, const st7789_pixel_t *palette, size_t n_colors, st7789_pixel_t *dst);
+/*
+ * st7789_render_scale
+ *
+ * @brief Nearest-neighbour upscale of a src_w by src_h image into the frame
+ * buffer rect at (x0,y0) of size dst_w by dst_h. Each distinct output row is
+ * only computed once and then blitted as many times as it repeats.
+ */
+void st7789_render_scale(const st7789_pixel_t *src, uint src_w, uint src_h, uint x0, uint y0, uint dst_w, uint dst_h);
+
+#endif
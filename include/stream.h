@@ -0,0 +1,93 @@
+/*
+ * stream.h
+ *
+ * @brief Streams frames to a host over USB CDC, framed as in
+ * stream_proto.h. The sensor loop (core0) only copies each frame into a
+ * queue and never waits: when the queue is full the frame is dropped and
+ * counted. Core1 spends the time between display ticks running the USB
+ * stack, encoding packed frames and feeding the queue to the CDC endpoint.
+ * The console and printf stay on the UART, so the USB link only ever
+ * carries frames.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "stream_proto.h"
+
+/*
+ * @brief Frames the queue holds; with a sensor at 16Hz that is a quarter
+ * second of slack on the link.
+ */
+#define STREAM_QUEUE_LEN 4
+
+typedef enum {
+  STREAM_OFF,
+  STREAM_TO,      // To values, as published to the display
+  STREAM_RAW,     // frame data as read, for calculating on the host
+  STREAM_PACKED,  // frame data through frame_codec.h, about a fifth the size
+} stream_mode_t;
+
+typedef struct {
+  uint32_t queued;        // frames handed to the queue
+  uint32_t dropped;       // frames that found the queue full, or were queued when the host went
+  uint32_t sent;          // messages completely written to the endpoint
+  uint64_t bytes;         // bytes written to the endpoint
+  uint32_t packed;        // frames encoded, in STREAM_PACKED
+  uint64_t packed_bytes;  // what they came to
+  uint64_t packed_us;     // time spent encoding them, on core1
+} stream_stats_t;
+
+/*
+ * stream_init
+ *
+ * @brief Core0 side: set up the queue and register the "stream" console
+ * command. Nothing goes out until core1 calls stream_service.
+ */
+void stream_init(stream_mode_t mode);
+/*
+ * stream_set_eeprom
+ *
+ * @brief Core0 side, after sensor_init: keep a copy of the sensor's
+ * EEPROM dump, which goes to each host that opens the port before any
+ * frame, so raw frames can be calculated (or recorded) over there.
+ */
+void stream_set_eeprom(uint8_t sensor, const uint16_t *ee_data);
+/*
+ * stream_frame
+ *
+ * @brief Core0 side, once a sensor's subpage is calculated: queue it in the
+ * current mode. Returns false if it was dropped. Does nothing while off or
+ * while no host has the port open.
+ */
+bool stream_frame(uint8_t sensor, int subpage, uint32_t time_us, const uint16_t *frame_data, const float *temps);
+/*
+ * stream_service
+ *
+ * @brief Core1 side: one pass of the USB stack, handing the endpoint what
+ * it takes of the frame going out. Quick enough to run while the display
+ * waits on a flush (st7789_set_idle). Starts the USB stack on the first
+ * call.
+ */
+void stream_service(void);
+/*
+ * stream_service_until
+ *
+ * @brief Core1 side: stream_service over and over until time_us_64()
+ * reaches until_us.
+ */
+void stream_service_until(uint64_t until_us);
+/*
+ * stream_get_stats
+ *
+ * @brief Counters since start-up.
+ */
+void stream_get_stats(stream_stats_t *stats);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * stream_proto.h
+ *
+ * @brief Framing for frames streamed to a host. Each message is a fixed
+ * header, a payload and a CRC-32:
+ *
+ * | offset | size | field                                     |
+ * |--------|------|-------------------------------------------|
+ * | 0      | 4    | magic, "TCAM"                             |
+ * | 4      | 1    | version, STREAM_PROTO_VERSION             |
+ * | 5      | 1    | type, stream_msg_type_t                   |
+ * | 6      | 1    | sensor index                              |
+ * | 7      | 1    | subpage                                   |
+ * | 8      | 4    | sequence number, per stream               |
+ * | 12     | 4    | time_us, when the sensor finished it      |
+ * | 16     | 2    | payload length                            |
+ * | 18     | 2    | reserved, 0                               |
+ * | 20     | n    | payload                                   |
+ * | 20 + n | 4    | CRC-32 (IEEE) of bytes 4 to 20 + n - 1    |
+ *
+ * Everything is little-endian, floats are IEEE 754 singles. A reader that
+ * loses sync looks for the next magic. Plain C with no SDK dependencies so
+ * the host tools share it.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _STREAM_PROTO_H
+#define _STREAM_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_PROTO_VERSION 1
+#define STREAM_PROTO_HEADER_SIZE 20
+#define STREAM_PROTO_CRC_SIZE 4
+/*
+ * @brief Largest payload, one sensor's To values.
+ */
+#define STREAM_PROTO_MAX_PAYLOAD (768 * 4)
+#define STREAM_PROTO_EEPROM_WORDS 832
+#define STREAM_PROTO_MAX_MSG (STREAM_PROTO_HEADER_SIZE + STREAM_PROTO_MAX_PAYLOAD + STREAM_PROTO_CRC_SIZE)
+
+typedef enum {
+  // the 834 words MLX90640_GetFrameData read, calibration not applied
+  STREAM_MSG_RAW = 1,
+  // the 768 To values in degrees C, as published to the display
+  STREAM_MSG_TO = 2,
+  // STREAM_MSG_RAW through frame_codec.h, decoded in order per sensor
+  STREAM_MSG_RAW_PACKED = 3,
+  // a sensor's 832 words of calibration EEPROM, sent once each time a host
+  // opens the port, before any frame; seq is 0 and doesn't count
+  STREAM_MSG_EEPROM = 4,
+} stream_msg_type_t;
+
+typedef struct {
+  uint8_t type;
+  uint8_t sensor;
+  uint8_t subpage;
+  uint32_t seq;
+  uint32_t time_us;
+  uint16_t payload_len;
+} stream_header_t;
+
+typedef enum {
+  STREAM_PARSE_OK,
+  // not enough bytes yet for a whole message, read more
+  STREAM_PARSE_MORE,
+  // not a message at the start of the buffer, skip consumed bytes and retry
+  STREAM_PARSE_SKIP,
+  // a whole message whose CRC doesn't match, skip consumed bytes
+  STREAM_PARSE_BAD_CRC,
+} stream_parse_t;
+
+/*
+ * stream_proto_crc32
+ *
+ * @brief CRC-32 (IEEE 802.3, as zlib) of n bytes, continuing from crc (0
+ * to start).
+ */
+uint32_t stream_proto_crc32(uint32_t crc, const void *data, size_t n);
+/*
+ * stream_proto_encode
+ *
+ * @brief Write a whole message for h and its payload (h->payload_len bytes)
+ * to out, which has room for cap bytes. Returns the message length, or 0 if
+ * it doesn't fit.
+ */
+size_t stream_proto_encode(const stream_header_t *h, const void *payload, uint8_t *out, size_t cap);
+/*
+ * stream_proto_parse
+ *
+ * @brief Look for a message at the start of buf. On STREAM_PARSE_OK, h and
+ * payload describe it; in every case but STREAM_PARSE_MORE, consumed is how
+ * many bytes to drop from the front of buf before parsing again.
+ */
+stream_parse_t stream_proto_parse(const uint8_t *buf, size_t len, stream_header_t *h, const uint8_t **payload, size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
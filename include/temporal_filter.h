@@ -0,0 +1,71 @@
+/*
+ * temporal_filter.h
+ *
+ * @brief Per-pixel exponential moving average over the To frames, to take
+ * the flicker out of a still scene. The average is kept in fixed point and
+ * its weight adapts to motion: the further a pixel moves from its average,
+ * the more the new value counts, up to taking it as it is once the change
+ * passes the threshold. So noise is smoothed while real changes come
+ * through without a trail.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _TEMPORAL_FILTER_H
+#define _TEMPORAL_FILTER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_sched.h"
+
+#define TEMPORAL_FILTER_MAX_PIXELS FRAME_SCHED_PIXELS
+
+/*
+ * @brief Defaults: weight of a new value when nothing moves, and the change
+ * in degrees C past which it is taken as it is.
+ */
+#define TEMPORAL_FILTER_ALPHA 0.25f
+#define TEMPORAL_FILTER_THRESHOLD 1.5f
+
+/*
+ * temporal_filter_init
+ *
+ * @brief Set up with the defaults and register the "filter" console
+ * command. enabled is whether it starts on.
+ */
+void temporal_filter_init(bool enabled);
+/*
+ * temporal_filter_set
+ *
+ * @brief Change the weight of a new value in a still scene (0 to 1) and the
+ * change in degrees C past which it is taken as it is. Out of range values
+ * are clamped.
+ */
+void temporal_filter_set(float alpha, float threshold);
+/*
+ * temporal_filter_enable
+ *
+ * @brief Turn the filter on or off. Turning it on starts every pixel over
+ * from its next value.
+ */
+void temporal_filter_enable(bool enabled);
+bool temporal_filter_enabled(void);
+/*
+ * temporal_filter_reset
+ *
+ * @brief Forget the averages, the next value of every pixel is taken as it
+ * is.
+ */
+void temporal_filter_reset(void);
+/*
+ * temporal_filter_apply
+ *
+ * @brief Filter frame[first] to frame[first + n - 1] in place, right after
+ * MLX90640_CalculateTo wrote them. Pixels the subpage didn't update still
+ * hold their filtered value and so come out unchanged. Does nothing while
+ * the filter is off.
+ */
+void temporal_filter_apply(float *frame, size_t first, size_t n);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * tusb_config.h
+ *
+ * @brief TinyUSB configuration for the frame stream: a full speed device
+ * with a single CDC interface, see stream.h. Only used when
+ * THERMAL_CAMERA_STREAM is on.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _TUSB_CONFIG_H
+#define _TUSB_CONFIG_H
+
+#define CFG_TUSB_RHPORT0_MODE (OPT_MODE_DEVICE)
+#define CFG_TUSB_OS OPT_OS_PICO
+
+#define CFG_TUD_ENDPOINT0_SIZE 64
+
+#define CFG_TUD_CDC 1
+#define CFG_TUD_MSC 0
+#define CFG_TUD_HID 0
+#define CFG_TUD_MIDI 0
+#define CFG_TUD_VENDOR 0
+
+// nothing is read from the host, so keep RX small; TX holds a couple of
+// To frames, so a pass of stream_service can hand a whole one over while
+// the last is still going out
+#define CFG_TUD_CDC_RX_BUFSIZE 64
+#define CFG_TUD_CDC_TX_BUFSIZE 8192
+// bytes per bulk transfer, which the controller splits into 64-byte full
+// speed packets: each pass queues eight packets rather than one
+#define CFG_TUD_CDC_EP_BUFSIZE 512
+
+#endif
@@ -29,6 +29,8 @@
 #define MLX90640_EEPROM_DATA_ERROR 7
 #define MLX90640_FRAME_DATA_ERROR 8
 #define MLX90640_MEAS_TRIGGER_ERROR 9
+#define MLX90640_I2C_TIMEOUT_ERROR 10
+#define MLX90640_AUX_DATA_ERROR 11
 
 #define BIT_MASK(x) (1UL << (x))
 #define REG_MASK(sbit,nbits) ~((~(~0UL << (nbits))) << (sbit))
@@ -49,9 +51,17 @@
 #define MLX90640_GET_FRAME(reg_value) (reg_value & MLX90640_STAT_FRAME_MASK)
 #define MLX90640_STAT_DATA_READY_MASK BIT_MASK(3) 
 #define MLX90640_GET_DATA_READY(reg_value) (reg_value & MLX90640_STAT_DATA_READY_MASK)
+#define MLX90640_STAT_OVERWRITE_MASK BIT_MASK(4)
+#define MLX90640_STAT_START_MASK BIT_MASK(5) 
+// clears data ready, overwrite on. INIT_STATUS_VALUE also sets the start
+// bit, which in step mode starts the next measurement on every clear
+#define MLX90640_CLEAR_STATUS_VALUE MLX90640_STAT_OVERWRITE_MASK
+// starts a measurement in step mode, see MLX90640_TriggerMeasurement
+#define MLX90640_START_STATUS_VALUE (MLX90640_STAT_START_MASK | MLX90640_STAT_OVERWRITE_MASK)
 
 #define MLX90640_CTRL_REG 0x800D
 #define MLX90640_CTRL_TRIG_READY_MASK BIT_MASK(15) 
+#define MLX90640_CTRL_STEP_MODE_MASK BIT_MASK(1)
 #define MLX90640_CTRL_REFRESH_SHIFT 7
 #define MLX90640_CTRL_REFRESH_MASK REG_MASK(MLX90640_CTRL_REFRESH_SHIFT,3)
 #define MLX90640_CTRL_ENABLE_SUBPAGE_REPEAT_SHIFT 3
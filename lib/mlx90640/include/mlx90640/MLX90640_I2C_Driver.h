@@ -19,7 +19,41 @@
 
 #include <stdint.h>
 
+/*
+ * Addresses are 7 bits, so the top bit of the slaveAddr every call takes
+ * picks the bus: 0 for i2c0 (SDA 4, SCL 5), 1 for i2c1 (SDA 6, SCL 7).
+ * A bare 0x33 is the sensor on i2c0, as before.
+ */
+#define MLX90640_I2C_BUSES 2
+#define MLX90640_I2C_ADDR(bus, addr) ((uint8_t)(((bus) << 7) | ((addr) & 0x7F)))
+#define MLX90640_I2C_ADDR_BUS(slaveAddr) (((slaveAddr) >> 7) & 1)
+#define MLX90640_I2C_ADDR_DEVICE(slaveAddr) ((slaveAddr) & 0x7F)
+
+/*
+ * Per-bus counters, see MLX90640_I2CGetStats.
+ */
+typedef struct {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t nacks;       // the slave didn't ACK
+    uint32_t timeouts;    // took far longer than it should, e.g. a line held low
+    uint32_t recoveries;  // bus clears
+    uint32_t stuck;       // bus clears that didn't get both lines high
+} mlx90640_i2c_stats_t;
+
+    /*
+     * I2C general call reset on every bus in use. Every slave on a bus
+     * takes it, so it is no way to talk to one sensor. It doesn't clear a
+     * stuck bus, that is MLX90640_I2CBusRecover.
+     */
     int MLX90640_I2CGeneralReset(void);
+    /*
+     * Clock the bus slaveAddr is on free (up to 9 SCL pulses and a STOP) and
+     * start its controller over. Returns -MLX90640_I2C_TIMEOUT_ERROR if a
+     * line is still held low.
+     */
+    int MLX90640_I2CBusRecover(uint8_t slaveAddr);
+    void MLX90640_I2CGetStats(uint8_t bus, mlx90640_i2c_stats_t *stats);
     void MLX90640_I2CInit(void);
     int MLX90640_I2CRead(uint8_t slaveAddr,uint16_t startAddress, uint16_t nMemAddressRead, uint16_t *data);
     int MLX90640_I2CWrite(uint8_t slaveAddr,uint16_t writeAddress, uint16_t data);
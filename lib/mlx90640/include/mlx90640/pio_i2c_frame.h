@@ -0,0 +1,125 @@
+/*
+ * pio_i2c_frame.h
+ *
+ * @brief Builds the TX FIFO word stream the PIO I2C master (pio_i2c.pio)
+ * runs a transaction from, and decodes such a stream back into bus events
+ * so its framing can be checked. Plain C with no SDK dependencies, so the
+ * same code runs on the host as a protocol model.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PIO_I2C_FRAME_H_
+#define _PIO_I2C_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * @brief Fields of a TX FIFO word, see pio_i2c.pio.
+ */
+#define PIO_I2C_ICOUNT_LSB 10
+#define PIO_I2C_FINAL_LSB 9
+#define PIO_I2C_DATA_LSB 1
+#define PIO_I2C_NAK_LSB 0
+
+/*
+ * @brief The four entries of pio_i2c_set_scl_sda: "set pindirs, sda side scl
+ * [7]" with the optional side-set enabled. A 1 releases the line.
+ */
+#define PIO_I2C_SC0_SD0 0xF780
+#define PIO_I2C_SC0_SD1 0xF781
+#define PIO_I2C_SC1_SD0 0xFF80
+#define PIO_I2C_SC1_SD1 0xFF81
+
+typedef struct {
+  uint16_t *words;
+  size_t cap;
+  size_t len;
+  size_t n_bytes;  // data words, each of which pushes one byte to the RX FIFO
+  bool overflow;   // ran out of room, the frame is incomplete
+} pio_i2c_frame_t;
+
+typedef enum {
+  PIO_I2C_EVENT_START,
+  PIO_I2C_EVENT_RSTART,
+  PIO_I2C_EVENT_STOP,
+  PIO_I2C_EVENT_BYTE,
+} pio_i2c_event_type_t;
+
+typedef struct {
+  pio_i2c_event_type_t type;
+  uint8_t data;  // for bytes: what the master shifts out, 0xFF when reading
+  bool nak;      // for bytes: the master releases SDA during the ACK bit
+  bool final;    // for bytes: a NAK here ends the transfer instead of failing it
+} pio_i2c_event_t;
+
+/*
+ * pio_i2c_frame_init
+ *
+ * @brief Start an empty frame in words, which has room for cap entries.
+ */
+void pio_i2c_frame_init(pio_i2c_frame_t *f, uint16_t *words, size_t cap);
+/*
+ * pio_i2c_frame_start, pio_i2c_frame_repstart, pio_i2c_frame_stop
+ *
+ * @brief Append a START, repeated START or STOP condition.
+ */
+void pio_i2c_frame_start(pio_i2c_frame_t *f);
+void pio_i2c_frame_repstart(pio_i2c_frame_t *f);
+void pio_i2c_frame_stop(pio_i2c_frame_t *f);
+/*
+ * pio_i2c_frame_addr
+ *
+ * @brief Append the address byte for a 7-bit slave address.
+ */
+void pio_i2c_frame_addr(pio_i2c_frame_t *f, uint8_t addr, bool read);
+/*
+ * pio_i2c_frame_write
+ *
+ * @brief Append n bytes to write. If last, the final one may be NAKed.
+ */
+void pio_i2c_frame_write(pio_i2c_frame_t *f, const uint8_t *buf, size_t n, bool last);
+/*
+ * pio_i2c_frame_read
+ *
+ * @brief Append n bytes to read, ACKing all but the last, which is NAKed.
+ */
+void pio_i2c_frame_read(pio_i2c_frame_t *f, size_t n);
+/*
+ * pio_i2c_frame_mem_read
+ *
+ * @brief Append a whole read of n bytes from a 16-bit register address:
+ * START, write the register, repeated START, read, STOP. Returns the index
+ * in the RX byte stream where the data read starts.
+ */
+size_t pio_i2c_frame_mem_read(pio_i2c_frame_t *f, uint8_t addr, uint16_t reg, size_t n);
+/*
+ * pio_i2c_frame_mem_write
+ *
+ * @brief Append a whole write of n bytes to a 16-bit register address.
+ */
+void pio_i2c_frame_mem_write(pio_i2c_frame_t *f, uint8_t addr, uint16_t reg, const uint8_t *buf, size_t n);
+/*
+ * pio_i2c_frame_decode
+ *
+ * @brief Run words through a model of the state machine and write the bus
+ * events to events (room for cap). Returns the number of events, or -1 if
+ * the stream isn't something the state machine can run, with the reason in
+ * err.
+ */
+int pio_i2c_frame_decode(const uint16_t *words, size_t len, pio_i2c_event_t *events, size_t cap, char *err, size_t err_len);
+/*
+ * pio_i2c_frame_check
+ *
+ * @brief Check decoded events follow I2C framing: START first, an address
+ * byte after every (repeated) START, SDA released for the slave while
+ * writing and for the data while reading, reads ACKed except the last,
+ * Final only on the last byte of a transfer, and a STOP at the end.
+ * Returns 0, or -1 with the first violation in err.
+ */
+int pio_i2c_frame_check(const pio_i2c_event_t *events, size_t n, char *err, size_t err_len);
+
+#endif
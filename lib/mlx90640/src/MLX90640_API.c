@@ -20,6 +20,20 @@
 #include <stdio.h>
 #include <math.h>
 
+/*
+ * MLX90640_HOT_IN_RAM links the To calculation into SRAM on the RP2040 so it
+ * doesn't stall on XIP cache misses. Its per-pixel loop also calls sqrt and
+ * the double and float arithmetic helpers; the SDK wraps those onto the
+ * boot ROM, and the build puts the wrappers in SRAM as well
+ * (PICO_FLOAT_IN_RAM, PICO_DOUBLE_IN_RAM).
+ */
+#if MLX90640_HOT_IN_RAM
+#include "pico/platform.h"
+#define MLX90640_HOT_FUNC(f) __not_in_flash_func(f)
+#else
+#define MLX90640_HOT_FUNC(f) f
+#endif
+
 static void ExtractVDDParameters(uint16_t *eeData, paramsMLX90640 *mlx90640);
 static void ExtractPTATParameters(uint16_t *eeData, paramsMLX90640 *mlx90640);
 static void ExtractGainParameters(uint16_t *eeData, paramsMLX90640 *mlx90640);
@@ -51,8 +65,10 @@ int MLX90640_SynchFrame(uint8_t slaveAddr)
     uint16_t statusRegister;
     int error = 1;
     
-    error = MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_INIT_STATUS_VALUE);
-    if(error == -MLX90640_I2C_NACK_ERROR)
+    // without the start bit: in step mode this waits for a measurement
+    // MLX90640_TriggerMeasurement started
+    error = MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+    if(error != MLX90640_NO_ERROR)
     {
         return error;
     }
@@ -73,44 +89,14 @@ int MLX90640_SynchFrame(uint8_t slaveAddr)
 
 int MLX90640_TriggerMeasurement(uint8_t slaveAddr)
 {
-    int error = 1;
-    uint16_t ctrlReg;
-    
-    error = MLX90640_I2CRead(slaveAddr, MLX90640_CTRL_REG, 1, &ctrlReg);
-    
-    if ( error != MLX90640_NO_ERROR) 
-    {
-        return error;
-    }    
-                                                
-    ctrlReg |= MLX90640_CTRL_TRIG_READY_MASK;
-    error = MLX90640_I2CWrite(slaveAddr, MLX90640_CTRL_REG, ctrlReg);
-    
-    if ( error != MLX90640_NO_ERROR)
-    {
-        return error;
-    }    
-    
-    error = MLX90640_I2CGeneralReset();
-    
-    if ( error != MLX90640_NO_ERROR)
-    {
-        return error;
-    }    
-    
-    error = MLX90640_I2CRead(slaveAddr, MLX90640_CTRL_REG, 1, &ctrlReg);
-    
-    if ( error != MLX90640_NO_ERROR)
-    {
-        return error;
-    }    
-    
-    if ((ctrlReg & MLX90640_CTRL_TRIG_READY_MASK) != 0)
-    {
-        return -MLX90640_MEAS_TRIGGER_ERROR;
-    }
-    
-    return MLX90640_NO_ERROR;    
+    // start of measurement in the sensor's own status register, which also
+    // clears data ready. Melexis' version set TRIG_READY in the control
+    // register and sent a general call reset, which every sensor on the
+    // bus takes, then checked TRIG_READY had cleared; none of that is done
+    // here, so MLX90640_MEAS_TRIGGER_ERROR is never returned. The clears in
+    // GetFrameData and SynchFrame leave the start bit alone, so this is
+    // the only thing that starts a step mode measurement
+    return MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_START_STATUS_VALUE);
 }
     
 int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t *frameData)
@@ -133,8 +119,10 @@ int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t *frameData)
         dataReady = MLX90640_GET_DATA_READY(statusRegister); 
     }      
     
-    error = MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_INIT_STATUS_VALUE);
-    if(error == -MLX90640_I2C_NACK_ERROR)
+    // without the start bit, so reading a subpage in step mode doesn't
+    // start the next one
+    error = MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+    if(error != MLX90640_NO_ERROR)
     {
         return error;
     }
@@ -161,14 +149,17 @@ int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t *frameData)
         return error;
     }
     
+    // stale aux data would skew Ta and the gain of the whole frame, so a
+    // bad read of it fails the frame rather than falling back on it
     error = ValidateAuxData(data);
-    if(error == MLX90640_NO_ERROR)
+    if(error != MLX90640_NO_ERROR)
     {
-        for(cnt=0; cnt<MLX90640_AUX_NUM; cnt++)
-        {
-            frameData[cnt+MLX90640_PIXEL_NUM] = data[cnt];
-        }
-    }        
+        return error;
+    }
+    for(cnt=0; cnt<MLX90640_AUX_NUM; cnt++)
+    {
+        frameData[cnt+MLX90640_PIXEL_NUM] = data[cnt];
+    }
     
     error = ValidateFrameData(frameData);
     if (error != MLX90640_NO_ERROR)
@@ -195,36 +186,36 @@ static int ValidateFrameData(uint16_t *frameData)
 static int ValidateAuxData(uint16_t *auxData)
 {
     
-    if(auxData[0] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;    
+    if(auxData[0] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;    
     
     for(int i=8; i<19; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     for(int i=20; i<23; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     for(int i=24; i<33; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     for(int i=40; i<51; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     for(int i=52; i<55; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     for(int i=56; i<64; i++)
     {
-        if(auxData[i] == 0x7FFF) return -MLX90640_FRAME_DATA_ERROR;
+        if(auxData[i] == 0x7FFF) return -MLX90640_AUX_DATA_ERROR;
     }
     
     return MLX90640_NO_ERROR;
@@ -415,7 +406,7 @@ int MLX90640_GetCurMode(uint8_t slaveAddr)
 
 //------------------------------------------------------------------------------
 
-void MLX90640_CalculateTo(uint16_t *frameData, const paramsMLX90640 *params, float emissivity, float tr, float *result)
+void MLX90640_HOT_FUNC(MLX90640_CalculateTo)(uint16_t *frameData, const paramsMLX90640 *params, float emissivity, float tr, float *result)
 {
     float vdd;
     float ta;
@@ -5,21 +5,83 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "mlx90640/MLX90640_API.h"
 #include "mlx90640/MLX90640_I2C_Driver.h"
 #include "hardware/i2c.h"
 #include "pico/binary_info.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#if MLX90640_I2C_PIO
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "mlx90640/pio_i2c_frame.h"
+#include "pio_i2c.pio.h"
+#endif
 
 /*
  * The EEPROM is limited to a 400kHz baud rate. After we're done with it, we can go 1 Mhz.
  */
 #define I2C_BAUD 400 * 1000
 
-bool init = 0;
-
 #define SDA 4
 #define SCL 5
+#ifndef MLX90640_I2C1_SDA
+#define MLX90640_I2C1_SDA 6
+#endif
+#ifndef MLX90640_I2C1_SCL
+#define MLX90640_I2C1_SCL 7
+#endif
+
+/*
+ * @brief One entry per bus, picked by the bus bits of the slave address
+ * (see MLX90640_I2C_ADDR). Each is set up on its first transaction.
+ */
+typedef struct {
+  i2c_inst_t *i2c;
+  uint sda;
+  uint scl;
+  bool init;
+#if MLX90640_I2C_PIO
+  uint sm;
+#endif
+  mlx90640_i2c_stats_t stats;
+} mlx90640_i2c_bus_t;
+
+static mlx90640_i2c_bus_t buses[MLX90640_I2C_BUSES] = {
+  { .i2c = i2c0, .sda = SDA, .scl = SCL },
+  { .i2c = i2c1, .sda = MLX90640_I2C1_SDA, .scl = MLX90640_I2C1_SCL },
+};
+static uint i2c_freq = I2C_BAUD;
+
+static inline mlx90640_i2c_bus_t *_i2c_bus(uint8_t slaveAddr) {
+  return &buses[MLX90640_I2C_ADDR_BUS(slaveAddr) % MLX90640_I2C_BUSES];
+}
+
+/*
+ * _i2c_timeout_us
+ *
+ * @brief How long a transfer of n_bytes may take: 9 clocks a byte, with
+ * plenty of room for clock stretching.
+ */
+static inline uint32_t _i2c_timeout_us(size_t n_bytes) {
+  return 2 * (uint32_t)(((uint64_t)n_bytes * 9 * 1000000) / i2c_freq) + 1000;
+}
+
+/*
+ * _i2c_error
+ *
+ * @brief Count a failed transfer and turn the SDK's error into the
+ * matching MLX90640 one. Anything but a timeout is the slave not ACKing.
+ */
+static int _i2c_error(mlx90640_i2c_bus_t *bus, int error) {
+  if (error == PICO_ERROR_TIMEOUT) {
+    bus->stats.timeouts++;
+    return -MLX90640_I2C_TIMEOUT_ERROR;
+  }
+  bus->stats.nacks++;
+  return -MLX90640_I2C_NACK_ERROR;
+}
 
 void MLX90640_I2CInit() {
 }
@@ -161,15 +223,148 @@ int _i2c_read_blocking(uint8_t slaveAddr, uint8_t *buf, uint16_t nbytes, bool no
   return 0;
 }
 
-int MLX90640_I2CGeneralReset() {
+#if MLX90640_I2C_PIO
+/*
+ * @brief PIO I2C master, fed and drained by DMA. The CPU only builds the
+ * FIFO word stream (pio_i2c_frame.h) and waits; START/STOP and the ACK bits
+ * are all in the stream, so a whole frame read is a single pair of DMA
+ * transfers. Runs past the i2c block's 1MHz limit, and lets the slave
+ * stretch the clock.
+ */
+#define MLX90640_PIO pio0
+/*
+ * @brief The biggest read is a full frame or EEPROM dump, 832 words.
+ */
+#define PIO_I2C_MAX_READ_BYTES (2 * 832)
+#define PIO_I2C_TX_WORDS (PIO_I2C_MAX_READ_BYTES + 32)
+#define PIO_I2C_RX_BYTES (PIO_I2C_MAX_READ_BYTES + 8)
+
+/*
+ * @brief The program and DMA channels are shared, each bus gets its own
+ * state machine. Transactions never overlap, so one set of buffers will do.
+ */
+static bool pio_i2c_loaded = false;
+static uint pio_i2c_offset;
+static int pio_i2c_tx_dma = -1;
+static int pio_i2c_rx_dma = -1;
+static uint16_t pio_i2c_tx[PIO_I2C_TX_WORDS];
+static uint8_t pio_i2c_rx[PIO_I2C_RX_BYTES];
+
+static void _pio_i2c_init(mlx90640_i2c_bus_t *bus) {
+  if (!pio_i2c_loaded) {
+    pio_i2c_offset = pio_add_program(MLX90640_PIO, &pio_i2c_program);
+    pio_i2c_tx_dma = dma_claim_unused_channel(true);
+    pio_i2c_rx_dma = dma_claim_unused_channel(true);
+    pio_i2c_loaded = true;
+  }
+  bus->sm = pio_claim_unused_sm(MLX90640_PIO, true);
+}
+
+/*
+ * _pio_i2c_recover
+ *
+ * @brief After a NAK the state machine sits on an irq wait. Throw away the
+ * rest of the transaction, send it back to the top of its loop, and put a
+ * STOP on the bus. If a line is held low even that stalls, which is left to
+ * MLX90640_I2CBusRecover.
+ */
+static void _pio_i2c_recover(mlx90640_i2c_bus_t *bus) {
+  PIO pio = MLX90640_PIO;
+  uint sm = bus->sm;
+  dma_channel_abort(pio_i2c_tx_dma);
+  dma_channel_abort(pio_i2c_rx_dma);
+  pio_sm_drain_tx_fifo(pio, sm);
+  pio_sm_exec(pio, sm, pio_encode_jmp(pio_i2c_offset + pio_i2c_offset_entry_point));
+  pio_interrupt_clear(pio, sm);
+
+  uint16_t words[8];
+  pio_i2c_frame_t f;
+  pio_i2c_frame_init(&f, words, count_of(words));
+  pio_i2c_frame_stop(&f);
+  // the STOP fits in the FIFO, so this never waits
+  for (size_t i = 0; i < f.len; i++) {
+    pio_sm_put(pio, sm, words[i]);
+  }
+  // wait for it to go out, then drop whatever bytes made it in
+  uint32_t t0 = time_us_32();
+  while (!pio_sm_is_tx_fifo_empty(pio, sm) && time_us_32() - t0 < _i2c_timeout_us(1)) {
+    tight_loop_contents();
+  }
+  sleep_us(10 * 1000000 / i2c_freq + 1);
+  while (!pio_sm_is_rx_fifo_empty(pio, sm)) {
+    (void)pio_sm_get(pio, sm);
+  }
+}
+
+/*
+ * _pio_i2c_run
+ *
+ * @brief Run a built frame, the received bytes (one per data word, written
+ * ones included) landing in rx. Returns 0, or like the SDK's i2c functions
+ * PICO_ERROR_GENERIC on a NAK and PICO_ERROR_TIMEOUT if it takes far longer
+ * than the bus should.
+ */
+static int _pio_i2c_run(mlx90640_i2c_bus_t *bus, const pio_i2c_frame_t *f, uint8_t *rx) {
+  PIO pio = MLX90640_PIO;
+  uint sm = bus->sm;
+  if (f->overflow || f->n_bytes > PIO_I2C_RX_BYTES) {
+    return PICO_ERROR_GENERIC;
+  }
+
+  // RX goes first, the state machine stalls if its RX FIFO fills up
+  dma_channel_config c = dma_channel_get_default_config(pio_i2c_rx_dma);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+  dma_channel_configure(pio_i2c_rx_dma, &c, rx, &pio->rxf[sm], f->n_bytes, true);
+
+  c = dma_channel_get_default_config(pio_i2c_tx_dma);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+  dma_channel_configure(pio_i2c_tx_dma, &c, &pio->txf[sm], f->words, f->len, true);
+
+  uint32_t timeout_us = _i2c_timeout_us(f->n_bytes);
+  uint32_t t0 = time_us_32();
+  while (dma_channel_is_busy(pio_i2c_rx_dma)) {
+    if (pio_interrupt_get(pio, sm)) {
+      _pio_i2c_recover(bus);
+      return PICO_ERROR_GENERIC;
+    }
+    if (time_us_32() - t0 > timeout_us) {
+      _pio_i2c_recover(bus);
+      return PICO_ERROR_TIMEOUT;
+    }
+    tight_loop_contents();
+  }
   return 0;
 }
+#endif
 
-static inline void _i2c_init(void) {
-  init = true;
-  i2c_init(i2c0, I2C_BAUD);
-  gpio_set_function(SDA, GPIO_FUNC_I2C);
-  gpio_set_function(SCL, GPIO_FUNC_I2C);
+/*
+ * _i2c_attach
+ *
+ * @brief Hand the bus pins to the i2c block (or state machine) at the
+ * current clock.
+ */
+static void _i2c_attach(mlx90640_i2c_bus_t *bus) {
+#if MLX90640_I2C_PIO
+  pio_i2c_program_init(MLX90640_PIO, bus->sm, pio_i2c_offset, bus->sda, bus->scl, i2c_freq);
+#else
+  i2c_init(bus->i2c, i2c_freq);
+  gpio_set_function(bus->sda, GPIO_FUNC_I2C);
+  gpio_set_function(bus->scl, GPIO_FUNC_I2C);
+#endif
+}
+
+static inline void _i2c_init(mlx90640_i2c_bus_t *bus) {
+  bus->init = true;
+#if MLX90640_I2C_PIO
+  _pio_i2c_init(bus);
+#endif
+  _i2c_attach(bus);
   /*
   FIXME: for bit banging
   gpio_init(SDA);
@@ -181,11 +376,143 @@ static inline void _i2c_init(void) {
   */
 }
 
+/*
+ * @brief Half an SCL period while clearing the bus, 100kHz so even a
+ * confused slave keeps up, and how long it may stretch each clock.
+ */
+#define I2C_CLEAR_HALF_US 5
+#define I2C_CLEAR_STRETCH_US 1000
+
+/*
+ * _i2c_bus_clear
+ *
+ * @brief Get a slave that is holding SDA low mid-byte (typically after a
+ * glitch on SCL) off the bus: take the pins over, clock SCL until it lets
+ * go of SDA, which takes at most 9 clocks to finish any byte and its ACK,
+ * then put a STOP on the bus. Returns whether both lines are high after.
+ */
+static bool _i2c_bus_clear(mlx90640_i2c_bus_t *bus) {
+  // open drain by hand: output (low) to pull a line down, input to let go
+  gpio_init(bus->sda);
+  gpio_init(bus->scl);
+  gpio_pull_up(bus->sda);
+  gpio_pull_up(bus->scl);
+  sleep_us(I2C_CLEAR_HALF_US);
+
+  for (int i = 0; i < 9 && !gpio_get(bus->sda); i++) {
+    gpio_set_dir(bus->scl, GPIO_OUT);
+    sleep_us(I2C_CLEAR_HALF_US);
+    gpio_set_dir(bus->scl, GPIO_IN);
+    for (int t = 0; t < I2C_CLEAR_STRETCH_US && !gpio_get(bus->scl); t++) {
+      sleep_us(1);
+    }
+    sleep_us(I2C_CLEAR_HALF_US);
+  }
+
+  // STOP: SDA goes high while SCL is high
+  gpio_set_dir(bus->scl, GPIO_OUT);
+  sleep_us(I2C_CLEAR_HALF_US);
+  gpio_set_dir(bus->sda, GPIO_OUT);
+  sleep_us(I2C_CLEAR_HALF_US);
+  gpio_set_dir(bus->scl, GPIO_IN);
+  sleep_us(I2C_CLEAR_HALF_US);
+  gpio_set_dir(bus->sda, GPIO_IN);
+  sleep_us(I2C_CLEAR_HALF_US);
+  return gpio_get(bus->sda) && gpio_get(bus->scl);
+}
+
+int MLX90640_I2CBusRecover(uint8_t slaveAddr) {
+  mlx90640_i2c_bus_t *bus = _i2c_bus(slaveAddr);
+  if (!bus->init) {
+    return 0;
+  }
+  bus->stats.recoveries++;
+#if MLX90640_I2C_PIO
+  dma_channel_abort(pio_i2c_tx_dma);
+  dma_channel_abort(pio_i2c_rx_dma);
+  pio_sm_set_enabled(MLX90640_PIO, bus->sm, false);
+#else
+  i2c_deinit(bus->i2c);
+#endif
+  bool clear = _i2c_bus_clear(bus);
+  // start the controller over either way, a stuck bus may free up later
+  _i2c_attach(bus);
+  if (!clear) {
+    bus->stats.stuck++;
+    return -MLX90640_I2C_TIMEOUT_ERROR;
+  }
+  return 0;
+}
+
+/*
+ * _i2c_general_reset
+ *
+ * @brief General call reset: 0x06 to address 0, which every slave on the
+ * bus takes.
+ */
+static int _i2c_general_reset(mlx90640_i2c_bus_t *bus) {
+  uint8_t cmd = 0x06;
+#if MLX90640_I2C_PIO
+  uint16_t words[16];
+  uint8_t rx[4];
+  pio_i2c_frame_t f;
+  pio_i2c_frame_init(&f, words, count_of(words));
+  pio_i2c_frame_start(&f);
+  pio_i2c_frame_addr(&f, 0x00, false);
+  pio_i2c_frame_write(&f, &cmd, 1, true);
+  pio_i2c_frame_stop(&f);
+  int error = _pio_i2c_run(bus, &f, rx);
+#else
+  int error = i2c_write_timeout_us(bus->i2c, 0x00, &cmd, 1, false, _i2c_timeout_us(2));
+#endif
+  return error < 0 ? _i2c_error(bus, error) : 0;
+}
+
+int MLX90640_I2CGeneralReset() {
+  int error = 0;
+  for (uint i = 0; i < MLX90640_I2C_BUSES; i++) {
+    if (!buses[i].init) {
+      continue;
+    }
+    int e = _i2c_general_reset(&buses[i]);
+    if (e != 0) {
+      error = e;
+    }
+  }
+  // give the slaves a moment before talking to them again
+  sleep_us(50);
+  return error;
+}
+
+void MLX90640_I2CGetStats(uint8_t bus, mlx90640_i2c_stats_t *stats) {
+  *stats = buses[bus % MLX90640_I2C_BUSES].stats;
+}
+
 int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t *data) {
-    if (!init) {
-      _i2c_init();
+    mlx90640_i2c_bus_t *bus = _i2c_bus(slaveAddr);
+    if (!bus->init) {
+      _i2c_init(bus);
     }
+    slaveAddr = MLX90640_I2C_ADDR_DEVICE(slaveAddr);
+    bus->stats.reads++;
 
+#if MLX90640_I2C_PIO
+    if (2 * nMemAddressRead > PIO_I2C_MAX_READ_BYTES) {
+      return -1;
+    }
+    pio_i2c_frame_t f;
+    pio_i2c_frame_init(&f, pio_i2c_tx, PIO_I2C_TX_WORDS);
+    size_t first = pio_i2c_frame_mem_read(&f, slaveAddr, startAddress, 2 * nMemAddressRead);
+    int error = _pio_i2c_run(bus, &f, pio_i2c_rx);
+    if (error < 0) {
+      return _i2c_error(bus, error);
+    }
+    for (int count = 0; count < nMemAddressRead; count++) {
+      const uint8_t *b = &pio_i2c_rx[first + 2 * count];
+      data[count] = ((uint16_t)b[0] << 8) | b[1];
+    }
+    return 0;
+#else
     uint8_t buf[1664];
     uint8_t cmd[2] = {0, 0};
     cmd[0] = startAddress >> 8;
@@ -198,13 +525,13 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
     // NOTE: bit banging implementation
     // error |= _i2c_write_blocking(slaveAddr, cmd, 2, 1);
     // error |= _i2c_read_blocking(slaveAddr, buf, 2*nMemAddressRead, 0);
-    if (i2c_write_blocking(i2c0, slaveAddr, cmd, 2, 1) < 0) {
-      error = -1;
-      return error;
+    error = i2c_write_timeout_us(bus->i2c, slaveAddr, cmd, 2, 1, _i2c_timeout_us(3));
+    if (error < 0) {
+      return _i2c_error(bus, error);
     }
-    if (i2c_read_blocking(i2c0, slaveAddr, buf, 2*nMemAddressRead, 0) < 0) {
-      error = -1;
-      return error;
+    error = i2c_read_timeout_us(bus->i2c, slaveAddr, buf, 2*nMemAddressRead, 0, _i2c_timeout_us(1 + 2*nMemAddressRead));
+    if (error < 0) {
+      return _i2c_error(bus, error);
     }
 
     for (int count = 0; count < nMemAddressRead; count++) {
@@ -212,13 +539,42 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
         *p++ = ((uint16_t)buf[i] << 8) | buf[i + 1];
     }
     return 0;
+#endif
 }
 
 void MLX90640_I2CFreqSet(int freq) {
-  i2c_set_baudrate(i2c0, freq);
+  // every bus, a bus not in use yet picks it up when it is set up
+  i2c_freq = freq;
+  for (uint i = 0; i < MLX90640_I2C_BUSES; i++) {
+    if (!buses[i].init) {
+      continue;
+    }
+#if MLX90640_I2C_PIO
+    pio_sm_set_clkdiv(MLX90640_PIO, buses[i].sm, (float)clock_get_hz(clk_sys) / (32.0f * freq));
+#else
+    i2c_set_baudrate(buses[i].i2c, freq);
+#endif
+  }
 }
 
 int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data) {
+    mlx90640_i2c_bus_t *bus = _i2c_bus(slaveAddr);
+    if (!bus->init) {
+      _i2c_init(bus);
+    }
+    slaveAddr = MLX90640_I2C_ADDR_DEVICE(slaveAddr);
+    bus->stats.writes++;
+
+#if MLX90640_I2C_PIO
+    uint8_t payload[2] = { data >> 8, data & 0x00FF };
+    uint16_t words[16];
+    uint8_t rx[8];
+    pio_i2c_frame_t f;
+    pio_i2c_frame_init(&f, words, count_of(words));
+    pio_i2c_frame_mem_write(&f, slaveAddr, writeAddress, payload, 2);
+    int error = _pio_i2c_run(bus, &f, rx);
+    return error < 0 ? _i2c_error(bus, error) : 0;
+#else
     uint8_t cmd[4] = {0, 0, 0, 0};
 
     cmd[0] = writeAddress >> 8;
@@ -230,9 +586,10 @@ int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data) {
 
     // NOTE: bit banging implementation
     // error |= _i2c_write_blocking(slaveAddr, cmd, 4, 0);
-    if (i2c_write_blocking(i2c0, slaveAddr, cmd, 4, 0) < 0) {
-      error = -1;
-      return error;
+    error = i2c_write_timeout_us(bus->i2c, slaveAddr, cmd, 4, 0, _i2c_timeout_us(5));
+    if (error < 0) {
+      return _i2c_error(bus, error);
     }
-    return error;
+    return 0;
+#endif
 }
@@ -0,0 +1,243 @@
+/*
+ * pio_i2c_frame.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include "mlx90640/pio_i2c_frame.h"
+
+void pio_i2c_frame_init(pio_i2c_frame_t *f, uint16_t *words, size_t cap) {
+  f->words = words;
+  f->cap = cap;
+  f->len = 0;
+  f->n_bytes = 0;
+  f->overflow = false;
+}
+
+static void pio_i2c_frame_put(pio_i2c_frame_t *f, uint16_t word) {
+  if (f->len >= f->cap) {
+    f->overflow = true;
+    return;
+  }
+  f->words[f->len++] = word;
+}
+
+/*
+ * pio_i2c_frame_instrs
+ *
+ * @brief Append an escape word and the n instructions it runs.
+ */
+static void pio_i2c_frame_instrs(pio_i2c_frame_t *f, const uint16_t *instrs, size_t n) {
+  pio_i2c_frame_put(f, (uint16_t)((n - 1) << PIO_I2C_ICOUNT_LSB));
+  for (size_t i = 0; i < n; i++) {
+    pio_i2c_frame_put(f, instrs[i]);
+  }
+}
+
+static void pio_i2c_frame_byte(pio_i2c_frame_t *f, uint8_t data, bool nak, bool final) {
+  pio_i2c_frame_put(f, (uint16_t)((data << PIO_I2C_DATA_LSB) | (final << PIO_I2C_FINAL_LSB) | (nak << PIO_I2C_NAK_LSB)));
+  f->n_bytes++;
+}
+
+void pio_i2c_frame_start(pio_i2c_frame_t *f) {
+  // bus is idle: pull SDA low, then SCL so data can follow
+  static const uint16_t instrs[] = { PIO_I2C_SC1_SD0, PIO_I2C_SC0_SD0 };
+  pio_i2c_frame_instrs(f, instrs, 2);
+}
+
+void pio_i2c_frame_repstart(pio_i2c_frame_t *f) {
+  static const uint16_t instrs[] = { PIO_I2C_SC0_SD1, PIO_I2C_SC1_SD1, PIO_I2C_SC1_SD0, PIO_I2C_SC0_SD0 };
+  pio_i2c_frame_instrs(f, instrs, 4);
+}
+
+void pio_i2c_frame_stop(pio_i2c_frame_t *f) {
+  static const uint16_t instrs[] = { PIO_I2C_SC0_SD0, PIO_I2C_SC1_SD0, PIO_I2C_SC1_SD1 };
+  pio_i2c_frame_instrs(f, instrs, 3);
+}
+
+void pio_i2c_frame_addr(pio_i2c_frame_t *f, uint8_t addr, bool read) {
+  // release SDA during the ACK bit so the slave can answer
+  pio_i2c_frame_byte(f, (uint8_t)((addr << 1) | read), true, false);
+}
+
+void pio_i2c_frame_write(pio_i2c_frame_t *f, const uint8_t *buf, size_t n, bool last) {
+  for (size_t i = 0; i < n; i++) {
+    pio_i2c_frame_byte(f, buf[i], true, last && i == n - 1);
+  }
+}
+
+void pio_i2c_frame_read(pio_i2c_frame_t *f, size_t n) {
+  // shift out all ones to leave SDA to the slave, and ACK all but the last
+  for (size_t i = 0; i < n; i++) {
+    bool last = i == n - 1;
+    pio_i2c_frame_byte(f, 0xFF, last, last);
+  }
+}
+
+size_t pio_i2c_frame_mem_read(pio_i2c_frame_t *f, uint8_t addr, uint16_t reg, size_t n) {
+  uint8_t cmd[2] = { reg >> 8, reg & 0xFF };
+  pio_i2c_frame_start(f);
+  pio_i2c_frame_addr(f, addr, false);
+  pio_i2c_frame_write(f, cmd, 2, false);
+  pio_i2c_frame_repstart(f);
+  pio_i2c_frame_addr(f, addr, true);
+  size_t first = f->n_bytes;
+  pio_i2c_frame_read(f, n);
+  pio_i2c_frame_stop(f);
+  return first;
+}
+
+void pio_i2c_frame_mem_write(pio_i2c_frame_t *f, uint8_t addr, uint16_t reg, const uint8_t *buf, size_t n) {
+  uint8_t cmd[2] = { reg >> 8, reg & 0xFF };
+  pio_i2c_frame_start(f);
+  pio_i2c_frame_addr(f, addr, false);
+  pio_i2c_frame_write(f, cmd, 2, n == 0);
+  pio_i2c_frame_write(f, buf, n, true);
+  pio_i2c_frame_stop(f);
+}
+
+int pio_i2c_frame_decode(const uint16_t *words, size_t len, pio_i2c_event_t *events, size_t cap, char *err, size_t err_len) {
+  // line levels as the master leaves them, both released while idle
+  bool scl = true, sda = true;
+  bool in_transaction = false;
+  size_t n = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    uint16_t w = words[i];
+    uint16_t icount = w >> PIO_I2C_ICOUNT_LSB;
+    pio_i2c_event_t ev;
+
+    if (icount == 0) {
+      if (scl) {
+        snprintf(err, err_len, "word %zu: data byte while SCL is released", i);
+        return -1;
+      }
+      ev.type = PIO_I2C_EVENT_BYTE;
+      ev.data = (w >> PIO_I2C_DATA_LSB) & 0xFF;
+      ev.nak = (w >> PIO_I2C_NAK_LSB) & 1;
+      ev.final = (w >> PIO_I2C_FINAL_LSB) & 1;
+      // the bit loop ends with SCL low and SDA as the ACK bit left it
+      sda = ev.nak;
+      if (n < cap) {
+        events[n] = ev;
+      }
+      n++;
+      continue;
+    }
+
+    // the escape word runs the next icount + 1 words as instructions
+    if (i + icount + 1 >= len) {
+      snprintf(err, err_len, "word %zu: %u instructions announced, %zu words left", i, icount + 1, len - i - 1);
+      return -1;
+    }
+    for (uint16_t k = 0; k <= icount; k++) {
+      uint16_t instr = words[++i];
+      bool new_scl, new_sda;
+      switch (instr) {
+        case PIO_I2C_SC0_SD0: new_scl = false; new_sda = false; break;
+        case PIO_I2C_SC0_SD1: new_scl = false; new_sda = true; break;
+        case PIO_I2C_SC1_SD0: new_scl = true; new_sda = false; break;
+        case PIO_I2C_SC1_SD1: new_scl = true; new_sda = true; break;
+        default:
+          snprintf(err, err_len, "word %zu: 0x%04x is not a SCL/SDA instruction", i, instr);
+          return -1;
+      }
+      // SDA moving while SCL stays high is a START or a STOP
+      if (scl && new_scl && sda != new_sda) {
+        if (!new_sda) {
+          ev.type = in_transaction ? PIO_I2C_EVENT_RSTART : PIO_I2C_EVENT_START;
+          in_transaction = true;
+        } else {
+          ev.type = PIO_I2C_EVENT_STOP;
+          in_transaction = false;
+        }
+        ev.data = 0;
+        ev.nak = false;
+        ev.final = false;
+        if (n < cap) {
+          events[n] = ev;
+        }
+        n++;
+      }
+      scl = new_scl;
+      sda = new_sda;
+    }
+  }
+  return (int)n;
+}
+
+int pio_i2c_frame_check(const pio_i2c_event_t *events, size_t n, char *err, size_t err_len) {
+  bool in_transaction = false;
+  bool need_addr = false;
+  bool reading = false;
+
+  for (size_t i = 0; i < n; i++) {
+    const pio_i2c_event_t *ev = &events[i];
+    // the last byte of a transfer is the one right before STOP or repeated START
+    bool last = i + 1 == n || events[i + 1].type != PIO_I2C_EVENT_BYTE;
+
+    switch (ev->type) {
+      case PIO_I2C_EVENT_START:
+        if (in_transaction) {
+          snprintf(err, err_len, "event %zu: START inside a transaction", i);
+          return -1;
+        }
+        in_transaction = true;
+        need_addr = true;
+        break;
+      case PIO_I2C_EVENT_RSTART:
+        if (!in_transaction || need_addr) {
+          snprintf(err, err_len, "event %zu: repeated START without a transfer before it", i);
+          return -1;
+        }
+        need_addr = true;
+        break;
+      case PIO_I2C_EVENT_STOP:
+        if (!in_transaction || need_addr) {
+          snprintf(err, err_len, "event %zu: STOP without a transfer before it", i);
+          return -1;
+        }
+        in_transaction = false;
+        break;
+      case PIO_I2C_EVENT_BYTE:
+        if (!in_transaction) {
+          snprintf(err, err_len, "event %zu: byte outside a transaction", i);
+          return -1;
+        }
+        if (need_addr) {
+          if (!ev->nak || ev->final) {
+            snprintf(err, err_len, "event %zu: address byte must leave the ACK to the slave and not be final", i);
+            return -1;
+          }
+          reading = ev->data & 1;
+          need_addr = false;
+        } else if (reading) {
+          if (ev->data != 0xFF) {
+            snprintf(err, err_len, "event %zu: read byte 0x%02x doesn't release SDA", i, ev->data);
+            return -1;
+          }
+          if (ev->nak != last || ev->final != last) {
+            snprintf(err, err_len, "event %zu: reads must ACK every byte but the last, which is NAKed and final", i);
+            return -1;
+          }
+        } else {
+          if (!ev->nak) {
+            snprintf(err, err_len, "event %zu: write byte doesn't release SDA for the slave's ACK", i);
+            return -1;
+          }
+          if (ev->final && !last) {
+            snprintf(err, err_len, "event %zu: final set before the end of the transfer", i);
+            return -1;
+          }
+        }
+        break;
+    }
+  }
+  if (in_transaction) {
+    snprintf(err, err_len, "transaction not ended with a STOP");
+    return -1;
+  }
+  return 0;
+}
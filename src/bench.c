@@ -0,0 +1,226 @@
+/*
+ * bench.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "bench.h"
+#include "fonts.h"
+#include "st7789.h"
+#include "st7789_framebuf.h"
+#include "st7789_render.h"
+#include "temporal_filter.h"
+#include "deinterlace.h"
+#if THERMAL_CAMERA_STREAM
+#include "frame_codec.h"
+#endif
+
+#define BENCH_FILL_ITERATIONS 50
+#define BENCH_KERNEL_ITERATIONS 20
+#define BENCH_FLUSH_ITERATIONS 10
+
+/*
+ * bench_report_rate
+ *
+ * @brief Print the rate in Mpixel/s for n_pixels drawn in dt_us.
+ */
+static void bench_report_rate(const char *name, uint64_t n_pixels, uint64_t dt_us) {
+  if (dt_us == 0) dt_us = 1;
+  // pixels per microsecond is Mpixel/s
+  printf("[BENCH] %-28s %8llu us %8.2f Mpixel/s\n", name, (unsigned long long)dt_us, (double)n_pixels / dt_us);
+}
+
+static void bench_fill_rate(void) {
+  uint64_t t0 = time_us_64();
+  for (int i = 0; i < BENCH_FILL_ITERATIONS; i++) {
+    st7789_framebuf_fill_rect(0, 0, ST7789_LINE_SIZE-1, ST7789_COLUMN_SIZE-1, i & 1 ? WHITE : BLACK);
+  }
+  bench_report_rate("fill_rect full screen", (uint64_t)BENCH_FILL_ITERATIONS * ST7789_LINE_SIZE * ST7789_COLUMN_SIZE, time_us_64() - t0);
+
+  // heatmap sized cells, which is what st7789_fill_32_24 draws
+  t0 = time_us_64();
+  uint64_t n_pixels = 0;
+  for (int i = 0; i < BENCH_FILL_ITERATIONS; i++) {
+    for (uint y = 0; y + 10 <= ST7789_COLUMN_SIZE; y += 10) {
+      for (uint x = 1; x + 8 <= ST7789_LINE_SIZE; x += 8) {
+        st7789_framebuf_fill_rect(x, y, x + 7, y + 9, i & 1 ? WHITE : BLACK);
+        n_pixels += 8 * 10;
+      }
+    }
+  }
+  bench_report_rate("fill_rect 8x10 cells", n_pixels, time_us_64() - t0);
+
+  static st7789_pixel_t src[ST7789_LINE_SIZE];
+  t0 = time_us_64();
+  for (int i = 0; i < BENCH_FILL_ITERATIONS; i++) {
+    st7789_framebuf_blit(0, 0, ST7789_LINE_SIZE, ST7789_COLUMN_SIZE, src, 0);
+  }
+  bench_report_rate("blit full screen", (uint64_t)BENCH_FILL_ITERATIONS * ST7789_LINE_SIZE * ST7789_COLUMN_SIZE, time_us_64() - t0);
+
+  // what the flush has to do to every pixel before it goes out on the bus
+  static uint16_t expanded[2 * ST7789_LINE_SIZE];
+  t0 = time_us_64();
+  for (int i = 0; i < BENCH_FILL_ITERATIONS; i++) {
+    for (size_t first = 0; first < ST7789_LINE_SIZE * ST7789_COLUMN_SIZE; first += count_of(expanded)) {
+      st7789_framebuf_expand(expanded, first, count_of(expanded));
+    }
+  }
+  bench_report_rate("expand full screen", (uint64_t)BENCH_FILL_ITERATIONS * ST7789_LINE_SIZE * ST7789_COLUMN_SIZE, time_us_64() - t0);
+
+  // and the flush itself in each panel format
+  static const struct {
+    const char *name;
+    st7789_pixel_format_t format;
+  } formats[] = {
+    { "flush full screen rgb565", ST7789_PIXEL_FORMAT_RGB565 },
+    { "flush full screen rgb444", ST7789_PIXEL_FORMAT_RGB444 },
+  };
+  st7789_pixel_format_t format = st7789_framebuf_get_pixel_format();
+  for (size_t i = 0; i < count_of(formats); i++) {
+    st7789_framebuf_set_pixel_format(formats[i].format);
+    // the first flush may also switch COLMOD, leave it out
+    st7789_framebuf_flush();
+    t0 = time_us_64();
+    for (int j = 0; j < BENCH_FLUSH_ITERATIONS; j++) {
+      st7789_framebuf_flush();
+    }
+    bench_report_rate(formats[i].name, (uint64_t)BENCH_FLUSH_ITERATIONS * ST7789_LINE_SIZE * ST7789_COLUMN_SIZE, time_us_64() - t0);
+  }
+  st7789_framebuf_set_pixel_format(format);
+}
+
+/*
+ * bench_xip_flush
+ *
+ * @brief Throw away everything in the XIP cache, so the next flash-resident
+ * code runs as if it was the first time.
+ */
+static void bench_xip_flush(void) {
+  xip_ctrl_hw->flush = 1;
+  // reading back blocks until the flush is done
+  (void)xip_ctrl_hw->flush;
+}
+
+/*
+ * bench_kernel
+ *
+ * @brief Time run() with a warm XIP cache and again with the cache flushed
+ * before every call, and print cycles per call along with where fn lives.
+ * Kernels placed in SRAM should see next to no difference between the two.
+ */
+static void bench_kernel(const char *name, const void *fn, void (*run)(void)) {
+  uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+  const char *where = (uintptr_t)fn >= SRAM_BASE ? "sram" : "flash";
+
+  run();
+  uint64_t t0 = time_us_64();
+  for (int i = 0; i < BENCH_KERNEL_ITERATIONS; i++) {
+    run();
+  }
+  uint64_t warm_us = time_us_64() - t0;
+
+  uint64_t cold_us = 0;
+  for (int i = 0; i < BENCH_KERNEL_ITERATIONS; i++) {
+    bench_xip_flush();
+    t0 = time_us_64();
+    run();
+    cold_us += time_us_64() - t0;
+  }
+
+  printf("[BENCH] %-28s %-5s warm %9llu cycles cold %9llu cycles\n", name, where,
+    (unsigned long long)(warm_us * mhz / BENCH_KERNEL_ITERATIONS),
+    (unsigned long long)(cold_us * mhz / BENCH_KERNEL_ITERATIONS));
+}
+
+static float bench_frame[MLX90640_PIXEL_NUM];
+static st7789_pixel_t bench_image[MLX90640_PIXEL_NUM];
+#if ST7789_FRAMEBUF_INDEXED
+static const st7789_pixel_t bench_palette[] = { 0, 1, 2, 3 };
+#else
+static const st7789_pixel_t bench_palette[] = { BLACK, BLUE, RED, WHITE };
+#endif
+
+static void bench_run_fill_rect(void) {
+  st7789_framebuf_fill_rect(0, 0, ST7789_LINE_SIZE-1, ST7789_COLUMN_SIZE-1, BLACK);
+}
+
+static void bench_run_write_string(void) {
+  st7789_framebuf_write_string(10, 10, "Max:  25.34 C", 13, WHITE, RED, false);
+}
+
+static void bench_run_render_map(void) {
+  st7789_render_map(bench_frame, NULL, MLX90640_PIXEL_NUM, 0.0f, 40.0f, bench_palette, count_of(bench_palette), bench_image);
+}
+
+static void bench_run_render_scale(void) {
+  st7789_render_scale(bench_image, MLX90640_COLUMN_SIZE, MLX90640_LINE_SIZE, 130, 0, 190, ST7789_COLUMN_SIZE);
+}
+
+static uint16_t *bench_sensor_frame;
+static const paramsMLX90640 *bench_sensor_params;
+static void bench_run_calculate_to(void) {
+  MLX90640_CalculateTo(bench_sensor_frame, bench_sensor_params, 0.95f, 25.0f, bench_frame);
+}
+
+static void bench_run_temporal_filter(void) {
+  temporal_filter_apply(bench_frame, 0, MLX90640_PIXEL_NUM);
+}
+
+#if THERMAL_CAMERA_STREAM
+static frame_codec_t bench_codec;
+static uint8_t bench_packed[FRAME_CODEC_MAX_BYTES];
+static size_t bench_packed_len;
+static void bench_run_frame_codec(void) {
+  // a key frame each time, the inter frames need a sequence to mean anything
+  frame_codec_init(&bench_codec, 0);
+  bench_packed_len = frame_codec_encode(&bench_codec, bench_sensor_frame, bench_packed, sizeof(bench_packed));
+}
+#endif
+
+static void bench_run_deinterlace(void) {
+  deinterlace_apply(bench_frame, 0, 0);
+}
+
+void bench_run(void) {
+  printf("[BENCH] starting.\n");
+  bench_fill_rate();
+
+  for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
+    bench_frame[i] = (float)(i % 40);
+  }
+  bench_kernel("st7789_framebuf_fill_rect", (const void *)st7789_framebuf_fill_rect, bench_run_fill_rect);
+  bench_kernel("st7789_framebuf_write_string", (const void *)st7789_framebuf_write_string, bench_run_write_string);
+  bench_kernel("st7789_render_map", (const void *)st7789_render_map, bench_run_render_map);
+  bench_kernel("st7789_render_scale", (const void *)st7789_render_scale, bench_run_render_scale);
+  printf("[BENCH] done.\n");
+}
+
+void bench_run_sensor(uint16_t *frameData, const paramsMLX90640 *params) {
+  bench_sensor_frame = frameData;
+  bench_sensor_params = params;
+  bench_kernel("MLX90640_CalculateTo", (const void *)MLX90640_CalculateTo, bench_run_calculate_to);
+
+  // should be a small fraction of the above; it runs on the To just computed
+  bool filter_on = temporal_filter_enabled();
+  temporal_filter_enable(true);
+  bench_kernel("temporal_filter_apply", (const void *)temporal_filter_apply, bench_run_temporal_filter);
+  temporal_filter_enable(filter_on);
+#if THERMAL_CAMERA_STREAM
+  bench_kernel("frame_codec_encode key", (const void *)frame_codec_encode, bench_run_frame_codec);
+  printf("[BENCH] frame_codec key frame %u bytes from %u, %.2f:1, \"stream\" has the streamed ratio\n",
+    (unsigned)bench_packed_len, 2 * FRAME_CODEC_WORDS, 2.0 * FRAME_CODEC_WORDS / bench_packed_len);
+#endif
+
+  bool deinterlace_on = deinterlace_enabled();
+  deinterlace_enable(true);
+  bench_kernel("deinterlace_apply", (const void *)deinterlace_apply, bench_run_deinterlace);
+  deinterlace_enable(deinterlace_on);
+  // the benchmarks left their own history behind
+  temporal_filter_reset();
+  deinterlace_reset();
+}
@@ -0,0 +1,262 @@
+/*
+ * capture.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hardware/gpio.h"
+#include "capture.h"
+#include "console.h"
+#include "mlx90640/MLX90640_I2C_Driver.h"
+#if THERMAL_CAMERA_GOVERNOR
+#include "governor.h"
+#endif
+
+/*
+ * @brief Triggers per subpage before giving up, in case a trigger gets
+ * lost or measures a subpage we already have.
+ */
+#define CAPTURE_MAX_TRIGGERS 4
+#define CAPTURE_BENCH_DEFAULT 8
+#define CAPTURE_BENCH_MAX 64
+
+static sensor_t *capture_sensors;
+static uint capture_n_sensors = 0;
+static float capture_emissivity = 0.95f;
+static int capture_pin = -1;
+
+/*
+ * @brief set by whoever triggers, cleared by the sensor loop.
+ */
+static volatile bool capture_requested = false;
+static volatile capture_mode_t capture_requested_mode = CAPTURE_STEP;
+static volatile uint32_t capture_trigger_us = 0;
+
+static void capture_irq(void) {
+  if (gpio_get_irq_event_mask(capture_pin) & GPIO_IRQ_EDGE_FALL) {
+    gpio_acknowledge_irq(capture_pin, GPIO_IRQ_EDGE_FALL);
+    if (!capture_requested) {
+      capture_trigger_us = time_us_32();
+      capture_requested_mode = CAPTURE_STEP;
+      capture_requested = true;
+    }
+  }
+}
+
+void capture_request(capture_mode_t mode) {
+  capture_trigger_us = time_us_32();
+  capture_requested_mode = mode;
+  capture_requested = true;
+}
+
+bool capture_pending(void) {
+  return capture_requested;
+}
+
+/*
+ * capture_period_us
+ *
+ * @brief Subpage period at the sensor's current refresh rate.
+ */
+static uint32_t capture_period_us(sensor_t *s) {
+  int rate = MLX90640_GetRefreshRate(s->slave_addr);
+  return 2000000u >> (rate < 0 ? 0 : rate);
+}
+
+/*
+ * capture_wait_ready
+ *
+ * @brief Poll as fast as the bus allows, this is where the latency is.
+ * Gives up on the timeout, or a failed status read.
+ */
+static bool capture_wait_ready(sensor_t *s, uint32_t timeout_us) {
+  uint32_t t0 = time_us_32();
+  int ready;
+  while ((ready = sensor_data_ready(s)) == 0) {
+    if (time_us_32() - t0 > timeout_us) {
+      return false;
+    }
+  }
+  return ready > 0;
+}
+
+/*
+ * capture_subpages
+ *
+ * @brief Read subpages until every sensor has delivered both. In step mode
+ * each subpage is triggered here, and only here, the next one before the
+ * last is calculated, so the sensor measures while we calculate. In free
+ * mode the first one to arrive was started before the trigger and is
+ * thrown away.
+ */
+static bool capture_subpages(capture_result_t *r, uint32_t period_us) {
+  uint8_t seen[SENSOR_MAX] = { 0 };
+  bool skipped[SENSOR_MAX] = { false };
+  bool read[SENSOR_MAX] = { false };
+  bool first = true;
+
+  for (int attempt = 0; attempt <= CAPTURE_MAX_TRIGGERS; attempt++) {
+    if (r->mode == CAPTURE_STEP && attempt < CAPTURE_MAX_TRIGGERS) {
+      // start them all before reading any, so they measure at the same time
+      for (uint k = 0; k < capture_n_sensors; k++) {
+        sensor_t *s = &capture_sensors[k];
+        uint8_t have = seen[k] | (read[k] ? 1 << s->subpage : 0);
+        if (s->ok && have != 0x3 && MLX90640_TriggerMeasurement(s->slave_addr) != 0) {
+          return false;
+        }
+      }
+    }
+    bool done = true;
+    for (uint k = 0; k < capture_n_sensors; k++) {
+      sensor_t *s = &capture_sensors[k];
+      if (read[k]) {
+        sensor_calculate(s, capture_emissivity);
+        seen[k] |= 1 << s->subpage;
+        read[k] = false;
+        if (first) {
+          r->first_data_us = s->frame_time_us - r->trigger_us;
+          first = false;
+        }
+      }
+      done &= !s->ok || seen[k] == 0x3;
+    }
+    if (done) {
+      r->data_us = time_us_32() - r->trigger_us;
+      return true;
+    }
+    if (attempt == CAPTURE_MAX_TRIGGERS) {
+      break;
+    }
+    for (uint k = 0; k < capture_n_sensors; k++) {
+      sensor_t *s = &capture_sensors[k];
+      if (!s->ok || seen[k] == 0x3) {
+        continue;
+      }
+      if (!capture_wait_ready(s, 3 * period_us) || sensor_read(s) < 0) {
+        return false;
+      }
+      if (r->mode == CAPTURE_FREE && !skipped[k]) {
+        skipped[k] = true;
+        continue;
+      }
+      read[k] = true;
+    }
+  }
+  return false;
+}
+
+bool capture_run(capture_result_t *r) {
+  memset(r, 0, sizeof(*r));
+  if (!capture_requested || capture_n_sensors == 0) {
+    return false;
+  }
+  r->mode = capture_requested_mode;
+  r->trigger_us = capture_trigger_us;
+  r->start_us = time_us_32() - r->trigger_us;
+
+  uint32_t period_us = capture_period_us(&capture_sensors[0]);
+  if (r->mode == CAPTURE_STEP) {
+    for (uint k = 0; k < capture_n_sensors; k++) {
+      if (capture_sensors[k].ok) {
+        sensor_set_step_mode(&capture_sensors[k], true);
+      }
+    }
+  }
+
+  // throw away anything measured before the trigger. This doesn't start a
+  // measurement, capture_subpages triggers each subpage in step mode
+  for (uint k = 0; k < capture_n_sensors; k++) {
+    if (capture_sensors[k].ok) {
+      MLX90640_I2CWrite(capture_sensors[k].slave_addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+    }
+  }
+  r->ok = capture_subpages(r, period_us);
+  r->result_us = time_us_32() - r->trigger_us;
+
+  if (r->mode == CAPTURE_STEP) {
+    for (uint k = 0; k < capture_n_sensors; k++) {
+      if (capture_sensors[k].ok) {
+        sensor_set_step_mode(&capture_sensors[k], false);
+        MLX90640_I2CWrite(capture_sensors[k].slave_addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+      }
+    }
+  }
+  capture_requested = false;
+#if THERMAL_CAMERA_GOVERNOR
+  // the sensor loop stood still for the capture, from the loop or a bench
+  governor_reset();
+#endif
+  return r->ok;
+}
+
+void capture_print(const capture_result_t *r) {
+  const char *mode = r->mode == CAPTURE_STEP ? "step" : "free";
+  if (!r->ok) {
+    printf("[ERROR] %s capture failed after %lu us.\n", mode, (unsigned long)r->result_us);
+    return;
+  }
+  printf("[INFO] %s capture: picked up %lu us, first subpage %lu us, all subpages %lu us, To %lu us after the trigger.\n",
+    mode, (unsigned long)r->start_us, (unsigned long)r->first_data_us, (unsigned long)r->data_us, (unsigned long)r->result_us);
+}
+
+/*
+ * capture_bench
+ *
+ * @brief n captures each way, back to back, and their trigger to To
+ * latencies.
+ */
+static void capture_bench(uint n) {
+  for (int m = 0; m < 2; m++) {
+    capture_mode_t mode = m == 0 ? CAPTURE_STEP : CAPTURE_FREE;
+    uint32_t min = UINT32_MAX, max = 0;
+    uint64_t sum = 0;
+    uint ok = 0;
+    for (uint i = 0; i < n; i++) {
+      capture_result_t r;
+      capture_request(mode);
+      if (capture_run(&r)) {
+        ok++;
+        sum += r.result_us;
+        min = r.result_us < min ? r.result_us : min;
+        max = r.result_us > max ? r.result_us : max;
+      }
+    }
+    if (ok == 0) {
+      printf("[ERROR] bench: every %s capture failed.\n", m == 0 ? "step" : "free");
+      continue;
+    }
+    printf("[INFO] bench: %s capture %u/%u ok, trigger to To mean %lu us, min %lu us, max %lu us.\n",
+      m == 0 ? "step" : "free", ok, n, (unsigned long)(sum / ok), (unsigned long)min, (unsigned long)max);
+  }
+}
+
+static void console_capture(const char *args) {
+  if (strncmp(args, "bench", 5) == 0) {
+    int n = atoi(args + 5);
+    capture_bench(n > 0 && n <= CAPTURE_BENCH_MAX ? n : CAPTURE_BENCH_DEFAULT);
+    return;
+  }
+  // picked up by the sensor loop like any other trigger
+  capture_request(strcmp(args, "free") == 0 ? CAPTURE_FREE : CAPTURE_STEP);
+}
+
+void capture_init(sensor_t *sensors, uint n, float emissivity, int trigger_pin) {
+  capture_sensors = sensors;
+  capture_n_sensors = n;
+  capture_emissivity = emissivity;
+  capture_pin = trigger_pin;
+  if (trigger_pin >= 0) {
+    gpio_init(trigger_pin);
+    gpio_set_dir(trigger_pin, GPIO_IN);
+    gpio_pull_up(trigger_pin);
+    // the irq lands on whichever core runs this, the one reading the sensors
+    gpio_add_raw_irq_handler(trigger_pin, capture_irq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    gpio_set_irq_enabled(trigger_pin, GPIO_IRQ_EDGE_FALL, true);
+  }
+  console_register("capture", "capture [step|free|bench [n]]: one image on demand, or compare both ways", console_capture);
+}
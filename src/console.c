@@ -0,0 +1,88 @@
+/*
+ * console.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "console.h"
+
+typedef struct {
+  const char *name;
+  const char *help;
+  console_fn_t fn;
+} console_command_t;
+
+static console_command_t console_commands[CONSOLE_MAX_COMMANDS];
+static size_t console_n_commands = 0;
+
+/*
+ * @brief the line typed so far.
+ */
+static char console_line[CONSOLE_LINE_LEN];
+static size_t console_len = 0;
+
+bool console_register(const char *name, const char *help, console_fn_t fn) {
+  if (console_n_commands >= CONSOLE_MAX_COMMANDS) {
+    printf("[ERROR] no room for console command \"%s\".\n", name);
+    return false;
+  }
+  console_commands[console_n_commands++] = (console_command_t){ name, help, fn };
+  return true;
+}
+
+static void console_help(void) {
+  printf("help - list commands\n");
+  for (size_t i = 0; i < console_n_commands; i++) {
+    printf("%s - %s\n", console_commands[i].name, console_commands[i].help);
+  }
+}
+
+static void console_run(char *line) {
+  while (*line == ' ') {
+    line++;
+  }
+  if (*line == '\0') {
+    return;
+  }
+  // split the name off at the first space
+  char *args = strchr(line, ' ');
+  if (args) {
+    *args++ = '\0';
+    while (*args == ' ') {
+      args++;
+    }
+  } else {
+    args = line + strlen(line);
+  }
+
+  if (strcmp(line, "help") == 0) {
+    console_help();
+    return;
+  }
+  for (size_t i = 0; i < console_n_commands; i++) {
+    if (strcmp(line, console_commands[i].name) == 0) {
+      console_commands[i].fn(args);
+      return;
+    }
+  }
+  printf("[ERROR] unknown command \"%s\", try help.\n", line);
+}
+
+void console_poll(void) {
+  int c;
+  while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+    if (c == '\r' || c == '\n') {
+      console_line[console_len] = '\0';
+      console_len = 0;
+      console_run(console_line);
+    } else if ((c == '\b' || c == 0x7F) && console_len > 0) {
+      console_len--;
+    } else if (c >= ' ' && c < 0x7F && console_len < CONSOLE_LINE_LEN - 1) {
+      console_line[console_len++] = (char)c;
+    }
+  }
+}
@@ -0,0 +1,129 @@
+/*
+ * deinterlace.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "deinterlace.h"
+#include "console.h"
+#include "hotpath.h"
+
+#define DEINTERLACE_SENSORS (FRAME_SCHED_PIXELS / MLX90640_PIXEL_NUM)
+
+static bool deinterlace_on = false;
+
+/*
+ * @brief each pixel's value when its subpage was last read, and per sensor
+ * whether there is one yet for each subpage.
+ */
+static float deinterlace_prev[FRAME_SCHED_PIXELS];
+static bool deinterlace_prev_valid[DEINTERLACE_SENSORS][2];
+
+/*
+ * @brief per sensor the subpage deinterlace_apply last ran on, -1 for none.
+ */
+static int8_t deinterlace_last[DEINTERLACE_SENSORS];
+
+/*
+ * @brief how much each measured pixel changed, for the current image only.
+ */
+static float deinterlace_motion[MLX90640_PIXEL_NUM];
+
+/*
+ * @brief stale pixels seen and how many of them were mostly interpolated,
+ * since the last time the console asked.
+ */
+static uint32_t deinterlace_n_stale = 0;
+static uint32_t deinterlace_n_moving = 0;
+
+void deinterlace_reset(void) {
+  memset(deinterlace_prev_valid, 0, sizeof(deinterlace_prev_valid));
+  memset(deinterlace_last, -1, sizeof(deinterlace_last));
+}
+
+void deinterlace_enable(bool enabled) {
+  if (enabled && !deinterlace_on) {
+    deinterlace_reset();
+  }
+  deinterlace_on = enabled;
+}
+
+bool deinterlace_enabled(void) {
+  return deinterlace_on;
+}
+
+void HOT_FUNC(deinterlace_apply)(float *frame, size_t first, int subpage) {
+  size_t sensor = first / MLX90640_PIXEL_NUM;
+  if (!deinterlace_on || sensor >= DEINTERLACE_SENSORS) {
+    return;
+  }
+  subpage &= 1;
+  float *temps = &frame[first];
+  float *prev = &deinterlace_prev[first];
+  // the same subpage twice in a row means the other one was dropped, so
+  // the stale half is two subpages old rather than one: don't keep it
+  bool valid = deinterlace_prev_valid[sensor][subpage] && deinterlace_last[sensor] != subpage;
+  deinterlace_last[sensor] = subpage;
+
+  // measured pixels: how far they moved since this subpage was last read
+  for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
+    // chess pattern, same as MLX90640_CalculateTo
+    if ((((i / MLX90640_LINE_SIZE) ^ i) & 1) != subpage) {
+      continue;
+    }
+    deinterlace_motion[i] = fabsf(temps[i] - prev[i]);
+    prev[i] = temps[i];
+  }
+  deinterlace_prev_valid[sensor][subpage] = true;
+
+  // stale pixels: every neighbour in the same row or column was measured
+  for (int y = 0; y < MLX90640_COLUMN_SIZE; y++) {
+    for (int x = (y ^ subpage ^ 1) & 1; x < MLX90640_LINE_SIZE; x += 2) {
+      int i = y * MLX90640_LINE_SIZE + x;
+      float sum = 0, motion = 0;
+      int n = 0;
+      if (x > 0) { sum += temps[i - 1]; motion += deinterlace_motion[i - 1]; n++; }
+      if (x < MLX90640_LINE_SIZE - 1) { sum += temps[i + 1]; motion += deinterlace_motion[i + 1]; n++; }
+      if (y > 0) { sum += temps[i - MLX90640_LINE_SIZE]; motion += deinterlace_motion[i - MLX90640_LINE_SIZE]; n++; }
+      if (y < MLX90640_COLUMN_SIZE - 1) { sum += temps[i + MLX90640_LINE_SIZE]; motion += deinterlace_motion[i + MLX90640_LINE_SIZE]; n++; }
+      float spatial = sum / n;
+
+      // nothing to compare against yet, or the other subpage was skipped:
+      // the stale value may be from before the sensor started or a frame
+      // behind, so trust the neighbours
+      float w = 1.0f;
+      if (valid) {
+        w = (motion / n - DEINTERLACE_MOTION_LOW) * (1.0f / (DEINTERLACE_MOTION_HIGH - DEINTERLACE_MOTION_LOW));
+        w = w < 0.0f ? 0.0f : (w > 1.0f ? 1.0f : w);
+      }
+      temps[i] += w * (spatial - temps[i]);
+      deinterlace_n_moving += w > 0.5f;
+    }
+  }
+  deinterlace_n_stale += MLX90640_PIXEL_NUM / 2;
+}
+
+static void console_deinterlace(const char *args) {
+  if (strcmp(args, "on") == 0) {
+    deinterlace_enable(true);
+  } else if (strcmp(args, "off") == 0) {
+    deinterlace_enable(false);
+  } else if (args[0] != '\0') {
+    printf("[ERROR] deinterlace: unknown setting \"%s\".\n", args);
+    return;
+  }
+  printf("[INFO] deinterlace: %s, %.1f%% of stale pixels interpolated since last asked.\n", deinterlace_on ? "on" : "off",
+    deinterlace_n_stale ? 100.0 * deinterlace_n_moving / deinterlace_n_stale : 0.0);
+  deinterlace_n_stale = 0;
+  deinterlace_n_moving = 0;
+}
+
+void deinterlace_init(bool enabled) {
+  deinterlace_on = false;
+  deinterlace_enable(enabled);
+  console_register("deinterlace", "deinterlace [on|off]: fill in the pixels a subpage didn't measure", console_deinterlace);
+}
@@ -0,0 +1,383 @@
+/*
+ * flash_log.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "flash_log.h"
+
+#define FLASH_LOG_NO_FIRST 0xFFFF
+
+/*
+ * flash_log_crc16
+ *
+ * @brief CRC-16/CCITT-FALSE, bit at a time: it's only run once per page
+ * going to or coming from flash.
+ */
+static uint16_t flash_log_crc16(uint16_t crc, const uint8_t *p, size_t n) {
+  while (n--) {
+    crc ^= (uint16_t)(*p++ << 8);
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint16_t flash_log_get16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t flash_log_get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void flash_log_put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void flash_log_put32(uint8_t *p, uint32_t v) {
+  flash_log_put16(p, (uint16_t)v);
+  flash_log_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static const uint8_t *flash_log_page(const flash_log_t *log, uint32_t n) {
+  return log->backend->base + n * FLASH_LOG_PAGE_SIZE;
+}
+
+static bool flash_log_blank(const uint8_t *p, size_t n) {
+  while (n--) {
+    if (*p++ != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool flash_log_page_valid(const flash_log_t *log, uint32_t n, uint32_t *seq) {
+  const uint8_t *p = flash_log_page(log, n);
+  uint16_t first = flash_log_get16(p + 6);
+  uint16_t used = flash_log_get16(p + 8);
+  if (flash_log_get16(p + 4) != FLASH_LOG_MAGIC || used > FLASH_LOG_PAGE_PAYLOAD ||
+      (first != FLASH_LOG_NO_FIRST && first >= used)) {
+    return false;
+  }
+  uint16_t crc = flash_log_crc16(0xFFFF, p, 10);
+  crc = flash_log_crc16(crc, p + FLASH_LOG_PAGE_HEADER, used);
+  if (crc != flash_log_get16(p + 10)) {
+    return false;
+  }
+  *seq = flash_log_get32(p);
+  return true;
+}
+
+uint32_t flash_log_valid_pages(const flash_log_t *log) {
+  uint32_t valid = 0, seq;
+  for (uint32_t n = 0; n < log->n_pages; n++) {
+    valid += flash_log_page_valid(log, n, &seq);
+  }
+  return valid;
+}
+
+uint32_t flash_log_dump(const flash_log_t *log, uint32_t max_pages, flash_log_page_fn_t fn, void *ctx) {
+  uint32_t valid = flash_log_valid_pages(log);
+  uint32_t skip = max_pages && valid > max_pages ? valid - max_pages : 0;
+  uint32_t dumped = 0, seq;
+  for (uint32_t i = 0; i < log->n_pages; i++) {
+    uint32_t n = (log->head + i) % log->n_pages;
+    if (!flash_log_page_valid(log, n, &seq)) {
+      continue;
+    }
+    if (skip) {
+      skip--;
+      continue;
+    }
+    fn(ctx, flash_log_page(log, n));
+    dumped++;
+  }
+  return dumped;
+}
+
+/*
+ * flash_log_fill_page
+ *
+ * @brief The queue slot being filled.
+ */
+static uint8_t *flash_log_fill_page(flash_log_t *log) {
+  return log->queue[(log->queue_head + log->queue_count) % FLASH_LOG_QUEUE_PAGES];
+}
+
+static void flash_log_start_fill(flash_log_t *log) {
+  log->fill_used = 0;
+  log->fill_first = FLASH_LOG_NO_FIRST;
+  memset(flash_log_fill_page(log), 0xFF, FLASH_LOG_PAGE_SIZE);
+}
+
+bool flash_log_init(flash_log_t *log, const flash_log_backend_t *backend) {
+  memset(log, 0, sizeof(*log));
+  log->backend = backend;
+  log->n_sectors = backend->size / FLASH_LOG_SECTOR_SIZE;
+  log->n_pages = log->n_sectors * FLASH_LOG_PAGES_PER_SECTOR;
+  if (log->n_sectors < FLASH_LOG_MIN_SECTORS) {
+    return false;
+  }
+  flash_log_start_fill(log);
+
+  // carry on after the newest page
+  bool found = false;
+  uint32_t newest = 0, newest_seq = 0;
+  for (uint32_t n = 0; n < log->n_pages; n++) {
+    uint32_t seq;
+    if (flash_log_page_valid(log, n, &seq) && (!found || (int32_t)(seq - newest_seq) > 0)) {
+      found = true;
+      newest = n;
+      newest_seq = seq;
+    }
+  }
+  log->head = found ? (newest + 1) % log->n_pages : 0;
+  // skipping a number: the end of the last record before a restart may
+  // never have got to flash, the reader mustn't join it to what follows
+  log->seq = found ? newest_seq + 2 : 1;
+
+  // what's left of the head's sector has to be blank to be written, or
+  // (a program cut short) the writer moves on to the next sector
+  uint32_t in_sector = log->head % FLASH_LOG_PAGES_PER_SECTOR;
+  if (in_sector != 0) {
+    const uint8_t *rest = flash_log_page(log, log->head);
+    if (!flash_log_blank(rest, (FLASH_LOG_PAGES_PER_SECTOR - in_sector) * FLASH_LOG_PAGE_SIZE)) {
+      log->head = (log->head + FLASH_LOG_PAGES_PER_SECTOR - in_sector) % log->n_pages;
+    } else {
+      log->erased_ahead = 1;
+    }
+  }
+  // and whole sectors after it may already be erased
+  uint32_t sector = log->head / FLASH_LOG_PAGES_PER_SECTOR + log->erased_ahead;
+  while (log->erased_ahead < FLASH_LOG_ERASE_AHEAD) {
+    const uint8_t *s = log->backend->base + (sector % log->n_sectors) * FLASH_LOG_SECTOR_SIZE;
+    if (!flash_log_blank(s, FLASH_LOG_SECTOR_SIZE)) {
+      break;
+    }
+    log->erased_ahead++;
+    sector++;
+  }
+  return true;
+}
+
+bool flash_log_fits(const flash_log_t *log, uint16_t len) {
+  // at most FLASH_LOG_QUEUE_PAGES - 1 queued, so that filling (or flushing)
+  // the last page still leaves a slot to go on in, not the oldest page
+  if (log->queue_count + 2 > FLASH_LOG_QUEUE_PAGES) {
+    return false;
+  }
+  size_t room = (size_t)(FLASH_LOG_QUEUE_PAGES - 2 - log->queue_count) * FLASH_LOG_PAGE_PAYLOAD +
+    (FLASH_LOG_PAGE_PAYLOAD - log->fill_used);
+  return len <= FLASH_LOG_MAX_PAYLOAD && FLASH_LOG_RECORD_HEADER + (size_t)len <= room;
+}
+
+bool flash_log_append(flash_log_t *log, uint8_t type, uint8_t sensor, uint32_t time_us, const void *payload,
+  uint16_t len) {
+  if (!flash_log_fits(log, len)) {
+    log->counters.dropped++;
+    return false;
+  }
+
+  uint8_t header[FLASH_LOG_RECORD_HEADER];
+  header[0] = type;
+  header[1] = sensor;
+  flash_log_put16(header + 2, len);
+  flash_log_put32(header + 4, time_us);
+  if (log->fill_first == FLASH_LOG_NO_FIRST) {
+    log->fill_first = log->fill_used;
+  }
+
+  const uint8_t *parts[2] = { header, payload };
+  size_t sizes[2] = { sizeof(header), len };
+  for (int i = 0; i < 2; i++) {
+    const uint8_t *src = parts[i];
+    size_t n = sizes[i];
+    while (n > 0) {
+      size_t k = FLASH_LOG_PAGE_PAYLOAD - log->fill_used;
+      if (k > n) {
+        k = n;
+      }
+      memcpy(flash_log_fill_page(log) + FLASH_LOG_PAGE_HEADER + log->fill_used, src, k);
+      log->fill_used += (uint16_t)k;
+      src += k;
+      n -= k;
+      if (log->fill_used == FLASH_LOG_PAGE_PAYLOAD) {
+        flash_log_flush(log);
+      }
+    }
+  }
+  log->counters.records++;
+  return true;
+}
+
+void flash_log_flush(flash_log_t *log) {
+  if (log->fill_used == 0) {
+    return;
+  }
+  uint8_t *p = flash_log_fill_page(log);
+  flash_log_put16(p + 4, FLASH_LOG_MAGIC);
+  flash_log_put16(p + 6, log->fill_first);
+  flash_log_put16(p + 8, log->fill_used);
+  log->queue_count++;
+  flash_log_start_fill(log);
+}
+
+bool flash_log_pending(const flash_log_t *log, bool *erase) {
+  bool program = log->queue_count > 0 && log->erased_ahead > 0;
+  *erase = !program && log->erased_ahead < FLASH_LOG_ERASE_AHEAD;
+  return program || *erase;
+}
+
+bool flash_log_urgent(const flash_log_t *log) {
+  return log->erased_ahead == 0 && log->queue_count >= FLASH_LOG_QUEUE_URGENT;
+}
+
+/*
+ * flash_log_program
+ *
+ * @brief The oldest queued page goes to the head, with its sequence number
+ * and CRC filled in now they're known.
+ */
+static void flash_log_program(flash_log_t *log) {
+  uint8_t *p = log->queue[log->queue_head];
+  uint16_t used = flash_log_get16(p + 8);
+  flash_log_put32(p, log->seq);
+  uint16_t crc = flash_log_crc16(0xFFFF, p, 10);
+  flash_log_put16(p + 10, flash_log_crc16(crc, p + FLASH_LOG_PAGE_HEADER, used));
+
+  if (log->backend->program(log->backend->ctx, log->head * FLASH_LOG_PAGE_SIZE, p)) {
+    log->queue_head = (log->queue_head + 1) % FLASH_LOG_QUEUE_PAGES;
+    log->queue_count--;
+    log->counters.pages++;
+    log->seq++;
+  } else {
+    // leave that page be and try the same data on the next one
+    log->counters.failures++;
+  }
+  log->head++;
+  if (log->head % FLASH_LOG_PAGES_PER_SECTOR == 0) {
+    log->erased_ahead--;
+    if (log->head == log->n_pages) {
+      log->head = 0;
+      log->counters.wraps++;
+    }
+  }
+}
+
+static void flash_log_erase(flash_log_t *log) {
+  uint32_t sector = (log->head / FLASH_LOG_PAGES_PER_SECTOR + log->erased_ahead) % log->n_sectors;
+  if (log->backend->erase(log->backend->ctx, sector * FLASH_LOG_SECTOR_SIZE)) {
+    log->erased_ahead++;
+    log->counters.erases++;
+  } else {
+    log->counters.failures++;
+  }
+}
+
+bool flash_log_step(flash_log_t *log, bool may_program, bool may_erase) {
+  if (may_program && log->queue_count > 0 && log->erased_ahead > 0) {
+    flash_log_program(log);
+    return true;
+  }
+  if (may_erase && log->erased_ahead < FLASH_LOG_ERASE_AHEAD) {
+    flash_log_erase(log);
+    return true;
+  }
+  return false;
+}
+
+void flash_log_reader_init(flash_log_reader_t *r, const flash_log_t *log) {
+  memset(r, 0, offsetof(flash_log_reader_t, record));
+  r->log = log;
+  r->page = log->head;
+  r->left = log->n_pages;
+}
+
+/*
+ * flash_log_next_page
+ *
+ * @brief Move on to the next page of the log. A record that a gap in the
+ * sequence numbers cut off is lost, and reading starts again at the first
+ * record in the new page.
+ */
+static bool flash_log_next_page(flash_log_reader_t *r) {
+  const flash_log_t *log = r->log;
+  while (r->left > 0) {
+    uint32_t n = r->page, seq;
+    r->page = (r->page + 1) % log->n_pages;
+    r->left--;
+    if (!flash_log_page_valid(log, n, &seq)) {
+      continue;
+    }
+    const uint8_t *p = flash_log_page(log, n);
+    bool follows = r->have_seq && seq == r->seq + 1;
+    r->seq = seq;
+    r->have_seq = true;
+    r->data = p + FLASH_LOG_PAGE_HEADER;
+    r->used = flash_log_get16(p + 8);
+    r->pos = 0;
+    if (!follows || (r->have == 0 && r->need == 0)) {
+      uint16_t first = flash_log_get16(p + 6);
+      if (r->have > 0) {
+        r->broken++;
+      }
+      r->have = r->need = 0;
+      if (first == FLASH_LOG_NO_FIRST) {
+        // only the rest of a record we haven't the start of
+        continue;
+      }
+      r->pos = first;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool flash_log_read(flash_log_reader_t *r, flash_log_record_t *h, const uint8_t **payload) {
+  for (;;) {
+    if (r->data == NULL || r->pos >= r->used) {
+      if (!flash_log_next_page(r)) {
+        return false;
+      }
+      continue;
+    }
+    uint32_t want = r->need ? r->need : FLASH_LOG_RECORD_HEADER;
+    uint32_t k = want - r->have;
+    if (k > (uint32_t)(r->used - r->pos)) {
+      k = r->used - r->pos;
+    }
+    memcpy(r->record + r->have, r->data + r->pos, k);
+    r->have += k;
+    r->pos += (uint16_t)k;
+    if (r->have < want) {
+      continue;
+    }
+    if (r->need == 0) {
+      uint16_t len = flash_log_get16(r->record + 2);
+      if (len > FLASH_LOG_MAX_PAYLOAD) {
+        // not a record after all: drop the rest of the page
+        r->broken++;
+        r->have = 0;
+        r->pos = r->used;
+        continue;
+      }
+      r->need = FLASH_LOG_RECORD_HEADER + len;
+      if (r->have < r->need) {
+        continue;
+      }
+    }
+    h->type = r->record[0];
+    h->sensor = r->record[1];
+    h->len = flash_log_get16(r->record + 2);
+    h->time_us = flash_log_get32(r->record + 4);
+    *payload = r->record + FLASH_LOG_RECORD_HEADER;
+    r->have = r->need = 0;
+    return true;
+  }
+}
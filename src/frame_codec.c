@@ -0,0 +1,334 @@
+/*
+ * frame_codec.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "frame_codec.h"
+
+#define FRAME_CODEC_PIXELS 768
+#define FRAME_CODEC_LINE_SIZE 32
+#define FRAME_CODEC_COLUMN_SIZE 24
+#define FRAME_CODEC_CTRL 832
+#define FRAME_CODEC_SUBPAGE 833
+// control register: chess pattern rather than interleaved rows
+#define FRAME_CODEC_CHESS_MODE 0x1000
+
+/*
+ * @brief Unary parts longer than this escape to the residual in 16 bits,
+ * so a glitch costs 40 bits at most.
+ */
+#define FRAME_CODEC_RICE_LIMIT 24
+/*
+ * @brief Halve a context's history every this many residuals, so the Rice
+ * parameter follows changes in the noise.
+ */
+#define FRAME_CODEC_CTX_RESET 64
+
+typedef enum {
+  FRAME_CODEC_CTX_FRESH,
+  FRAME_CODEC_CTX_STALE,
+  FRAME_CODEC_CTX_AUX,
+  FRAME_CODEC_N_CTX,
+} frame_codec_ctx_id_t;
+
+/*
+ * @brief Running sum of residual magnitudes a and count n, the Rice
+ * parameter is the smallest k with n << k >= a.
+ */
+typedef struct {
+  uint32_t a;
+  uint32_t n;
+} frame_codec_ctx_t;
+
+/*
+ * @brief The bit stream in either direction, and the contexts. Encoding
+ * and decoding run the same code, so their predictions can't drift apart.
+ */
+typedef struct {
+  bool encode;
+  uint8_t *buf;
+  size_t len;
+  size_t pos;
+  uint32_t acc;
+  int n_bits;
+  bool err;  // encoding: out of room; decoding: out of input
+  frame_codec_ctx_t ctx[FRAME_CODEC_N_CTX];
+} frame_codec_bits_t;
+
+/*
+ * @brief Already coded neighbours to predict from, in order of preference.
+ * Only those of the pixel's own subpage are used.
+ */
+static const int8_t frame_codec_neighbours[][2] = { { -1, 0 }, { -2, 0 }, { -1, -1 }, { 1, -1 }, { 0, -2 } };
+
+void frame_codec_init(frame_codec_t *c, uint16_t key_interval) {
+  c->have_prev = false;
+  c->key_interval = key_interval;
+  c->since_key = 0;
+  c->count = 0;
+}
+
+static void frame_codec_put_bits(frame_codec_bits_t *b, uint32_t v, int n) {
+  b->acc = (b->acc << n) | (v & ((1u << n) - 1));
+  b->n_bits += n;
+  while (b->n_bits >= 8) {
+    b->n_bits -= 8;
+    if (b->pos >= b->len) {
+      b->err = true;
+      continue;
+    }
+    b->buf[b->pos++] = (uint8_t)(b->acc >> b->n_bits);
+  }
+}
+
+static uint32_t frame_codec_get_bits(frame_codec_bits_t *b, int n) {
+  while (b->n_bits < n) {
+    uint8_t byte = 0;
+    if (b->pos < b->len) {
+      byte = b->buf[b->pos++];
+    } else {
+      b->err = true;
+    }
+    b->acc = (b->acc << 8) | byte;
+    b->n_bits += 8;
+  }
+  b->n_bits -= n;
+  return (b->acc >> b->n_bits) & ((1u << n) - 1);
+}
+
+/*
+ * frame_codec_rice
+ *
+ * @brief Write u, or read and return it, with the context's Rice parameter,
+ * then update the context.
+ */
+static uint16_t frame_codec_rice(frame_codec_bits_t *b, frame_codec_ctx_t *ctx, uint16_t u) {
+  int k = 0;
+  while ((ctx->n << k) < ctx->a && k < 15) {
+    k++;
+  }
+
+  if (b->encode) {
+    uint32_t q = u >> k;
+    if (q < FRAME_CODEC_RICE_LIMIT) {
+      for (; q >= 16; q -= 16) {
+        frame_codec_put_bits(b, 0xFFFF, 16);
+      }
+      // q ones and the terminating zero
+      frame_codec_put_bits(b, ((1u << q) - 1) << 1, (int)q + 1);
+      frame_codec_put_bits(b, u, k);
+    } else {
+      frame_codec_put_bits(b, 0xFFFFFF, FRAME_CODEC_RICE_LIMIT);
+      frame_codec_put_bits(b, u, 16);
+    }
+  } else {
+    uint32_t q = 0;
+    while (q < FRAME_CODEC_RICE_LIMIT && frame_codec_get_bits(b, 1)) {
+      q++;
+    }
+    if (q == FRAME_CODEC_RICE_LIMIT) {
+      u = (uint16_t)frame_codec_get_bits(b, 16);
+    } else {
+      u = (uint16_t)((q << k) | frame_codec_get_bits(b, k));
+    }
+  }
+
+  ctx->a += u;
+  ctx->n++;
+  if (ctx->n >= FRAME_CODEC_CTX_RESET) {
+    ctx->a >>= 1;
+    ctx->n >>= 1;
+  }
+  return u;
+}
+
+/*
+ * frame_codec_word
+ *
+ * @brief Code frame[i] as its residual from pred, wrapping at 16 bits. When
+ * decoding, frame[i] is written.
+ */
+static void frame_codec_word(frame_codec_bits_t *b, frame_codec_ctx_id_t ctx, uint16_t *frame, int i, int32_t pred) {
+  uint16_t u = 0;
+  if (b->encode) {
+    int16_t e = (int16_t)(uint16_t)(frame[i] - (uint16_t)pred);
+    // zigzag, small magnitudes of either sign make small codes
+    u = (uint16_t)(((uint16_t)e << 1) ^ (uint16_t)(e >> 15));
+  }
+  u = frame_codec_rice(b, &b->ctx[ctx], u);
+  if (!b->encode) {
+    int16_t e = (int16_t)((u >> 1) ^ (uint16_t)-(int16_t)(u & 1));
+    frame[i] = (uint16_t)((uint16_t)pred + (uint16_t)e);
+  }
+}
+
+static int frame_codec_subpage_of(bool chess, int x, int y) {
+  return chess ? (x ^ y) & 1 : y & 1;
+}
+
+static int32_t frame_codec_median3(int32_t a, int32_t b, int32_t c) {
+  if (a > b) { int32_t t = a; a = b; b = t; }
+  if (b > c) { b = c; }
+  return a > b ? a : b;
+}
+
+/*
+ * frame_codec_predict
+ *
+ * @brief Median of up to three already coded neighbours of the same
+ * subpage: of their values for key frames, or of how much they changed
+ * since prev, added to the pixel's previous value.
+ */
+static int32_t frame_codec_predict(const uint16_t *frame, const uint16_t *prev, bool chess, int x, int y) {
+  int subpage = frame_codec_subpage_of(chess, x, y);
+  int32_t v[3];
+  int n = 0;
+  for (size_t j = 0; j < sizeof(frame_codec_neighbours) / sizeof(frame_codec_neighbours[0]) && n < 3; j++) {
+    int nx = x + frame_codec_neighbours[j][0];
+    int ny = y + frame_codec_neighbours[j][1];
+    if (nx < 0 || nx >= FRAME_CODEC_LINE_SIZE || ny < 0 || frame_codec_subpage_of(chess, nx, ny) != subpage) {
+      continue;
+    }
+    int idx = ny * FRAME_CODEC_LINE_SIZE + nx;
+    // pixel data is signed
+    v[n] = (int16_t)frame[idx];
+    if (prev) {
+      v[n] -= (int16_t)prev[idx];
+    }
+    n++;
+  }
+  int32_t p = n == 3 ? frame_codec_median3(v[0], v[1], v[2]) : n == 2 ? (v[0] + v[1]) / 2 : n == 1 ? v[0] : 0;
+  return prev ? (int16_t)prev[y * FRAME_CODEC_LINE_SIZE + x] + p : p;
+}
+
+/*
+ * frame_codec_run
+ *
+ * @brief Code a whole frame, against prev unless it is NULL (key frames).
+ */
+static void frame_codec_run(frame_codec_bits_t *b, uint16_t *frame, const uint16_t *prev, uint8_t flags) {
+  for (int j = 0; j < FRAME_CODEC_N_CTX; j++) {
+    b->ctx[j].a = 4;
+    b->ctx[j].n = 1;
+  }
+
+  // these say which pixels were measured, so they go first
+  frame_codec_word(b, FRAME_CODEC_CTX_AUX, frame, FRAME_CODEC_SUBPAGE, prev ? prev[FRAME_CODEC_SUBPAGE] : 0);
+  frame_codec_word(b, FRAME_CODEC_CTX_AUX, frame, FRAME_CODEC_CTRL, prev ? prev[FRAME_CODEC_CTRL] : 0);
+  bool chess = frame[FRAME_CODEC_CTRL] & FRAME_CODEC_CHESS_MODE;
+  int subpage = frame[FRAME_CODEC_SUBPAGE] & 1;
+
+  for (int y = 0; y < FRAME_CODEC_COLUMN_SIZE; y++) {
+    for (int x = 0; x < FRAME_CODEC_LINE_SIZE; x++) {
+      int i = y * FRAME_CODEC_LINE_SIZE + x;
+      if (prev && frame_codec_subpage_of(chess, x, y) != subpage) {
+        if (flags & FRAME_CODEC_STALE_SAME) {
+          if (!b->encode) {
+            frame[i] = prev[i];
+          }
+        } else {
+          frame_codec_word(b, FRAME_CODEC_CTX_STALE, frame, i, prev[i]);
+        }
+        continue;
+      }
+      frame_codec_word(b, FRAME_CODEC_CTX_FRESH, frame, i, frame_codec_predict(frame, prev, chess, x, y));
+    }
+  }
+
+  for (int i = FRAME_CODEC_PIXELS; i < FRAME_CODEC_CTRL; i++) {
+    int32_t pred = prev ? prev[i] : (i > FRAME_CODEC_PIXELS ? frame[i - 1] : 0);
+    frame_codec_word(b, FRAME_CODEC_CTX_AUX, frame, i, pred);
+  }
+}
+
+static bool frame_codec_stale_same(const uint16_t *frame, const uint16_t *prev) {
+  bool chess = frame[FRAME_CODEC_CTRL] & FRAME_CODEC_CHESS_MODE;
+  int subpage = frame[FRAME_CODEC_SUBPAGE] & 1;
+  for (int i = 0; i < FRAME_CODEC_PIXELS; i++) {
+    int x = i % FRAME_CODEC_LINE_SIZE, y = i / FRAME_CODEC_LINE_SIZE;
+    if (frame_codec_subpage_of(chess, x, y) != subpage && frame[i] != prev[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t frame_codec_encode(frame_codec_t *c, const uint16_t *frame, uint8_t *out, size_t cap) {
+  if (cap < FRAME_CODEC_MAX_BYTES) {
+    return 0;
+  }
+  bool key = !c->have_prev || (c->key_interval && c->since_key >= c->key_interval);
+  const uint16_t *prev = key ? NULL : c->prev;
+  uint8_t flags = key ? FRAME_CODEC_KEY : 0;
+  if (prev && frame_codec_stale_same(frame, prev)) {
+    flags |= FRAME_CODEC_STALE_SAME;
+  }
+
+  // only worth it if it comes out smaller than storing the frame
+  frame_codec_bits_t b = { .encode = true, .buf = &out[FRAME_CODEC_HEADER_BYTES], .len = FRAME_CODEC_MAX_BYTES - FRAME_CODEC_HEADER_BYTES };
+  // encoding only reads the frame
+  frame_codec_run(&b, (uint16_t *)frame, prev, flags);
+  if (b.n_bits > 0) {
+    frame_codec_put_bits(&b, 0, 8 - b.n_bits);
+  }
+
+  size_t len;
+  if (b.err || b.pos >= FRAME_CODEC_MAX_BYTES - FRAME_CODEC_HEADER_BYTES) {
+    out[0] = FRAME_CODEC_KEY | FRAME_CODEC_STORED;
+    uint8_t *p = &out[FRAME_CODEC_HEADER_BYTES];
+    for (int i = 0; i < FRAME_CODEC_WORDS; i++) {
+      p[2 * i] = frame[i] & 0xFF;
+      p[2 * i + 1] = frame[i] >> 8;
+    }
+    len = FRAME_CODEC_MAX_BYTES;
+    key = true;
+  } else {
+    out[0] = flags;
+    len = FRAME_CODEC_HEADER_BYTES + b.pos;
+  }
+  out[1] = c->count++;
+
+  memcpy(c->prev, frame, sizeof(c->prev));
+  c->have_prev = true;
+  c->since_key = key ? 1 : c->since_key + 1;
+  return len;
+}
+
+frame_codec_status_t frame_codec_decode(frame_codec_t *c, const uint8_t *in, size_t len, uint16_t *frame) {
+  if (len < FRAME_CODEC_HEADER_BYTES) {
+    c->have_prev = false;
+    return FRAME_CODEC_CORRUPT;
+  }
+  uint8_t flags = in[0];
+  const uint8_t *p = &in[FRAME_CODEC_HEADER_BYTES];
+  if (flags & FRAME_CODEC_STORED) {
+    if (len != FRAME_CODEC_MAX_BYTES) {
+      c->have_prev = false;
+      return FRAME_CODEC_CORRUPT;
+    }
+    for (int i = 0; i < FRAME_CODEC_WORDS; i++) {
+      frame[i] = (uint16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+    }
+  } else {
+    bool key = flags & FRAME_CODEC_KEY;
+    // an inter frame only decodes against the frame right before it
+    if (!key && (!c->have_prev || in[1] != c->count)) {
+      c->have_prev = false;
+      return FRAME_CODEC_NEED_KEY;
+    }
+    frame_codec_bits_t b = { .encode = false, .buf = (uint8_t *)p, .len = len - FRAME_CODEC_HEADER_BYTES };
+    frame_codec_run(&b, frame, key ? NULL : c->prev, flags);
+    if (b.err) {
+      c->have_prev = false;
+      return FRAME_CODEC_CORRUPT;
+    }
+  }
+
+  memcpy(c->prev, frame, sizeof(c->prev));
+  c->have_prev = true;
+  c->count = in[1] + 1;
+  return FRAME_CODEC_OK;
+}
@@ -0,0 +1,140 @@
+/*
+ * frame_sched.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "pico/mutex.h"
+#include "frame_sched.h"
+
+/*
+ * @brief Four slots, each owned by exactly one role at a time: the one the
+ * sensor copies into, the newest published frame, and the two the display
+ * is showing or blending between. Publishing and consuming only swap slot
+ * indices under the mutex; the frames themselves are copied outside it.
+ */
+static frame_sched_frame_t frame_sched_slots[4];
+static int frame_sched_back = 0;
+static int frame_sched_ready = 1;
+static int frame_sched_cur = 2;
+static int frame_sched_prev = 3;
+static bool frame_sched_ready_new = false;
+static mutex_t frame_sched_mutex;
+
+static frame_sched_mode_t frame_sched_mode = FRAME_SCHED_HOLD;
+static uint32_t frame_sched_seq = 0;
+static frame_sched_stats_t frame_sched_stats;
+
+/*
+ * @brief display side state, only touched from the display loop.
+ */
+static uint64_t frame_sched_display_period_us = 0;
+static uint64_t frame_sched_next_tick_us = 0;
+static bool frame_sched_settled = false;
+
+void frame_sched_init(uint display_hz, frame_sched_mode_t mode) {
+  mutex_init(&frame_sched_mutex);
+  frame_sched_mode = mode;
+  frame_sched_display_period_us = display_hz ? 1000000 / display_hz : 0;
+  frame_sched_next_tick_us = time_us_64();
+  memset(&frame_sched_stats, 0, sizeof(frame_sched_stats));
+}
+
+void frame_sched_publish(const float *temps, uint32_t time_us) {
+  // the back slot belongs to us alone, so fill it without holding the lock
+  frame_sched_frame_t *f = &frame_sched_slots[frame_sched_back];
+  memcpy(f->temps, temps, sizeof(f->temps));
+  f->time_us = time_us;
+  f->seq = ++frame_sched_seq;
+
+  mutex_enter_blocking(&frame_sched_mutex);
+  if (frame_sched_ready_new) {
+    frame_sched_stats.dropped++;
+  }
+  int ready = frame_sched_ready;
+  frame_sched_ready = frame_sched_back;
+  frame_sched_back = ready;
+  frame_sched_ready_new = true;
+  frame_sched_stats.produced++;
+  mutex_exit(&frame_sched_mutex);
+}
+
+void frame_sched_wait_display(void) {
+  uint64_t now = time_us_64();
+  if (now < frame_sched_next_tick_us) {
+    sleep_us(frame_sched_next_tick_us - now);
+  } else if (now >= frame_sched_next_tick_us + frame_sched_display_period_us && frame_sched_display_period_us) {
+    // fell a whole tick behind, don't try to catch up with a burst
+    frame_sched_stats.late++;
+    frame_sched_next_tick_us = now;
+  }
+  frame_sched_next_tick_us += frame_sched_display_period_us;
+}
+
+uint64_t frame_sched_next_display_us(void) {
+  return frame_sched_next_tick_us;
+}
+
+/*
+ * frame_sched_consume
+ *
+ * @brief Pick up the newest published frame, if there is one. The current
+ * frame becomes the previous one.
+ */
+static bool frame_sched_consume(void) {
+  bool new_frame = false;
+  mutex_enter_blocking(&frame_sched_mutex);
+  if (frame_sched_ready_new) {
+    int prev = frame_sched_prev;
+    frame_sched_prev = frame_sched_cur;
+    frame_sched_cur = frame_sched_ready;
+    frame_sched_ready = prev;
+    frame_sched_ready_new = false;
+    frame_sched_stats.consumed++;
+    new_frame = true;
+  }
+  mutex_exit(&frame_sched_mutex);
+  return new_frame;
+}
+
+bool frame_sched_display_frame(float *out, uint32_t now_us) {
+  if (frame_sched_consume()) {
+    frame_sched_settled = false;
+  }
+  const frame_sched_frame_t *cur = &frame_sched_slots[frame_sched_cur];
+  const frame_sched_frame_t *prev = &frame_sched_slots[frame_sched_prev];
+  if (cur->seq == 0 || frame_sched_settled) {
+    frame_sched_stats.idle++;
+    return false;
+  }
+
+  // how far into the fade from prev to cur we are, in [0, 1]
+  float alpha = 1.0f;
+  if (frame_sched_mode == FRAME_SCHED_INTERPOLATE && prev->seq != 0) {
+    uint32_t period = cur->time_us - prev->time_us;
+    uint32_t elapsed = now_us - cur->time_us;
+    if (period > 0 && elapsed < period) {
+      alpha = (float)elapsed / (float)period;
+    }
+  }
+
+  if (alpha >= 1.0f) {
+    // straight copy, and nothing more to draw until the next frame
+    memcpy(out, cur->temps, sizeof(cur->temps));
+    frame_sched_settled = true;
+  } else {
+    for (int i = 0; i < FRAME_SCHED_PIXELS; i++) {
+      out[i] = prev->temps[i] + alpha * (cur->temps[i] - prev->temps[i]);
+    }
+  }
+  frame_sched_stats.displayed++;
+  return true;
+}
+
+void frame_sched_get_stats(frame_sched_stats_t *stats) {
+  mutex_enter_blocking(&frame_sched_mutex);
+  *stats = frame_sched_stats;
+  mutex_exit(&frame_sched_mutex);
+}
@@ -0,0 +1,213 @@
+/*
+ * governor.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "governor.h"
+#include "mlx90640/MLX90640_API.h"
+
+/*
+ * @brief Step the rate down once the busiest stage takes more than
+ * GOVERNOR_LOAD_HIGH of the subpage period, and up once it would take less
+ * than GOVERNOR_LOAD_LOW at twice the rate. The gap keeps it from bouncing.
+ */
+#define GOVERNOR_LOAD_HIGH 0.9f
+#define GOVERNOR_LOAD_LOW 0.7f
+/*
+ * @brief Raise the resolution while the noise floor is below
+ * GOVERNOR_NOISE_LOW, and give bits back once it is above
+ * GOVERNOR_NOISE_HIGH (degrees C); past that the extra bits only measure
+ * noise and cost ADC range on hot scenes.
+ */
+#define GOVERNOR_NOISE_LOW 0.10f
+#define GOVERNOR_NOISE_HIGH 0.50f
+/*
+ * @brief Decide once per window: at least GOVERNOR_WINDOW_MIN subpages and
+ * GOVERNOR_WINDOW_US long. The first GOVERNOR_SETTLE subpages after a
+ * change are not measured.
+ */
+#define GOVERNOR_WINDOW_MIN 4
+#define GOVERNOR_WINDOW_US 2000000
+#define GOVERNOR_SETTLE 2
+
+static governor_config_t governor_config;
+static governor_state_t governor_state;
+static volatile uint32_t governor_render_us = 0;
+
+/*
+ * @brief measurements for the current window.
+ */
+static uint32_t governor_n = 0;
+static uint32_t governor_settle = 0;
+static uint32_t governor_window_t0 = 0;
+static uint32_t governor_acq_min_us = 0;
+static uint64_t governor_calc_sum_us = 0;
+static uint32_t governor_last_time_us = 0;
+static uint64_t governor_interval_sum_us = 0;
+static uint32_t governor_n_intervals = 0;
+static float governor_noise_min = INFINITY;
+
+/*
+ * @brief each pixel's value when it was last updated, to measure noise.
+ */
+static float governor_prev_temps[MLX90640_PIXEL_NUM];
+static bool governor_prev_valid[2] = { false, false };
+
+/*
+ * governor_period_us
+ *
+ * @brief Subpage period of a refresh rate code, 0.5Hz * 2^rate.
+ */
+static uint32_t governor_period_us(uint8_t rate) {
+  return 2000000u >> rate;
+}
+
+static void governor_reset_window(void) {
+  governor_n = 0;
+  governor_window_t0 = time_us_32();
+  governor_acq_min_us = UINT32_MAX;
+  governor_calc_sum_us = 0;
+  governor_interval_sum_us = 0;
+  governor_n_intervals = 0;
+  governor_noise_min = INFINITY;
+}
+
+void governor_init(const governor_config_t *config, uint8_t rate, uint8_t res) {
+  governor_config = *config;
+  governor_state.rate = rate;
+  governor_state.res = res;
+  governor_state.load = 0;
+  governor_state.noise = 0;
+  governor_state.changes = 0;
+  governor_settle = GOVERNOR_SETTLE;
+  governor_reset_window();
+}
+
+void governor_reset(void) {
+  governor_prev_valid[0] = governor_prev_valid[1] = false;
+  governor_settle = GOVERNOR_SETTLE;
+  governor_reset_window();
+}
+
+void governor_note_render(uint32_t render_us) {
+  governor_render_us = render_us;
+}
+
+/*
+ * governor_noise
+ *
+ * @brief Mean absolute change of the pixels this subpage updated since
+ * they were last updated, scaled to a standard deviation for gaussian
+ * noise. Motion inflates it, so the window keeps the smallest one.
+ */
+static float governor_noise(const float *temps, int subpage) {
+  float sum = 0;
+  int n = 0;
+  for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
+    // chess pattern, same as MLX90640_CalculateTo
+    if ((((i / 32) ^ i) & 1) != subpage) {
+      continue;
+    }
+    if (governor_prev_valid[subpage]) {
+      sum += fabsf(temps[i] - governor_prev_temps[i]);
+      n++;
+    }
+    governor_prev_temps[i] = temps[i];
+  }
+  governor_prev_valid[subpage] = true;
+  // E|x - y| = 2 sigma / sqrt(pi) for two independent samples
+  return n ? sum / n * 0.886f : INFINITY;
+}
+
+/*
+ * governor_decide
+ *
+ * @brief End of a window: maybe change the rate or the resolution, not both.
+ */
+static bool governor_decide(uint8_t slave_addr) {
+  uint32_t period = governor_period_us(governor_state.rate);
+  // GetFrameData's fastest call is about the read alone, the rest was waiting
+  uint32_t busy = governor_acq_min_us + (uint32_t)(governor_calc_sum_us / governor_n);
+  uint32_t render = governor_render_us;
+  float load = (float)(busy > render ? busy : render) / period;
+  // subpages arriving late means we're already missing them
+  if (governor_n_intervals > 0) {
+    float actual = (float)governor_interval_sum_us / governor_n_intervals;
+    if (actual > 1.25f * period && load < 1.0f) {
+      load = 1.0f;
+    }
+  }
+  governor_state.load = load;
+  governor_state.noise = governor_noise_min;
+
+  uint8_t rate = governor_state.rate;
+  uint8_t res = governor_state.res;
+  if (load > GOVERNOR_LOAD_HIGH && rate > governor_config.min_rate) {
+    rate--;
+  } else if (2 * load < GOVERNOR_LOAD_LOW && rate < governor_config.max_rate) {
+    rate++;
+  } else if (governor_noise_min < GOVERNOR_NOISE_LOW && res < governor_config.max_res) {
+    res++;
+  } else if (governor_noise_min > GOVERNOR_NOISE_HIGH && isfinite(governor_noise_min) && res > governor_config.min_res) {
+    res--;
+  }
+
+  if (rate != governor_state.rate) {
+    printf("[INFO] governor: refresh rate %u -> %u (load %.2f).\n", governor_state.rate, rate, (double)load);
+    MLX90640_SetRefreshRate(slave_addr, rate);
+    governor_state.rate = rate;
+  } else if (res != governor_state.res) {
+    printf("[INFO] governor: resolution %u -> %u bits (noise %.3f C).\n", 16 + governor_state.res, 16 + res, (double)governor_noise_min);
+    MLX90640_SetResolution(slave_addr, res);
+    governor_state.res = res;
+  } else {
+    return false;
+  }
+  governor_state.changes++;
+  // the noise reference is from the old settings
+  governor_prev_valid[0] = governor_prev_valid[1] = false;
+  governor_settle = GOVERNOR_SETTLE;
+  return true;
+}
+
+bool governor_update(uint8_t slave_addr, uint32_t acq_us, uint32_t calc_us, const float *temps, int subpage) {
+  uint32_t now = time_us_32();
+  uint32_t interval = now - governor_last_time_us;
+  governor_last_time_us = now;
+
+  float noise = governor_noise(temps, subpage & 1);
+  if (governor_settle > 0) {
+    // still on subpages from before the last change
+    governor_settle--;
+    governor_reset_window();
+    return false;
+  }
+
+  if (governor_n > 0) {
+    governor_interval_sum_us += interval;
+    governor_n_intervals++;
+  }
+  if (acq_us < governor_acq_min_us) {
+    governor_acq_min_us = acq_us;
+  }
+  governor_calc_sum_us += calc_us;
+  if (noise < governor_noise_min) {
+    governor_noise_min = noise;
+  }
+  governor_n++;
+
+  if (governor_n < GOVERNOR_WINDOW_MIN || now - governor_window_t0 < GOVERNOR_WINDOW_US) {
+    return false;
+  }
+  bool changed = governor_decide(slave_addr);
+  governor_reset_window();
+  return changed;
+}
+
+void governor_get_state(governor_state_t *state) {
+  *state = governor_state;
+}
@@ -0,0 +1,387 @@
+/*
+ * logger.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "logger.h"
+#include "console.h"
+#include "flash_log.h"
+#include "frame_codec.h"
+#include "sensor.h"
+#include "mlx90640/MLX90640_API.h"
+
+#ifndef THERMAL_CAMERA_FLASH_LOG_KB
+#define THERMAL_CAMERA_FLASH_LOG_KB 1024
+#endif
+
+// the top of the flash, well clear of the firmware
+#define LOGGER_SIZE (THERMAL_CAMERA_FLASH_LOG_KB * 1024u)
+#define LOGGER_OFFSET (PICO_FLASH_SIZE_BYTES - LOGGER_SIZE)
+// how long core1 gets to get out of the way
+#define LOGGER_LOCKOUT_MS 10
+// what it takes to check a sensor and start reading it
+#define LOGGER_MARGIN_US 2000
+#define LOGGER_DRAIN_TRIES (4 * FLASH_LOG_QUEUE_PAGES)
+// no subpage for this long (with a sensor failing, say): the flash is free
+#define LOGGER_IDLE_US 2000000
+// how often dropped records get a warning on the console, at most
+#define LOGGER_REPORT_MS 10000
+
+_Static_assert(FLASH_LOG_PAGE_SIZE == FLASH_PAGE_SIZE, "flash page size");
+_Static_assert(FLASH_LOG_SECTOR_SIZE == FLASH_SECTOR_SIZE, "flash sector size");
+
+extern char __flash_binary_end;
+
+typedef struct {
+  float min;
+  float max;
+  uint16_t hottest;
+  double sum;      // of the frames' means
+  uint16_t frames;
+  uint32_t start_us;
+  uint32_t frame_us;  // when a frame was last logged
+  bool frame_logged;
+} logger_sensor_t;
+
+static flash_log_backend_t logger_backend;
+static flash_log_t logger_log;
+static bool logger_ok = false;
+static logger_mode_t logger_mode = LOGGER_OFF;
+static uint32_t logger_period_us;
+static logger_sensor_t logger_sensors[THERMAL_CAMERA_SENSORS];
+static frame_codec_t logger_codecs[THERMAL_CAMERA_SENSORS];
+static uint8_t logger_packed[FRAME_CODEC_MAX_BYTES];
+
+/*
+ * @brief How often logger_frame is called, which is how often the loop
+ * needs to be free to read a subpage.
+ */
+static bool logger_have_frame = false;
+static uint32_t logger_last_frame_us;
+static uint32_t logger_interval_us;
+static uint32_t logger_flush_ms;
+
+/*
+ * @brief Erases done without the time for them, and the dropped records
+ * last warned about.
+ */
+static uint32_t logger_forced_erases = 0;
+static uint32_t logger_dropped_reported = 0;
+static uint32_t logger_report_ms;
+
+/*
+ * @brief flash_safe_execute runs these with core1 parked and interrupts
+ * off; offsets are the log's.
+ */
+typedef struct {
+  uint32_t offset;
+  const uint8_t *page;
+} logger_flash_op_t;
+
+static void logger_do_erase(void *param) {
+  const logger_flash_op_t *op = param;
+  flash_range_erase(LOGGER_OFFSET + op->offset, FLASH_SECTOR_SIZE);
+}
+
+static void logger_do_program(void *param) {
+  const logger_flash_op_t *op = param;
+  flash_range_program(LOGGER_OFFSET + op->offset, op->page, FLASH_PAGE_SIZE);
+}
+
+static bool logger_erase(void *ctx, uint32_t offset) {
+  logger_flash_op_t op = { offset, NULL };
+  return flash_safe_execute(logger_do_erase, &op, LOGGER_LOCKOUT_MS) == PICO_OK;
+}
+
+static bool logger_program(void *ctx, uint32_t offset, const uint8_t *page) {
+  logger_flash_op_t op = { offset, page };
+  return flash_safe_execute(logger_do_program, &op, LOGGER_LOCKOUT_MS) == PICO_OK;
+}
+
+static void logger_reset_stats(logger_sensor_t *ls, uint32_t now_us) {
+  ls->min = INFINITY;
+  ls->max = -INFINITY;
+  ls->hottest = 0;
+  ls->sum = 0;
+  ls->frames = 0;
+  ls->start_us = now_us;
+}
+
+static int16_t logger_centi(float t) {
+  float c = roundf(t * 100.0f);
+  return (int16_t)(c > INT16_MAX ? INT16_MAX : c < INT16_MIN ? INT16_MIN : c);
+}
+
+static void logger_put_stats(uint8_t sensor, uint32_t time_us, const logger_sensor_t *ls) {
+  flash_log_stats_t st = {
+    .min = logger_centi(ls->min),
+    .max = logger_centi(ls->max),
+    .avg = logger_centi((float)(ls->sum / ls->frames)),
+    .hottest = ls->hottest,
+    .frames = ls->frames,
+  };
+  uint8_t payload[FLASH_LOG_STATS_SIZE];
+  // little-endian, as the log is
+  memcpy(payload, &st.min, 2);
+  memcpy(payload + 2, &st.max, 2);
+  memcpy(payload + 4, &st.avg, 2);
+  memcpy(payload + 6, &st.hottest, 2);
+  memcpy(payload + 8, &st.frames, 2);
+  flash_log_append(&logger_log, FLASH_LOG_STATS, sensor, time_us, payload, sizeof(payload));
+}
+
+void logger_frame(uint8_t sensor, uint32_t time_us, const uint16_t *frame_data, const float *temps) {
+  if (logger_have_frame) {
+    uint32_t gap = time_us - logger_last_frame_us;
+    if (gap < LOGGER_IDLE_US) {
+      logger_interval_us = logger_interval_us ? logger_interval_us - logger_interval_us / 8 + gap / 8 : gap;
+    }
+  }
+  logger_have_frame = true;
+  logger_last_frame_us = time_us;
+  if (!logger_ok || logger_mode == LOGGER_OFF || sensor >= THERMAL_CAMERA_SENSORS) {
+    return;
+  }
+
+  logger_sensor_t *ls = &logger_sensors[sensor];
+  float sum = 0;
+  uint n = 0;
+  for (uint i = 0; i < MLX90640_PIXEL_NUM; i++) {
+    float t = temps[i];
+    if (isnan(t)) {
+      continue;
+    }
+    sum += t;
+    n++;
+    if (t < ls->min) {
+      ls->min = t;
+    }
+    if (t > ls->max) {
+      ls->max = t;
+      ls->hottest = (uint16_t)i;
+    }
+  }
+  if (n > 0) {
+    ls->sum += sum / n;
+    ls->frames++;
+  }
+  if (time_us - ls->start_us >= logger_period_us) {
+    if (ls->frames > 0) {
+      logger_put_stats(sensor, time_us, ls);
+    }
+    logger_reset_stats(ls, time_us);
+  }
+
+  if (logger_mode == LOGGER_FRAMES && (!ls->frame_logged || time_us - ls->frame_us >= logger_period_us)) {
+    size_t len = frame_codec_encode(&logger_codecs[sensor], frame_data, logger_packed, sizeof(logger_packed));
+    if (flash_log_append(&logger_log, FLASH_LOG_FRAME, sensor, time_us, logger_packed, (uint16_t)len)) {
+      ls->frame_us = time_us;
+      ls->frame_logged = true;
+    } else {
+      // the decoder would wait for a key frame anyway, start over with one
+      frame_codec_init(&logger_codecs[sensor], FRAME_CODEC_KEY_INTERVAL);
+    }
+  }
+}
+
+/*
+ * logger_slack_us
+ *
+ * @brief Time until the next subpage is due, less what it takes to start
+ * reading it.
+ */
+static int32_t logger_slack_us(uint32_t now_us) {
+  uint32_t since = now_us - logger_last_frame_us;
+  if (!logger_have_frame || logger_interval_us == 0 || since > LOGGER_IDLE_US) {
+    return INT32_MAX;
+  }
+  return (int32_t)(logger_interval_us - since) - LOGGER_MARGIN_US;
+}
+
+void logger_service(void) {
+  if (!logger_ok) {
+    return;
+  }
+  uint32_t now_ms = time_us_32() / 1000;
+  if (logger_log.fill_used > 0 && now_ms - logger_flush_ms > LOGGER_FLUSH_MS) {
+    flash_log_flush(&logger_log);
+  }
+  if (logger_log.fill_used == 0) {
+    logger_flush_ms = now_ms;
+  }
+  uint32_t dropped = logger_log.counters.dropped;
+  if (dropped != logger_dropped_reported && now_ms - logger_report_ms >= LOGGER_REPORT_MS) {
+    printf("[ERROR] log: %lu records dropped, %lu in all, the flash isn't keeping up.\n",
+      (unsigned long)(dropped - logger_dropped_reported), (unsigned long)dropped);
+    logger_dropped_reported = dropped;
+    logger_report_ms = now_ms;
+  }
+  bool erase;
+  if (!flash_log_pending(&logger_log, &erase)) {
+    return;
+  }
+  int32_t slack = logger_slack_us(time_us_32());
+  if (slack < LOGGER_ERASE_US && flash_log_urgent(&logger_log)) {
+    // too fast for an erase ever to fit between subpages: miss one rather
+    // than fill the queue and drop records
+    flash_log_step(&logger_log, false, true);
+    logger_forced_erases++;
+    return;
+  }
+  flash_log_step(&logger_log, slack >= LOGGER_PROGRAM_US, slack >= LOGGER_ERASE_US);
+}
+
+/*
+ * logger_drain
+ *
+ * @brief Write out everything queued, whatever the sensors are doing.
+ */
+static void logger_drain(void) {
+  flash_log_flush(&logger_log);
+  // bounded, in case the flash keeps failing
+  for (uint tries = 0; logger_log.queue_count > 0 && tries < LOGGER_DRAIN_TRIES; tries++) {
+    flash_log_step(&logger_log, true, logger_log.erased_ahead == 0);
+  }
+}
+
+/*
+ * logger_append_waiting
+ *
+ * @brief Queue a record, writing out what's queued first if it has to.
+ */
+static void logger_append_waiting(uint8_t type, uint8_t sensor, const void *payload, uint16_t len) {
+  if (!flash_log_fits(&logger_log, len)) {
+    logger_drain();
+  }
+  flash_log_append(&logger_log, type, sensor, time_us_32(), payload, len);
+}
+
+void logger_eeprom(uint8_t sensor, const uint16_t *ee_data) {
+  if (logger_ok) {
+    logger_append_waiting(FLASH_LOG_EEPROM, sensor, ee_data, MLX90640_EEPROM_DUMP_NUM * sizeof(uint16_t));
+  }
+}
+
+static const char *logger_mode_name(logger_mode_t mode) {
+  switch (mode) {
+    case LOGGER_STATS: return "stats";
+    case LOGGER_FRAMES: return "frames";
+    default: return "off";
+  }
+}
+
+static void logger_set_mode(logger_mode_t mode) {
+  uint32_t now_us = time_us_32();
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    logger_reset_stats(&logger_sensors[k], now_us);
+    logger_sensors[k].frame_logged = false;
+    frame_codec_init(&logger_codecs[k], FRAME_CODEC_KEY_INTERVAL);
+  }
+  logger_mode = mode;
+}
+
+/*
+ * logger_dump_page
+ *
+ * @brief One page of a dump, as a "LOG <hex>" line for tools/log_decode.
+ */
+static void logger_dump_page(void *ctx, const uint8_t *page) {
+  (void)ctx;
+  printf("LOG ");
+  for (uint j = 0; j < FLASH_LOG_PAGE_SIZE; j++) {
+    printf("%02x", page[j]);
+  }
+  printf("\n");
+}
+
+/*
+ * logger_dump
+ *
+ * @brief Print the newest max_pages pages of the log, oldest first.
+ */
+static void logger_dump(uint32_t max_pages) {
+  logger_drain();
+  uint32_t valid = flash_log_valid_pages(&logger_log);
+  printf("[INFO] log: dumping %lu of %lu pages.\n", (unsigned long)(max_pages && valid > max_pages ? max_pages : valid),
+    (unsigned long)valid);
+  flash_log_dump(&logger_log, max_pages, logger_dump_page, NULL);
+  printf("[INFO] log: dump done.\n");
+}
+
+static void console_log(const char *args) {
+  if (!logger_ok) {
+    printf("[ERROR] log: no flash for it.\n");
+    return;
+  }
+  if (strcmp(args, "off") == 0) {
+    logger_set_mode(LOGGER_OFF);
+  } else if (strcmp(args, "stats") == 0) {
+    logger_set_mode(LOGGER_STATS);
+  } else if (strcmp(args, "frames") == 0) {
+    logger_set_mode(LOGGER_FRAMES);
+  } else if (strncmp(args, "period", 6) == 0) {
+    long ms = strtol(args + 6, NULL, 10);
+    if (ms < 100) {
+      printf("[ERROR] log: period is in ms, 100 or more.\n");
+      return;
+    }
+    logger_period_us = (uint32_t)ms * 1000;
+    logger_set_mode(logger_mode);
+  } else if (strcmp(args, "flush") == 0) {
+    logger_drain();
+  } else if (strncmp(args, "dump", 4) == 0) {
+    logger_dump((uint32_t)strtoul(args + 4, NULL, 10));
+    return;
+  } else if (strcmp(args, "erase") == 0) {
+    printf("[INFO] log: erasing %uKB, the camera stops meanwhile.\n", THERMAL_CAMERA_FLASH_LOG_KB);
+    for (uint32_t s = 0; s < logger_log.n_sectors; s++) {
+      logger_erase(NULL, s * FLASH_SECTOR_SIZE);
+    }
+    flash_log_init(&logger_log, &logger_backend);
+  } else if (args[0] != '\0') {
+    printf("[ERROR] log: unknown command \"%s\".\n", args);
+    return;
+  }
+  const flash_log_counters_t *c = &logger_log.counters;
+  printf("[INFO] log: %s every %lums, %uKB at 0x%08lx, page %lu of %lu, %lu pages queued.\n",
+    logger_mode_name(logger_mode), (unsigned long)(logger_period_us / 1000), THERMAL_CAMERA_FLASH_LOG_KB,
+    (unsigned long)LOGGER_OFFSET, (unsigned long)logger_log.head, (unsigned long)logger_log.n_pages,
+    (unsigned long)logger_log.queue_count);
+  printf("[INFO] log: records %lu dropped %lu, pages %lu erases %lu (%lu forced) wraps %lu failures %lu.\n",
+    (unsigned long)c->records, (unsigned long)c->dropped, (unsigned long)c->pages, (unsigned long)c->erases,
+    (unsigned long)logger_forced_erases, (unsigned long)c->wraps, (unsigned long)c->failures);
+}
+
+void logger_init(logger_mode_t mode, uint32_t period_ms) {
+  logger_period_us = period_ms * 1000;
+  console_register("log", "log [off|stats|frames|period <ms>|flush|dump [pages]|erase]: history in flash", console_log);
+  if ((uintptr_t)&__flash_binary_end - XIP_BASE > LOGGER_OFFSET) {
+    printf("[ERROR] log: the firmware reaches into the %uKB at the top of flash.\n", THERMAL_CAMERA_FLASH_LOG_KB);
+    return;
+  }
+  logger_backend.base = (const uint8_t *)(XIP_BASE + LOGGER_OFFSET);
+  logger_backend.size = LOGGER_SIZE;
+  logger_backend.erase = logger_erase;
+  logger_backend.program = logger_program;
+  if (!flash_log_init(&logger_log, &logger_backend)) {
+    printf("[ERROR] log: %uKB is too small.\n", THERMAL_CAMERA_FLASH_LOG_KB);
+    return;
+  }
+  logger_ok = true;
+  logger_flush_ms = time_us_32() / 1000;
+  logger_set_mode(mode);
+
+  uint8_t boot[8] = { THERMAL_CAMERA_SENSORS, (uint8_t)mode, 0, 0 };
+  memcpy(&boot[4], &period_ms, sizeof(period_ms));
+  logger_append_waiting(FLASH_LOG_BOOT, 0, boot, sizeof(boot));
+  printf("[INFO] log: %s, carrying on at page %lu of %lu.\n", logger_mode_name(mode), (unsigned long)logger_log.head,
+    (unsigned long)logger_log.n_pages);
+}
@@ -14,25 +14,99 @@
 #include "mlx90640/MLX90640_I2C_Driver.h"
 #include "st7789.h"
 #include "st7789_framebuf.h"
+#include "frame_sched.h"
+#include "sensor.h"
+#include "console.h"
+#include "capture.h"
+#include "temporal_filter.h"
+#include "deinterlace.h"
+#if THERMAL_CAMERA_STREAM
+#include "stream.h"
+#endif
+#if THERMAL_CAMERA_GOVERNOR
+#include "governor.h"
+#endif
+#if THERMAL_CAMERA_FLASH_LOG
+#include "pico/flash.h"
+#include "logger.h"
+#endif
+#ifdef THERMAL_CAMERA_BENCH
+#include "bench.h"
+#endif
 #include "pico/multicore.h"
-#include "pico/mutex.h"
 
 #define MLX90640_ADDR 0x33
 #define INITIAL_DELAY_MS 6000
 
+#define MLX90640_REFRESH_RATE_0_5HZ 0b000
+#define MLX90640_REFRESH_RATE_1HZ 0b001
+#define MLX90640_REFRESH_RATE_2HZ 0b010
 #define MLX90640_REFRESH_RATE_4HZ 0b011
 #define MLX90640_REFRESH_RATE_8HZ 0b100
 #define MLX90640_REFRESH_RATE_16HZ 0b101
+#define MLX90640_REFRESH_RATE_32HZ 0b110
+#define MLX90640_REFRESH_RATE_64HZ 0b111
 
-static uint16_t eeData[MLX90640_EEPROM_DUMP_NUM];
+// sensor and display rates are independent, see frame_sched.h
+#ifndef THERMAL_CAMERA_SENSOR_RATE
+#define THERMAL_CAMERA_SENSOR_RATE MLX90640_REFRESH_RATE_8HZ
+#endif
+#ifndef THERMAL_CAMERA_DISPLAY_HZ
+#define THERMAL_CAMERA_DISPLAY_HZ 20
+#endif
+#if THERMAL_CAMERA_FRAME_INTERPOLATE
+#define THERMAL_CAMERA_FRAME_MODE FRAME_SCHED_INTERPOLATE
+#else
+#define THERMAL_CAMERA_FRAME_MODE FRAME_SCHED_HOLD
+#endif
+#define FRAME_STATS_PERIOD_MS 10000
 
-paramsMLX90640 mlx90640;
-static float frameTemperatureCore0[MLX90640_PIXEL_NUM];
-static float frameTemperatureCore1[MLX90640_PIXEL_NUM];
-static uint16_t frameData[MLX90640_PIXEL_NUM + 64 + 2];
+// GPIO that triggers a capture on a falling edge, -1 for console only
+#ifndef THERMAL_CAMERA_CAPTURE_PIN
+#define THERMAL_CAMERA_CAPTURE_PIN -1
+#endif
 
-mutex_t mutex;
-volatile bool frameTemperatureChanged = false;
+// how long to wait when no sensor has data yet, or they're all failing
+#define SENSOR_POLL_US 500
+#define SENSOR_EMISSIVITY 0.95f
+
+// sensor bus clock; the MLX90640 is specified up to 1MHz (FM+)
+#ifndef THERMAL_CAMERA_I2C_FREQ
+#define THERMAL_CAMERA_I2C_FREQ (1000 * 1000)
+#endif
+// the EEPROM only reads reliably at up to 400kHz, which is where the bus starts
+#define SENSOR_EEPROM_I2C_FREQ (400 * 1000)
+
+// whether the temporal noise filter starts on, the console can toggle it
+#ifndef THERMAL_CAMERA_TEMPORAL_FILTER
+#define THERMAL_CAMERA_TEMPORAL_FILTER 1
+#endif
+// whether the pixels a subpage didn't measure are estimated, likewise
+#ifndef THERMAL_CAMERA_DEINTERLACE
+#define THERMAL_CAMERA_DEINTERLACE 1
+#endif
+
+// how often the flash log takes statistics (and frames), see logger.h
+#ifndef THERMAL_CAMERA_FLASH_LOG_PERIOD_MS
+#define THERMAL_CAMERA_FLASH_LOG_PERIOD_MS 1000
+#endif
+
+// range the governor may move the sensor settings in
+#define GOVERNOR_MIN_RATE MLX90640_REFRESH_RATE_1HZ
+#define GOVERNOR_MAX_RATE MLX90640_REFRESH_RATE_64HZ
+#define MLX90640_RESOLUTION_16BIT 0
+#define MLX90640_RESOLUTION_18BIT 2
+#define MLX90640_RESOLUTION_19BIT 3
+
+// panel refresh when pacing flushes, a multiple of the sensor's 8Hz subpage
+// rate. a full flush takes about 79ms in RGB565 (59ms in RGB444) at the SPI
+// clock, and stays tear-free if that's under two refresh periods (83ms here)
+#define ST7789_REFRESH_RATE_HZ 24
+
+// sensor k computes straight into its part of the panorama, see sensor.h
+static sensor_t sensors[THERMAL_CAMERA_SENSORS];
+static float frameTemperatureCore0[FRAME_SCHED_PIXELS];
+static float frameTemperatureCore1[FRAME_SCHED_PIXELS];
 
 /*
  * core1_main
@@ -40,9 +114,26 @@ volatile bool frameTemperatureChanged = false;
  * @brief This core is for loading and sending the frame buffer.
  */
 void core1_main() {
+#if THERMAL_CAMERA_FLASH_LOG
+  // core0 parks this core while it writes the log to flash
+  flash_safe_execute_core_init();
+#endif
+
   // clear the st7789 display
   st7789_init();
 
+#if ST7789_TE_PACING
+  // only start flushes at V-blank, so they don't tear
+  uint refresh_hz = st7789_set_refresh_rate(ST7789_REFRESH_RATE_HZ);
+  st7789_te_enable(true);
+  st7789_framebuf_set_paced(true);
+  printf("[INFO] panel refresh %uHz, flushes paced to V-blank.\n", refresh_hz);
+#endif
+
+#ifdef THERMAL_CAMERA_BENCH
+  bench_run();
+#endif
+
   // display a loading animation while core0 starts up.
   uint32_t t0_ms = time_us_32() / 1000;
   uint32_t t1_ms = t0_ms;
@@ -58,79 +149,309 @@ void core1_main() {
   }
   // clear any remaining loading animations
   st7789_framebuf_fill_rect(0, 0, ST7789_LINE_SIZE-1, ST7789_COLUMN_SIZE-1, BLACK);
+#if THERMAL_CAMERA_STREAM
+  // a flush takes longer than a display tick, the USB link can't wait for
+  // the time between them
+  st7789_set_idle(stream_service);
+#endif
 
   while (1) {
-    mutex_enter_blocking(&mutex);
-    if (frameTemperatureChanged) {
-      st7789_fill_32_24(frameTemperatureCore1);
-      frameTemperatureChanged = false;
+#if THERMAL_CAMERA_STREAM
+    // the time until the next tick goes to the USB link
+    stream_service_until(frame_sched_next_display_us());
+#endif
+    // draw at our own rate, whatever the sensor is doing
+    frame_sched_wait_display();
+    if (frame_sched_display_frame(frameTemperatureCore1, time_us_32())) {
+#if THERMAL_CAMERA_GOVERNOR
+      uint32_t render_t0_us = time_us_32();
+      st7789_fill_panorama(frameTemperatureCore1, THERMAL_CAMERA_SENSORS, THERMAL_CAMERA_PANORAMA_OVERLAP);
+      governor_note_render(time_us_32() - render_t0_us);
+#else
+      st7789_fill_panorama(frameTemperatureCore1, THERMAL_CAMERA_SENSORS, THERMAL_CAMERA_PANORAMA_OVERLAP);
+#endif
     }
-    mutex_exit(&mutex);
   }
 }
 
+/*
+ * print_frame_stats
+ *
+ * @brief Report how frames moved between the sensor and the display.
+ */
+static void print_frame_stats(void) {
+  frame_sched_stats_t stats;
+  frame_sched_get_stats(&stats);
+  printf("[INFO] frames produced %lu consumed %lu dropped %lu, display ticks drawn %lu idle %lu late %lu.\n",
+    (unsigned long)stats.produced, (unsigned long)stats.consumed, (unsigned long)stats.dropped,
+    (unsigned long)stats.displayed, (unsigned long)stats.idle, (unsigned long)stats.late);
+}
+
+/*
+ * print_error_stats
+ *
+ * @brief Report what went wrong on each sensor and bus, and how often.
+ */
+static void print_error_stats(void) {
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    const sensor_t *s = &sensors[k];
+    const sensor_errors_t *e = &s->error_counts;
+    printf("[INFO] sensor 0x%02x%s: subpages %lu, errors %lu (nack %lu timeout %lu frame %lu aux %lu other %lu), recoveries %lu.\n",
+      s->slave_addr, s->ok ? "" : " (not set up)", (unsigned long)s->subpages, (unsigned long)s->errors,
+      (unsigned long)e->nack, (unsigned long)e->timeout, (unsigned long)e->frame, (unsigned long)e->aux,
+      (unsigned long)e->other, (unsigned long)e->recoveries);
+  }
+  for (uint8_t bus = 0; bus < MLX90640_I2C_BUSES; bus++) {
+    mlx90640_i2c_stats_t b;
+    MLX90640_I2CGetStats(bus, &b);
+    printf("[INFO] i2c%u: reads %lu writes %lu, nacks %lu timeouts %lu, bus clears %lu (stuck %lu).\n",
+      bus, (unsigned long)b.reads, (unsigned long)b.writes, (unsigned long)b.nacks,
+      (unsigned long)b.timeouts, (unsigned long)b.recoveries, (unsigned long)b.stuck);
+  }
+}
+
+static void console_stats(const char *args) {
+  (void)args;
+  print_frame_stats();
+  print_error_stats();
+}
+
+/*
+ * sensor_addr
+ *
+ * @brief Where sensor k is: alternating between the two buses, then on to
+ * the next address on each.
+ */
+static uint8_t sensor_addr(uint k) {
+  return MLX90640_I2C_ADDR(k % MLX90640_I2C_BUSES, MLX90640_ADDR + k / MLX90640_I2C_BUSES);
+}
+
+/*
+ * sensor_no_data
+ *
+ * @brief Show sensor k's slice as no data, rather than as a cold slice
+ * pulling the scale down, or its last image frozen.
+ */
+static void sensor_no_data(uint k) {
+  for (uint i = 0; i < MLX90640_PIXEL_NUM; i++) {
+    frameTemperatureCore0[k * MLX90640_PIXEL_NUM + i] = NAN;
+  }
+}
+
+/*
+ * sensor_start
+ *
+ * @brief Set up sensor k, and hand its calibration to whatever needs it.
+ * The bus has to be at SENSOR_EEPROM_I2C_FREQ.
+ */
+static bool sensor_start(uint k) {
+  if (!sensor_init(&sensors[k], sensor_addr(k), THERMAL_CAMERA_SENSOR_RATE, &frameTemperatureCore0[k * MLX90640_PIXEL_NUM])) {
+    return false;
+  }
+#if THERMAL_CAMERA_STREAM
+  // a host needs the calibration to make anything of raw frames
+  stream_set_eeprom(k, sensor_eeprom());
+#endif
+#if THERMAL_CAMERA_FLASH_LOG
+  logger_eeprom(k, sensor_eeprom());
+#endif
+  return true;
+}
+
 int main() {
   stdio_init_all();
 
-  // initialize the mutex and launch core for handling st7789
-  mutex_init(&mutex);
+  // set up the hand-off between the cores and launch core for handling st7789
+  frame_sched_init(THERMAL_CAMERA_DISPLAY_HZ, THERMAL_CAMERA_FRAME_MODE);
   multicore_launch_core1(core1_main);
 
   // add delay for the camera to start up
   sleep_ms(INITIAL_DELAY_MS);
 
-  printf("[INFO] set refresh rate.\n");
-  MLX90640_SetChessMode(MLX90640_ADDR);
-  printf("[INFO] set chess mode.\n");
-  MLX90640_SetSubPageRepeat(MLX90640_ADDR, 0);
-  printf("[INFO] set subpage repeat.\n");
-
-  if (MLX90640_DumpEE(MLX90640_ADDR, eeData) != 0) {
-    printf("[ERROR] DumpEE returned error.\n");
+#if THERMAL_CAMERA_FLASH_LOG
+  // first, so the sensors' EEPROM dumps go in after the boot record
+  logger_init(LOGGER_STATS, THERMAL_CAMERA_FLASH_LOG_PERIOD_MS);
+#endif
+  uint32_t sensors_ok = 0;
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    if (sensor_start(k)) {
+      sensors_ok |= 1u << k;
+    }
+  }
+  if (!sensors_ok) {
+    printf("[ERROR] no MLX90640 answered.\n");
+  }
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    if (!(sensors_ok >> k & 1)) {
+      sensor_no_data(k);
+    }
   }
-  printf("[INFO] dumpEE.\n");
-  // set the refresh rate to be 8Hz
-  MLX90640_SetRefreshRate(MLX90640_ADDR, MLX90640_REFRESH_RATE_8HZ);
 
-  // after reading the EEPROM, we can read much faster.
-  MLX90640_I2CFreqSet(1000 * 1000);
+  // after reading the EEPROMs, we can read much faster.
+  MLX90640_I2CFreqSet(THERMAL_CAMERA_I2C_FREQ);
 
-  if (MLX90640_ExtractParameters(eeData, &mlx90640) != 0) {
-    printf("[ERROR] ExtractParameters returned error.\n");
-  }
-  printf("[INFO] extractparameters.\n");
-  MLX90640_I2CWrite(MLX90640_ADDR, MLX90640_STATUS_REG, MLX90640_INIT_STATUS_VALUE);
+  console_register("stats", "frame, sensor error and I2C bus counters", console_stats);
+  capture_init(sensors, THERMAL_CAMERA_SENSORS, SENSOR_EMISSIVITY, THERMAL_CAMERA_CAPTURE_PIN);
+  temporal_filter_init(THERMAL_CAMERA_TEMPORAL_FILTER);
+  deinterlace_init(THERMAL_CAMERA_DEINTERLACE);
+#if THERMAL_CAMERA_STREAM
+  stream_init(STREAM_TO);
+#endif
 
   uint16_t frameTemperatureColorsRGB565[MLX90640_PIXEL_NUM];
 
-  while (1) {
+#if THERMAL_CAMERA_GOVERNOR
+  // start from the configured settings and let the governor find the limits
+  int resolution = MLX90640_GetCurResolution(sensors[0].slave_addr);
+  if (resolution < 0) {
+    printf("[ERROR] GetCurResolution returned error.\n");
+    resolution = MLX90640_RESOLUTION_18BIT;
+  }
+  const governor_config_t governor_config = {
+    .min_rate = GOVERNOR_MIN_RATE,
+    .max_rate = GOVERNOR_MAX_RATE,
+    .min_res = MLX90640_RESOLUTION_16BIT,
+    .max_res = MLX90640_RESOLUTION_19BIT,
+  };
+  governor_init(&governor_config, THERMAL_CAMERA_SENSOR_RATE, resolution);
+#endif
 
-    int subpage = 0;
-    subpage = MLX90640_GetFrameData(MLX90640_ADDR, frameData);
-    // 0, 1 are valid subpge return values. anything else implies error
-    if (subpage == 0 || subpage == 1) {
-      float eTa = MLX90640_GetTa(frameData, &mlx90640) - 8;
-      float emissivity = 0.95;
+  uint32_t stats_t0_ms = time_us_32() / 1000;
+  // sensors read since the last frame went out; one goes out per round of
+  // the sensors in sensors_ok, the ones set up and not backing off
+  uint32_t sensors_fresh = 0;
 
+  while (1) {
+    if (capture_pending()) {
+      // an image taken after the trigger, shown like any other frame
+      capture_result_t r;
+      if (capture_run(&r)) {
+        frame_sched_publish(frameTemperatureCore0, r.trigger_us + r.result_us);
+      }
+      capture_print(&r);
+      sensors_fresh = 0;
+    }
 
-      MLX90640_CalculateTo(frameData, &mlx90640, emissivity, eTa, frameTemperatureCore0);
+    bool any_read = false;
+    for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+      sensor_t *s = &sensors[k];
+      if (!s->ok && (int32_t)(time_us_32() - s->retry_at_us) >= 0) {
+        // one that didn't come up: try it again every so often, at the
+        // EEPROM's bus speed
+        MLX90640_I2CFreqSet(SENSOR_EEPROM_I2C_FREQ);
+        bool started = sensor_start(k);
+        MLX90640_I2CFreqSet(THERMAL_CAMERA_I2C_FREQ);
+        if (started) {
+          sensors_ok |= 1u << k;
+          sensors_fresh = 0;
+#if THERMAL_CAMERA_GOVERNOR
+          // at whatever the others have been brought to
+          governor_state_t g;
+          governor_get_state(&g);
+          MLX90640_SetRefreshRate(s->slave_addr, g.rate);
+          MLX90640_SetResolution(s->slave_addr, g.res);
+#endif
+        }
+      }
+      if (!s->ok || !sensor_can_read(s)) {
+        continue;
+      }
+      // only read what's there, rather than wait in GetFrameData: several
+      // sensors take turns as their subpages come in, and a capture
+      // trigger doesn't sit behind a subpage period
+      int ready = sensor_data_ready(s);
+#if THERMAL_CAMERA_GOVERNOR
+      uint32_t acq_t0_us = time_us_32();
+#endif
+      int subpage = ready > 0 ? sensor_read(s) : ready;
+      if (subpage < 0) {
+        // quiet once it's backing off, the counters keep track
+        if (s->errors_in_row <= SENSOR_RETRY_AFTER) {
+          printf("[ERROR] MLX90640 0x%02x failed while %s: %s (%d).\n", s->slave_addr,
+            ready < 0 ? "polling status" : "getting frame data", sensor_error_name(subpage), subpage);
+        }
+        if (s->errors_in_row >= SENSOR_RETRY_AFTER && (sensors_ok >> k & 1)) {
+          // don't hold the others' frames for it while it backs off
+          printf("[ERROR] MLX90640 0x%02x keeps failing, showing it as no data.\n", s->slave_addr);
+          sensors_ok &= ~(1u << k);
+          sensors_fresh &= ~(1u << k);
+          sensor_no_data(k);
+        }
+        continue;
+      }
+      if (ready == 0) {
+        continue;
+      }
+      if (!(sensors_ok >> k & 1)) {
+        printf("[INFO] MLX90640 0x%02x is reading again.\n", s->slave_addr);
+        sensors_ok |= 1u << k;
+      }
+      any_read = true;
+      sensor_calculate(s, SENSOR_EMISSIVITY);
+
+#ifdef THERMAL_CAMERA_BENCH
+      static bool benched = false;
+      if (!benched) {
+        bench_run_sensor(s->frame_data, &s->params);
+        benched = true;
+      }
+#endif
 
       // NOTE: leaving this out because we do have bad pixels and this breaks it
-      // MLX90640_BadPixelsCorrection((&mlx90640)->brokenPixels, frameTemperatureCore0, 1, &mlx90640);
-      // MLX90640_BadPixelsCorrection((&mlx90640)->outlierPixels, frameTemperatureCore0, 1, &mlx90640);
+      // MLX90640_BadPixelsCorrection(s->params.brokenPixels, s->temps, 1, &s->params);
+      // MLX90640_BadPixelsCorrection(s->params.outlierPixels, s->temps, 1, &s->params);
+
+#if THERMAL_CAMERA_GOVERNOR
+      if (k == 0) {
+        // all sensors share this core and cost about the same
+        uint n_ok = __builtin_popcount(sensors_ok);
+        uint32_t calc_us = time_us_32() - s->frame_time_us;
+        if (governor_update(s->slave_addr, n_ok * (s->frame_time_us - acq_t0_us), n_ok * calc_us, s->temps, subpage)) {
+          governor_state_t g;
+          governor_get_state(&g);
+          for (uint j = 1; j < THERMAL_CAMERA_SENSORS; j++) {
+            if (sensors[j].ok) {
+              MLX90640_SetRefreshRate(sensors[j].slave_addr, g.rate);
+              MLX90640_SetResolution(sensors[j].slave_addr, g.res);
+            }
+          }
+        }
+      }
+#endif
 
-      // signal to the core1 that we're ready to draw the next frame
-      mutex_enter_blocking(&mutex);
+      // after the governor, which measures the noise this takes out
+      temporal_filter_apply(frameTemperatureCore0, k * MLX90640_PIXEL_NUM, MLX90640_PIXEL_NUM);
+      // last, so the filter only ever sees measurements
+      deinterlace_apply(frameTemperatureCore0, k * MLX90640_PIXEL_NUM, subpage);
+#if THERMAL_CAMERA_STREAM
+      stream_frame(k, subpage, s->frame_time_us, s->frame_data, s->temps);
+#endif
+#if THERMAL_CAMERA_FLASH_LOG
+      logger_frame(k, s->frame_time_us, s->frame_data, s->temps);
+#endif
 
-      frameTemperatureChanged = true;
-      for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
-        frameTemperatureCore1[i] = frameTemperatureCore0[i];
+      sensors_fresh |= 1u << k;
+      if (sensors_fresh == sensors_ok) {
+        // hand the frame over to core1, which picks it up on its next tick
+        frame_sched_publish(frameTemperatureCore0, s->frame_time_us);
+        sensors_fresh = 0;
       }
+    }
+
+#if THERMAL_CAMERA_FLASH_LOG
+    // only writes if it's done before the next subpage is due
+    logger_service();
+#endif
 
-      mutex_exit(&mutex);
+    // nothing ready, or every sensor is failing: don't spin on the bus
+    if (!any_read) {
+      sleep_us(SENSOR_POLL_US);
+    }
+    console_poll();
 
-    } else {
-      printf("[ERROR] MLX90640 failed while getting frame data (%d).\n", subpage);
+    if (time_us_32() / 1000 - stats_t0_ms > FRAME_STATS_PERIOD_MS) {
+      print_frame_stats();
+      stats_t0_ms = time_us_32() / 1000;
     }
   }
 }
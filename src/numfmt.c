@@ -0,0 +1,73 @@
+/*
+ * numfmt.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "numfmt.h"
+
+// enough for the sign, 10 digits of int32_t and a decimal point
+#define NUMFMT_MAX_CHARS 12
+
+static const int32_t numfmt_pow10[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+int32_t numfmt_float_to_fixed(float f, unsigned int decimals) {
+  if (f != f) {
+    // NaN
+    return 0;
+  }
+  if (decimals > 9) {
+    decimals = 9;
+  }
+  float scaled = f * (float)numfmt_pow10[decimals];
+  if (scaled >= 2147483647.0f) {
+    return INT32_MAX;
+  }
+  if (scaled <= -2147483647.0f) {
+    return -INT32_MAX;
+  }
+  return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+size_t numfmt_fixed(char *buf, size_t len, int32_t value, unsigned int decimals, unsigned int width, bool sign_space) {
+  if (len == 0) {
+    return 0;
+  }
+
+  // build the number back to front in a scratch buffer
+  char tmp[NUMFMT_MAX_CHARS];
+  size_t n = 0;
+  bool negative = value < 0;
+  uint32_t mag = negative ? (uint32_t)0 - (uint32_t)value : (uint32_t)value;
+
+  for (unsigned int i = 0; i < decimals && n < NUMFMT_MAX_CHARS; i++) {
+    tmp[n++] = '0' + (mag % 10);
+    mag /= 10;
+  }
+  if (decimals > 0 && n < NUMFMT_MAX_CHARS) {
+    tmp[n++] = '.';
+  }
+  do {
+    tmp[n++] = '0' + (mag % 10);
+    mag /= 10;
+  } while (mag != 0 && n < NUMFMT_MAX_CHARS);
+  if (negative) {
+    tmp[n++] = '-';
+  } else if (sign_space) {
+    tmp[n++] = ' ';
+  }
+
+  // left pad to the requested width, then copy the digits in order
+  size_t out = 0;
+  for (size_t pad = n; pad < width && out + 1 < len; pad++) {
+    buf[out++] = ' ';
+  }
+  while (n > 0 && out + 1 < len) {
+    buf[out++] = tmp[--n];
+  }
+  buf[out] = '\0';
+  return out;
+}
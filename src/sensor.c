@@ -0,0 +1,182 @@
+/*
+ * sensor.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sensor.h"
+#include "mlx90640/MLX90640_I2C_Driver.h"
+
+/*
+ * @brief Ta minus this is the reflected temperature, as the Melexis
+ * examples do for a sensor in open air.
+ */
+#define SENSOR_TA_SHIFT 8
+
+/*
+ * @brief Only needed while extracting the parameters, so it is shared.
+ */
+static uint16_t sensor_ee_data[MLX90640_EEPROM_DUMP_NUM];
+
+/*
+ * sensor_setup
+ *
+ * @brief One go at sensor_init's bus traffic. Returns 0, or the first
+ * error.
+ */
+static int sensor_setup(sensor_t *s, uint8_t rate) {
+  int error;
+  if ((error = MLX90640_SetChessMode(s->slave_addr)) != 0 ||
+      (error = MLX90640_SetSubPageRepeat(s->slave_addr, 0)) != 0) {
+    printf("[ERROR] sensor 0x%02x: setting the reading pattern returned error.\n", s->slave_addr);
+    return error;
+  }
+  if ((error = MLX90640_DumpEE(s->slave_addr, sensor_ee_data)) != 0) {
+    printf("[ERROR] sensor 0x%02x: DumpEE returned error.\n", s->slave_addr);
+    return error;
+  }
+  if ((error = MLX90640_SetRefreshRate(s->slave_addr, rate)) != 0) {
+    printf("[ERROR] sensor 0x%02x: SetRefreshRate returned error.\n", s->slave_addr);
+    return error;
+  }
+  if ((error = MLX90640_ExtractParameters(sensor_ee_data, &s->params)) != 0) {
+    printf("[ERROR] sensor 0x%02x: ExtractParameters returned error.\n", s->slave_addr);
+    return error;
+  }
+  return MLX90640_I2CWrite(s->slave_addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+}
+
+bool sensor_init(sensor_t *s, uint8_t slave_addr, uint8_t rate, float *temps) {
+  s->slave_addr = slave_addr;
+  s->ok = false;
+  s->subpage = -1;
+  s->frame_time_us = 0;
+  s->subpages = 0;
+  s->errors = 0;
+  memset(&s->error_counts, 0, sizeof(s->error_counts));
+  s->errors_in_row = 0;
+  s->retry_at_us = 0;
+  s->temps = temps;
+
+  // one NACK in the EEPROM dump shouldn't cost the sensor for good
+  for (int attempt = 0; attempt < SENSOR_INIT_TRIES; attempt++) {
+    if (attempt > 0) {
+      s->error_counts.recoveries++;
+      MLX90640_I2CBusRecover(slave_addr);
+    }
+    if (sensor_setup(s, rate) == 0) {
+      s->ok = true;
+      printf("[INFO] sensor 0x%02x ready.\n", slave_addr);
+      return true;
+    }
+  }
+  s->retry_at_us = time_us_32() + SENSOR_INIT_RETRY_US;
+  return false;
+}
+
+const uint16_t *sensor_eeprom(void) {
+  return sensor_ee_data;
+}
+
+bool sensor_can_read(const sensor_t *s) {
+  return s->errors_in_row < SENSOR_RETRY_AFTER || (int32_t)(time_us_32() - s->retry_at_us) >= 0;
+}
+
+/*
+ * sensor_recover
+ *
+ * @brief Clear the bus, then clear the status register so the sensor
+ * flags the next subpage as usual. The subpage being read is lost, the
+ * next one isn't.
+ */
+static void sensor_recover(sensor_t *s) {
+  s->error_counts.recoveries++;
+  if (MLX90640_I2CBusRecover(s->slave_addr) != 0) {
+    printf("[ERROR] sensor 0x%02x: bus still held low after clearing it.\n", s->slave_addr);
+    return;
+  }
+  MLX90640_I2CWrite(s->slave_addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+}
+
+/*
+ * sensor_fail
+ *
+ * @brief Count a failed read by its kind, recovering the bus after a NACK
+ * or timeout, and start backing off if it keeps happening. Returns error.
+ */
+static int sensor_fail(sensor_t *s, int error) {
+  s->errors++;
+  switch (-error) {
+    case MLX90640_I2C_NACK_ERROR:
+      s->error_counts.nack++;
+      sensor_recover(s);
+      break;
+    case MLX90640_I2C_TIMEOUT_ERROR:
+      s->error_counts.timeout++;
+      sensor_recover(s);
+      break;
+    case MLX90640_FRAME_DATA_ERROR:
+      s->error_counts.frame++;
+      break;
+    case MLX90640_AUX_DATA_ERROR:
+      s->error_counts.aux++;
+      break;
+    default:
+      s->error_counts.other++;
+      break;
+  }
+  if (++s->errors_in_row >= SENSOR_RETRY_AFTER) {
+    s->retry_at_us = time_us_32() + SENSOR_RETRY_US;
+  }
+  return error;
+}
+
+int sensor_data_ready(sensor_t *s) {
+  uint16_t status;
+  int error = MLX90640_I2CRead(s->slave_addr, MLX90640_STATUS_REG, 1, &status);
+  if (error != 0) {
+    return sensor_fail(s, error);
+  }
+  return MLX90640_GET_DATA_READY(status) ? 1 : 0;
+}
+
+int sensor_read(sensor_t *s) {
+  int subpage = MLX90640_GetFrameData(s->slave_addr, s->frame_data);
+  s->frame_time_us = time_us_32();
+  // 0, 1 are valid subpage return values. anything else implies error
+  if (subpage == 0 || subpage == 1) {
+    s->subpage = subpage;
+    s->subpages++;
+    s->errors_in_row = 0;
+    return subpage;
+  }
+  return sensor_fail(s, subpage < 0 ? subpage : -MLX90640_FRAME_DATA_ERROR);
+}
+
+int sensor_set_step_mode(sensor_t *s, bool step) {
+  uint16_t ctrl;
+  int error = MLX90640_I2CRead(s->slave_addr, MLX90640_CTRL_REG, 1, &ctrl);
+  if (error != 0) {
+    return error;
+  }
+  ctrl = step ? (ctrl | MLX90640_CTRL_STEP_MODE_MASK) : (ctrl & ~MLX90640_CTRL_STEP_MODE_MASK);
+  return MLX90640_I2CWrite(s->slave_addr, MLX90640_CTRL_REG, ctrl);
+}
+
+const char *sensor_error_name(int error) {
+  switch (-error) {
+    case MLX90640_I2C_NACK_ERROR: return "NACK";
+    case MLX90640_I2C_TIMEOUT_ERROR: return "timeout";
+    case MLX90640_FRAME_DATA_ERROR: return "invalid frame";
+    case MLX90640_AUX_DATA_ERROR: return "invalid aux data";
+    default: return "error";
+  }
+}
+
+void sensor_calculate(sensor_t *s, float emissivity) {
+  float eTa = MLX90640_GetTa(s->frame_data, &s->params) - SENSOR_TA_SHIFT;
+  MLX90640_CalculateTo(s->frame_data, &s->params, emissivity, eTa, s->temps);
+}
@@ -7,19 +7,26 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include "hardware/spi.h"
+#include "hardware/dma.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include <malloc.h>
 #include "st7789.h"
 #include "fonts.h"
+#include "numfmt.h"
 #include "st7789_framebuf.h"
+#include "st7789_render.h"
+#include "hotpath.h"
 #include <math.h>
 #include "mlx90640/MLX90640_API.h"
+#include "sensor.h"
 
 #define RES_PIN 21
 #define DC_PIN 20
+#define TE_PIN 22
 
 volatile bool st7789_is_init = false;
 
@@ -55,6 +62,28 @@ const uint16_t heatmap_color_rgb565[] = {
 void st7789_write_data_byte(uint8_t b);
 void st7789_write_command(uint8_t cmd);
 
+/*
+ * @brief COLMOD values: 65k RGB interface with 16 or 12 bits per pixel on
+ * the control interface.
+ */
+#define ST7789_COLMOD_RGB565 0x55
+#define ST7789_COLMOD_RGB444 0x53
+
+/*
+ * @brief MADCTL bits. The screen is drawn rotated; a scan order stream
+ * drops the exchange for the length of the RAMWR, see
+ * st7789_stream_begin_scan.
+ */
+#define ST7789_MADCTL_MY 0x80
+#define ST7789_MADCTL_MX 0x40
+#define ST7789_MADCTL_MV 0x20
+#define ST7789_MADCTL_ROTATED (ST7789_MADCTL_MV | ST7789_MADCTL_MX)
+
+/*
+ * @brief Pixel format the panel was last told to take.
+ */
+static st7789_pixel_format_t st7789_colmod_format = ST7789_PIXEL_FORMAT_RGB565;
+
 void st7789_init(void) {
   gpio_set_function(PICO_DEFAULT_SPI_TX_PIN, GPIO_FUNC_SPI);
   gpio_set_function(PICO_DEFAULT_SPI_RX_PIN, GPIO_FUNC_SPI);
@@ -85,10 +114,11 @@ void st7789_init(void) {
   st7789_write_command(ST7789_CMD_SLPOUT);
   sleep_ms(10);
   st7789_write_command(ST7789_CMD_COLMOD);
-  st7789_write_data_byte(0x55); // 65k RGB interface, 16b per pixel (datasheet: p 224)
+  st7789_write_data_byte(ST7789_COLMOD_RGB565); // 65k RGB interface, 16b per pixel (datasheet: p 224)
+  st7789_colmod_format = ST7789_PIXEL_FORMAT_RGB565;
   sleep_ms(10);
   st7789_write_command(ST7789_CMD_MADCTL);
-  st7789_write_data_byte(0x60); // MV, MX, MY = 1 1 0 (rotate 90 clockwise)
+  st7789_write_data_byte(ST7789_MADCTL_ROTATED); // MV, MX, MY = 1 1 0 (rotate 90 clockwise)
   st7789_write_command(ST7789_CMD_INVON); // adafruit claims this helps to avoid startup issues
   sleep_ms(10);
   st7789_write_command(ST7789_CMD_NORON); // normal display mode on
@@ -97,6 +127,122 @@ void st7789_init(void) {
   sleep_ms(10);
 }
 
+/*
+ * @brief FRCTRL2 RTNA settings 0x00..0x1F and the refresh rate each gives
+ * in normal mode with the default porch settings (datasheet: p 289).
+ */
+static const uint8_t st7789_frctrl2_hz[] = {
+  119, 111, 105, 99, 94, 90, 86, 82, 78, 75, 72, 69, 67, 64, 62, 60,
+  58, 57, 55, 53, 52, 50, 49, 48, 46, 45, 44, 43, 42, 41, 40, 39,
+};
+
+/*
+ * @brief A frame is 320 lines plus the back and front porches (PORCTRL),
+ * 12 each by default. Below what RTNA alone can do, longer porches slow
+ * the refresh further, up to 127 lines each.
+ */
+#define ST7789_FRAME_LINES 320
+#define ST7789_PORCH_DEFAULT 0x0C
+#define ST7789_PORCH_MAX 0x7F
+
+uint st7789_set_refresh_rate(uint hz) {
+  uint8_t rtna = 0;
+  for (uint8_t i = 1; i < count_of(st7789_frctrl2_hz); i++) {
+    if (abs((int)st7789_frctrl2_hz[i] - (int)hz) < abs((int)st7789_frctrl2_hz[rtna] - (int)hz)) {
+      rtna = i;
+    }
+  }
+  uint lines = ST7789_FRAME_LINES + 2 * ST7789_PORCH_DEFAULT;
+  uint porches = 2 * ST7789_PORCH_DEFAULT;
+  if (hz > 0 && hz < st7789_frctrl2_hz[rtna]) {
+    // the slowest RTNA, and as many porch lines as it takes
+    porches = (st7789_frctrl2_hz[rtna] * lines + hz / 2) / hz - ST7789_FRAME_LINES;
+    if (porches > 2 * ST7789_PORCH_MAX) {
+      porches = 2 * ST7789_PORCH_MAX;
+    }
+  }
+  // back porch, front porch, then the defaults for the rest
+  uint8_t porctrl[5] = { (porches + 1) / 2, porches / 2, 0x00, 0x33, 0x33 };
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_command(&cl, ST7789_CMD_PORCTRL, porctrl, sizeof(porctrl));
+  st7789_cmdlist_command(&cl, ST7789_CMD_FRCTR2, &rtna, 1);
+  st7789_cmdlist_execute(&cl);
+  return (st7789_frctrl2_hz[rtna] * lines + (ST7789_FRAME_LINES + porches) / 2) / (ST7789_FRAME_LINES + porches);
+}
+
+// run while waiting on the DMA or V-blank, see st7789_set_idle
+static void (*st7789_idle)(void) = NULL;
+
+void st7789_set_idle(void (*idle)(void)) {
+  st7789_idle = idle;
+}
+
+/*
+ * @brief V-blank pulses seen on the TE pin, and when the last two arrived.
+ */
+static volatile uint32_t st7789_vsync_count = 0;
+static volatile uint32_t st7789_vsync_time_us = 0;
+static volatile uint32_t st7789_vsync_period_us = 0;
+static bool st7789_te_irq_added = false;
+
+static void st7789_te_irq(void) {
+  if (gpio_get_irq_event_mask(TE_PIN) & GPIO_IRQ_EDGE_RISE) {
+    gpio_acknowledge_irq(TE_PIN, GPIO_IRQ_EDGE_RISE);
+    uint32_t now = time_us_32();
+    if (st7789_vsync_count > 0) {
+      st7789_vsync_period_us = now - st7789_vsync_time_us;
+    }
+    st7789_vsync_time_us = now;
+    st7789_vsync_count++;
+  }
+}
+
+void st7789_te_enable(bool enable) {
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  if (enable) {
+    // TEM = 0, pulse on V-blank only
+    uint8_t tem = 0x00;
+    st7789_cmdlist_command(&cl, ST7789_CMD_TEON, &tem, 1);
+  } else {
+    st7789_cmdlist_command(&cl, ST7789_CMD_TEOFF, NULL, 0);
+  }
+  st7789_cmdlist_execute(&cl);
+
+  if (enable && !st7789_te_irq_added) {
+    gpio_init(TE_PIN);
+    gpio_set_dir(TE_PIN, GPIO_IN);
+    // the irq lands on whichever core runs this, the one driving the display
+    gpio_add_raw_irq_handler(TE_PIN, st7789_te_irq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    st7789_te_irq_added = true;
+  }
+  gpio_set_irq_enabled(TE_PIN, GPIO_IRQ_EDGE_RISE, enable);
+  if (!enable) {
+    st7789_vsync_period_us = 0;
+  }
+}
+
+bool st7789_wait_vsync(uint32_t timeout_us) {
+  uint32_t count = st7789_vsync_count;
+  uint32_t t0 = time_us_32();
+  while (st7789_vsync_count == count) {
+    if (time_us_32() - t0 > timeout_us) {
+      return false;
+    }
+    if (st7789_idle) {
+      st7789_idle();
+    }
+    tight_loop_contents();
+  }
+  return true;
+}
+
+uint32_t st7789_refresh_period_us(void) {
+  return st7789_vsync_period_us;
+}
+
 void st7789_dc_data(void) {
   gpio_put(DC_PIN, 1);
 }
@@ -115,79 +261,351 @@ void st7789_unselect(void) {
   gpio_put(PICO_DEFAULT_SPI_CSN_PIN, 1);
 }
 
-void st7789_write_data(uint8_t *buf, uint len) {
-  if (!st7789_is_init) {
-    st7789_init();
+/*
+ * @brief Payloads at least this many frames long go out over DMA, anything
+ * shorter isn't worth the channel setup.
+ */
+#define ST7789_DMA_MIN_LEN 64
+
+static int st7789_dma_chan = -1;
+static uint st7789_spi_bits = 8;
+/*
+ * st7789_dma_wait
+ *
+ * @brief Wait for the channel to finish, running the idle hook meanwhile.
+ */
+static void st7789_dma_wait(void) {
+  if (st7789_idle) {
+    while (dma_channel_is_busy(st7789_dma_chan)) {
+      st7789_idle();
+    }
   }
-  st7789_dc_data();
-  st7789_select();
-  spi_write_blocking(spi_default, buf, len);
-  st7789_unselect();
+  dma_channel_wait_for_finish_blocking(st7789_dma_chan);
 }
 
-void st7789_write_data_words(uint16_t *buf, uint len) {
-  size_t newlen = len * 2;
+/*
+ * st7789_spi_set_bits
+ *
+ * @brief Switch the SPI frame size between 8 and 16 bits. 16-bit frames are
+ * shifted out MSB first, so RGB565 words go out big-endian without swapping.
+ */
+static void st7789_spi_set_bits(uint bits) {
+  if (bits == st7789_spi_bits) {
+    return;
+  }
+  spi_set_format(spi_default, bits, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+  st7789_spi_bits = bits;
+}
 
-  // shift word-sized buffer around to be big-endian
-  for (int i = 0; i < len; i++) {
-    uint16_t temp = buf[i];
-    buf[i] = (temp >> 8) | (temp << 8); // HSB -> LSB order
+/*
+ * st7789_spi_dma_start
+ *
+ * @brief Start pushing a buffer through the SPI TX FIFO with DMA and return
+ * straight away.
+ */
+static void st7789_spi_dma_start(const void *buf, size_t len, uint bits) {
+  if (st7789_dma_chan < 0) {
+    st7789_dma_chan = dma_claim_unused_channel(true);
   }
-  // cast buffer as uint8_t* after we shift its endianness
-  st7789_write_data((uint8_t*)buf, newlen);
+  dma_channel_config c = dma_channel_get_default_config(st7789_dma_chan);
+  channel_config_set_transfer_data_size(&c, bits == 16 ? DMA_SIZE_16 : DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, spi_get_dreq(spi_default, true));
+  dma_channel_configure(st7789_dma_chan, &c, &spi_get_hw(spi_default)->dr, buf, len, true);
+}
 
-  // unshift word-sized buffer around to be little-endian
-  // so that we don't leave the data mutated.
-  for (int i = 0; i < len; i++) {
-    uint16_t temp = buf[i];
-    buf[i] = (temp >> 8) | (temp << 8);
+/*
+ * st7789_spi_dma_finish
+ *
+ * @brief Wait for the DMA transfer to end and the last frame to leave the
+ * shift register.
+ */
+static void st7789_spi_dma_finish(void) {
+  if (st7789_dma_chan >= 0) {
+    st7789_dma_wait();
   }
+
+  // wait for shifting to finish, then throw away whatever we clocked in
+  while (spi_is_busy(spi_default)) {
+    tight_loop_contents();
+  }
+  while (spi_is_readable(spi_default)) {
+    (void)spi_get_hw(spi_default)->dr;
+  }
+  spi_get_hw(spi_default)->icr = SPI_SSPICR_RORIC_BITS;
 }
 
-void st7789_write_data_byte(uint8_t b) {
-  st7789_write_data(&b, 1);
+/*
+ * st7789_spi_write_dma
+ *
+ * @brief Push a segment through the SPI TX FIFO with DMA and wait for it.
+ */
+static void st7789_spi_write_dma(const void *buf, size_t len, uint bits) {
+  st7789_spi_dma_start(buf, len, bits);
+  st7789_spi_dma_finish();
 }
 
+void st7789_cmdlist_init(st7789_cmdlist_t *cl) {
+  cl->n_segments = 0;
+  cl->inline_len = 0;
+}
 
-void st7789_write_command(uint8_t cmd) {
+/*
+ * st7789_cmdlist_push
+ *
+ * @brief Append a segment, merging it into the previous one when they share
+ * DC and frame size and the bytes are contiguous.
+ */
+static bool st7789_cmdlist_push(st7789_cmdlist_t *cl, bool dc, uint8_t bits, const void *buf, size_t len) {
+  if (len == 0) {
+    return true;
+  }
+  if (cl->n_segments > 0) {
+    st7789_segment_t *prev = &cl->segments[cl->n_segments - 1];
+    if (prev->dc == dc && prev->bits == bits && (const uint8_t *)prev->buf + prev->len * (bits / 8) == buf) {
+      prev->len += len;
+      return true;
+    }
+  }
+  if (cl->n_segments == ST7789_CMDLIST_MAX_SEGMENTS) {
+    printf("[ERROR] st7789_cmdlist: out of segments.\n");
+    return false;
+  }
+  st7789_segment_t *seg = &cl->segments[cl->n_segments++];
+  seg->dc = dc;
+  seg->bits = bits;
+  seg->buf = buf;
+  seg->len = len;
+  return true;
+}
+
+/*
+ * st7789_cmdlist_copy
+ *
+ * @brief Copy small bytes into the list's own storage so the caller doesn't
+ * have to keep them alive until the list is executed.
+ */
+static bool st7789_cmdlist_copy(st7789_cmdlist_t *cl, bool dc, const uint8_t *buf, size_t len) {
+  if (cl->inline_len + len > ST7789_CMDLIST_INLINE_SIZE) {
+    printf("[ERROR] st7789_cmdlist: out of inline storage.\n");
+    return false;
+  }
+  uint8_t *dst = &cl->inline_buf[cl->inline_len];
+  for (size_t i = 0; i < len; i++) {
+    dst[i] = buf[i];
+  }
+  cl->inline_len += len;
+  return st7789_cmdlist_push(cl, dc, 8, dst, len);
+}
+
+bool st7789_cmdlist_command(st7789_cmdlist_t *cl, uint8_t cmd, const uint8_t *params, size_t n_params) {
+  return st7789_cmdlist_copy(cl, false, &cmd, 1) && st7789_cmdlist_copy(cl, true, params, n_params);
+}
+
+bool st7789_cmdlist_window(st7789_cmdlist_t *cl, uint x0, uint y0, uint x1, uint y1) {
+  const uint8_t caset[4] = { (x0 >> 8) & 0xFF, x0 & 0xFF, (x1 >> 8) & 0xFF, x1 & 0xFF };
+  const uint8_t raset[4] = { (y0 >> 8) & 0xFF, y0 & 0xFF, (y1 >> 8) & 0xFF, y1 & 0xFF };
+  return st7789_cmdlist_command(cl, ST7789_CMD_CASET, caset, 4)
+      && st7789_cmdlist_command(cl, ST7789_CMD_RASET, raset, 4);
+}
+
+bool st7789_cmdlist_ramwr(st7789_cmdlist_t *cl, st7789_pixel_format_t format) {
+  if (format != st7789_colmod_format) {
+    uint8_t colmod = format == ST7789_PIXEL_FORMAT_RGB444 ? ST7789_COLMOD_RGB444 : ST7789_COLMOD_RGB565;
+    if (!st7789_cmdlist_command(cl, ST7789_CMD_COLMOD, &colmod, 1)) {
+      return false;
+    }
+    st7789_colmod_format = format;
+  }
+  return st7789_cmdlist_command(cl, ST7789_CMD_RAMWR, NULL, 0);
+}
+
+bool st7789_cmdlist_data(st7789_cmdlist_t *cl, const uint8_t *buf, size_t len) {
+  return st7789_cmdlist_push(cl, true, 8, buf, len);
+}
+
+bool st7789_cmdlist_data_words(st7789_cmdlist_t *cl, const uint16_t *buf, size_t len) {
+  return st7789_cmdlist_push(cl, true, 16, buf, len);
+}
+
+/*
+ * st7789_cmdlist_send
+ *
+ * @brief Send every segment of the list. The caller holds chip select.
+ */
+static void st7789_cmdlist_send(const st7789_cmdlist_t *cl) {
+  // DC only flips between command and data segments. each write below
+  // returns once the bus is idle, so it's safe to flip DC straight after.
+  int dc = -1;
+  for (size_t i = 0; i < cl->n_segments; i++) {
+    const st7789_segment_t *seg = &cl->segments[i];
+    if (seg->dc != dc) {
+      if (seg->dc) {
+        st7789_dc_data();
+      } else {
+        st7789_dc_command();
+      }
+      dc = seg->dc;
+    }
+    st7789_spi_set_bits(seg->bits);
+    if (seg->len >= ST7789_DMA_MIN_LEN) {
+      st7789_spi_write_dma(seg->buf, seg->len, seg->bits);
+    } else if (seg->bits == 16) {
+      spi_write16_blocking(spi_default, seg->buf, seg->len);
+    } else {
+      spi_write_blocking(spi_default, seg->buf, seg->len);
+    }
+  }
+}
+
+void st7789_cmdlist_execute(const st7789_cmdlist_t *cl) {
   if (!st7789_is_init) {
     st7789_init();
   }
-  st7789_dc_command();
+  if (cl->n_segments == 0) {
+    return;
+  }
+
+  // every segment goes out under one chip select
   st7789_select();
-  spi_write_blocking(spi_default, &cmd, 1);
+  st7789_cmdlist_send(cl);
+  st7789_spi_set_bits(8);
   st7789_unselect();
 }
 
-void st7789_set_window(uint x0, uint y0, uint x1, uint y1) {
-  uint8_t data[4];
+void st7789_stream_begin(uint x0, uint y0, uint x1, uint y1, st7789_pixel_format_t format) {
+  if (!st7789_is_init) {
+    st7789_init();
+  }
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_window(&cl, x0, y0, x1, y1);
+  st7789_cmdlist_ramwr(&cl, format);
 
-  // column address set for x0, x1
-  st7789_write_command(ST7789_CMD_CASET);
-  data[0] = (x0 >> 8) & 0xFF;
-  data[1] = (x0 >> 0) & 0xFF;
-  data[2] = (x1 >> 8) & 0xFF;
-  data[3] = (x1 >> 0) & 0xFF;
-  st7789_write_data(data, 4);
+  // leave chip select asserted with DC on data for the chunks to follow
+  st7789_select();
+  st7789_cmdlist_send(&cl);
+  st7789_dc_data();
+}
 
-  // row address set for y0, y1
-  st7789_write_command(ST7789_CMD_RASET);
-  data[0] = (y0 >> 8) & 0xFF;
-  data[1] = (y0 >> 0) & 0xFF;
-  data[2] = (y1 >> 8) & 0xFF;
-  data[3] = (y1 >> 0) & 0xFF;
-  st7789_write_data(data, 4);
+/*
+ * @brief Whether the stream open is in scan order, with MADCTL to put back.
+ */
+static bool st7789_stream_scan = false;
+
+void st7789_stream_begin_scan(st7789_pixel_format_t format, bool reversed) {
+  if (!st7789_is_init) {
+    st7789_init();
+  }
+  // without the exchange the address counter runs the way the panel scans,
+  // and MX still mirrors the screen's y as it does drawn rotated; MY turns
+  // the columns round for a scan from the right
+  uint8_t madctl = ST7789_MADCTL_MX | (reversed ? ST7789_MADCTL_MY : 0);
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_command(&cl, ST7789_CMD_MADCTL, &madctl, 1);
+  st7789_cmdlist_window(&cl, 0, 0, ST7789_COLUMN_SIZE - 1, ST7789_LINE_SIZE - 1);
+  st7789_cmdlist_ramwr(&cl, format);
+
+  st7789_select();
+  st7789_cmdlist_send(&cl);
+  st7789_dc_data();
+  st7789_stream_scan = true;
 }
 
-void st7789_draw_pixel(uint x, uint y, uint16_t color) {
-  st7789_set_window(x, y, x, y);
-  st7789_write_command(ST7789_CMD_RAMWR);
-  uint8_t data[2];
+void st7789_stream_data(const void *buf, size_t len, uint bits) {
+  // the previous chunk has to be out of the way before we reprogram the
+  // channel, but this one is left running while the caller fills the next
+  if (st7789_dma_chan >= 0) {
+    st7789_dma_wait();
+  }
+  if (bits != st7789_spi_bits) {
+    st7789_spi_dma_finish();
+    st7789_spi_set_bits(bits);
+  }
+  st7789_spi_dma_start(buf, len, bits);
+}
 
-  data[0] = (color >> 8) & 0xFF; // HSB
-  data[1] = (color >> 0) & 0xFF; // LSB
+void st7789_stream_end(void) {
+  st7789_spi_dma_finish();
+  st7789_spi_set_bits(8);
+  if (st7789_stream_scan) {
+    // back to drawing rotated, under the same chip select
+    uint8_t madctl = ST7789_MADCTL_ROTATED;
+    st7789_cmdlist_t cl;
+    st7789_cmdlist_init(&cl);
+    st7789_cmdlist_command(&cl, ST7789_CMD_MADCTL, &madctl, 1);
+    st7789_cmdlist_send(&cl);
+    st7789_stream_scan = false;
+  }
+  st7789_unselect();
+}
+
+// keep the top 4 bits of each channel: RRRR GGGG BBBB
+#define RGB565_TO_444(c) ((((c) >> 4) & 0xF00) | (((c) >> 3) & 0x0F0) | (((c) >> 1) & 0x00F))
+
+void HOT_FUNC(st7789_pack_rgb444)(uint8_t *dst, const uint16_t *src, size_t n) {
+  for (; n >= 2; n -= 2) {
+    uint32_t a = RGB565_TO_444(src[0]);
+    uint32_t b = RGB565_TO_444(src[1]);
+    dst[0] = a >> 4;
+    dst[1] = (a << 4) | (b >> 8);
+    dst[2] = b;
+    src += 2;
+    dst += 3;
+  }
+  if (n) {
+    // half a pair, the panel ignores the missing nibbles past the window
+    uint32_t a = RGB565_TO_444(src[0]);
+    dst[0] = a >> 4;
+    dst[1] = a << 4;
+  }
+}
+
+void st7789_write_data(uint8_t *buf, uint len) {
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_data(&cl, buf, len);
+  st7789_cmdlist_execute(&cl);
+}
+
+void st7789_write_data_words(uint16_t *buf, uint len) {
+  // 16-bit SPI frames put the words on the wire big-endian, so the buffer
+  // no longer has to be byte swapped (and swapped back) around the write.
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_data_words(&cl, buf, len);
+  st7789_cmdlist_execute(&cl);
+}
+
+void st7789_write_data_byte(uint8_t b) {
+  st7789_write_data(&b, 1);
+}
+
+
+void st7789_write_command(uint8_t cmd) {
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_command(&cl, cmd, NULL, 0);
+  st7789_cmdlist_execute(&cl);
+}
+
+void st7789_set_window(uint x0, uint y0, uint x1, uint y1) {
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_window(&cl, x0, y0, x1, y1);
+  st7789_cmdlist_execute(&cl);
+}
 
-  st7789_write_data(data, 2);
+void st7789_draw_pixel(uint x, uint y, uint16_t color) {
+  // window, RAMWR and the pixel all go out in a single transaction
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_window(&cl, x, y, x, y);
+  st7789_cmdlist_ramwr(&cl, ST7789_PIXEL_FORMAT_RGB565);
+  st7789_cmdlist_data_words(&cl, &color, 1);
+  st7789_cmdlist_execute(&cl);
 }
 
 /*
@@ -227,22 +645,23 @@ void st7789_draw_line(uint x0, uint y0, uint x1, uint y1, uint16_t color) {
 }
 
 void st7789_fill_rect(uint x0, uint y0, uint x1, uint y1, uint16_t color) {
-  st7789_set_window(x0, y0, x1, y1);
-  st7789_write_command(ST7789_CMD_RAMWR);
   uint32_t rect_size_words = (x1 - x0 + 1) * (y1 - y0 + 1);
-  uint32_t rect_size_bytes = rect_size_words * sizeof(uint16_t);
   // each pixel has size uint16_t
-  uint8_t *buf = malloc(rect_size_bytes);
+  uint16_t *buf = malloc(rect_size_words * sizeof(uint16_t));
   if (!buf) {
     printf("[ERROR] st7789_fill_rect: unable to malloc.\n");
     return;
   }
   // fill the entire buffer with the same color
   for (int i = 0; i < rect_size_words; i++) {
-    buf[2 * i]     = (color >> 8) & 0xFF; // HSB
-    buf[2 * i + 1] = (color >> 0) & 0xFF; // LSB
+    buf[i] = color;
   }
-  st7789_write_data(buf, rect_size_bytes);
+  st7789_cmdlist_t cl;
+  st7789_cmdlist_init(&cl);
+  st7789_cmdlist_window(&cl, x0, y0, x1, y1);
+  st7789_cmdlist_ramwr(&cl, ST7789_PIXEL_FORMAT_RGB565);
+  st7789_cmdlist_data_words(&cl, buf, rect_size_words);
+  st7789_cmdlist_execute(&cl);
   free(buf);
 }
 
@@ -344,55 +763,207 @@ void st7789_loading_ani_tick(void) {
  * the camera; define (x,y) = (max,max) to be "B" corner
  *
  * @note I don't like how they (Melexis) have 0-index on the right. It just leads to confusion.
+ *
+ * The A/B placement boils down to a transpose and a flip on each axis. When
+ * the sensor is rotated by 90 or 270 degrees its x runs along the st7789's y.
  */
-void mlx90640_xy_to_st7789_xy(size_t xi_mlx, size_t yi_mlx, size_t *xi_st, size_t *yi_st) {
-  if (false) {
-  } else if (MLX90640_A_GLOBAL_X < MLX90640_B_GLOBAL_X && MLX90640_A_GLOBAL_Y < MLX90640_B_GLOBAL_Y) {
-    // A at top-left, B at bottom-right (0deg CCW)
-    float sx = (float)((int)MLX90640_B_GLOBAL_X - (int)MLX90640_A_GLOBAL_X) / (MLX90640_LINE_SIZE - 1);
-    float sy = (float)((int)MLX90640_B_GLOBAL_Y - (int)MLX90640_A_GLOBAL_Y) / (MLX90640_COLUMN_SIZE - 1);
-    *xi_st = (size_t)(MLX90640_A_GLOBAL_X + xi_mlx * sx + 0.5f);
-    *yi_st = (size_t)(MLX90640_A_GLOBAL_Y + yi_mlx * sy + 0.5f);
-  } else if (MLX90640_A_GLOBAL_X < MLX90640_B_GLOBAL_X && MLX90640_A_GLOBAL_Y > MLX90640_B_GLOBAL_Y) {
-    // A at bottom-left, B at top-right (90deg CCW)
-    float sx = (float)((int)MLX90640_B_GLOBAL_X - (int)MLX90640_A_GLOBAL_X) / (MLX90640_COLUMN_SIZE - 1);
-    float sy = (float)((int)MLX90640_B_GLOBAL_Y - (int)MLX90640_A_GLOBAL_Y) / (MLX90640_LINE_SIZE - 1);
-    *xi_st = (size_t)(MLX90640_A_GLOBAL_X + yi_mlx * sx + 0.5f);
-    *yi_st = (size_t)(MLX90640_A_GLOBAL_Y + xi_mlx * sy + 0.5f);
-  } else if (MLX90640_A_GLOBAL_X > MLX90640_B_GLOBAL_X && MLX90640_A_GLOBAL_Y > MLX90640_B_GLOBAL_Y) {
-    // A at bottom-right, B at top-left (180deg CCW)
-    float sx = (float)((int)MLX90640_B_GLOBAL_X - (int)MLX90640_A_GLOBAL_X) / (MLX90640_LINE_SIZE - 1);
-    float sy = (float)((int)MLX90640_B_GLOBAL_Y - (int)MLX90640_A_GLOBAL_Y) / (MLX90640_COLUMN_SIZE - 1);
-    *xi_st = (size_t)(MLX90640_A_GLOBAL_X + xi_mlx * sx + 0.5f);
-    *yi_st = (size_t)(MLX90640_A_GLOBAL_Y + yi_mlx * sy + 0.5f);
-  } else if (MLX90640_A_GLOBAL_X > MLX90640_B_GLOBAL_X && MLX90640_A_GLOBAL_Y < MLX90640_B_GLOBAL_Y) {
-    // A at top-right, B at bottom-left (270deg CCW)
-    float sx = (float)((int)MLX90640_B_GLOBAL_X - (int)MLX90640_A_GLOBAL_X) / (MLX90640_COLUMN_SIZE - 1);
-    float sy = (float)((int)MLX90640_B_GLOBAL_Y - (int)MLX90640_A_GLOBAL_Y) / (MLX90640_LINE_SIZE - 1);
-    *xi_st = (size_t)(MLX90640_A_GLOBAL_X + yi_mlx * sx + 0.5f);
-    *yi_st = (size_t)(MLX90640_A_GLOBAL_Y + xi_mlx * sy + 0.5f);
-  }
-}
+#define MLX90640_SWAP_XY ((MLX90640_A_GLOBAL_X < MLX90640_B_GLOBAL_X) != (MLX90640_A_GLOBAL_Y < MLX90640_B_GLOBAL_Y))
+#define MLX90640_FLIP_X (MLX90640_A_GLOBAL_X > MLX90640_B_GLOBAL_X)
+#define MLX90640_FLIP_Y (MLX90640_A_GLOBAL_Y > MLX90640_B_GLOBAL_Y)
+// st7789 rect the sensor image is drawn into
+#define MLX90640_ST7789_X0 (MLX90640_FLIP_X ? MLX90640_B_GLOBAL_X : MLX90640_A_GLOBAL_X)
+#define MLX90640_ST7789_Y0 (MLX90640_FLIP_Y ? MLX90640_B_GLOBAL_Y : MLX90640_A_GLOBAL_Y)
+#define MLX90640_ST7789_W (abs(MLX90640_B_GLOBAL_X - MLX90640_A_GLOBAL_X) + 1)
+#define MLX90640_ST7789_H (abs(MLX90640_B_GLOBAL_Y - MLX90640_A_GLOBAL_Y) + 1)
 
 // define the index to go in the opposite x-order, because the MLX90640 goes right->left, top-bottom
 #define MLX90640_INDEX(xi, yi) ((yi) * MLX90640_LINE_SIZE + (MLX90640_LINE_SIZE - 1 - (xi)))
 
+/*
+ * @brief Frame index of each pixel of the sensor image (a panorama of
+ * several sensors side by side, see sensor.h), in screen orientation and
+ * row-major order. The stitching is all in here, so it costs nothing per
+ * frame. Built on first use and whenever the layout changes.
+ */
+static uint16_t mlx90640_screen_order[SENSOR_PANORAMA_PIXELS(THERMAL_CAMERA_SENSORS)];
+static uint mlx90640_screen_n = 0;  // sensors it was built for, 0 before the first
+static uint mlx90640_screen_overlap = 0;
+static size_t mlx90640_screen_len = 0;
+// size of the image once it's turned the way it sits on the screen
+static uint mlx90640_screen_w = 0;
+static uint mlx90640_screen_h = 0;
+// st7789 rect it's drawn into
+static uint mlx90640_rect_x0 = 0;
+static uint mlx90640_rect_y0 = 0;
+static uint mlx90640_rect_w = 0;
+static uint mlx90640_rect_h = 0;
+
+static void mlx90640_build_screen_order(uint n, uint overlap) {
+  uint pano_w = SENSOR_PANORAMA_W(n, overlap);
+  mlx90640_screen_w = MLX90640_SWAP_XY ? MLX90640_COLUMN_SIZE : pano_w;
+  mlx90640_screen_h = MLX90640_SWAP_XY ? pano_w : MLX90640_COLUMN_SIZE;
+  for (size_t k = 0; k < n; k++) {
+    for (size_t yi_mlx = 0; yi_mlx < MLX90640_COLUMN_SIZE; yi_mlx++) {
+      // columns the sensor before already covers are left out
+      for (size_t xi_mlx = k ? overlap : 0; xi_mlx < MLX90640_LINE_SIZE; xi_mlx++) {
+        size_t x = k * (MLX90640_LINE_SIZE - overlap) + xi_mlx;
+        size_t u = MLX90640_SWAP_XY ? yi_mlx : x;
+        size_t v = MLX90640_SWAP_XY ? x : yi_mlx;
+        if (MLX90640_FLIP_X) u = mlx90640_screen_w - 1 - u;
+        if (MLX90640_FLIP_Y) v = mlx90640_screen_h - 1 - v;
+        mlx90640_screen_order[v * mlx90640_screen_w + u] = k * MLX90640_PIXEL_NUM + MLX90640_INDEX(xi_mlx, yi_mlx);
+      }
+    }
+  }
+  mlx90640_screen_len = (size_t)pano_w * MLX90640_COLUMN_SIZE;
+
+  // the panorama keeps the full length of the rect along the sensors' x
+  // axis, and is narrowed across it to keep the pixels the same shape
+  mlx90640_rect_x0 = MLX90640_ST7789_X0;
+  mlx90640_rect_y0 = MLX90640_ST7789_Y0;
+  mlx90640_rect_w = MLX90640_ST7789_W;
+  mlx90640_rect_h = MLX90640_ST7789_H;
+  if (MLX90640_SWAP_XY) {
+    mlx90640_rect_w = MLX90640_ST7789_W * MLX90640_LINE_SIZE / pano_w;
+    mlx90640_rect_x0 += (MLX90640_ST7789_W - mlx90640_rect_w) / 2;
+  } else {
+    mlx90640_rect_h = MLX90640_ST7789_H * MLX90640_LINE_SIZE / pano_w;
+    mlx90640_rect_y0 += (MLX90640_ST7789_H - mlx90640_rect_h) / 2;
+  }
+  mlx90640_screen_n = n;
+  mlx90640_screen_overlap = overlap;
+}
+
+/*
+ * @brief the sensor image after color mapping, in screen orientation.
+ */
+static st7789_pixel_t mlx90640_screen_pixels[SENSOR_PANORAMA_PIXELS(THERMAL_CAMERA_SENSORS)];
+
+/*
+ * @brief What a sensor with nothing to show is drawn in, well away from
+ * the heatmap's colors.
+ */
+#define NO_DATA_COLOR RGB565(64, 64, 64)
+
+#if ST7789_FRAMEBUF_INDEXED
+/*
+ * @brief The heatmap lives in the reserved palette slots, so the image is
+ * mapped to slot numbers and the colors are loaded into the palette once.
+ * Slot 0 is what a frame buffer never drawn on holds, so it stays black.
+ * The no data color comes straight after the heatmap.
+ */
+#define HEATMAP_PALETTE_FIRST 1
+static st7789_pixel_t heatmap_pixels[N_HEATMAP_COLORS];
+static bool heatmap_pixels_init = false;
+#define no_data_pixel (HEATMAP_PALETTE_FIRST + N_HEATMAP_COLORS)
+
+static void st7789_heatmap_pixels_init(void) {
+  static const uint16_t no_data_color = NO_DATA_COLOR;
+  for (size_t i = 0; i < N_HEATMAP_COLORS; i++) {
+    heatmap_pixels[i] = HEATMAP_PALETTE_FIRST + i;
+  }
+  st7789_framebuf_set_palette(HEATMAP_PALETTE_FIRST, heatmap_color_rgb565, N_HEATMAP_COLORS);
+  st7789_framebuf_set_palette(no_data_pixel, &no_data_color, 1);
+  heatmap_pixels_init = true;
+}
+#else
+#define heatmap_pixels heatmap_color_rgb565
+#define heatmap_pixels_init true
+#define no_data_pixel NO_DATA_COLOR
+static void st7789_heatmap_pixels_init(void) {}
+#endif
+
+/*
+ * st7789_mark_no_data
+ *
+ * @brief Paint the sensors in dead (a bit each) over the mapped image in
+ * the no data color.
+ */
+static void st7789_mark_no_data(uint32_t dead) {
+  for (size_t i = 0; i < mlx90640_screen_len; i++) {
+    if (dead >> (mlx90640_screen_order[i] / MLX90640_PIXEL_NUM) & 1) {
+      mlx90640_screen_pixels[i] = no_data_pixel;
+    }
+  }
+}
+
+/*
+ * st7789_label_no_data
+ *
+ * @brief Label the sensors in dead where the scaled image shows them.
+ */
+static void st7789_label_no_data(uint32_t dead) {
+  static const char label[] = "No data";
+  for (uint k = 0; k < mlx90640_screen_n; k++) {
+    if (!(dead >> k & 1)) {
+      continue;
+    }
+    // the sensor's part of the image, in screen pixels
+    uint u0 = mlx90640_screen_w, v0 = mlx90640_screen_h, u1 = 0, v1 = 0;
+    for (size_t i = 0; i < mlx90640_screen_len; i++) {
+      if (mlx90640_screen_order[i] / MLX90640_PIXEL_NUM != k) {
+        continue;
+      }
+      uint u = i % mlx90640_screen_w, v = i / mlx90640_screen_w;
+      if (u < u0) u0 = u;
+      if (u > u1) u1 = u;
+      if (v < v0) v0 = v;
+      if (v > v1) v1 = v;
+    }
+    uint x0 = mlx90640_rect_x0 + u0 * mlx90640_rect_w / mlx90640_screen_w;
+    uint x1 = mlx90640_rect_x0 + (u1 + 1) * mlx90640_rect_w / mlx90640_screen_w;
+    uint y0 = mlx90640_rect_y0 + v0 * mlx90640_rect_h / mlx90640_screen_h;
+    uint y1 = mlx90640_rect_y0 + (v1 + 1) * mlx90640_rect_h / mlx90640_screen_h;
+    uint w = (sizeof(label) - 1) * FONT_W;
+    if (x1 - x0 >= w && y1 - y0 >= FONT_H) {
+      st7789_framebuf_write_string((x0 + x1 - w) / 2, (y0 + y1 - FONT_H) / 2, label, sizeof(label) - 1, WHITE, NO_DATA_COLOR, false);
+    }
+  }
+}
+
 uint32_t st7789_fill_32_24_fps_estimate_t0 = 0;
 uint32_t st7789_fill_32_24_fps_estimate_t1 = 0;
 
+/*
+ * @brief Width of the HUD labels, e.g. "Max: -12.34 C".
+ */
+#define HUD_LABEL_LEN 13
+
+/*
+ * st7789_hud_temp_label
+ *
+ * @brief Format "<prefix>% 5.2f C" into buf without going through snprintf.
+ */
+static void st7789_hud_temp_label(char buf[HUD_LABEL_LEN+1], const char prefix[5], float temp) {
+  memcpy(buf, prefix, 5);
+  size_t n = 5 + numfmt_fixed(buf + 5, HUD_LABEL_LEN + 1 - 5 - 2, numfmt_float_to_fixed(temp, 2), 2, 5, true);
+  buf[n++] = ' ';
+  buf[n++] = 'C';
+  buf[n] = '\0';
+}
+
 void st7789_fill_32_24(float *frame) {
+  st7789_fill_panorama(frame, 1, 0);
+}
+
+void st7789_fill_panorama(float *frame, uint n_sensors, uint overlap) {
+  if (n_sensors < 1 || n_sensors > THERMAL_CAMERA_SENSORS || overlap >= MLX90640_LINE_SIZE) {
+    printf("[ERROR] can't draw a panorama of %u sensors overlapping by %u.\n", n_sensors, overlap);
+    return;
+  }
+
   /*
    * %%%%%%%%%%%%%%
    * FPS estimation
    * %%%%%%%%%%%%%%
    */
   st7789_fill_32_24_fps_estimate_t1 = time_us_32() / 1000;
-  char fps_buf[32];
+  char fps_buf[12] = "FPS: ";
   uint32_t dt = st7789_fill_32_24_fps_estimate_t1 - st7789_fill_32_24_fps_estimate_t0;
   if (dt == 0) dt = 1;
-  float fps_estimate = 1000.0f/dt;
-  snprintf(fps_buf, 32, "FPS: %3.2f", fps_estimate);
-  st7789_framebuf_write_string(10, 10, fps_buf, 32, WHITE, BLACK, false);
+  // hundredths of a frame per second, padded so a shorter value overwrites a longer one
+  numfmt_fixed(fps_buf + 5, sizeof(fps_buf) - 5, (int32_t)(100000 / dt), 2, 6, false);
+  st7789_framebuf_write_string(10, 10, fps_buf, sizeof(fps_buf), WHITE, BLACK, false);
   st7789_fill_32_24_fps_estimate_t0 = st7789_fill_32_24_fps_estimate_t1;
 
   /*
@@ -400,61 +971,88 @@ void st7789_fill_32_24(float *frame) {
    * calculate min and max temperature values
    * %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
    */
+  // over the pixels that were measured: a NaN or inf is drawn at the end
+  // of the scale it falls off, and doesn't move it. a sensor with nothing
+  // finite at all (one that never came up is all NaN) is drawn as no data
   float max_temp = -INFINITY;
   float min_temp = INFINITY;
   float avg_temp = 0;
-  for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
-    avg_temp += frame[i];
-    if (frame[i] > max_temp) {
-      max_temp = frame[i];
+  size_t n_finite = 0;
+  uint32_t dead = 0;
+  for (size_t k = 0; k < n_sensors; k++) {
+    size_t n_finite_k = n_finite;
+    for (size_t i = k * MLX90640_PIXEL_NUM; i < (k + 1) * MLX90640_PIXEL_NUM; i++) {
+      if (!isfinite(frame[i])) {
+        continue;
+      }
+      avg_temp += frame[i];
+      n_finite++;
+      if (frame[i] > max_temp) {
+        max_temp = frame[i];
+      }
+      if (frame[i] < min_temp) {
+        min_temp = frame[i];
+      }
     }
-    if (frame[i] < min_temp) {
-      min_temp = frame[i];
+    if (n_finite == n_finite_k) {
+      dead |= 1u << k;
     }
   }
-  avg_temp /= MLX90640_PIXEL_NUM;
-  char temp_buf[14];
-  snprintf(temp_buf, 13+1, "Max: % 5.2f C", max_temp);
-  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2-FONT_H, temp_buf, 13+1, WHITE, heatmap_color_rgb565[N_HEATMAP_COLORS-1], false);
-  snprintf(temp_buf, 13+1, "Min: % 5.2f C", min_temp);
-  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2, temp_buf, 13+1, WHITE, heatmap_color_rgb565[0], false);
+  if (n_finite) {
+    avg_temp /= n_finite;
+  } else {
+    max_temp = min_temp = 0;
+  }
+  char temp_buf[HUD_LABEL_LEN+1];
+  st7789_hud_temp_label(temp_buf, "Max: ", max_temp);
+  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2-FONT_H, temp_buf, HUD_LABEL_LEN+1, WHITE, heatmap_color_rgb565[N_HEATMAP_COLORS-1], false);
+  st7789_hud_temp_label(temp_buf, "Min: ", min_temp);
+  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2, temp_buf, HUD_LABEL_LEN+1, WHITE, heatmap_color_rgb565[0], false);
 
-  // calculate heatmap color of average temperature
-  size_t avg_heatmap_color_rgb565_ind = (size_t)((avg_temp - min_temp) / (max_temp - min_temp) * (N_HEATMAP_COLORS - 1));
-  snprintf(temp_buf, 13+1, "Avg: % 5.2f C", avg_temp);
-  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2+FONT_H, temp_buf, 13+1, heatmap_color_rgb565[avg_heatmap_color_rgb565_ind], BLACK, false);
+  // calculate heatmap color of average temperature; a flat scene is all
+  // the bottom of the scale, as st7789_render_map draws it
+  size_t avg_heatmap_color_rgb565_ind = 0;
+  if (max_temp > min_temp) {
+    avg_heatmap_color_rgb565_ind = (size_t)((avg_temp - min_temp) / (max_temp - min_temp) * (N_HEATMAP_COLORS - 1));
+    if (avg_heatmap_color_rgb565_ind > N_HEATMAP_COLORS - 1) {
+      avg_heatmap_color_rgb565_ind = N_HEATMAP_COLORS - 1;
+    }
+  }
+  st7789_hud_temp_label(temp_buf, "Avg: ", avg_temp);
+  st7789_framebuf_write_string(10, ST7789_COLUMN_SIZE/2+FONT_H, temp_buf, HUD_LABEL_LEN+1, heatmap_color_rgb565[avg_heatmap_color_rgb565_ind], BLACK, false);
 
   /*
    * %%%%%%%%%%%%%%%%%%%%%%%%%
    * temperature color mapping
    * %%%%%%%%%%%%%%%%%%%%%%%%%
    */
-  for (size_t mlx90640_yi = 0; mlx90640_yi < (MLX90640_COLUMN_SIZE-1); mlx90640_yi++) {
-    for (size_t mlx90640_xi = 0; mlx90640_xi < (MLX90640_LINE_SIZE-1); mlx90640_xi++) {
-      // calcualte heatmap color index based on range of mlx90640 color values in frame
-      float pix = frame[MLX90640_INDEX(mlx90640_xi,mlx90640_yi)];
-      size_t heatmap_color_rgb565_ind = (size_t)((pix - min_temp) / (max_temp - min_temp) * (N_HEATMAP_COLORS - 1));
-
-      // fetch newly calculated color from heatmap array
-      uint16_t heatmap_color_rgb565_value = heatmap_color_rgb565[heatmap_color_rgb565_ind];
-
-      // grab coordinates of window in st7789 space
-      size_t st7789_x0 = 0;
-      size_t st7789_y0 = 0;
-      mlx90640_xy_to_st7789_xy(mlx90640_xi, mlx90640_yi, &st7789_x0, &st7789_y0);
-      size_t st7789_x1 = 0;
-      size_t st7789_y1 = 0;
-      mlx90640_xy_to_st7789_xy(mlx90640_xi+1, mlx90640_yi+1, &st7789_x1, &st7789_y1);
-
-      // update st7789 framebuffer with newly calculated color
-      st7789_framebuf_fill_rect(
-        st7789_x0,
-        st7789_y0,
-        st7789_x1,
-        st7789_y1,
-        heatmap_color_rgb565_value
-      );
+  if (mlx90640_screen_n != n_sensors || mlx90640_screen_overlap != overlap) {
+    if (mlx90640_screen_n) {
+      // the new layout may not cover all of the old one
+      st7789_framebuf_fill_rect(mlx90640_rect_x0, mlx90640_rect_y0, mlx90640_rect_x0 + mlx90640_rect_w - 1, mlx90640_rect_y0 + mlx90640_rect_h - 1, BLACK);
     }
+    mlx90640_build_screen_order(n_sensors, overlap);
+  }
+  if (!heatmap_pixels_init) {
+    st7789_heatmap_pixels_init();
+  }
+  // map to heatmap colors, turning the image the way it sits on the screen
+  st7789_render_map(frame, mlx90640_screen_order, mlx90640_screen_len, min_temp, max_temp, heatmap_pixels, N_HEATMAP_COLORS, mlx90640_screen_pixels);
+  if (dead) {
+    st7789_mark_no_data(dead);
+  }
+  // then blow it up to fill its rect in the framebuffer
+  st7789_render_scale(
+    mlx90640_screen_pixels,
+    mlx90640_screen_w,
+    mlx90640_screen_h,
+    mlx90640_rect_x0,
+    mlx90640_rect_y0,
+    mlx90640_rect_w,
+    mlx90640_rect_h
+  );
+  if (dead) {
+    st7789_label_no_data(dead);
   }
 
   // now that we've done all of our transformations, flush the frame buffer
@@ -6,15 +6,27 @@
  */
 
 #include "st7789.h"
+#include "st7789_framebuf.h"
 #include <stdlib.h>
+#include <string.h>
 #include "fonts.h"
+#include "hotpath.h"
 #include "stdio.h"
 #include <math.h>
 
 /*
  * @brief define the frame buffer for the st7789
  */
-static uint16_t framebuf[ST7789_LINE_SIZE * ST7789_COLUMN_SIZE];
+static st7789_pixel_t framebuf[ST7789_LINE_SIZE * ST7789_COLUMN_SIZE] __attribute__((aligned(4)));
+/*
+ * @brief a word's worth of adjacent pixels (two RGB565 or four indexed), for
+ * writing the frame buffer a word at a time. may_alias lets us store through
+ * it into the st7789_pixel_t frame buffer.
+ */
+typedef uint32_t __attribute__((may_alias)) framebuf_word_t;
+#define FRAMEBUF_PIXEL_BITS (8 * sizeof(st7789_pixel_t))
+#define FRAMEBUF_PIXELS_PER_WORD (sizeof(framebuf_word_t) / sizeof(st7789_pixel_t))
+#define FRAMEBUF_HOLDS_RGB565 (sizeof(st7789_pixel_t) == sizeof(uint16_t))
 /*
  * @brief define the ram window of the frame buffer.
  */
@@ -23,11 +35,267 @@ static size_t framebuf_window_y0 = 0;
 static size_t framebuf_window_x1 = 0;
 static size_t framebuf_window_y1 = 0;
 #define FRAMEBUF_INDEX(xi, yi) (yi) * ST7789_LINE_SIZE + (xi)
+#define FRAMEBUF_SIZE (ST7789_LINE_SIZE * ST7789_COLUMN_SIZE)
+
+#if ST7789_FRAMEBUF_INDEXED
+/*
+ * @brief RGB565 value of every palette index. The first
+ * ST7789_FRAMEBUF_PALETTE_RESERVED entries belong to whoever calls
+ * st7789_framebuf_set_palette; the rest are handed out to RGB565 colors as
+ * the draw routines first see them.
+ */
+static uint16_t framebuf_palette[ST7789_FRAMEBUF_PALETTE_SIZE];
+static size_t framebuf_palette_used = ST7789_FRAMEBUF_PALETTE_RESERVED;
+
+/*
+ * @brief open-addressed RGB565 -> palette index lookup for the handed out entries.
+ */
+#define FRAMEBUF_COLOR_MAP_SIZE 512
+typedef struct {
+  bool used;
+  uint8_t index;
+  uint16_t color;
+} framebuf_color_map_entry_t;
+static framebuf_color_map_entry_t framebuf_color_map[FRAMEBUF_COLOR_MAP_SIZE];
+
+/*
+ * framebuf_color_nearest
+ *
+ * @brief Closest handed out palette entry to color, for when the palette is full.
+ */
+static uint8_t framebuf_color_nearest(uint16_t color) {
+  int r = color >> 11, g = (color >> 5) & 0x3F, b = color & 0x1F;
+  uint8_t best = ST7789_FRAMEBUF_PALETTE_RESERVED;
+  int best_dist = INT32_MAX;
+  for (size_t i = ST7789_FRAMEBUF_PALETTE_RESERVED; i < framebuf_palette_used; i++) {
+    uint16_t c = framebuf_palette[i];
+    int dr = r - (c >> 11), dg = g - ((c >> 5) & 0x3F), db = b - (c & 0x1F);
+    int dist = 4 * dr * dr + dg * dg + 4 * db * db;
+    if (dist < best_dist) {
+      best = i;
+      best_dist = dist;
+    }
+  }
+  return best;
+}
+
+/*
+ * framebuf_color
+ *
+ * @brief Palette index standing for the RGB565 color, handing out a new
+ * entry the first time a color is seen.
+ */
+static st7789_pixel_t framebuf_color(uint16_t color) {
+  size_t h = ((color * 0x9E37u) >> 7) % FRAMEBUF_COLOR_MAP_SIZE;
+  while (framebuf_color_map[h].used) {
+    if (framebuf_color_map[h].color == color) {
+      return framebuf_color_map[h].index;
+    }
+    h = (h + 1) % FRAMEBUF_COLOR_MAP_SIZE;
+  }
+  if (framebuf_palette_used == ST7789_FRAMEBUF_PALETTE_SIZE) {
+    // out of entries, settle for the closest one we have (not remembered,
+    // so the map never fills up)
+    return framebuf_color_nearest(color);
+  }
+  uint8_t index = framebuf_palette_used++;
+  framebuf_palette[index] = color;
+  framebuf_color_map[h].used = true;
+  framebuf_color_map[h].index = index;
+  framebuf_color_map[h].color = color;
+  return index;
+}
+
+void st7789_framebuf_set_palette(uint first, const uint16_t *colors, size_t n) {
+  for (size_t i = 0; i < n && first + i < ST7789_FRAMEBUF_PALETTE_RESERVED; i++) {
+    framebuf_palette[first + i] = colors[i];
+  }
+}
+
+void HOT_FUNC(st7789_framebuf_expand)(uint16_t *dst, size_t first, size_t n) {
+  const st7789_pixel_t *src = &framebuf[first];
+  const uint16_t *palette = framebuf_palette;
+  // the frame buffer is word aligned and chunks are multiples of four, so
+  // pull four indices out of each word load
+  while (n >= 4 && ((uintptr_t)src & 3) == 0) {
+    uint32_t quad = *(const framebuf_word_t *)src;
+    dst[0] = palette[quad & 0xFF];
+    dst[1] = palette[(quad >> 8) & 0xFF];
+    dst[2] = palette[(quad >> 16) & 0xFF];
+    dst[3] = palette[quad >> 24];
+    src += 4;
+    dst += 4;
+    n -= 4;
+  }
+  while (n--) {
+    *dst++ = palette[*src++];
+  }
+}
+#else
+static inline st7789_pixel_t framebuf_color(uint16_t color) {
+  return color;
+}
+
+void st7789_framebuf_set_palette(uint first, const uint16_t *colors, size_t n) {
+  // nothing to do, the frame buffer holds RGB565 directly
+  (void)first;
+  (void)colors;
+  (void)n;
+}
+
+void st7789_framebuf_expand(uint16_t *dst, size_t first, size_t n) {
+  memcpy(dst, &framebuf[first], n * sizeof(uint16_t));
+}
+#endif
+
+/*
+ * @brief Format the frame buffer goes out to the panel in.
+ */
+#if ST7789_FRAMEBUF_RGB444
+static st7789_pixel_format_t framebuf_pixel_format = ST7789_PIXEL_FORMAT_RGB444;
+#else
+static st7789_pixel_format_t framebuf_pixel_format = ST7789_PIXEL_FORMAT_RGB565;
+#endif
+
+void st7789_framebuf_set_pixel_format(st7789_pixel_format_t format) {
+  framebuf_pixel_format = format;
+}
+
+st7789_pixel_format_t st7789_framebuf_get_pixel_format(void) {
+  return framebuf_pixel_format;
+}
+
+/*
+ * @brief Pixels converted per chunk during a flush. Two full rows, double
+ * buffered, so one chunk is converted while the previous one is on the wire.
+ */
+#define FRAMEBUF_FLUSH_CHUNK (2 * ST7789_LINE_SIZE)
+static uint16_t framebuf_flush_buf[2][FRAMEBUF_FLUSH_CHUNK];
+static uint8_t framebuf_flush_packed[2][(3 * FRAMEBUF_FLUSH_CHUNK + 1) / 2];
+
+/*
+ * framebuf_flush_rect
+ *
+ * @brief Send the w by h rect at (x0,y0) to the panel in the current pixel
+ * format, a few rows at a time.
+ */
+static void framebuf_flush_rect(uint x0, uint y0, uint w, uint h) {
+  st7789_stream_begin(x0, y0, x0 + w - 1, y0 + h - 1, framebuf_pixel_format);
+  if (FRAMEBUF_HOLDS_RGB565 && w == ST7789_LINE_SIZE && framebuf_pixel_format == ST7789_PIXEL_FORMAT_RGB565) {
+    // already in wire format and contiguous, send the lot in one go
+    st7789_stream_data(&framebuf[FRAMEBUF_INDEX(0, y0)], (size_t)w * h, 16);
+    st7789_stream_end();
+    return;
+  }
+  uint rows_per_chunk = FRAMEBUF_FLUSH_CHUNK / w;
+  int k = 0;
+  for (uint yi = y0; yi < y0 + h; yi += rows_per_chunk) {
+    uint rows = y0 + h - yi < rows_per_chunk ? y0 + h - yi : rows_per_chunk;
+    size_t n = (size_t)rows * w;
+    // buffer k's last transfer finished before the other one started
+    const uint16_t *rgb565 = framebuf_flush_buf[k];
+    if (FRAMEBUF_HOLDS_RGB565 && w == ST7789_LINE_SIZE) {
+      rgb565 = (const uint16_t *)&framebuf[FRAMEBUF_INDEX(0, yi)];
+    } else {
+      for (uint r = 0; r < rows; r++) {
+        st7789_framebuf_expand(&framebuf_flush_buf[k][r * w], FRAMEBUF_INDEX(x0, yi + r), w);
+      }
+    }
+    if (framebuf_pixel_format == ST7789_PIXEL_FORMAT_RGB444) {
+      st7789_pack_rgb444(framebuf_flush_packed[k], rgb565, n);
+      st7789_stream_data(framebuf_flush_packed[k], (3 * n + 1) / 2, 8);
+    } else {
+      st7789_stream_data(rgb565, n, 16);
+    }
+    k ^= 1;
+  }
+  st7789_stream_end();
+}
+
+/*
+ * @brief With MV set in MADCTL the panel's gate scan runs along x, so a
+ * paced flush goes out column by column in scan order as one RAMWR (see
+ * st7789_stream_begin_scan), right behind V-blank. Set
+ * ST7789_SCAN_X_REVERSED if the scan runs from the right edge.
+ */
+#define FRAMEBUF_VSYNC_TIMEOUT_US 50000
+#define FRAMEBUF_SCAN_COLUMNS (FRAMEBUF_FLUSH_CHUNK / ST7789_COLUMN_SIZE)
+#ifndef ST7789_SCAN_X_REVERSED
+#define ST7789_SCAN_X_REVERSED 0
+#endif
+static bool framebuf_paced = false;
+static uint32_t framebuf_flush_us = 0;
+
+void st7789_framebuf_set_paced(bool paced) {
+  framebuf_paced = paced;
+}
+
+uint32_t st7789_framebuf_last_flush_us(void) {
+  return framebuf_flush_us;
+}
+
+/*
+ * framebuf_gather_column
+ *
+ * @brief Column x of the frame buffer, top to bottom, as RGB565.
+ */
+static void HOT_FUNC(framebuf_gather_column)(uint16_t *dst, uint x) {
+  const st7789_pixel_t *src = &framebuf[FRAMEBUF_INDEX(x, 0)];
+  for (uint yi = 0; yi < ST7789_COLUMN_SIZE; yi++) {
+#if ST7789_FRAMEBUF_INDEXED
+    dst[yi] = framebuf_palette[src[yi * ST7789_LINE_SIZE]];
+#else
+    dst[yi] = src[yi * ST7789_LINE_SIZE];
+#endif
+  }
+}
+
+/*
+ * framebuf_flush_scan
+ *
+ * @brief The whole frame buffer in the order the panel scans it out.
+ */
+static void framebuf_flush_scan(void) {
+  st7789_stream_begin_scan(framebuf_pixel_format, ST7789_SCAN_X_REVERSED);
+  int k = 0;
+  for (uint i = 0; i < ST7789_LINE_SIZE; i += FRAMEBUF_SCAN_COLUMNS) {
+    size_t n = 0;
+    for (uint c = i; c < i + FRAMEBUF_SCAN_COLUMNS && c < ST7789_LINE_SIZE; c++) {
+      uint x = ST7789_SCAN_X_REVERSED ? ST7789_LINE_SIZE - 1 - c : c;
+      framebuf_gather_column(&framebuf_flush_buf[k][n], x);
+      n += ST7789_COLUMN_SIZE;
+    }
+    if (framebuf_pixel_format == ST7789_PIXEL_FORMAT_RGB444) {
+      st7789_pack_rgb444(framebuf_flush_packed[k], framebuf_flush_buf[k], n);
+      st7789_stream_data(framebuf_flush_packed[k], (3 * n + 1) / 2, 8);
+    } else {
+      st7789_stream_data(framebuf_flush_buf[k], n, 16);
+    }
+    k ^= 1;
+  }
+  st7789_stream_end();
+}
 
 void st7789_framebuf_flush(void) {
-  st7789_set_window(0, 0, ST7789_LINE_SIZE-1, ST7789_COLUMN_SIZE-1);
-  st7789_write_command(ST7789_CMD_RAMWR);
-  st7789_write_data_words(framebuf, ST7789_LINE_SIZE * ST7789_COLUMN_SIZE);
+  if (!framebuf_paced) {
+    uint32_t t0 = time_us_32();
+    framebuf_flush_rect(0, 0, ST7789_LINE_SIZE, ST7789_COLUMN_SIZE);
+    framebuf_flush_us = time_us_32() - t0;
+    return;
+  }
+
+  // starting at V-blank, a flush quicker than the scan stays ahead of it,
+  // and one that takes under two periods stays behind it: the scan passes
+  // each column before we write it and is gone again before it comes back
+  // round. slower than that the scan catches us whatever we do, so only
+  // wait when it buys a tear-free frame.
+  uint32_t period = st7789_refresh_period_us();
+  if (period == 0 || framebuf_flush_us < 2 * period) {
+    st7789_wait_vsync(FRAMEBUF_VSYNC_TIMEOUT_US);
+  }
+  uint32_t t0 = time_us_32();
+  framebuf_flush_scan();
+  framebuf_flush_us = time_us_32() - t0;
 }
 
 static void st7789_clip_pixel_vals(uint *_x, uint *_y) {
@@ -45,68 +313,259 @@ static void st7789_clip_pixel_vals(uint *_x, uint *_y) {
 void st7789_framebuf_draw_pixel(uint x, uint y, uint16_t color) {
   // keep values within range
   st7789_clip_pixel_vals(&x, &y);
-  framebuf[FRAMEBUF_INDEX(x, y)] = color;
+  framebuf[FRAMEBUF_INDEX(x, y)] = framebuf_color(color);
 }
 
 void st7789_framebuf_set_window(size_t x0, size_t y0, size_t x1, size_t y1) {
+  uint _x0 = x0, _y0 = y0, _x1 = x1, _y1 = y1;
   // keep values within range
-  st7789_clip_pixel_vals(&x0, &y0);
-  st7789_clip_pixel_vals(&x1, &y1);
+  st7789_clip_pixel_vals(&_x0, &_y0);
+  st7789_clip_pixel_vals(&_x1, &_y1);
+
+  framebuf_window_x0 = _x0;
+  framebuf_window_y0 = _y0;
+  framebuf_window_x1 = _x1;
+  framebuf_window_y1 = _y1;
+}
 
-  framebuf_window_x0 = x0;
-  framebuf_window_y0 = y0;
-  framebuf_window_x1 = x1;
-  framebuf_window_y1 = y1;
+/*
+ * framebuf_splat
+ *
+ * @brief A word with every pixel set to p.
+ */
+static inline uint32_t framebuf_splat(st7789_pixel_t p) {
+  return (uint32_t)p * (FRAMEBUF_PIXEL_BITS == 8 ? 0x01010101u : 0x00010001u);
+}
+
+/*
+ * framebuf_fill_span
+ *
+ * @brief Fill n consecutive pixels a word at a time, with an unrolled run of
+ * word stores in the middle.
+ */
+static inline void framebuf_fill_span(st7789_pixel_t *dst, size_t n, st7789_pixel_t p) {
+  // get to a word boundary first
+  while (n > 0 && ((uintptr_t)dst & 3) != 0) {
+    *dst++ = p;
+    n--;
+  }
+  uint32_t word = framebuf_splat(p);
+  framebuf_word_t *d = (framebuf_word_t *)dst;
+  size_t words = n / FRAMEBUF_PIXELS_PER_WORD;
+  while (words >= 4) {
+    d[0] = word;
+    d[1] = word;
+    d[2] = word;
+    d[3] = word;
+    d += 4;
+    words -= 4;
+  }
+  while (words--) {
+    *d++ = word;
+  }
+  // whatever doesn't fill a word at the end
+  dst = (st7789_pixel_t *)d;
+  for (n %= FRAMEBUF_PIXELS_PER_WORD; n > 0; n--) {
+    *dst++ = p;
+  }
 }
 
-void st7789_framebuf_write_data_words(uint16_t *words, size_t len) {
-  size_t i = 0;
-  for (size_t xi = framebuf_window_x0; xi <= framebuf_window_x1; xi++) {
-    for (size_t yi = framebuf_window_y0; yi <= framebuf_window_y1; yi++) {
-      if (i == len) return;
-      framebuf[FRAMEBUF_INDEX(xi, yi)] = words[i++];
+void HOT_FUNC(st7789_framebuf_write_data_words)(uint16_t *words, size_t len) {
+  // same order the st7789 fills its RAM window in: left to right, top to bottom
+  size_t width = framebuf_window_x1 - framebuf_window_x0 + 1;
+  for (size_t yi = framebuf_window_y0; yi <= framebuf_window_y1 && len > 0; yi++) {
+    size_t n = len < width ? len : width;
+#if ST7789_FRAMEBUF_INDEXED
+    st7789_pixel_t *dst = &framebuf[FRAMEBUF_INDEX(framebuf_window_x0, yi)];
+    for (size_t i = 0; i < n; i++) {
+      dst[i] = framebuf_color(words[i]);
     }
+#else
+    memcpy(&framebuf[FRAMEBUF_INDEX(framebuf_window_x0, yi)], words, n * sizeof(uint16_t));
+#endif
+    words += n;
+    len -= n;
   }
 }
 
-void st7789_framebuf_write_char(uint x0, uint y0, char c, uint16_t color, uint16_t bgcolor, bool bgtransparent) {
-  // keep values within range
-  st7789_clip_pixel_vals(&x0, &y0);
+void HOT_FUNC(st7789_framebuf_blit)(uint x0, uint y0, uint w, uint h, const st7789_pixel_t *src, size_t src_stride) {
+  // clip the window to the screen
+  if (x0 >= ST7789_LINE_SIZE || y0 >= ST7789_COLUMN_SIZE) {
+    return;
+  }
+  if (w > ST7789_LINE_SIZE - x0) {
+    w = ST7789_LINE_SIZE - x0;
+  }
+  if (h > ST7789_COLUMN_SIZE - y0) {
+    h = ST7789_COLUMN_SIZE - y0;
+  }
+  for (uint yi = 0; yi < h; yi++) {
+    memcpy(&framebuf[FRAMEBUF_INDEX(x0, y0 + yi)], &src[yi * src_stride], w * sizeof(st7789_pixel_t));
+  }
+}
 
+/*
+ * @brief Expand one nibble of a font row (4 pixels, MSb is leftmost) into
+ * word masks: two double-pixel masks for RGB565, one quad-pixel mask for
+ * indexed pixels. Pixels are little-endian in the framebuffer, so the
+ * leftmost pixel of each word is the lowest.
+ */
+#define FONT_NIBBLE_WORDS (4 / FRAMEBUF_PIXELS_PER_WORD)
+#if ST7789_FRAMEBUF_INDEXED
+#define FONT_QUAD_MASK(a, b, c, d) (((a) ? 0x000000FFu : 0u) | ((b) ? 0x0000FF00u : 0u) | ((c) ? 0x00FF0000u : 0u) | ((d) ? 0xFF000000u : 0u))
+#define FONT_NIBBLE_MASKS(n) { FONT_QUAD_MASK((n) & 0x8, (n) & 0x4, (n) & 0x2, (n) & 0x1) }
+#else
+#define FONT_PAIR_MASK(l, r) (((l) ? 0x0000FFFFu : 0u) | ((r) ? 0xFFFF0000u : 0u))
+#define FONT_NIBBLE_MASKS(n) { FONT_PAIR_MASK((n) & 0x8, (n) & 0x4), FONT_PAIR_MASK((n) & 0x2, (n) & 0x1) }
+#endif
+static const uint32_t font_nibble_masks[16][FONT_NIBBLE_WORDS] = {
+  FONT_NIBBLE_MASKS(0x0), FONT_NIBBLE_MASKS(0x1), FONT_NIBBLE_MASKS(0x2), FONT_NIBBLE_MASKS(0x3),
+  FONT_NIBBLE_MASKS(0x4), FONT_NIBBLE_MASKS(0x5), FONT_NIBBLE_MASKS(0x6), FONT_NIBBLE_MASKS(0x7),
+  FONT_NIBBLE_MASKS(0x8), FONT_NIBBLE_MASKS(0x9), FONT_NIBBLE_MASKS(0xA), FONT_NIBBLE_MASKS(0xB),
+  FONT_NIBBLE_MASKS(0xC), FONT_NIBBLE_MASKS(0xD), FONT_NIBBLE_MASKS(0xE), FONT_NIBBLE_MASKS(0xF),
+};
+#define FONT_ROW_WORDS (FONT_W / FRAMEBUF_PIXELS_PER_WORD)
+
+/*
+ * @brief Small direct-mapped cache of opaque glyphs already expanded to
+ * pixels. The HUD redraws the same handful of characters in the same colors
+ * every frame, so most lookups hit.
+ */
+#define GLYPH_CACHE_SIZE 16
+typedef struct {
+  bool valid;
+  char c;
+  uint16_t color;
+  uint16_t bgcolor;
+  uint32_t rows[FONT_H][FONT_ROW_WORDS];
+} glyph_cache_entry_t;
+static glyph_cache_entry_t glyph_cache[GLYPH_CACHE_SIZE];
+
+static inline const uint8_t *font_glyph(char c) {
+  unsigned char uc = (unsigned char)c;
+  // the font only covers printable ascii (0x20 - 0x7F)
+  if (uc < 32 || uc > 127) {
+    uc = '?';
+  }
+  return &thefont[(uc - 32) * FONT_H];
+}
+
+static inline void font_row_masks(uint8_t bitmap_row, uint32_t m[FONT_ROW_WORDS]) {
+  const uint32_t *hi = font_nibble_masks[bitmap_row >> 4];
+  const uint32_t *lo = font_nibble_masks[bitmap_row & 0xF];
+  for (uint32_t k = 0; k < FONT_NIBBLE_WORDS; k++) {
+    m[k] = hi[k];
+    m[FONT_NIBBLE_WORDS + k] = lo[k];
+  }
+}
+
+/*
+ * font_mask_pixel
+ *
+ * @brief Pull pixel j of a row out of its expanded words.
+ */
+static inline uint32_t font_mask_pixel(const uint32_t *words, uint32_t j) {
+  return words[j / FRAMEBUF_PIXELS_PER_WORD] >> ((j % FRAMEBUF_PIXELS_PER_WORD) * FRAMEBUF_PIXEL_BITS);
+}
+
+static const glyph_cache_entry_t *HOT_FUNC(glyph_cache_get)(char c, uint16_t color, uint16_t bgcolor) {
+  glyph_cache_entry_t *e = &glyph_cache[((uint8_t)c ^ (color >> 5) ^ (bgcolor >> 9)) % GLYPH_CACHE_SIZE];
+  if (e->valid && e->c == c && e->color == color && e->bgcolor == bgcolor) {
+    return e;
+  }
+
+  // miss, so expand the glyph into the slot
+  const uint8_t *glyph = font_glyph(c);
+  uint32_t fg = framebuf_splat(framebuf_color(color));
+  uint32_t bg = framebuf_splat(framebuf_color(bgcolor));
   for (uint32_t i = 0; i < FONT_H; i++) {
-    uint8_t bitmap_row = thefont[(c - 32) * FONT_H + i];
-    for (uint32_t j = 0; j < FONT_W; j++) {
-      // keep shifting and checking the MSb of the word
-      // if it's 1, then we should draw the character's pixel
-      // if it's 0, then we should draw the bgcolor
-      if ((bitmap_row << j) & 0x80) {
-        framebuf[FRAMEBUF_INDEX(x0 + j, y0 + i)] = color;
+    uint32_t m[FONT_ROW_WORDS];
+    font_row_masks(glyph[i], m);
+    for (uint32_t k = 0; k < FONT_ROW_WORDS; k++) {
+      e->rows[i][k] = (fg & m[k]) | (bg & ~m[k]);
+    }
+  }
+  e->valid = true;
+  e->c = c;
+  e->color = color;
+  e->bgcolor = bgcolor;
+  return e;
+}
+
+void HOT_FUNC(st7789_framebuf_write_char)(uint x0, uint y0, char c, uint16_t color, uint16_t bgcolor, bool bgtransparent) {
+  // clip instead of clamping, glyphs hanging off the edge are cut short
+  if (x0 >= ST7789_LINE_SIZE || y0 >= ST7789_COLUMN_SIZE) {
+    return;
+  }
+  uint w = ST7789_LINE_SIZE - x0 < FONT_W ? ST7789_LINE_SIZE - x0 : FONT_W;
+  uint h = ST7789_COLUMN_SIZE - y0 < FONT_H ? ST7789_COLUMN_SIZE - y0 : FONT_H;
+  bool word_aligned = (x0 % FRAMEBUF_PIXELS_PER_WORD) == 0 && w == FONT_W;
+
+  if (!bgtransparent) {
+    const glyph_cache_entry_t *e = glyph_cache_get(c, color, bgcolor);
+    for (uint32_t i = 0; i < h; i++) {
+      st7789_pixel_t *row = &framebuf[FRAMEBUF_INDEX(x0, y0 + i)];
+      if (word_aligned) {
+        // whole row in a few word stores
+        framebuf_word_t *dst = (framebuf_word_t *)row;
+        for (uint32_t k = 0; k < FONT_ROW_WORDS; k++) {
+          dst[k] = e->rows[i][k];
+        }
+      } else {
+        for (uint32_t j = 0; j < w; j++) {
+          row[j] = (st7789_pixel_t)font_mask_pixel(e->rows[i], j);
+        }
       }
-      else {
-        if (!bgtransparent) {
-          framebuf[FRAMEBUF_INDEX(x0 + j, y0 + i)] = bgcolor;
+    }
+    return;
+  }
+
+  const uint8_t *glyph = font_glyph(c);
+  st7789_pixel_t p = framebuf_color(color);
+  uint32_t fg = framebuf_splat(p);
+  for (uint32_t i = 0; i < h; i++) {
+    if (glyph[i] == 0) {
+      continue;
+    }
+    uint32_t m[FONT_ROW_WORDS];
+    font_row_masks(glyph[i], m);
+    st7789_pixel_t *row = &framebuf[FRAMEBUF_INDEX(x0, y0 + i)];
+    if (word_aligned) {
+      // only overwrite the set pixels, keep whatever is behind the glyph
+      framebuf_word_t *dst = (framebuf_word_t *)row;
+      for (uint32_t k = 0; k < FONT_ROW_WORDS; k++) {
+        dst[k] = (dst[k] & ~m[k]) | (fg & m[k]);
+      }
+    } else {
+      for (uint32_t j = 0; j < w; j++) {
+        if (font_mask_pixel(m, j) & 1) {
+          row[j] = p;
         }
       }
     }
   }
 }
 
-void st7789_framebuf_write_string(uint x0, uint y0, const char *s, size_t len, uint16_t color, uint16_t bgcolor, bool bgtransparent) {
-  // keep values within range
-  st7789_clip_pixel_vals(&x0, &y0);
-  int line_width = 0;
-  for (int i = 0; i < len; i++) {
+void HOT_FUNC(st7789_framebuf_write_string)(uint x0, uint y0, const char *s, size_t len, uint16_t color, uint16_t bgcolor, bool bgtransparent) {
+  uint x = x0;
+  for (size_t i = 0; i < len; i++) {
     if (s[i] == '\0') {
       break;
     }
     // on line breaks, increment us down a line
     if (s[i] == '\n') {
       y0 += FONT_H;
-      line_width = 0;
+      x = x0;
       continue;
     }
-    st7789_framebuf_write_char(x0 + line_width * FONT_W, y0, s[i], color, bgcolor, bgtransparent);
-    line_width++;
+    if (y0 >= ST7789_COLUMN_SIZE) {
+      break;
+    }
+    // anything past the right edge is clipped, but a later line may still fit
+    if (x < ST7789_LINE_SIZE) {
+      st7789_framebuf_write_char(x, y0, s[i], color, bgcolor, bgtransparent);
+    }
+    x += FONT_W;
   }
 }
 
@@ -153,9 +612,9 @@ void st7789_framebuf_draw_line(uint x0, uint y0, uint x1, uint y1, uint16_t colo
 /*
  * st7789_framebuf_fill_rect
  *
- * @brief Fill a rect in the framebuffer.
+ * @brief Fill a rect in the framebuffer. Both corners are inclusive, same as st7789_fill_rect.
  */
-void st7789_framebuf_fill_rect(uint x0, uint y0, uint x1, uint y1, uint16_t color) {
+void HOT_FUNC(st7789_framebuf_fill_rect)(uint x0, uint y0, uint x1, uint y1, uint16_t color) {
   // keep values within range
   st7789_clip_pixel_vals(&x0, &y0);
   st7789_clip_pixel_vals(&x1, &y1);
@@ -171,9 +630,13 @@ void st7789_framebuf_fill_rect(uint x0, uint y0, uint x1, uint y1, uint16_t colo
     y0 = y1;
     y1 = tmp;
   }
-  for (size_t xi = x0; xi < x1; xi++) {
-    for (size_t yi = y0; yi < y1; yi++) {
-      framebuf[FRAMEBUF_INDEX(xi, yi)] = color;
-    }
+  st7789_pixel_t p = framebuf_color(color);
+  // full-width rects are contiguous in memory, so fill them in one go
+  if (x0 == 0 && x1 == ST7789_LINE_SIZE-1) {
+    framebuf_fill_span(&framebuf[FRAMEBUF_INDEX(0, y0)], (y1 - y0 + 1) * ST7789_LINE_SIZE, p);
+    return;
+  }
+  for (size_t yi = y0; yi <= y1; yi++) {
+    framebuf_fill_span(&framebuf[FRAMEBUF_INDEX(x0, yi)], x1 - x0 + 1, p);
   }
 }
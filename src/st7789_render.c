@@ -0,0 +1,137 @@
+/*
+ * st7789_render.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include "st7789_render.h"
+#include "st7789.h"
+#include "st7789_framebuf.h"
+#include "hotpath.h"
+#if PICO_ON_DEVICE
+#include "hardware/interp.h"
+#endif
+
+/*
+ * @brief log2 of sizeof(st7789_pixel_t): the low bits of a byte offset that
+ * are always zero.
+ */
+#define RENDER_PIXEL_SHIFT (sizeof(st7789_pixel_t) == 1 ? 0 : 1)
+
+/*
+ * render_offset_bits
+ *
+ * @brief Highest bit set in a byte offset into an array of n st7789_pixel_t,
+ * i.e. the msb of the interpolator mask that selects elements 0..n-1.
+ */
+static inline uint render_offset_bits(size_t n) {
+  uint bits = RENDER_PIXEL_SHIFT;
+  while (((size_t)1 << (bits + 1)) < (n << RENDER_PIXEL_SHIFT)) {
+    bits++;
+  }
+  return bits;
+}
+
+/*
+ * @brief Both paths turn a 16.16 fixed-point index into a byte offset into a
+ * st7789_pixel_t array with ((x >> shift) & mask), mask covering bits
+ * RENDER_PIXEL_SHIFT..msb. That is exactly what the interpolator lanes
+ * compute, so the C fallback below has to stick to the same formula.
+ */
+#define RENDER_OFFSET_SHIFT (ST7789_RENDER_FRAC_BITS - RENDER_PIXEL_SHIFT)
+#define RENDER_OFFSET_MASK(msb) ((((uint32_t)1 << ((msb) + 1)) - 1) & ~(((uint32_t)1 << RENDER_PIXEL_SHIFT) - 1))
+
+void HOT_FUNC(st7789_render_map)(const float *src, const uint16_t *order, size_t n, float min_temp, float max_temp, const st7789_pixel_t *palette, size_t n_colors, st7789_pixel_t *dst) {
+  // a flat scene maps everything to palette[0] rather than dividing by zero
+  float scale = max_temp > min_temp ? (float)((n_colors - 1) << ST7789_RENDER_FRAC_BITS) / (max_temp - min_temp) : 0.0f;
+  int32_t max_index = (int32_t)((n_colors - 1) << ST7789_RENDER_FRAC_BITS);
+  uint msb = render_offset_bits(n_colors);
+
+#if PICO_ON_DEVICE
+  // lane 0 turns the fixed-point index into the address of the palette entry
+  interp_config cfg = interp_default_config();
+  interp_config_set_shift(&cfg, RENDER_OFFSET_SHIFT);
+  interp_config_set_mask(&cfg, RENDER_PIXEL_SHIFT, msb);
+  interp_set_config(interp1, 0, &cfg);
+  interp1->base[0] = (uintptr_t)palette;
+#else
+  uint32_t mask = RENDER_OFFSET_MASK(msb);
+#endif
+
+  for (size_t i = 0; i < n; i++) {
+    float pix = src[order ? order[i] : i];
+    // clamped before converting, which NaN (failing both) and inf can't be
+    float f = (pix - min_temp) * scale;
+    if (!(f > 0.0f)) f = 0.0f;
+    if (f > (float)max_index) f = (float)max_index;
+    int32_t index = (int32_t)f;
+#if PICO_ON_DEVICE
+    interp1->accum[0] = (uint32_t)index;
+    dst[i] = *(const st7789_pixel_t *)(uintptr_t)interp1->peek[0];
+#else
+    dst[i] = *(const st7789_pixel_t *)((uintptr_t)palette + (((uint32_t)index >> RENDER_OFFSET_SHIFT) & mask));
+#endif
+  }
+}
+
+void HOT_FUNC(st7789_render_scale)(const st7789_pixel_t *src, uint src_w, uint src_h, uint x0, uint y0, uint dst_w, uint dst_h) {
+  static st7789_pixel_t row[ST7789_LINE_SIZE] __attribute__((aligned(4)));
+  if (dst_w > ST7789_LINE_SIZE) {
+    dst_w = ST7789_LINE_SIZE;
+  }
+  if (src_w > ST7789_RENDER_MAX_SRC_W || dst_w == 0 || dst_h == 0) {
+    return;
+  }
+
+  // step through the source in 16.16, sampling the middle of each output pixel
+  uint32_t du = ((uint32_t)src_w << ST7789_RENDER_FRAC_BITS) / dst_w;
+  uint32_t dv = ((uint32_t)src_h << ST7789_RENDER_FRAC_BITS) / dst_h;
+  uint msb = render_offset_bits(src_w);
+
+#if PICO_ON_DEVICE
+  // lane 0 walks u (add_raw keeps the full 16.16 value in the accumulator),
+  // lane 1 stays at zero, and the full result is row + the texel's byte offset
+  interp_config cfg = interp_default_config();
+  interp_config_set_add_raw(&cfg, true);
+  interp_config_set_shift(&cfg, RENDER_OFFSET_SHIFT);
+  interp_config_set_mask(&cfg, RENDER_PIXEL_SHIFT, msb);
+  interp_set_config(interp0, 0, &cfg);
+  interp_set_config(interp0, 1, &cfg);
+  interp0->accum[1] = 0;
+  interp0->base[1] = 0;
+  interp0->base[0] = du;
+#else
+  uint32_t mask = RENDER_OFFSET_MASK(msb);
+#endif
+
+  uint yi = 0;
+  while (yi < dst_h) {
+    uint32_t sv = (yi * dv + dv / 2) >> ST7789_RENDER_FRAC_BITS;
+    const st7789_pixel_t *src_row = &src[sv * src_w];
+
+#if PICO_ON_DEVICE
+    interp0->accum[0] = du / 2;
+    interp0->base[2] = (uintptr_t)src_row;
+    for (uint xi = 0; xi < dst_w; xi++) {
+      row[xi] = *(const st7789_pixel_t *)(uintptr_t)interp0->pop[2];
+    }
+#else
+    uint32_t u = du / 2;
+    for (uint xi = 0; xi < dst_w; xi++) {
+      row[xi] = *(const st7789_pixel_t *)((uintptr_t)src_row + ((u >> RENDER_OFFSET_SHIFT) & mask));
+      u += du;
+    }
+#endif
+
+    // every output row sampling the same source row is identical
+    uint run = 1;
+    while (yi + run < dst_h && (((yi + run) * dv + dv / 2) >> ST7789_RENDER_FRAC_BITS) == sv) {
+      run++;
+    }
+    for (uint k = 0; k < run; k++) {
+      st7789_framebuf_blit(x0, y0 + yi + k, dst_w, 1, row, dst_w);
+    }
+    yi += run;
+  }
+}
@@ -0,0 +1,264 @@
+/*
+ * stream.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/util/queue.h"
+#include "tusb.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "stream.h"
+#include "console.h"
+#include "frame_codec.h"
+#include "sensor.h"
+#include "mlx90640/MLX90640_API.h"
+
+typedef struct {
+  stream_header_t h;
+  // raw frames are encoded straight from here
+  uint8_t payload[STREAM_PROTO_MAX_PAYLOAD] __attribute__((aligned(4)));
+} stream_msg_t;
+
+static queue_t stream_queue;
+static volatile stream_mode_t stream_mode = STREAM_OFF;
+// set by core1 from the CDC line state, DTR means a host has the port open
+static volatile bool stream_host_open = false;
+
+/*
+ * @brief core0: the next sequence number, which also counts dropped frames
+ * so the host sees them as gaps, and where a message is put together.
+ */
+static uint32_t stream_seq = 0;
+static stream_msg_t stream_stage;
+
+/*
+ * @brief core1: the message going out and how much of it the endpoint has
+ * taken.
+ */
+static bool stream_usb_started = false;
+static stream_msg_t stream_tx_msg;
+static uint8_t stream_tx_buf[STREAM_PROTO_MAX_MSG];
+static size_t stream_tx_len = 0;
+static size_t stream_tx_pos = 0;
+// packed frames depend on the one before from the same sensor
+static frame_codec_t stream_codecs[THERMAL_CAMERA_SENSORS];
+static uint8_t stream_packed[FRAME_CODEC_MAX_BYTES];
+
+/*
+ * @brief Each sensor's calibration, written by core0 once at start-up;
+ * a sensor's bit in stream_eeprom_valid is set after its copy is, and core1
+ * keeps which ones the current host has been sent.
+ */
+static uint16_t stream_eeprom[THERMAL_CAMERA_SENSORS][STREAM_PROTO_EEPROM_WORDS];
+static volatile uint32_t stream_eeprom_valid = 0;
+static uint32_t stream_eeprom_sent = 0;
+
+// the 64-bit counters are only written by core1 and may read torn from
+// core0, they are for show
+static volatile stream_stats_t stream_stats;
+// frames dropped, counted apart by each core so neither loses the other's
+// increments: core0's found the queue full, core1's were thrown out of it
+static volatile uint32_t stream_dropped_full = 0;
+static volatile uint32_t stream_dropped_discarded = 0;
+
+void stream_set_eeprom(uint8_t sensor, const uint16_t *ee_data) {
+  if (sensor >= THERMAL_CAMERA_SENSORS) {
+    return;
+  }
+  memcpy(stream_eeprom[sensor], ee_data, sizeof(stream_eeprom[sensor]));
+  // the copy has to be seen by core1 before the bit is
+  __dmb();
+  stream_eeprom_valid |= 1u << sensor;
+}
+
+bool stream_frame(uint8_t sensor, int subpage, uint32_t time_us, const uint16_t *frame_data, const float *temps) {
+  stream_mode_t mode = stream_mode;
+  if (mode == STREAM_OFF || !stream_host_open) {
+    return true;
+  }
+
+  stream_msg_t *m = &stream_stage;
+  m->h.sensor = sensor;
+  m->h.subpage = (uint8_t)subpage;
+  m->h.seq = stream_seq++;
+  m->h.time_us = time_us;
+  if (mode == STREAM_RAW || mode == STREAM_PACKED) {
+    // packed frames are encoded on core1, on the way out
+    m->h.type = mode == STREAM_PACKED ? STREAM_MSG_RAW_PACKED : STREAM_MSG_RAW;
+    m->h.payload_len = FRAME_CODEC_WORDS * sizeof(uint16_t);
+    memcpy(m->payload, frame_data, m->h.payload_len);
+  } else {
+    m->h.type = STREAM_MSG_TO;
+    m->h.payload_len = MLX90640_PIXEL_NUM * sizeof(float);
+    memcpy(m->payload, temps, m->h.payload_len);
+  }
+
+  // only copies, the other core is never waited for
+  if (!queue_try_add(&stream_queue, m)) {
+    stream_dropped_full++;
+    return false;
+  }
+  stream_stats.queued++;
+  return true;
+}
+
+/*
+ * stream_discard
+ *
+ * @brief The host went away: forget the message half sent and what is
+ * queued, they'd only be stale by the time it's back.
+ */
+static void stream_discard(void) {
+  stream_tx_len = stream_tx_pos = 0;
+  while (queue_try_remove(&stream_queue, &stream_tx_msg)) {
+    stream_dropped_discarded++;
+  }
+  // and from the calibration
+  stream_eeprom_sent = 0;
+  // the next host starts from a key frame
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    frame_codec_init(&stream_codecs[k], FRAME_CODEC_KEY_INTERVAL);
+  }
+}
+
+/*
+ * stream_encode_eeprom
+ *
+ * @brief Put together the next EEPROM message the host hasn't had, if
+ * there is one.
+ */
+static bool stream_encode_eeprom(void) {
+  uint32_t todo = stream_eeprom_valid & ~stream_eeprom_sent;
+  if (!todo) {
+    return false;
+  }
+  uint8_t sensor = (uint8_t)__builtin_ctz(todo);
+  stream_header_t h = { STREAM_MSG_EEPROM, sensor, 0, 0, time_us_32(), sizeof(stream_eeprom[sensor]) };
+  stream_tx_len = stream_proto_encode(&h, stream_eeprom[sensor], stream_tx_buf, sizeof(stream_tx_buf));
+  stream_tx_pos = 0;
+  stream_eeprom_sent |= 1u << sensor;
+  return true;
+}
+
+/*
+ * stream_encode
+ *
+ * @brief Put the message just taken off the queue together for sending,
+ * packing it first if it asks for that.
+ */
+static void stream_encode(stream_msg_t *m) {
+  const uint8_t *payload = m->payload;
+  if (m->h.type == STREAM_MSG_RAW_PACKED) {
+    if (m->h.sensor >= THERMAL_CAMERA_SENSORS) {
+      stream_tx_len = stream_tx_pos = 0;
+      return;
+    }
+    uint32_t t0 = time_us_32();
+    m->h.payload_len = (uint16_t)frame_codec_encode(&stream_codecs[m->h.sensor], (const uint16_t *)m->payload,
+      stream_packed, sizeof(stream_packed));
+    stream_stats.packed_us += time_us_32() - t0;
+    stream_stats.packed_bytes += m->h.payload_len;
+    stream_stats.packed++;
+    payload = stream_packed;
+  }
+  stream_tx_len = stream_proto_encode(&m->h, payload, stream_tx_buf, sizeof(stream_tx_buf));
+  stream_tx_pos = 0;
+}
+
+void stream_service(void) {
+  if (!stream_usb_started) {
+    // the USB irq goes to whichever core does this, which must be the one
+    // calling tud_task
+    tusb_init();
+    stream_discard();
+    stream_usb_started = true;
+  }
+
+  tud_task();
+  bool open = tud_cdc_connected();
+  if (stream_host_open && !open) {
+    stream_discard();
+  }
+  stream_host_open = open;
+  if (!open) {
+    return;
+  }
+
+  if (stream_tx_pos == stream_tx_len && stream_mode != STREAM_OFF && !stream_encode_eeprom() &&
+      queue_try_remove(&stream_queue, &stream_tx_msg)) {
+    stream_encode(&stream_tx_msg);
+  }
+  if (stream_tx_pos < stream_tx_len) {
+    // takes what fits in the CDC FIFO, the rest goes on a later pass
+    uint32_t n = tud_cdc_write(&stream_tx_buf[stream_tx_pos], stream_tx_len - stream_tx_pos);
+    stream_tx_pos += n;
+    stream_stats.bytes += n;
+    if (stream_tx_pos == stream_tx_len) {
+      stream_stats.sent++;
+    }
+    tud_cdc_write_flush();
+  }
+}
+
+void stream_service_until(uint64_t until_us) {
+  do {
+    stream_service();
+  } while (time_us_64() < until_us);
+}
+
+void stream_get_stats(stream_stats_t *stats) {
+  stats->queued = stream_stats.queued;
+  stats->dropped = stream_dropped_full + stream_dropped_discarded;
+  stats->sent = stream_stats.sent;
+  stats->bytes = stream_stats.bytes;
+  stats->packed = stream_stats.packed;
+  stats->packed_bytes = stream_stats.packed_bytes;
+  stats->packed_us = stream_stats.packed_us;
+}
+
+static const char *stream_mode_name(stream_mode_t mode) {
+  switch (mode) {
+    case STREAM_TO: return "to";
+    case STREAM_RAW: return "raw";
+    case STREAM_PACKED: return "packed";
+    default: return "off";
+  }
+}
+
+static void console_stream(const char *args) {
+  if (strcmp(args, "off") == 0) {
+    stream_mode = STREAM_OFF;
+  } else if (strcmp(args, "to") == 0) {
+    stream_mode = STREAM_TO;
+  } else if (strcmp(args, "raw") == 0) {
+    stream_mode = STREAM_RAW;
+  } else if (strcmp(args, "packed") == 0) {
+    stream_mode = STREAM_PACKED;
+  } else if (args[0] != '\0') {
+    printf("[ERROR] stream: unknown mode \"%s\".\n", args);
+    return;
+  }
+  stream_stats_t stats;
+  stream_get_stats(&stats);
+  printf("[INFO] stream: %s, host %s, queued %lu dropped %lu sent %lu, %llu bytes.\n", stream_mode_name(stream_mode),
+    stream_host_open ? "open" : "closed", (unsigned long)stats.queued, (unsigned long)stats.dropped,
+    (unsigned long)stats.sent, (unsigned long long)stats.bytes);
+  if (stats.packed > 0) {
+    // cycles at the system clock, both cores run off it
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    printf("[INFO] stream: packed %lu frames, %.1f bytes each, %.2f:1, %llu cycles each.\n",
+      (unsigned long)stats.packed, (double)stats.packed_bytes / stats.packed,
+      (double)FRAME_CODEC_WORDS * 2 * stats.packed / stats.packed_bytes,
+      (unsigned long long)(stats.packed_us * mhz / stats.packed));
+  }
+}
+
+void stream_init(stream_mode_t mode) {
+  queue_init(&stream_queue, sizeof(stream_msg_t), STREAM_QUEUE_LEN);
+  stream_mode = mode;
+  console_register("stream", "stream [off|to|raw|packed]: frames over USB CDC", console_stream);
+}
@@ -0,0 +1,118 @@
+/*
+ * stream_proto.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "stream_proto.h"
+
+static const uint8_t stream_proto_magic[4] = { 'T', 'C', 'A', 'M' };
+
+/*
+ * @brief CRC-32 of each nibble, reflected polynomial 0xEDB88320. Half a
+ * kilobyte less than the byte table and plenty fast for a few kB a frame.
+ */
+static const uint32_t stream_proto_crc_nibble[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t stream_proto_crc32(uint32_t crc, const void *data, size_t n) {
+  const uint8_t *p = data;
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ stream_proto_crc_nibble[crc & 0xF];
+    crc = (crc >> 4) ^ stream_proto_crc_nibble[crc & 0xF];
+  }
+  return ~crc;
+}
+
+static void stream_proto_put16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void stream_proto_put32(uint8_t *p, uint32_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = v >> 24;
+}
+
+static uint16_t stream_proto_get16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t stream_proto_get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t stream_proto_encode(const stream_header_t *h, const void *payload, uint8_t *out, size_t cap) {
+  size_t len = STREAM_PROTO_HEADER_SIZE + h->payload_len + STREAM_PROTO_CRC_SIZE;
+  if (h->payload_len > STREAM_PROTO_MAX_PAYLOAD || len > cap) {
+    return 0;
+  }
+  memcpy(out, stream_proto_magic, sizeof(stream_proto_magic));
+  out[4] = STREAM_PROTO_VERSION;
+  out[5] = h->type;
+  out[6] = h->sensor;
+  out[7] = h->subpage;
+  stream_proto_put32(&out[8], h->seq);
+  stream_proto_put32(&out[12], h->time_us);
+  stream_proto_put16(&out[16], h->payload_len);
+  stream_proto_put16(&out[18], 0);
+  memcpy(&out[STREAM_PROTO_HEADER_SIZE], payload, h->payload_len);
+  // the magic is left out, it never changes
+  uint32_t crc = stream_proto_crc32(0, &out[4], STREAM_PROTO_HEADER_SIZE - 4 + h->payload_len);
+  stream_proto_put32(&out[STREAM_PROTO_HEADER_SIZE + h->payload_len], crc);
+  return len;
+}
+
+stream_parse_t stream_proto_parse(const uint8_t *buf, size_t len, stream_header_t *h, const uint8_t **payload, size_t *consumed) {
+  // find where the magic could start; a partial one at the end is kept
+  size_t start = 0;
+  while (start < len) {
+    size_t n = len - start < sizeof(stream_proto_magic) ? len - start : sizeof(stream_proto_magic);
+    if (memcmp(&buf[start], stream_proto_magic, n) == 0) {
+      break;
+    }
+    start++;
+  }
+  if (start > 0) {
+    *consumed = start;
+    return STREAM_PARSE_SKIP;
+  }
+  if (len < STREAM_PROTO_HEADER_SIZE) {
+    return STREAM_PARSE_MORE;
+  }
+
+  uint16_t payload_len = stream_proto_get16(&buf[16]);
+  if (buf[4] != STREAM_PROTO_VERSION || payload_len > STREAM_PROTO_MAX_PAYLOAD) {
+    // a magic by chance, or a header we don't understand
+    *consumed = 1;
+    return STREAM_PARSE_SKIP;
+  }
+  size_t msg_len = STREAM_PROTO_HEADER_SIZE + payload_len + STREAM_PROTO_CRC_SIZE;
+  if (len < msg_len) {
+    return STREAM_PARSE_MORE;
+  }
+  uint32_t crc = stream_proto_crc32(0, &buf[4], STREAM_PROTO_HEADER_SIZE - 4 + payload_len);
+  if (crc != stream_proto_get32(&buf[STREAM_PROTO_HEADER_SIZE + payload_len])) {
+    // the length may be what got corrupted, so only step past this magic
+    *consumed = 1;
+    return STREAM_PARSE_BAD_CRC;
+  }
+
+  h->type = buf[5];
+  h->sensor = buf[6];
+  h->subpage = buf[7];
+  h->seq = stream_proto_get32(&buf[8]);
+  h->time_us = stream_proto_get32(&buf[12]);
+  h->payload_len = payload_len;
+  *payload = &buf[STREAM_PROTO_HEADER_SIZE];
+  *consumed = msg_len;
+  return STREAM_PARSE_OK;
+}
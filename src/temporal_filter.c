@@ -0,0 +1,139 @@
+/*
+ * temporal_filter.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "temporal_filter.h"
+#include "console.h"
+#include "hotpath.h"
+
+/*
+ * @brief Averages are Q16.16 degrees C, weights Q8 with 256 taking the new
+ * value as it is.
+ */
+#define TEMPORAL_FILTER_FRAC_BITS 16
+#define TEMPORAL_FILTER_ONE (1 << TEMPORAL_FILTER_FRAC_BITS)
+#define TEMPORAL_FILTER_ALPHA_ONE 256
+/*
+ * @brief Values further out than TEMPORAL_FILTER_MAX_C can't be a real
+ * reading (and would overflow the fixed point), they go through as they
+ * are. Keeping the threshold under TEMPORAL_FILTER_MAX_THRESHOLD keeps
+ * change * weight inside 32 bits.
+ */
+#define TEMPORAL_FILTER_MAX_C 1000.0f
+#define TEMPORAL_FILTER_MAX_THRESHOLD 64.0f
+/*
+ * @brief An average no reading can be near, so the next value is always
+ * past the threshold and gets taken as it is. Far enough from
+ * TEMPORAL_FILTER_MAX_C that the difference still fits.
+ */
+#define TEMPORAL_FILTER_UNSET (-(1 << 30))
+
+static bool temporal_filter_on = false;
+static int32_t temporal_filter_alpha;      // Q8 weight when nothing moves
+static int32_t temporal_filter_threshold;  // Q16.16
+static int32_t temporal_filter_slope;      // Q16 weight per Q16.16 of change
+static int32_t temporal_filter_state[TEMPORAL_FILTER_MAX_PIXELS];
+
+void temporal_filter_set(float alpha, float threshold) {
+  if (!(alpha >= 0.0f)) alpha = 0.0f;
+  if (alpha > 1.0f) alpha = 1.0f;
+  if (!(threshold >= 0.01f)) threshold = 0.01f;
+  if (threshold > TEMPORAL_FILTER_MAX_THRESHOLD) threshold = TEMPORAL_FILTER_MAX_THRESHOLD;
+
+  int32_t a = (int32_t)(alpha * TEMPORAL_FILTER_ALPHA_ONE + 0.5f);
+  int32_t t = (int32_t)(threshold * TEMPORAL_FILTER_ONE);
+  // the weight ramps from a with no change up to one at the threshold; at
+  // the threshold change * slope is (one - a) << 16, well inside 32 bits
+  temporal_filter_slope = ((TEMPORAL_FILTER_ALPHA_ONE - a) << 16) / t;
+  temporal_filter_alpha = a;
+  temporal_filter_threshold = t;
+}
+
+void temporal_filter_reset(void) {
+  for (size_t i = 0; i < TEMPORAL_FILTER_MAX_PIXELS; i++) {
+    temporal_filter_state[i] = TEMPORAL_FILTER_UNSET;
+  }
+}
+
+void temporal_filter_enable(bool enabled) {
+  if (enabled && !temporal_filter_on) {
+    temporal_filter_reset();
+  }
+  temporal_filter_on = enabled;
+}
+
+bool temporal_filter_enabled(void) {
+  return temporal_filter_on;
+}
+
+/*
+ * temporal_filter_apply
+ *
+ * @brief One pass over the pixels with no data dependent branches but the
+ * range check, so it stays cheap next to MLX90640_CalculateTo: the float
+ * conversions are most of it.
+ */
+void HOT_FUNC(temporal_filter_apply)(float *frame, size_t first, size_t n) {
+  if (!temporal_filter_on || first + n > TEMPORAL_FILTER_MAX_PIXELS) {
+    return;
+  }
+  const int32_t alpha = temporal_filter_alpha;
+  const int32_t threshold = temporal_filter_threshold;
+  const int32_t slope = temporal_filter_slope;
+  float *temps = &frame[first];
+  int32_t *state = &temporal_filter_state[first];
+
+  for (size_t i = 0; i < n; i++) {
+    float t = temps[i];
+    if (!(fabsf(t) < TEMPORAL_FILTER_MAX_C)) {
+      continue;
+    }
+    int32_t x = (int32_t)(t * TEMPORAL_FILTER_ONE);
+    int32_t y = state[i];
+    int32_t d = x - y;
+    // clamp the change to the threshold so the products below can't overflow
+    int32_t dc = d > threshold ? threshold : (d < -threshold ? -threshold : d);
+    int32_t ad = dc < 0 ? -dc : dc;
+    int32_t a = alpha + ((ad * slope) >> 16);
+    y = ad >= threshold ? x : y + ((dc * a) >> 8);
+    state[i] = y;
+    temps[i] = (float)y * (1.0f / TEMPORAL_FILTER_ONE);
+  }
+}
+
+static void temporal_filter_print(void) {
+  printf("[INFO] filter: %s, alpha %.3f, threshold %.2f C.\n", temporal_filter_on ? "on" : "off",
+    (double)temporal_filter_alpha / TEMPORAL_FILTER_ALPHA_ONE, (double)temporal_filter_threshold / TEMPORAL_FILTER_ONE);
+}
+
+static void console_filter(const char *args) {
+  if (strcmp(args, "on") == 0) {
+    temporal_filter_enable(true);
+  } else if (strcmp(args, "off") == 0) {
+    temporal_filter_enable(false);
+  } else if (strcmp(args, "reset") == 0) {
+    temporal_filter_reset();
+  } else if (strncmp(args, "alpha ", 6) == 0) {
+    temporal_filter_set(strtof(args + 6, NULL), (float)temporal_filter_threshold / TEMPORAL_FILTER_ONE);
+  } else if (strncmp(args, "threshold ", 10) == 0) {
+    temporal_filter_set((float)temporal_filter_alpha / TEMPORAL_FILTER_ALPHA_ONE, strtof(args + 10, NULL));
+  } else if (args[0] != '\0') {
+    printf("[ERROR] filter: unknown setting \"%s\".\n", args);
+    return;
+  }
+  temporal_filter_print();
+}
+
+void temporal_filter_init(bool enabled) {
+  temporal_filter_set(TEMPORAL_FILTER_ALPHA, TEMPORAL_FILTER_THRESHOLD);
+  temporal_filter_on = false;
+  temporal_filter_enable(enabled);
+  console_register("filter", "filter [on|off|reset|alpha <0-1>|threshold <C>]: temporal noise filter", console_filter);
+}
@@ -0,0 +1,107 @@
+/*
+ * usb_descriptors.c
+ *
+ * @brief USB descriptors for the frame stream, one CDC interface. Follows
+ * the TinyUSB device examples.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "pico/unique_id.h"
+#include "tusb.h"
+
+// Raspberry Pi's vendor ID with the product ID the SDK uses for CDC stdio
+#define USBD_VID 0x2E8A
+#define USBD_PID 0x000A
+
+#define USBD_ITF_CDC 0
+#define USBD_ITF_MAX 2
+
+#define USBD_CDC_EP_CMD 0x81
+#define USBD_CDC_EP_OUT 0x02
+#define USBD_CDC_EP_IN 0x82
+#define USBD_CDC_CMD_MAX_SIZE 8
+// max packet size, all full speed bulk allows; transfers can be longer
+#define USBD_CDC_EP_SIZE 64
+
+#define USBD_STR_MANUF 1
+#define USBD_STR_PRODUCT 2
+#define USBD_STR_SERIAL 3
+#define USBD_STR_CDC 4
+
+#define USBD_DESC_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN)
+
+// room for the longest string below, the CDC interface's 27 characters;
+// the serial number is 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES = 16
+#define USBD_STR_MAX_LEN 32
+
+static const tusb_desc_device_t usbd_desc_device = {
+  .bLength = sizeof(tusb_desc_device_t),
+  .bDescriptorType = TUSB_DESC_DEVICE,
+  .bcdUSB = 0x0200,
+  // interface association, so hosts bind the CDC function's control and
+  // data interfaces together
+  .bDeviceClass = TUSB_CLASS_MISC,
+  .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+  .bDeviceProtocol = MISC_PROTOCOL_IAD,
+  .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor = USBD_VID,
+  .idProduct = USBD_PID,
+  .bcdDevice = 0x0100,
+  .iManufacturer = USBD_STR_MANUF,
+  .iProduct = USBD_STR_PRODUCT,
+  .iSerialNumber = USBD_STR_SERIAL,
+  .bNumConfigurations = 1,
+};
+
+static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
+  TUD_CONFIG_DESCRIPTOR(1, USBD_ITF_MAX, 0, USBD_DESC_LEN, 0, 250),
+  TUD_CDC_DESCRIPTOR(USBD_ITF_CDC, USBD_STR_CDC, USBD_CDC_EP_CMD, USBD_CDC_CMD_MAX_SIZE,
+    USBD_CDC_EP_OUT, USBD_CDC_EP_IN, USBD_CDC_EP_SIZE),
+};
+
+static const char *const usbd_desc_str[] = {
+  [USBD_STR_MANUF] = "simojo",
+  [USBD_STR_PRODUCT] = "thermal-camera",
+  [USBD_STR_SERIAL] = NULL,  // the flash unique ID, filled in below
+  [USBD_STR_CDC] = "thermal-camera frame stream",
+};
+
+const uint8_t *tud_descriptor_device_cb(void) {
+  return (const uint8_t *)&usbd_desc_device;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
+  (void)index;
+  return usbd_desc_cfg;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+  (void)langid;
+  static uint16_t desc_str[1 + USBD_STR_MAX_LEN];
+  static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+  uint8_t len;
+
+  if (index == 0) {
+    // supported language: English (0x0409)
+    desc_str[1] = 0x0409;
+    len = 1;
+  } else {
+    if (index >= count_of(usbd_desc_str)) {
+      return NULL;
+    }
+    const char *str = usbd_desc_str[index];
+    if (index == USBD_STR_SERIAL) {
+      pico_get_unique_board_id_string(serial, sizeof(serial));
+      str = serial;
+    }
+    for (len = 0; len < count_of(desc_str) - 1 && str[len]; len++) {
+      desc_str[1 + len] = str[len];
+    }
+  }
+  // first entry is the length in bytes (header included) and the type
+  desc_str[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * len + 2));
+  return desc_str;
+}
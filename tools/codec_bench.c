@@ -0,0 +1,133 @@
+/*
+ * codec_bench.c
+ *
+ * @brief Runs raw frames through frame_codec.h and back, checks they come
+ * out as they went in, and reports the compression ratio and how long each
+ * direction takes per frame on this machine. The device's own timing is in
+ * the "stream" console command and the sensor benchmarks.
+ *
+ *   codec_bench [-n frames] [-k key_interval] [frames.csv]
+ *
+ * Reads the raw lines of a CSV from stream_recv, or makes n synthetic
+ * frames (1000 by default) if there is no file.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_codec.h"
+#include "fake_frames.h"
+
+#define CSV_FIELDS_BEFORE_WORDS 5
+#define CSV_LINE_MAX (16 * 1024)
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * read_csv_frame
+ *
+ * @brief The next raw frame in a stream_recv CSV, skipping To lines.
+ * Returns 0 at the end of the file.
+ */
+static int read_csv_frame(FILE *f, uint16_t *frame) {
+  static char line[CSV_LINE_MAX];
+  while (fgets(line, sizeof(line), f)) {
+    char *field = line;
+    int n = 0, words = 0;
+    for (char *p = line; ; p++) {
+      if (*p != ',' && *p != '\n' && *p != '\0') {
+        continue;
+      }
+      char end = *p;
+      *p = '\0';
+      if (n == CSV_FIELDS_BEFORE_WORDS - 1 && strcmp(field, "raw") != 0) {
+        break;
+      }
+      if (n >= CSV_FIELDS_BEFORE_WORDS && words < FAKE_RAW_WORDS) {
+        frame[words++] = (uint16_t)strtoul(field, NULL, 10);
+      }
+      n++;
+      field = p + 1;
+      if (end != ',') {
+        break;
+      }
+    }
+    if (words == FAKE_RAW_WORDS) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  long n_frames = 1000;
+  int key_interval = FRAME_CODEC_KEY_INTERVAL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:k:")) != -1) {
+    switch (opt) {
+      case 'n': n_frames = atol(optarg); break;
+      case 'k': key_interval = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-k key_interval] [frames.csv]\n", argv[0]);
+        return 2;
+    }
+  }
+  FILE *csv = NULL;
+  if (optind < argc) {
+    csv = fopen(argv[optind], "r");
+    if (!csv) {
+      perror("[ERROR] fopen");
+      return 1;
+    }
+  }
+
+  static fake_frames_t fake;
+  static frame_codec_t enc, dec;
+  static uint16_t frame[FAKE_RAW_WORDS], out[FAKE_RAW_WORDS];
+  static uint8_t packed[FRAME_CODEC_MAX_BYTES];
+  fake_frames_init(&fake, 1);
+  frame_codec_init(&enc, (uint16_t)key_interval);
+  frame_codec_init(&dec, 0);
+
+  uint64_t enc_ns = 0, dec_ns = 0, bytes = 0;
+  long n = 0, keys = 0, stored = 0;
+  for (; csv ? read_csv_frame(csv, frame) : n < n_frames; n++) {
+    if (!csv) {
+      fake_frames_raw(&fake, (uint32_t)n, frame);
+    }
+    uint64_t t0 = now_ns();
+    size_t len = frame_codec_encode(&enc, frame, packed, sizeof(packed));
+    uint64_t t1 = now_ns();
+    frame_codec_status_t r = frame_codec_decode(&dec, packed, len, out);
+    uint64_t t2 = now_ns();
+    enc_ns += t1 - t0;
+    dec_ns += t2 - t1;
+    bytes += len;
+    keys += (packed[0] & FRAME_CODEC_KEY) != 0;
+    stored += (packed[0] & FRAME_CODEC_STORED) != 0;
+    if (r != FRAME_CODEC_OK || memcmp(frame, out, sizeof(frame)) != 0) {
+      printf("[ERROR] frame %ld didn't survive the round trip (%d).\n", n, r);
+      return 1;
+    }
+  }
+  if (n == 0) {
+    printf("[ERROR] no raw frames.\n");
+    return 1;
+  }
+
+  printf("[INFO] %ld frames (%ld key, %ld stored), %.1f bytes each on average from %d, %.2f:1.\n",
+    n, keys, stored, (double)bytes / n, 2 * FAKE_RAW_WORDS, 2.0 * FAKE_RAW_WORDS * n / bytes);
+  printf("[INFO] encode %.1f us, decode %.1f us per frame.\n", enc_ns / 1e3 / n, dec_ns / 1e3 / n);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * fake_frames.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "fake_frames.h"
+
+#define FAKE_CTRL 832
+#define FAKE_SUBPAGE 833
+// 2Hz, 18 bit, chess mode: what the firmware sets up
+#define FAKE_CTRL_VALUE 0x1901
+// ADC counts per degree above the background, and the noise in counts
+#define FAKE_GAIN 20.0f
+#define FAKE_NOISE 3
+
+static uint32_t fake_rand(fake_frames_t *f) {
+  // xorshift32, the same sequence on every host
+  f->rng ^= f->rng << 13;
+  f->rng ^= f->rng >> 17;
+  f->rng ^= f->rng << 5;
+  return f->rng;
+}
+
+/*
+ * fake_noise
+ *
+ * @brief Roughly gaussian, the sum of four uniforms, with about the given
+ * standard deviation.
+ */
+static int fake_noise(fake_frames_t *f, int sigma) {
+  int sum = 0;
+  for (int i = 0; i < 4; i++) {
+    sum += (int)(fake_rand(f) % 1001) - 500;
+  }
+  return sum * sigma / 577;
+}
+
+static float fake_scene(uint32_t n, int i) {
+  float cx = 16.0f + 10.0f * cosf(n * 0.05f);
+  float cy = 12.0f + 7.0f * sinf(n * 0.05f);
+  float dx = i % FAKE_LINE_SIZE - cx, dy = i / FAKE_LINE_SIZE - cy;
+  return 25.0f + 10.0f * expf(-(dx * dx + dy * dy) / 8.0f);
+}
+
+static int fake_measured(uint32_t n, int i) {
+  return (((i / FAKE_LINE_SIZE) ^ i) & 1) == (int)(n & 1);
+}
+
+void fake_frames_init(fake_frames_t *f, uint32_t seed) {
+  f->rng = seed ? seed : 1;
+  for (int i = 0; i < FAKE_PIXELS; i++) {
+    f->offset[i] = (int16_t)(-1000 + fake_noise(f, 150));
+    f->raw[i] = (uint16_t)f->offset[i];
+  }
+  for (int i = FAKE_PIXELS; i < FAKE_CTRL; i++) {
+    f->raw[i] = (uint16_t)fake_rand(f);
+  }
+  f->raw[FAKE_CTRL] = FAKE_CTRL_VALUE;
+  f->raw[FAKE_SUBPAGE] = 0;
+}
+
+void fake_frames_eeprom(uint32_t seed, uint16_t *ee_data) {
+  fake_frames_t f = { .rng = seed ? seed : 1 };
+  for (int i = 0; i < FAKE_EEPROM_WORDS; i++) {
+    ee_data[i] = (uint16_t)fake_rand(&f);
+  }
+  // per-pixel words from 64: none broken (0) or outliers (bit 0)
+  for (int i = 64; i < FAKE_EEPROM_WORDS; i++) {
+    ee_data[i] = (uint16_t)((ee_data[i] & ~1u) | 2u);
+  }
+}
+
+void fake_frames_to(fake_frames_t *f, uint32_t n, float *temps) {
+  for (int i = 0; i < FAKE_PIXELS; i++) {
+    if (fake_measured(n, i)) {
+      temps[i] = fake_scene(n, i) + fake_noise(f, 100) * 0.001f;
+    }
+  }
+}
+
+void fake_frames_raw(fake_frames_t *f, uint32_t n, uint16_t *frame) {
+  // the whole image drifts a little with the sensor's own temperature
+  int drift = (int)(8.0f * sinf(n * 0.01f));
+  for (int i = 0; i < FAKE_PIXELS; i++) {
+    if (fake_measured(n, i)) {
+      float signal = (fake_scene(n, i) - 25.0f) * FAKE_GAIN;
+      f->raw[i] = (uint16_t)(int16_t)(f->offset[i] + drift + (int)signal + fake_noise(f, FAKE_NOISE));
+    }
+  }
+  // a few aux words move (Ta, the compensation pixels), the rest are fixed
+  for (int i = FAKE_PIXELS; i < FAKE_CTRL; i += 8) {
+    f->raw[i] = (uint16_t)(f->raw[i] + fake_noise(f, 2));
+  }
+  f->raw[FAKE_SUBPAGE] = (uint16_t)(n & 1);
+  memcpy(frame, f->raw, sizeof(f->raw));
+}
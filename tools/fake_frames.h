@@ -0,0 +1,57 @@
+/*
+ * fake_frames.h
+ *
+ * @brief Synthetic MLX90640 frames for the host tools: a warm blob circling
+ * a 25C background, as To values or as the raw words MLX90640_GetFrameData
+ * would have read in chess mode. The raw frames have a fixed per-pixel
+ * offset, noise, drifting aux words, and the unmeasured subpage left as it
+ * was, which is what the codec and the protocol see from a real sensor.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _FAKE_FRAMES_H
+#define _FAKE_FRAMES_H
+
+#include <stdint.h>
+
+#define FAKE_PIXELS 768
+#define FAKE_RAW_WORDS 834
+#define FAKE_LINE_SIZE 32
+#define FAKE_EEPROM_WORDS 832
+
+typedef struct {
+  uint32_t rng;
+  int16_t offset[FAKE_PIXELS];
+  uint16_t raw[FAKE_RAW_WORDS];
+} fake_frames_t;
+
+/*
+ * fake_frames_init
+ *
+ * @brief Pick the fixed pattern and the first aux words from seed.
+ */
+void fake_frames_init(fake_frames_t *f, uint32_t seed);
+/*
+ * fake_frames_to
+ *
+ * @brief Frame n in degrees C, only the pixels of subpage n & 1 written.
+ */
+void fake_frames_to(fake_frames_t *f, uint32_t n, float *temps);
+/*
+ * fake_frames_eeprom
+ *
+ * @brief A made-up EEPROM dump of FAKE_EEPROM_WORDS, the same for a given
+ * seed. MLX90640_ExtractParameters takes it (no bad pixels), but the To it
+ * gives for the fake raw frames means nothing.
+ */
+void fake_frames_eeprom(uint32_t seed, uint16_t *ee_data);
+/*
+ * fake_frames_raw
+ *
+ * @brief Frame n as raw words, subpage n & 1 measured.
+ */
+void fake_frames_raw(fake_frames_t *f, uint32_t n, uint16_t *frame);
+
+#endif
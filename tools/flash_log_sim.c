@@ -0,0 +1,248 @@
+/*
+ * flash_log_sim.c
+ *
+ * @brief Runs the flash log (flash_log.h) the way the camera does, over a
+ * RAM stand-in for the flash (flash_ram.h), and checks what comes back:
+ *
+ *   flash_log_sim [-s sectors] [-n records] [-c cuts] [-f fail_every] [-e erase_every]
+ *                 [-d dump_pages]
+ *
+ * A record goes in each tick, small statistics-sized ones with a bigger
+ * frame-sized one now and then, and each tick leaves time for a couple of
+ * page programs, but only every erase_every ticks for an erase, unless the
+ * queue gets stuck behind one (flash_log_urgent), as logger.c does. -c cuts
+ * the power that many times, part way through a flash operation, and
+ * starts the log again from what's in the flash. -f fails every nth erase
+ * or program.
+ *
+ * Every record read back has to be intact and in order, the last one
+ * written has to be there, without failures nothing can be dropped, and
+ * without cuts, failures or a trip round the region nothing can be
+ * missing. Prints how evenly the sectors wore.
+ *
+ * Then the log is dumped, as "log dump" does, all of it and the newest
+ * dump_pages pages, and each dump laid out in a flash of its own as
+ * tools/log_decode does: it has to read back as the same records, the
+ * newest of them for the part.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flash_ram.h"
+
+#define SIM_PROGRAMS_PER_TICK 2
+#define SIM_BIG_EVERY 8
+
+static uint16_t sim_len(uint32_t id) {
+  return id % SIM_BIG_EVERY == 0 ? (uint16_t)(200 + id * 37 % (FLASH_LOG_MAX_PAYLOAD - 200)) : FLASH_LOG_STATS_SIZE;
+}
+
+static uint8_t sim_byte(uint32_t id, uint32_t i) {
+  return (uint8_t)(id * 31 + i * 7);
+}
+
+typedef struct {
+  flash_ram_t ram;
+  uint32_t n_pages;
+} sim_dump_t;
+
+static void sim_dump_page(void *ctx, const uint8_t *page) {
+  sim_dump_t *d = ctx;
+  memcpy(d->ram.mem + (size_t)d->n_pages++ * FLASH_LOG_PAGE_SIZE, page, FLASH_LOG_PAGE_SIZE);
+}
+
+/*
+ * sim_check_dump
+ *
+ * @brief Dump the newest max_pages pages of log and read them back as
+ * log_decode would. Has to come to the last read records of the whole
+ * log, ending with last; a part too small to hold a whole record can
+ * come to none. Returns false, having printed why, if not.
+ */
+static bool sim_check_dump(const flash_log_t *log, uint32_t max_pages, uint32_t read, uint32_t last) {
+  // a blank sector after the pages, for the log to find its way round them
+  uint32_t valid = flash_log_valid_pages(log);
+  uint32_t sectors = valid / FLASH_LOG_PAGES_PER_SECTOR + 2;
+  sectors = sectors < FLASH_LOG_MIN_SECTORS ? FLASH_LOG_MIN_SECTORS : sectors;
+  static sim_dump_t d;
+  d.n_pages = 0;
+  if (!flash_ram_init(&d.ram, sectors * FLASH_LOG_SECTOR_SIZE)) {
+    printf("[ERROR] out of memory.\n");
+    return false;
+  }
+  uint32_t dumped = flash_log_dump(log, max_pages, sim_dump_page, &d);
+  uint32_t want = max_pages && valid > max_pages ? max_pages : valid;
+
+  static flash_log_t copy;
+  static flash_log_reader_t r;
+  flash_log_init(&copy, &d.ram.backend);
+  flash_log_reader_init(&r, &copy);
+  flash_log_record_t h;
+  const uint8_t *p;
+  uint32_t n = 0, prev = 0, bad = 0;
+  while (flash_log_read(&r, &h, &p)) {
+    bad += h.len != sim_len(h.time_us) || h.time_us <= prev;
+    prev = h.time_us;
+    n++;
+  }
+  flash_ram_free(&d.ram);
+
+  printf("[INFO] dump of %u pages: %u pages, %u records.\n", max_pages, dumped, n);
+  if (dumped != want || d.n_pages != want) {
+    printf("[ERROR] dumped %u pages of %u, not %u.\n", dumped, valid, want);
+    return false;
+  }
+  if (bad || (n ? prev != last : want == valid) || n > read || (want == valid && n + r.broken < read)) {
+    printf("[ERROR] the dump read back as %u records, %u bad, the last %u, not %u ending with %u.\n", n, bad, prev,
+      read, last);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t sectors = 16, records = 20000, cuts = 0, fail_every = 0, erase_every = 4, dump_pages = 10;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:c:f:e:d:")) != -1) {
+    switch (opt) {
+      case 's': sectors = (uint32_t)atol(optarg); break;
+      case 'n': records = (uint32_t)atol(optarg); break;
+      case 'c': cuts = (uint32_t)atol(optarg); break;
+      case 'f': fail_every = (uint32_t)atol(optarg); break;
+      case 'e': erase_every = (uint32_t)atol(optarg); break;
+      case 'd': dump_pages = (uint32_t)atol(optarg); break;
+      default:
+        fprintf(stderr,
+          "usage: %s [-s sectors] [-n records] [-c cuts] [-f fail_every] [-e erase_every]\n"
+          "       [-d dump_pages]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (erase_every == 0) {
+    erase_every = 1;
+  }
+
+  flash_ram_t ram;
+  if (!flash_ram_init(&ram, sectors * FLASH_LOG_SECTOR_SIZE)) {
+    fprintf(stderr, "[ERROR] can't have %u sectors.\n", sectors);
+    return 1;
+  }
+  ram.fail_every = fail_every;
+  static flash_log_t log;
+  if (!flash_log_init(&log, &ram.backend)) {
+    fprintf(stderr, "[ERROR] %u sectors is too small, the log needs %u.\n", sectors, FLASH_LOG_MIN_SECTORS);
+    return 1;
+  }
+
+  // the ticks the power goes off on, spread over the run
+  uint32_t next_cut = cuts ? records / (cuts + 1) : UINT32_MAX;
+  uint32_t cuts_done = 0, appended = 0, dropped = 0, last_id = 0, failures = 0, wraps = 0, forced = 0;
+  uint8_t payload[FLASH_LOG_MAX_PAYLOAD];
+  for (uint32_t id = 1; id <= records; id++) {
+    uint16_t len = sim_len(id);
+    for (uint32_t i = 0; i < len; i++) {
+      payload[i] = sim_byte(id, i);
+    }
+    if (flash_log_append(&log, FLASH_LOG_STATS, 0, id, payload, len)) {
+      appended++;
+      last_id = id;
+    } else {
+      dropped++;
+    }
+    for (int k = 0; k < SIM_PROGRAMS_PER_TICK; k++) {
+      if (!(id % erase_every == 0 && k == 0) && flash_log_urgent(&log)) {
+        flash_log_step(&log, false, true);
+        forced++;
+      } else {
+        flash_log_step(&log, true, id % erase_every == 0 && k == 0);
+      }
+    }
+
+    if (id == next_cut && cuts_done < cuts) {
+      // the next operation only half happens, and whatever was queued is
+      // lost with the RAM
+      ram.cut_at = ram.ops + 1;
+      flash_log_flush(&log);
+      flash_log_step(&log, true, true);
+      ram.cut_at = 0;
+      failures += log.counters.failures;
+      wraps += log.counters.wraps;
+      if (!flash_log_init(&log, &ram.backend)) {
+        return 1;
+      }
+      cuts_done++;
+      next_cut += records / (cuts + 1);
+    }
+  }
+  flash_log_flush(&log);
+  while (flash_log_step(&log, true, true)) {
+  }
+  failures += log.counters.failures;
+  wraps += log.counters.wraps;
+
+  static flash_log_reader_t r;
+  flash_log_reader_init(&r, &log);
+  flash_log_record_t h;
+  const uint8_t *p;
+  uint32_t read = 0, corrupt = 0, out_of_order = 0, prev = 0, last_read = 0;
+  while (flash_log_read(&r, &h, &p)) {
+    bool intact = h.len == sim_len(h.time_us);
+    for (uint32_t i = 0; intact && i < h.len; i++) {
+      intact = p[i] == sim_byte(h.time_us, i);
+    }
+    corrupt += !intact;
+    out_of_order += h.time_us <= prev;
+    prev = last_read = h.time_us;
+    read++;
+  }
+
+  uint32_t wear_min = UINT32_MAX, wear_max = 0;
+  for (uint32_t s = 0; s < sectors; s++) {
+    wear_min = ram.erases[s] < wear_min ? ram.erases[s] : wear_min;
+    wear_max = ram.erases[s] > wear_max ? ram.erases[s] : wear_max;
+  }
+
+  printf("[INFO] %u records, %u appended, %u dropped, %u read back, %u lost to gaps.\n", records, appended, dropped,
+    read, r.broken);
+  printf("[INFO] %u power cuts, %u failed operations, %u trips round %u sectors.\n", cuts_done, failures, wraps,
+    sectors);
+  printf("[INFO] sector erases: %u to %u, %u forced.\n", wear_min, wear_max, forced);
+
+  int status = 0;
+  if (corrupt || out_of_order) {
+    printf("[ERROR] %u records corrupt, %u out of order.\n", corrupt, out_of_order);
+    status = 1;
+  }
+  if (ram.overwrites) {
+    printf("[ERROR] %u pages programmed without being erased.\n", ram.overwrites);
+    status = 1;
+  }
+  if (dropped && !failures) {
+    printf("[ERROR] %u records dropped with the flash working.\n", dropped);
+    status = 1;
+  }
+  if (appended && last_read != last_id) {
+    printf("[ERROR] the last record read was %u, not %u.\n", last_read, last_id);
+    status = 1;
+  }
+  if (!cuts_done && !failures && !wraps && read != appended) {
+    printf("[ERROR] %u records missing.\n", appended - read);
+    status = 1;
+  }
+  // every cut can move the writer on a sector early
+  if (wear_max - wear_min > 1 + cuts_done) {
+    printf("[ERROR] uneven wear.\n");
+    status = 1;
+  }
+  if (read && (!sim_check_dump(&log, 0, read, last_read) || !sim_check_dump(&log, dump_pages, read, last_read))) {
+    status = 1;
+  }
+  flash_ram_free(&ram);
+  return status;
+}
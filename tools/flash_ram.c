@@ -0,0 +1,93 @@
+/*
+ * flash_ram.c
+ *
+ * @brief NOR flash in RAM, see flash_ram.h.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flash_ram.h"
+
+/*
+ * flash_ram_op
+ *
+ * @brief Count an op and say how much of it happens: 2 all, 1 half, 0 none.
+ */
+static int flash_ram_op(flash_ram_t *f) {
+  f->ops++;
+  if (f->cut_at && f->ops == f->cut_at) {
+    return 1;
+  }
+  if (f->fail_every && f->ops % f->fail_every == 0) {
+    return 0;
+  }
+  return 2;
+}
+
+static bool flash_ram_erase(void *ctx, uint32_t offset) {
+  flash_ram_t *f = ctx;
+  if (offset % FLASH_LOG_SECTOR_SIZE || offset >= f->size) {
+    return false;
+  }
+  int done = flash_ram_op(f);
+  if (done == 0) {
+    return false;
+  }
+  // an erase cut short leaves the sector neither one thing nor the other
+  memset(f->mem + offset, 0xFF, done == 2 ? FLASH_LOG_SECTOR_SIZE : FLASH_LOG_SECTOR_SIZE / 2);
+  f->erases[offset / FLASH_LOG_SECTOR_SIZE]++;
+  return done == 2;
+}
+
+static bool flash_ram_program(void *ctx, uint32_t offset, const uint8_t *page) {
+  flash_ram_t *f = ctx;
+  if (offset % FLASH_LOG_PAGE_SIZE || offset >= f->size) {
+    return false;
+  }
+  int done = flash_ram_op(f);
+  if (done == 0) {
+    return false;
+  }
+  uint8_t *p = f->mem + offset;
+  uint32_t n = done == 2 ? FLASH_LOG_PAGE_SIZE : FLASH_LOG_PAGE_SIZE / 2;
+  bool erased = true;
+  for (uint32_t i = 0; i < FLASH_LOG_PAGE_SIZE; i++) {
+    erased &= p[i] == 0xFF;
+  }
+  f->overwrites += !erased;
+  for (uint32_t i = 0; i < n; i++) {
+    p[i] &= page[i];
+  }
+  return done == 2;
+}
+
+bool flash_ram_init(flash_ram_t *f, uint32_t size) {
+  memset(f, 0, sizeof(*f));
+  if (size == 0 || size % FLASH_LOG_SECTOR_SIZE) {
+    return false;
+  }
+  f->mem = malloc(size);
+  f->erases = calloc(size / FLASH_LOG_SECTOR_SIZE, sizeof(uint32_t));
+  if (!f->mem || !f->erases) {
+    flash_ram_free(f);
+    return false;
+  }
+  memset(f->mem, 0xFF, size);
+  f->size = size;
+  f->backend.base = f->mem;
+  f->backend.size = size;
+  f->backend.erase = flash_ram_erase;
+  f->backend.program = flash_ram_program;
+  f->backend.ctx = f;
+  return true;
+}
+
+void flash_ram_free(flash_ram_t *f) {
+  free(f->mem);
+  free(f->erases);
+  f->mem = NULL;
+  f->erases = NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ * flash_ram.h
+ *
+ * @brief A flash_log.h backend over RAM that behaves like NOR flash: erase
+ * sets a sector to 0xFF, programming only clears bits. It counts erases
+ * per sector (wear), counts programs into pages that weren't erased (a
+ * bug in the log), and can fail operations or cut a program short to
+ * stand in for a power cut.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _FLASH_RAM_H
+#define _FLASH_RAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash_log.h"
+
+typedef struct {
+  uint8_t *mem;
+  uint32_t size;
+  uint32_t *erases;       // per sector
+  uint32_t overwrites;    // programs into pages that weren't erased
+  uint32_t ops;           // erases and programs asked for
+  uint32_t fail_every;    // fail every nth op, 0 for never
+  uint32_t cut_at;        // op that only half happens, 0 for none
+  flash_log_backend_t backend;
+} flash_ram_t;
+
+/*
+ * flash_ram_init
+ *
+ * @brief size bytes, a multiple of FLASH_LOG_SECTOR_SIZE, all erased.
+ */
+bool flash_ram_init(flash_ram_t *f, uint32_t size);
+/*
+ * flash_ram_free
+ */
+void flash_ram_free(flash_ram_t *f);
+
+#endif
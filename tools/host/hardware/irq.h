@@ -0,0 +1,22 @@
+/*
+ * hardware/irq.h
+ *
+ * @brief The host's interrupts, see pico/stdlib.h. Handlers run on the
+ * simulated clock, as it moves past the event that raised them.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_IRQ_H
+#define _PICO_HOST_IRQ_H
+
+#include "pico/stdlib.h"
+
+#define IO_IRQ_BANK0 13
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_enabled(uint num, bool enabled);
+
+#endif
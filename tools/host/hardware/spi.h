@@ -0,0 +1,50 @@
+/*
+ * hardware/spi.h
+ *
+ * @brief The host's SPI, see pico/stdlib.h. spi0 shifts out to the
+ * simulated panel (pico_host.h) at the baud rate spi_init really gets.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_SPI_H
+#define _PICO_HOST_SPI_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+  volatile uint32_t cr0, cr1, dr, sr, cpsr, imsc, ris, mis, icr, dmacr;
+} spi_hw_t;
+
+typedef struct spi_inst spi_inst_t;
+
+#define SPI_SSPICR_RORIC_BITS 0x1u
+
+extern spi_hw_t pico_host_spi_hw[2];
+#define spi0 ((spi_inst_t *)&pico_host_spi_hw[0])
+#define spi1 ((spi_inst_t *)&pico_host_spi_hw[1])
+#define spi_default spi0
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) {
+  return (spi_hw_t *)spi;
+}
+
+static inline uint spi_get_index(const spi_inst_t *spi) {
+  return spi == spi1 ? 1 : 0;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_write16_blocking(spi_inst_t *spi, const uint16_t *src, size_t len);
+bool spi_is_busy(const spi_inst_t *spi);
+bool spi_is_readable(const spi_inst_t *spi);
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx);
+
+#endif
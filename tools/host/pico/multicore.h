@@ -0,0 +1,18 @@
+/*
+ * pico/multicore.h
+ *
+ * @brief The host's second core, see pico/stdlib.h: a thread, kept in
+ * step with core 0 on the simulated clock by pico_host.c.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_MULTICORE_H
+#define _PICO_HOST_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+#endif
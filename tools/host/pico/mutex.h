@@ -0,0 +1,26 @@
+/*
+ * pico/mutex.h
+ *
+ * @brief The host's mutexes, see pico/stdlib.h. A core blocked on one
+ * stops holding the other back on the simulated clock, and carries on
+ * from when it was let go.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_MUTEX_H
+#define _PICO_HOST_MUTEX_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+  int owner;  // core + 1, 0 when free
+} mutex_t;
+
+void mutex_init(mutex_t *mtx);
+void mutex_enter_blocking(mutex_t *mtx);
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out);
+void mutex_exit(mutex_t *mtx);
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * pico/stdio.h
+ *
+ * @brief The host's stdio, see pico/stdlib.h. Output is the host's
+ * stdout; input is whatever pico_host_console_feed queued for the time.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_STDIO_H
+#define _PICO_HOST_STDIO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif
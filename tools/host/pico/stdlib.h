@@ -0,0 +1,48 @@
+/*
+ * pico/stdlib.h
+ *
+ * @brief Just enough of the pico-sdk for firmware sources built into the
+ * host tools, on the simulated hardware in pico_host.c. Time is the
+ * calling core's simulated clock: it moves on when the core waits
+ * (sleeping, spinning, waiting for a transfer), and by the CPU time it
+ * takes if pico_host_set_cpu_scale says so, never on its own.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_STDLIB_H
+#define _PICO_HOST_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define PICO_ON_DEVICE 0
+
+#define PICO_DEFAULT_SPI 0
+#define PICO_DEFAULT_SPI_RX_PIN 16
+#define PICO_DEFAULT_SPI_CSN_PIN 17
+#define PICO_DEFAULT_SPI_SCK_PIN 18
+#define PICO_DEFAULT_SPI_TX_PIN 19
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT -1
+#define PICO_ERROR_GENERIC -2
+
+#define __not_in_flash_func(f) f
+#define __time_critical_func(f) f
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#include "hardware/gpio.h"
+#include "pico/stdio.h"
+
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+uint get_core_num(void);
+
+#endif
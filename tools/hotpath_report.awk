@@ -0,0 +1,56 @@
+#
+# hotpath_report.awk
+#
+# Summarise the functions placed in SRAM (.time_critical.*) from a GNU ld map
+# file: address, size and object file for each, then the total.
+#
+#   awk -f tools/hotpath_report.awk build/thermal-camera.elf.map
+#
+# Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+# Licensed under the Apache License, Version 2.0.
+#
+
+# plain awk has no strtonum, so parse the hex sizes by hand
+function hex(s,    i, v) {
+  s = tolower(s)
+  sub(/^0x/, "", s)
+  v = 0
+  for (i = 1; i <= length(s); i++) {
+    v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+  }
+  return v
+}
+
+function report(name, addr, size, obj) {
+  sub(/^\.time_critical\./, "", name)
+  sub(/.*\//, "", obj)
+  printf "%-40s %10s %8d  %s\n", name, addr, hex(size), obj
+  total += hex(size)
+  count++
+}
+
+BEGIN {
+  printf "%-40s %10s %8s  %s\n", "function", "address", "bytes", "object"
+}
+
+# ld puts long section names on a line of their own, with the address, size
+# and object on the next line
+pending != "" {
+  if (NF >= 3 && $1 ~ /^0x/) {
+    report(pending, $1, $2, $3)
+  }
+  pending = ""
+  next
+}
+
+/^ \.time_critical\./ {
+  if (NF >= 4 && $2 ~ /^0x/) {
+    report($1, $2, $3, $4)
+  } else if (NF == 1) {
+    pending = $1
+  }
+}
+
+END {
+  printf "%d functions, %d bytes in SRAM\n", count, total
+}
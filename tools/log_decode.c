@@ -0,0 +1,213 @@
+/*
+ * log_decode.c
+ *
+ * @brief Decodes the camera's flash log (see include/logger.h) from what
+ * "log dump" printed on the console:
+ *
+ *   log_decode [-o stats.csv] [-r frames.tcr] <console.txt | ->
+ *
+ * The "LOG <hex>" lines are put back into a flash image and read with the
+ * same flash_log.c the camera writes with; anything else in the capture is
+ * ignored. Boot records are reported, statistics go to the CSV (or
+ * stdout) as boot,time_us,sensor,min,max,avg,hottest,frames in degrees C,
+ * and logged frames, with the sensors' EEPROM dumps, to a recording for
+ * rec_info and reprocess. Progress goes to stderr.
+ *
+ * The camera's clock is 32 bits of microseconds and starts again each
+ * boot, so in the recording times are unwrapped and each boot carries on
+ * from the one before.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "flash_ram.h"
+#include "frame_codec.h"
+#include "recording.h"
+
+#define LOG_DECODE_LINE (4 + 2 * FLASH_LOG_PAGE_SIZE + 8)
+
+static int log_decode_hex(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/*
+ * log_decode_page
+ *
+ * @brief A "LOG <hex>" line into page, false if it isn't one.
+ */
+static bool log_decode_page(const char *line, uint8_t *page) {
+  if (strncmp(line, "LOG ", 4) != 0) {
+    return false;
+  }
+  line += 4;
+  for (int i = 0; i < FLASH_LOG_PAGE_SIZE; i++) {
+    int hi = log_decode_hex(line[2 * i]);
+    int lo = hi < 0 ? -1 : log_decode_hex(line[2 * i + 1]);
+    if (lo < 0) {
+      return false;
+    }
+    page[i] = (uint8_t)(hi << 4 | lo);
+  }
+  return true;
+}
+
+static int16_t log_decode_i16(const uint8_t *p) {
+  return (int16_t)(p[0] | p[1] << 8);
+}
+
+static uint16_t log_decode_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
+
+int main(int argc, char **argv) {
+  const char *csv_path = NULL, *rec_path = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:r:")) != -1) {
+    switch (opt) {
+      case 'o': csv_path = optarg; break;
+      case 'r': rec_path = optarg; break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-o stats.csv] [-r frames.tcr] <console.txt | ->\n", argv[0]);
+    return 2;
+  }
+
+  FILE *in = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "r");
+  if (!in) {
+    perror(argv[optind]);
+    return 1;
+  }
+  // the pages, oldest first
+  uint8_t *pages = NULL;
+  uint32_t n_pages = 0, cap = 0;
+  char line[LOG_DECODE_LINE];
+  uint8_t page[FLASH_LOG_PAGE_SIZE];
+  while (fgets(line, sizeof(line), in)) {
+    if (!log_decode_page(line, page)) {
+      continue;
+    }
+    if (n_pages == cap) {
+      cap = cap ? cap * 2 : 256;
+      pages = realloc(pages, (size_t)cap * FLASH_LOG_PAGE_SIZE);
+      if (!pages) {
+        fprintf(stderr, "[ERROR] out of memory.\n");
+        return 1;
+      }
+    }
+    memcpy(pages + (size_t)n_pages * FLASH_LOG_PAGE_SIZE, page, FLASH_LOG_PAGE_SIZE);
+    n_pages++;
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (n_pages == 0) {
+    fprintf(stderr, "[ERROR] no LOG lines, capture the output of \"log dump\".\n");
+    return 1;
+  }
+
+  // laid out from the start of a region with a blank sector after them,
+  // so the log finds its way round them as it would on the camera
+  uint32_t sectors = (n_pages + FLASH_LOG_PAGES_PER_SECTOR - 1) / FLASH_LOG_PAGES_PER_SECTOR + 1;
+  if (sectors < FLASH_LOG_MIN_SECTORS) {
+    sectors = FLASH_LOG_MIN_SECTORS;
+  }
+  flash_ram_t ram;
+  static flash_log_t log;
+  if (!flash_ram_init(&ram, sectors * FLASH_LOG_SECTOR_SIZE)) {
+    fprintf(stderr, "[ERROR] out of memory.\n");
+    return 1;
+  }
+  memcpy(ram.mem, pages, (size_t)n_pages * FLASH_LOG_PAGE_SIZE);
+  free(pages);
+  flash_log_init(&log, &ram.backend);
+
+  FILE *csv = csv_path ? fopen(csv_path, "w") : stdout;
+  if (!csv) {
+    perror(csv_path);
+    return 1;
+  }
+  fprintf(csv, "boot,time_us,sensor,min,max,avg,hottest,frames\n");
+  static recording_writer_t rec;
+  if (rec_path && !recording_create(&rec, rec_path)) {
+    return 1;
+  }
+
+  static frame_codec_t codecs[RECORDING_MAX_SENSORS];
+  static flash_log_reader_t r;
+  flash_log_reader_init(&r, &log);
+  flash_log_record_t h;
+  const uint8_t *p;
+  uint16_t frame[FRAME_CODEC_WORDS], ee[RECORDING_EEPROM_WORDS];
+  uint32_t boots = 0, stats = 0, frames = 0, undecoded = 0, seq[RECORDING_MAX_SENSORS] = { 0 };
+  uint32_t last_us = 0;
+  uint64_t now = 0;
+  while (flash_log_read(&r, &h, &p)) {
+    if (h.type == FLASH_LOG_BOOT && h.len >= 8) {
+      boots++;
+      now++;
+      last_us = h.time_us;
+      uint32_t period_ms = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+      fprintf(stderr, "[INFO] boot %u: %u sensors, mode %u, period %ums.\n", boots, p[0], p[1], period_ms);
+      for (int k = 0; k < RECORDING_MAX_SENSORS; k++) {
+        frame_codec_init(&codecs[k], 0);
+      }
+      continue;
+    }
+    now += (uint32_t)(h.time_us - last_us);
+    last_us = h.time_us;
+
+    if (h.type == FLASH_LOG_STATS && h.len == FLASH_LOG_STATS_SIZE) {
+      fprintf(csv, "%u,%u,%u,%.2f,%.2f,%.2f,%u,%u\n", boots, h.time_us, h.sensor, log_decode_i16(p) / 100.0,
+        log_decode_i16(p + 2) / 100.0, log_decode_i16(p + 4) / 100.0, log_decode_u16(p + 6),
+        log_decode_u16(p + 8));
+      stats++;
+    } else if (h.type == FLASH_LOG_EEPROM && h.len == 2 * RECORDING_EEPROM_WORDS && rec_path &&
+      h.sensor < RECORDING_MAX_SENSORS) {
+      for (int i = 0; i < RECORDING_EEPROM_WORDS; i++) {
+        ee[i] = log_decode_u16(p + 2 * i);
+      }
+      recording_set_eeprom(&rec, h.sensor, ee);
+    } else if (h.type == FLASH_LOG_FRAME && rec_path && h.sensor < RECORDING_MAX_SENSORS) {
+      if (frame_codec_decode(&codecs[h.sensor], p, h.len, frame) != FRAME_CODEC_OK) {
+        undecoded++;
+        continue;
+      }
+      if (!recording_append(&rec, now, seq[h.sensor]++, h.sensor, (uint8_t)frame[833], frame)) {
+        return 1;
+      }
+      frames++;
+    }
+  }
+
+  fprintf(stderr, "[INFO] %u pages: %u boots, %u statistics, %u frames, %u records lost to gaps.\n", n_pages, boots,
+    stats, frames, r.broken);
+  if (undecoded) {
+    fprintf(stderr, "[INFO] %u frames waited for a key frame.\n", undecoded);
+  }
+  int status = 0;
+  if (rec_path && !recording_close(&rec)) {
+    status = 1;
+  }
+  if (csv != stdout) {
+    fclose(csv);
+  }
+  flash_ram_free(&ram);
+  return status;
+}
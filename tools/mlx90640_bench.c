@@ -0,0 +1,252 @@
+/*
+ * mlx90640_bench.c
+ *
+ * @brief Runs the Melexis API against simulated sensors (mlx90640_model.h)
+ * the way the camera does, sensor_init then the sensor loop's polling,
+ * reads and recovery, and reports what it cost:
+ *
+ *   mlx90640_bench [-n subpages] [-s sensors] [-r rate] [-f i2c_hz] [-p poll_us]
+ *                  [-S seed] [-N nack] [-T timeout] [-L bad_line] [-A bad_aux] [-x]
+ *
+ * rate is the refresh rate code (0 for 0.5Hz to 7 for 64Hz, 4 by default,
+ * as the camera). Fault rates are per thousand transactions (-N, -T) or
+ * measurements (-L, -A); -x never has data ready.
+ *
+ * Transactions, words, status polls and bus time come from the simulated
+ * clock, so they are the same every run; only the host time the driver
+ * takes varies. Each sensor's subpages have to alternate, with the control
+ * register read back in the frame, unless faults are injected.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "mlx90640/MLX90640_API.h"
+#include "mlx90640/MLX90640_I2C_Driver.h"
+#include "mlx90640_model.h"
+
+#define BENCH_ADDR 0x33
+// sensor_read gives up on a sensor for a while after this many errors
+#define BENCH_RETRY_AFTER 5
+#define BENCH_RETRY_US 1000000
+
+typedef struct {
+  mlx90640_model_t model;
+  paramsMLX90640 params;
+  uint16_t frame[834];
+  int subpage;
+  uint32_t subpages;
+  uint32_t repeats;      // the same subpage twice in a row, none missed
+  uint32_t overwritten;  // the model's count at the last read
+  uint32_t errors[MLX90640_AUX_DATA_ERROR + 1];
+  uint32_t errors_in_row;
+  uint64_t retry_at_ns;
+} bench_sensor_t;
+
+static uint64_t bench_host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * bench_init
+ *
+ * @brief What sensor_init does.
+ */
+static bool bench_init(bench_sensor_t *s, uint8_t rate) {
+  static uint16_t ee[MLX90640_EEPROM_DUMP_NUM];
+  uint8_t addr = s->model.slave_addr;
+  MLX90640_SetChessMode(addr);
+  MLX90640_SetSubPageRepeat(addr, 0);
+  if (MLX90640_DumpEE(addr, ee) != 0) {
+    printf("[ERROR] sensor 0x%02x: DumpEE returned error.\n", addr);
+    return false;
+  }
+  MLX90640_SetRefreshRate(addr, rate);
+  if (MLX90640_ExtractParameters(ee, &s->params) != 0) {
+    printf("[ERROR] sensor 0x%02x: ExtractParameters returned error.\n", addr);
+    return false;
+  }
+  MLX90640_I2CWrite(addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+  s->subpage = -1;
+  return true;
+}
+
+/*
+ * bench_read
+ *
+ * @brief What sensor_read does, recovering the bus after a NACK or a
+ * timeout.
+ */
+static void bench_read(bench_sensor_t *s) {
+  int subpage = MLX90640_GetFrameData(s->model.slave_addr, s->frame);
+  if (subpage == 0 || subpage == 1) {
+    // a subpage lost to an error or overwritten before it was read puts
+    // the same one next
+    bool missed = s->errors_in_row > 0 || s->model.counters.overwritten != s->overwritten;
+    s->repeats += !missed && subpage == s->subpage;
+    s->overwritten = s->model.counters.overwritten;
+    if (s->frame[832] != s->model.ctrl) {
+      printf("[ERROR] sensor 0x%02x: frame has control register 0x%04x, not 0x%04x.\n", s->model.slave_addr,
+        s->frame[832], s->model.ctrl);
+    }
+    s->subpage = subpage;
+    s->subpages++;
+    s->errors_in_row = 0;
+    return;
+  }
+  int error = subpage < 0 ? -subpage : MLX90640_FRAME_DATA_ERROR;
+  s->errors[error <= MLX90640_AUX_DATA_ERROR ? error : 0]++;
+  if (error == MLX90640_I2C_NACK_ERROR || error == MLX90640_I2C_TIMEOUT_ERROR) {
+    if (MLX90640_I2CBusRecover(s->model.slave_addr) == 0) {
+      MLX90640_I2CWrite(s->model.slave_addr, MLX90640_STATUS_REG, MLX90640_CLEAR_STATUS_VALUE);
+    }
+  }
+  if (++s->errors_in_row >= BENCH_RETRY_AFTER) {
+    s->retry_at_ns = mlx90640_host_now_ns() + BENCH_RETRY_US * 1000ull;
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t n = 64, n_sensors = 1, freq = 1000000, poll_us = 500;
+  uint8_t rate = 4;
+  mlx90640_model_faults_t faults = { .seed = 1 };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:r:f:p:S:N:T:L:A:x")) != -1) {
+    switch (opt) {
+      case 'n': n = (uint32_t)atol(optarg); break;
+      case 's': n_sensors = (uint32_t)atol(optarg); break;
+      case 'r': rate = (uint8_t)atoi(optarg); break;
+      case 'f': freq = (uint32_t)atol(optarg); break;
+      case 'p': poll_us = (uint32_t)atol(optarg); break;
+      case 'S': faults.seed = (uint32_t)atol(optarg); break;
+      case 'N': faults.nack = (uint16_t)atoi(optarg); break;
+      case 'T': faults.timeout = (uint16_t)atoi(optarg); break;
+      case 'L': faults.bad_line = (uint16_t)atoi(optarg); break;
+      case 'A': faults.bad_aux = (uint16_t)atoi(optarg); break;
+      case 'x': faults.never_ready = true; break;
+      default:
+        fprintf(stderr,
+          "usage: %s [-n subpages] [-s sensors] [-r rate] [-f i2c_hz] [-p poll_us]\n"
+          "       [-S seed] [-N nack] [-T timeout] [-L bad_line] [-A bad_aux] [-x]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (n_sensors < 1 || n_sensors > MLX90640_MODEL_MAX_DEVICES || rate > 7) {
+    fprintf(stderr, "[ERROR] 1 to %d sensors, rates 0 to 7.\n", MLX90640_MODEL_MAX_DEVICES);
+    return 2;
+  }
+
+  // one sensor on each bus, then a second address on each
+  static bench_sensor_t sensors[MLX90640_MODEL_MAX_DEVICES];
+  MLX90640_I2CFreqSet((int)freq);
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    uint8_t addr = MLX90640_I2C_ADDR(k % MLX90640_I2C_BUSES, BENCH_ADDR + k / MLX90640_I2C_BUSES);
+    mlx90640_model_init(&sensors[k].model, addr, k + 1, mlx90640_host_now_ns());
+    mlx90640_host_attach(&sensors[k].model);
+  }
+
+  uint64_t t0 = bench_host_ns();
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    if (!bench_init(&sensors[k], rate)) {
+      return 1;
+    }
+  }
+  uint64_t init_host_ns = bench_host_ns() - t0;
+  uint64_t init_sim_ns = mlx90640_host_now_ns();
+  uint64_t init_busy_ns = mlx90640_host_busy_ns();
+  // faults from here on, so start-up always works
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    mlx90640_model_set_faults(&sensors[k].model, &faults);
+  }
+  mlx90640_i2c_stats_t before[MLX90640_I2C_BUSES];
+  for (uint8_t b = 0; b < MLX90640_I2C_BUSES; b++) {
+    MLX90640_I2CGetStats(b, &before[b]);
+  }
+
+  // the sensor loop: poll each sensor, read what's ready, sleep if nothing
+  // was; give up well after the subpages should have come
+  uint64_t start_ns = mlx90640_host_now_ns();
+  uint64_t give_up_ns = start_ns + ((uint64_t)n * mlx90640_model_subpage_us(&sensors[0].model) * 4 + 1000000) * 1000;
+  uint64_t read_host_ns = 0;
+  uint32_t polls = 0, total = 0;
+  while (total < n * n_sensors && mlx90640_host_now_ns() < give_up_ns) {
+    bool any_read = false;
+    for (uint32_t k = 0; k < n_sensors; k++) {
+      bench_sensor_t *s = &sensors[k];
+      if (s->subpages >= n || (s->errors_in_row >= BENCH_RETRY_AFTER && mlx90640_host_now_ns() < s->retry_at_ns)) {
+        continue;
+      }
+      uint16_t status;
+      polls++;
+      if (MLX90640_I2CRead(s->model.slave_addr, MLX90640_STATUS_REG, 1, &status) != 0 ||
+        !MLX90640_GET_DATA_READY(status)) {
+        continue;
+      }
+      uint32_t had = s->subpages;
+      uint64_t r0 = bench_host_ns();
+      bench_read(s);
+      read_host_ns += bench_host_ns() - r0;
+      total += s->subpages - had;
+      any_read = true;
+    }
+    if (!any_read) {
+      mlx90640_host_sleep_us(poll_us);
+    }
+  }
+  uint64_t run_ns = mlx90640_host_now_ns() - start_ns;
+  uint64_t busy_ns = mlx90640_host_busy_ns() - init_busy_ns;
+
+  uint32_t reads = 0, writes = 0, nacks = 0, timeouts = 0, recoveries = 0;
+  for (uint8_t b = 0; b < MLX90640_I2C_BUSES; b++) {
+    mlx90640_i2c_stats_t st;
+    MLX90640_I2CGetStats(b, &st);
+    reads += st.reads - before[b].reads;
+    writes += st.writes - before[b].writes;
+    nacks += st.nacks - before[b].nacks;
+    timeouts += st.timeouts - before[b].timeouts;
+    recoveries += st.recoveries - before[b].recoveries;
+  }
+
+  printf("[BENCH] start-up: %.1fms on the bus, %.1fms simulated, %.3fms on the host.\n", init_busy_ns / 1e6,
+    init_sim_ns / 1e6, init_host_ns / 1e6);
+  printf("[BENCH] %u subpages from %u sensors at %.1fHz, %uHz I2C, in %.3fs simulated.\n", total, n_sensors,
+    1e6 / mlx90640_model_subpage_us(&sensors[0].model), freq, run_ns / 1e9);
+  if (total > 0) {
+    printf("[BENCH] per subpage: %.2f reads, %.2f writes, %.2f status polls, %.1fus on the bus, %.2fus on the host.\n",
+      (double)reads / total, (double)writes / total, (double)polls / total, busy_ns / 1e3 / total,
+      read_host_ns / 1e3 / total);
+  }
+  printf("[BENCH] bus busy %.1f%% of the time.\n", run_ns ? 100.0 * busy_ns / run_ns : 0.0);
+  printf("[INFO] %u NACKs, %u timeouts, %u bus recoveries.\n", nacks, timeouts, recoveries);
+
+  int status = 0;
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    bench_sensor_t *s = &sensors[k];
+    const mlx90640_model_counters_t *c = &s->model.counters;
+    printf("[INFO] sensor 0x%02x: %u subpages, %u measured, %u held unread, %u overwritten, %u made bad.\n",
+      s->model.slave_addr, s->subpages, c->measurements, c->held, c->overwritten, c->bad_data);
+    printf("[INFO] sensor 0x%02x: errors %u NACK, %u timeout, %u frame, %u aux, %u other.\n", s->model.slave_addr,
+      s->errors[MLX90640_I2C_NACK_ERROR], s->errors[MLX90640_I2C_TIMEOUT_ERROR], s->errors[MLX90640_FRAME_DATA_ERROR],
+      s->errors[MLX90640_AUX_DATA_ERROR], s->errors[0]);
+    // with faults it happens: a status write that times out leaves the
+    // data flagged, and GetFrameData only gives up on a NACK
+    bool faulty = faults.nack || faults.timeout || faults.bad_line || faults.bad_aux;
+    if (s->repeats) {
+      printf("[%s] sensor 0x%02x: the same subpage twice in a row %u times.\n", faulty ? "INFO" : "ERROR",
+        s->model.slave_addr, s->repeats);
+      status |= !faulty;
+    }
+    if (s->subpages < n) {
+      printf("[ERROR] sensor 0x%02x: gave up after %u of %u subpages.\n", s->model.slave_addr, s->subpages, n);
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,190 @@
+/*
+ * mlx90640_host_i2c.c
+ *
+ * @brief The MLX90640_I2C_Driver.h functions for the host tools. Each
+ * transaction goes to the simulated sensor (mlx90640_model.h) attached at
+ * its address, and a simulated clock moves on by the time it would take
+ * on the bus at the frequency set, timed as MLX90640_I2C_Driver.c times
+ * its transfers. With nothing attached, as for tools that link the
+ * Melexis API only to calculate frames already read, every transaction
+ * fails as if no sensor answered.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "mlx90640/MLX90640_I2C_Driver.h"
+#include "mlx90640/MLX90640_API.h"
+#include "mlx90640_model.h"
+
+#define HOST_I2C_BAUD 400000
+// a START, a STOP, a repeated START each take about a clock
+#define HOST_I2C_BYTE_BITS 9
+
+static mlx90640_model_t *host_devices[MLX90640_MODEL_MAX_DEVICES];
+static mlx90640_i2c_stats_t host_stats[MLX90640_I2C_BUSES];
+static uint32_t host_freq = HOST_I2C_BAUD;
+static uint64_t host_now_ns;
+static uint64_t host_busy_ns;
+static uint64_t (*host_clock_now)(void);
+static void (*host_clock_advance)(uint64_t ns);
+
+/*
+ * host_now
+ *
+ * @brief The clock transactions are timed on: the bus's own, unless the
+ * caller's was set.
+ */
+static uint64_t host_now(void) {
+  return host_clock_now ? host_clock_now() : host_now_ns;
+}
+
+static void host_advance(uint64_t ns) {
+  if (host_clock_advance) {
+    host_clock_advance(ns);
+  } else {
+    host_now_ns += ns;
+  }
+}
+
+static mlx90640_model_t *host_device(uint8_t slaveAddr) {
+  for (int i = 0; i < MLX90640_MODEL_MAX_DEVICES; i++) {
+    if (host_devices[i] && host_devices[i]->slave_addr == slaveAddr) {
+      return host_devices[i];
+    }
+  }
+  return NULL;
+}
+
+/*
+ * host_bus_ns
+ *
+ * @brief Time on the bus for bytes and extra clocks (START, STOP).
+ */
+static uint64_t host_bus_ns(uint32_t bytes, uint32_t clocks) {
+  return ((uint64_t)bytes * HOST_I2C_BYTE_BITS + clocks) * 1000000000ull / host_freq;
+}
+
+/*
+ * host_timeout_ns
+ *
+ * @brief How long the driver waits before giving up on n_bytes, as
+ * _i2c_timeout_us does.
+ */
+static uint64_t host_timeout_ns(uint32_t n_bytes) {
+  return (2 * (uint64_t)n_bytes * HOST_I2C_BYTE_BITS * 1000000 / host_freq + 1000) * 1000;
+}
+
+/*
+ * host_spend
+ *
+ * @brief Move the clock on by a transaction's time: all of it if it went
+ * through, the driver's timeout if it hung, or just the address byte if
+ * it wasn't ACKed.
+ */
+static int host_spend(mlx90640_i2c_stats_t *stats, int error, uint64_t ns, uint32_t n_bytes) {
+  if (error == -MLX90640_I2C_TIMEOUT_ERROR) {
+    stats->timeouts++;
+    ns = host_timeout_ns(n_bytes);
+  } else if (error == -MLX90640_I2C_NACK_ERROR) {
+    stats->nacks++;
+    ns = host_bus_ns(1, 2);
+  }
+  host_advance(ns);
+  host_busy_ns += ns;
+  return error;
+}
+
+bool mlx90640_host_attach(mlx90640_model_t *m) {
+  if (host_device(m->slave_addr)) {
+    return false;
+  }
+  for (int i = 0; i < MLX90640_MODEL_MAX_DEVICES; i++) {
+    if (!host_devices[i]) {
+      host_devices[i] = m;
+      return true;
+    }
+  }
+  return false;
+}
+
+void mlx90640_host_detach_all(void) {
+  memset(host_devices, 0, sizeof(host_devices));
+  memset(host_stats, 0, sizeof(host_stats));
+  host_freq = HOST_I2C_BAUD;
+  host_now_ns = 0;
+  host_busy_ns = 0;
+}
+
+void mlx90640_host_set_clock(uint64_t (*now_ns)(void), void (*advance_ns)(uint64_t ns)) {
+  host_clock_now = now_ns;
+  host_clock_advance = advance_ns;
+}
+
+uint64_t mlx90640_host_now_ns(void) {
+  return host_now();
+}
+
+void mlx90640_host_sleep_us(uint32_t us) {
+  host_advance((uint64_t)us * 1000);
+}
+
+uint64_t mlx90640_host_busy_ns(void) {
+  return host_busy_ns;
+}
+
+void MLX90640_I2CInit(void) {
+}
+
+int MLX90640_I2CGeneralReset(void) {
+  // to address 0 on every bus with a sensor on it, which all ACK
+  bool any = false;
+  for (int i = 0; i < MLX90640_MODEL_MAX_DEVICES; i++) {
+    if (host_devices[i]) {
+      mlx90640_model_general_reset(host_devices[i], host_now());
+      any = true;
+    }
+  }
+  uint64_t ns = host_bus_ns(2, 2);
+  host_advance(ns);
+  host_busy_ns += ns;
+  return any ? MLX90640_NO_ERROR : -MLX90640_I2C_NACK_ERROR;
+}
+
+int MLX90640_I2CBusRecover(uint8_t slaveAddr) {
+  // up to 9 clocks and a STOP; the model never holds a line low
+  host_stats[MLX90640_I2C_ADDR_BUS(slaveAddr)].recoveries++;
+  host_advance(host_bus_ns(1, 1));
+  return host_device(slaveAddr) ? MLX90640_NO_ERROR : -MLX90640_I2C_NACK_ERROR;
+}
+
+void MLX90640_I2CGetStats(uint8_t bus, mlx90640_i2c_stats_t *stats) {
+  *stats = host_stats[bus % MLX90640_I2C_BUSES];
+}
+
+int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t *data) {
+  mlx90640_i2c_stats_t *stats = &host_stats[MLX90640_I2C_ADDR_BUS(slaveAddr)];
+  stats->reads++;
+  mlx90640_model_t *m = host_device(slaveAddr);
+  // address and register, then a repeated START, the address and the data
+  uint32_t bytes = 3 + 1 + 2 * (uint32_t)nMemAddressRead;
+  int error = m ? mlx90640_model_read(m, host_now(), startAddress, nMemAddressRead, data) : -MLX90640_I2C_NACK_ERROR;
+  return host_spend(stats, error, host_bus_ns(bytes, 3), 1 + 2 * (uint32_t)nMemAddressRead);
+}
+
+int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data) {
+  mlx90640_i2c_stats_t *stats = &host_stats[MLX90640_I2C_ADDR_BUS(slaveAddr)];
+  stats->writes++;
+  mlx90640_model_t *m = host_device(slaveAddr);
+  int error = m ? mlx90640_model_write(m, host_now(), writeAddress, data) : -MLX90640_I2C_NACK_ERROR;
+  // a register the sensor won't take is still ACKed
+  if (error == -MLX90640_I2C_WRITE_ERROR) {
+    error = MLX90640_NO_ERROR;
+  }
+  return host_spend(stats, error, host_bus_ns(5, 2), 5);
+}
+
+void MLX90640_I2CFreqSet(int freq) {
+  host_freq = freq > 0 ? (uint32_t)freq : HOST_I2C_BAUD;
+}
@@ -0,0 +1,246 @@
+/*
+ * mlx90640_model.c
+ *
+ * @brief A simulated MLX90640, see mlx90640_model.h.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <string.h>
+#include "mlx90640_model.h"
+#include "mlx90640/MLX90640_API.h"
+
+#define MODEL_AUX_START (MLX90640_AUX_DATA_START_ADDRESS - MLX90640_MODEL_RAM_START)
+#define MODEL_CTRL_SUBPAGES 0x0001
+#define MODEL_CTRL_REPEAT 0x0008
+#define MODEL_CTRL_SELECT_SHIFT 4
+// control register bits that can't be written
+#define MODEL_CTRL_RESERVED 0x6000
+
+static uint32_t model_rand(mlx90640_model_t *m) {
+  m->rng ^= m->rng << 13;
+  m->rng ^= m->rng >> 17;
+  m->rng ^= m->rng << 5;
+  return m->rng;
+}
+
+static bool model_chance(mlx90640_model_t *m, uint16_t per_thousand) {
+  return per_thousand && model_rand(m) % 1000 < per_thousand;
+}
+
+static void model_fake_source(void *ctx, uint32_t n, uint8_t subpage, uint16_t *frame) {
+  mlx90640_model_t *m = ctx;
+  // fake_frames measures the subpage n's lowest bit says
+  fake_frames_raw(&m->fake, (n & ~1u) | subpage, frame);
+}
+
+uint32_t mlx90640_model_subpage_us(const mlx90640_model_t *m) {
+  // 0.5Hz doubling up to 64Hz
+  uint32_t rate = (m->ctrl & ~MLX90640_CTRL_REFRESH_MASK) >> MLX90640_CTRL_REFRESH_SHIFT;
+  return 2000000u >> rate;
+}
+
+/*
+ * model_measured
+ *
+ * @brief Whether pixel i is in subpage, for the pattern the control
+ * register picks.
+ */
+static bool model_measured(const mlx90640_model_t *m, int i, uint8_t subpage) {
+  int line = i / MLX90640_LINE_SIZE;
+  if (m->ctrl & MLX90640_CTRL_MEAS_MODE_MASK) {
+    return ((line ^ i) & 1) == subpage;
+  }
+  return (line & 1) == subpage;
+}
+
+static void model_start(mlx90640_model_t *m, uint64_t now_ns) {
+  m->measuring = !m->faults.never_ready;
+  m->done_ns = now_ns + (uint64_t)mlx90640_model_subpage_us(m) * 1000;
+  if (!(m->ctrl & MODEL_CTRL_SUBPAGES)) {
+    m->subpage = 0;
+  } else if (m->ctrl & MODEL_CTRL_REPEAT) {
+    m->subpage = (m->ctrl >> MODEL_CTRL_SELECT_SHIFT) & 1;
+  }
+}
+
+/*
+ * model_finish
+ *
+ * @brief The measurement in progress is done: into RAM, unless unread
+ * data is there and may not be overwritten, and flagged.
+ */
+static void model_finish(mlx90640_model_t *m) {
+  m->counters.measurements++;
+  bool unread = m->status & MLX90640_STAT_DATA_READY_MASK;
+  if (unread && !(m->status & MLX90640_MODEL_STAT_OVERWRITE)) {
+    m->counters.held++;
+  } else {
+    m->counters.overwritten += unread;
+    m->source(m->source_ctx, m->n, m->subpage, m->frame);
+    for (int i = 0; i < MLX90640_PIXEL_NUM; i++) {
+      if (model_measured(m, i, m->subpage)) {
+        m->ram[i] = m->frame[i];
+      }
+    }
+    memcpy(&m->ram[MODEL_AUX_START], &m->frame[MLX90640_PIXEL_NUM], MLX90640_AUX_NUM * sizeof(uint16_t));
+    if (model_chance(m, m->faults.bad_line)) {
+      // the first pixel of a line the subpage measures
+      int line = (int)(model_rand(m) % MLX90640_LINE_NUM);
+      int i = line * MLX90640_LINE_SIZE;
+      m->ram[model_measured(m, i, m->subpage) ? i : i + 1] = 0x7FFF;
+      m->counters.bad_data++;
+    } else if (model_chance(m, m->faults.bad_aux)) {
+      m->ram[MODEL_AUX_START] = 0x7FFF;
+      m->counters.bad_data++;
+    }
+    m->status = (uint16_t)((m->status & ~MLX90640_STAT_FRAME_MASK) | MLX90640_STAT_DATA_READY_MASK | m->subpage);
+  }
+  m->n++;
+  if (m->ctrl & MODEL_CTRL_SUBPAGES && !(m->ctrl & MODEL_CTRL_REPEAT)) {
+    m->subpage ^= 1;
+  }
+}
+
+/*
+ * model_update
+ *
+ * @brief Catch up to now_ns: every measurement that has finished since
+ * the last transaction.
+ */
+static void model_update(mlx90640_model_t *m, uint64_t now_ns) {
+  while (m->measuring && m->done_ns <= now_ns) {
+    uint64_t done_ns = m->done_ns;
+    model_finish(m);
+    if (m->ctrl & MLX90640_CTRL_STEP_MODE_MASK) {
+      m->measuring = false;
+      m->status &= (uint16_t)~MLX90640_MODEL_STAT_START;
+    } else {
+      model_start(m, done_ns);
+    }
+  }
+}
+
+void mlx90640_model_init(mlx90640_model_t *m, uint8_t slave_addr, uint32_t seed, uint64_t now_ns) {
+  memset(m, 0, sizeof(*m));
+  m->slave_addr = slave_addr;
+  m->ctrl = MLX90640_MODEL_CTRL_DEFAULT;
+  fake_frames_eeprom(seed, m->eeprom);
+  fake_frames_init(&m->fake, seed);
+  m->source = model_fake_source;
+  m->source_ctx = m;
+  m->rng = seed ? seed : 1;
+  model_start(m, now_ns);
+}
+
+void mlx90640_model_set_source(mlx90640_model_t *m, mlx90640_model_source_t source, void *ctx) {
+  m->source = source ? source : model_fake_source;
+  m->source_ctx = source ? ctx : m;
+}
+
+void mlx90640_model_set_faults(mlx90640_model_t *m, const mlx90640_model_faults_t *faults) {
+  m->faults = *faults;
+  m->rng = faults->seed ? faults->seed : 1;
+  if (faults->never_ready) {
+    m->measuring = false;
+  }
+}
+
+/*
+ * model_fault
+ *
+ * @brief Whether this transaction fails, and how.
+ */
+static int model_fault(mlx90640_model_t *m, uint64_t now_ns) {
+  bool dead = m->faults.dead_ns && now_ns >= m->faults.dead_ns && (!m->faults.alive_ns || now_ns < m->faults.alive_ns);
+  if (dead || model_chance(m, m->faults.nack)) {
+    m->counters.nacks++;
+    return -MLX90640_I2C_NACK_ERROR;
+  }
+  if (model_chance(m, m->faults.timeout)) {
+    m->counters.timeouts++;
+    return -MLX90640_I2C_TIMEOUT_ERROR;
+  }
+  return 0;
+}
+
+static uint16_t model_word(const mlx90640_model_t *m, uint16_t address) {
+  if (address >= MLX90640_MODEL_RAM_START && address < MLX90640_MODEL_RAM_START + MLX90640_MODEL_RAM_WORDS) {
+    return m->ram[address - MLX90640_MODEL_RAM_START];
+  }
+  if (address >= MLX90640_MODEL_EEPROM_START && address < MLX90640_MODEL_EEPROM_START + MLX90640_MODEL_EEPROM_WORDS) {
+    return m->eeprom[address - MLX90640_MODEL_EEPROM_START];
+  }
+  switch (address) {
+    case MLX90640_STATUS_REG: return m->status;
+    case MLX90640_CTRL_REG: return m->ctrl;
+    case MLX90640_MODEL_I2C_CONF: return m->i2c_conf;
+    default: return 0;
+  }
+}
+
+int mlx90640_model_read(mlx90640_model_t *m, uint64_t now_ns, uint16_t address, uint16_t n, uint16_t *data) {
+  model_update(m, now_ns);
+  m->counters.reads++;
+  int error = model_fault(m, now_ns);
+  if (error) {
+    return error;
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    data[i] = model_word(m, (uint16_t)(address + i));
+  }
+  m->counters.words_read += n;
+  if (address == MLX90640_STATUS_REG && n == 1 && !(m->status & MLX90640_STAT_DATA_READY_MASK)) {
+    m->counters.not_ready++;
+  }
+  return 0;
+}
+
+int mlx90640_model_write(mlx90640_model_t *m, uint64_t now_ns, uint16_t address, uint16_t data) {
+  model_update(m, now_ns);
+  m->counters.writes++;
+  int error = model_fault(m, now_ns);
+  if (error) {
+    return error;
+  }
+  switch (address) {
+    case MLX90640_STATUS_REG: {
+      // data ready only clears, the subpage bit is read-only, and start
+      // only means something in step mode, where it clears once done
+      bool step = m->ctrl & MLX90640_CTRL_STEP_MODE_MASK;
+      bool start = step && data & MLX90640_MODEL_STAT_START;
+      m->status = (uint16_t)((m->status & (MLX90640_STAT_FRAME_MASK | (data & MLX90640_STAT_DATA_READY_MASK))) |
+        (data & MLX90640_MODEL_STAT_OVERWRITE) | (start ? MLX90640_MODEL_STAT_START : 0));
+      if (start && !m->measuring) {
+        model_start(m, now_ns);
+      }
+      break;
+    }
+    case MLX90640_CTRL_REG:
+      // new settings apply from the next measurement, as on the sensor
+      m->ctrl = (uint16_t)((data & ~MODEL_CTRL_RESERVED) | (m->ctrl & MODEL_CTRL_RESERVED));
+      if (!(m->ctrl & MLX90640_CTRL_STEP_MODE_MASK) && !m->measuring) {
+        model_start(m, now_ns);
+      }
+      break;
+    case MLX90640_MODEL_I2C_CONF:
+      m->i2c_conf = data;
+      break;
+    default:
+      // RAM is read-only, and the EEPROM needs an erase first the API
+      // never does
+      return -MLX90640_I2C_WRITE_ERROR;
+  }
+  return 0;
+}
+
+void mlx90640_model_general_reset(mlx90640_model_t *m, uint64_t now_ns) {
+  model_update(m, now_ns);
+  if (m->ctrl & MLX90640_CTRL_TRIG_READY_MASK) {
+    m->ctrl &= (uint16_t)~MLX90640_CTRL_TRIG_READY_MASK;
+    if (!m->measuring) {
+      model_start(m, now_ns);
+    }
+  }
+}
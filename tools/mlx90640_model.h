@@ -0,0 +1,198 @@
+/*
+ * mlx90640_model.h
+ *
+ * @brief An MLX90640 at the register level, for running the Melexis API
+ * and the driver's callers on the host: the status and control registers,
+ * the RAM (pixels at 0x0400, aux words at 0x0700) and the EEPROM at
+ * 0x2400, measuring a subpage every period the refresh rate gives and
+ * flagging it in the status register, alternating subpages or repeating
+ * one, in continuous or step mode, chess or interleaved.
+ *
+ * The host's MLX90640_I2CRead/I2CWrite (mlx90640_host_i2c.c) hand each
+ * transaction to the model attached at its address and move a simulated
+ * clock on by the time it would take on the bus, so a run is the same
+ * every time: how many transactions a frame takes, how many status polls,
+ * how long the bus is busy. Nothing attached at an address NACKs, as
+ * before.
+ *
+ * What a subpage measures comes from fake_frames.h unless a source is set.
+ * Faults can be injected at a rate per transaction (NACKs, timeouts),
+ * per measurement (a line or aux word reading 0x7FFF), or for good (data
+ * never ready).
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _MLX90640_MODEL_H
+#define _MLX90640_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fake_frames.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MLX90640_MODEL_RAM_START 0x0400
+#define MLX90640_MODEL_RAM_WORDS 832
+#define MLX90640_MODEL_EEPROM_START 0x2400
+#define MLX90640_MODEL_EEPROM_WORDS 832
+#define MLX90640_MODEL_I2C_CONF 0x800F
+#define MLX90640_MODEL_MAX_DEVICES 4
+/*
+ * @brief Control register at power on: subpages, chess, 18 bits, 2Hz.
+ */
+#define MLX90640_MODEL_CTRL_DEFAULT 0x1901
+
+/*
+ * @brief Status register bits the Melexis API doesn't name.
+ */
+#define MLX90640_MODEL_STAT_OVERWRITE 0x0010  // new data may overwrite unread data
+#define MLX90640_MODEL_STAT_START 0x0020      // starts a measurement in step mode
+
+/*
+ * @brief Rates are per thousand.
+ */
+typedef struct {
+  uint32_t seed;
+  uint16_t nack;       // a transaction isn't ACKed
+  uint16_t timeout;    // a transaction hangs until the driver gives up
+  uint16_t bad_line;   // a measurement leaves a line of its subpage 0x7FFF
+  uint16_t bad_aux;    // or aux word 0
+  bool never_ready;    // no measurement ever finishes
+  uint64_t dead_ns;    // from this time nothing is ACKed, 0 for never
+  uint64_t alive_ns;   // until this time, 0 for good
+} mlx90640_model_faults_t;
+
+typedef struct {
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t words_read;
+  uint32_t not_ready;     // status reads without new data
+  uint32_t measurements;
+  uint32_t overwritten;   // measurements that replaced unread data
+  uint32_t held;          // measurements dropped, unread data not overwritten
+  uint32_t nacks;         // injected
+  uint32_t timeouts;      // injected
+  uint32_t bad_data;      // measurements made bad
+} mlx90640_model_counters_t;
+
+/*
+ * @brief Fill frame (834 words, as MLX90640_GetFrameData gives them) with
+ * measurement n of subpage. The model takes the pixels of that subpage
+ * and the aux words.
+ */
+typedef void (*mlx90640_model_source_t)(void *ctx, uint32_t n, uint8_t subpage, uint16_t *frame);
+
+typedef struct {
+  uint8_t slave_addr;  // with the bus, MLX90640_I2C_ADDR
+  uint16_t status;
+  uint16_t ctrl;
+  uint16_t i2c_conf;
+  uint16_t ram[MLX90640_MODEL_RAM_WORDS];
+  uint16_t eeprom[MLX90640_MODEL_EEPROM_WORDS];
+  bool measuring;
+  uint64_t done_ns;    // the measurement in progress ends
+  uint8_t subpage;     // it measures
+  uint32_t n;          // measurements so far
+  mlx90640_model_source_t source;
+  void *source_ctx;
+  fake_frames_t fake;
+  uint16_t frame[FAKE_RAW_WORDS];
+  mlx90640_model_faults_t faults;
+  uint32_t rng;
+  mlx90640_model_counters_t counters;
+} mlx90640_model_t;
+
+/*
+ * mlx90640_model_init
+ *
+ * @brief A sensor at slave_addr, as at power on, its EEPROM and fake
+ * scene made from seed. Measuring starts at now_ns.
+ */
+void mlx90640_model_init(mlx90640_model_t *m, uint8_t slave_addr, uint32_t seed, uint64_t now_ns);
+/*
+ * mlx90640_model_set_source
+ *
+ * @brief Take measurements from source rather than fake_frames.h.
+ */
+void mlx90640_model_set_source(mlx90640_model_t *m, mlx90640_model_source_t source, void *ctx);
+/*
+ * mlx90640_model_set_faults
+ */
+void mlx90640_model_set_faults(mlx90640_model_t *m, const mlx90640_model_faults_t *faults);
+/*
+ * mlx90640_model_subpage_us
+ *
+ * @brief How long a subpage takes at the refresh rate set.
+ */
+uint32_t mlx90640_model_subpage_us(const mlx90640_model_t *m);
+/*
+ * mlx90640_model_read
+ *
+ * @brief n words from address at now_ns, as the bus would. Returns 0 or
+ * a negative MLX90640 error.
+ */
+int mlx90640_model_read(mlx90640_model_t *m, uint64_t now_ns, uint16_t address, uint16_t n, uint16_t *data);
+/*
+ * mlx90640_model_write
+ */
+int mlx90640_model_write(mlx90640_model_t *m, uint64_t now_ns, uint16_t address, uint16_t data);
+/*
+ * mlx90640_model_general_reset
+ *
+ * @brief The I2C general call: a measurement triggered by the control
+ * register starts.
+ */
+void mlx90640_model_general_reset(mlx90640_model_t *m, uint64_t now_ns);
+
+/*
+ * The host bus, in mlx90640_host_i2c.c.
+ */
+
+/*
+ * mlx90640_host_attach
+ *
+ * @brief Answer transactions to m->slave_addr with m. Returns false if
+ * there's no room or the address is taken.
+ */
+bool mlx90640_host_attach(mlx90640_model_t *m);
+/*
+ * mlx90640_host_detach_all
+ *
+ * @brief Back to nothing answering, with the clock and counters reset.
+ */
+void mlx90640_host_detach_all(void);
+/*
+ * mlx90640_host_set_clock
+ *
+ * @brief Time transactions on the caller's clock instead of the bus's
+ * own, e.g. pico_host.h's; NULLs go back to the bus's.
+ */
+void mlx90640_host_set_clock(uint64_t (*now_ns)(void), void (*advance_ns)(uint64_t ns));
+/*
+ * mlx90640_host_now_ns
+ *
+ * @brief The simulated clock, moved on by every transaction.
+ */
+uint64_t mlx90640_host_now_ns(void);
+/*
+ * mlx90640_host_sleep_us
+ *
+ * @brief Move the clock on, as the caller sleeping would.
+ */
+void mlx90640_host_sleep_us(uint32_t us);
+/*
+ * mlx90640_host_busy_ns
+ *
+ * @brief Time the bus has spent on transactions.
+ */
+uint64_t mlx90640_host_busy_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,767 @@
+/*
+ * pico_host.c
+ *
+ * @brief The simulated hardware under the pico-sdk shims, see pico_host.h.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/mutex.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "pico_host.h"
+
+// how far spinning moves the clock when nothing is due sooner
+#define HOST_SPIN_NS 1000
+#define HOST_CONSOLE_LINES 256
+
+typedef enum {
+  HOST_IDLE,     // not launched
+  HOST_RUNNING,
+  HOST_WAITING,  // for its turn, to move its clock to want_ns
+  HOST_BLOCKED,  // on a mutex
+  HOST_PARKED,   // at the end of the run
+} host_state_t;
+
+typedef struct {
+  host_state_t state;
+  uint64_t now_ns;
+  uint64_t want_ns;
+  const mutex_t *blocked_on;
+} host_core_t;
+
+/*
+ * @brief The cores, under host_lock. Only host_current runs at a time,
+ * so whatever the two do together happens in the same order every run.
+ * Core 0 runs from the start, so tools that never launch core 1 have it
+ * to themselves.
+ */
+static host_core_t host_cores[PICO_HOST_CORES] = { { .state = HOST_RUNNING } };
+static uint host_current;
+static pthread_mutex_t host_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t host_end_ns = UINT64_MAX;
+static pthread_t host_threads[PICO_HOST_CORES];
+static int (*host_entry)(void);
+static void (*host_core1_entry)(void);
+
+static _Thread_local uint host_core_num;
+static _Thread_local uint64_t host_cpu_mark_ns;
+static _Thread_local bool host_charging;
+static _Thread_local uint64_t host_timer_read_ns = UINT64_MAX;
+static double host_cpu_scale;
+
+spi_hw_t pico_host_spi_hw[2];
+
+static pico_host_counters_t host_counters;
+
+static bool host_levels[NUM_BANK0_GPIOS];
+static uint32_t host_irq_enabled[NUM_BANK0_GPIOS];
+static uint32_t host_irq_events[NUM_BANK0_GPIOS];
+static irq_handler_t host_irq_handlers[NUM_BANK0_GPIOS];
+static bool host_bank0_enabled;
+static _Thread_local bool host_in_irq;
+
+static st7789_model_t *host_panel;
+static uint host_panel_core;  // the one that set spi0 up
+static uint64_t host_next_vsync_ns;
+static uint64_t host_tick_period_ns;
+static uint64_t host_next_tick_ns;
+static pico_host_tick_t host_tick_fn;
+static void *host_tick_ctx;
+
+static uint32_t host_spi_baud;
+static uint host_spi_bits = 8;
+static uint64_t host_spi_busy_until_ns;
+
+static bool host_dma_claimed[NUM_DMA_CHANNELS];
+static uint64_t host_dma_done_ns[NUM_DMA_CHANNELS];
+
+typedef struct {
+  uint64_t at_ns;
+  char *line;
+} host_console_line_t;
+static host_console_line_t host_console[HOST_CONSOLE_LINES];
+static uint host_console_n;
+static uint host_console_head;
+static size_t host_console_pos;
+
+static host_core_t *host_me(void) {
+  return &host_cores[host_core_num];
+}
+
+/*
+ * host_pick
+ *
+ * @brief Hand the host over to whichever core's clock is furthest behind,
+ * core 0 on a tie, or keep it if the other can't run.
+ */
+static void host_pick(void) {
+  const host_core_t *me = host_me(), *o = &host_cores[host_core_num ^ 1];
+  bool mine = me->state == HOST_WAITING;
+  bool other = o->state == HOST_WAITING;
+  if (other && (!mine || o->want_ns < me->want_ns || (o->want_ns == me->want_ns && host_core_num == 1))) {
+    host_current = host_core_num ^ 1;
+  } else {
+    host_current = host_core_num;
+  }
+  pthread_cond_broadcast(&host_cond);
+}
+
+/*
+ * host_wait_turn
+ *
+ * @brief Wait, under host_lock, until it's the calling core's turn.
+ */
+static void host_wait_turn(void) {
+  while (host_current != host_core_num) {
+    pthread_cond_wait(&host_cond, &host_lock);
+  }
+  host_core_t *me = host_me();
+  me->now_ns = me->want_ns;
+  me->state = HOST_RUNNING;
+}
+
+/*
+ * host_park
+ *
+ * @brief The run is over for this core; pico_host_run ends the process.
+ */
+static void host_park(void) {
+  host_me()->state = HOST_PARKED;
+  host_pick();
+  for (;;) {
+    pthread_cond_wait(&host_cond, &host_lock);
+  }
+}
+
+/*
+ * host_sync
+ *
+ * @brief Move the calling core's clock to t_ns, once the other core has
+ * caught up, or park it if that's past the end of the run.
+ */
+static void host_sync(uint64_t t_ns) {
+  host_core_t *me = host_me();
+  pthread_mutex_lock(&host_lock);
+  uint64_t t = t_ns < host_end_ns ? t_ns : host_end_ns;
+  me->want_ns = t;
+  me->state = HOST_WAITING;
+  host_pick();
+  host_wait_turn();
+  if (t == host_end_ns) {
+    host_park();
+  }
+  pthread_mutex_unlock(&host_lock);
+}
+
+/*
+ * host_raise
+ *
+ * @brief An edge on gpio: flag it, and run the bank's handlers if it's
+ * enabled. Handlers don't nest.
+ */
+static void host_raise(uint gpio, uint32_t event) {
+  host_irq_events[gpio] |= event;
+  if (!host_bank0_enabled || host_in_irq || !(host_irq_enabled[gpio] & event)) {
+    return;
+  }
+  host_in_irq = true;
+  for (uint i = 0; i < NUM_BANK0_GPIOS; i++) {
+    if (host_irq_handlers[i] && host_irq_events[i] & host_irq_enabled[i]) {
+      host_irq_handlers[i]();
+    }
+  }
+  host_in_irq = false;
+}
+
+/*
+ * host_panel_events
+ *
+ * @brief V-blank pulses and ticks due by now, on the panel's core.
+ */
+static void host_panel_events(uint64_t now_ns) {
+  while (host_next_vsync_ns <= now_ns) {
+    host_next_vsync_ns += (uint64_t)st7789_model_refresh_us(host_panel) * 1000;
+    if (host_panel->te_on && !host_panel->asleep) {
+      host_counters.te_pulses++;
+      host_raise(PICO_HOST_ST7789_TE_PIN, GPIO_IRQ_EDGE_RISE);
+    }
+  }
+  while (host_tick_fn && host_next_tick_ns <= now_ns) {
+    host_next_tick_ns += host_tick_period_ns;
+    host_tick_fn(host_tick_ctx, now_ns);
+  }
+}
+
+/*
+ * host_advance_to
+ *
+ * @brief Move the calling core's clock on to t_ns, stopping for the
+ * panel's events on the way if it's the panel's core.
+ */
+static void host_advance_to(uint64_t t_ns) {
+  host_core_t *me = host_me();
+  while (me->now_ns < t_ns) {
+    uint64_t next = t_ns;
+    bool panel = host_panel && host_core_num == host_panel_core && !host_in_irq;
+    if (panel && host_next_vsync_ns < next) {
+      next = host_next_vsync_ns;
+    }
+    if (panel && host_tick_fn && host_next_tick_ns < next) {
+      next = host_next_tick_ns;
+    }
+    host_sync(next);
+    if (panel) {
+      host_panel_events(me->now_ns);
+    }
+  }
+}
+
+static uint64_t host_thread_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * host_charge_cpu
+ *
+ * @brief Put the CPU time taken since last time on the clock, scaled.
+ */
+static void host_charge_cpu(void) {
+  if (host_cpu_scale <= 0 || host_charging) {
+    return;
+  }
+  uint64_t cpu = host_thread_cpu_ns();
+  uint64_t ns = (uint64_t)((double)(cpu - host_cpu_mark_ns) * host_cpu_scale);
+  host_cpu_mark_ns = cpu;
+  if (ns) {
+    host_charging = true;
+    host_counters.cpu_ns[host_core_num] += ns;
+    host_advance_to(host_me()->now_ns + ns);
+    host_charging = false;
+  }
+}
+
+void pico_host_discard_cpu(void) {
+  if (host_cpu_scale > 0) {
+    host_cpu_mark_ns = host_thread_cpu_ns();
+  }
+}
+
+void pico_host_set_cpu_scale(double scale) {
+  host_cpu_scale = scale;
+  host_cpu_mark_ns = host_thread_cpu_ns();
+}
+
+void pico_host_advance_ns(uint64_t ns) {
+  host_charge_cpu();
+  host_advance_to(host_me()->now_ns + ns);
+}
+
+uint64_t pico_host_now_ns(void) {
+  host_charge_cpu();
+  return host_me()->now_ns;
+}
+
+uint64_t pico_host_core_ns(uint32_t core) {
+  pthread_mutex_lock(&host_lock);
+  uint64_t ns = host_cores[core % PICO_HOST_CORES].now_ns;
+  pthread_mutex_unlock(&host_lock);
+  return ns;
+}
+
+void pico_host_attach_st7789(st7789_model_t *m) {
+  host_panel = m;
+  if (m) {
+    st7789_model_select(m, !host_levels[PICO_HOST_ST7789_CS_PIN]);
+    host_next_vsync_ns = host_me()->now_ns + (uint64_t)st7789_model_refresh_us(m) * 1000;
+  }
+}
+
+void pico_host_set_tick(uint64_t period_ns, pico_host_tick_t fn, void *ctx) {
+  host_tick_period_ns = period_ns;
+  host_tick_fn = period_ns ? fn : NULL;
+  host_tick_ctx = ctx;
+  host_next_tick_ns = host_me()->now_ns + period_ns;
+}
+
+uint32_t pico_host_spi_baud(void) {
+  return host_spi_baud;
+}
+
+void pico_host_get_counters(pico_host_counters_t *c) {
+  *c = host_counters;
+}
+
+bool pico_host_console_feed(uint64_t at_ns, const char *line) {
+  if (host_console_n == HOST_CONSOLE_LINES) {
+    return false;
+  }
+  // in time order, lines for the same time as they came
+  uint i = host_console_n++;
+  for (; i > host_console_head && host_console[i - 1].at_ns > at_ns; i--) {
+    host_console[i] = host_console[i - 1];
+  }
+  host_console[i].at_ns = at_ns;
+  host_console[i].line = strdup(line);
+  return host_console[i].line != NULL;
+}
+
+/*
+ * host_core1_main
+ */
+static void *host_core1_main(void *arg) {
+  (void)arg;
+  host_core_num = 1;
+  pthread_mutex_lock(&host_lock);
+  host_wait_turn();
+  pthread_mutex_unlock(&host_lock);
+  pico_host_discard_cpu();
+  host_core1_entry();
+  pthread_mutex_lock(&host_lock);
+  host_park();
+  return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+  host_core1_entry = entry;
+  // it starts when core 0 next waits
+  pthread_mutex_lock(&host_lock);
+  host_cores[1].state = HOST_WAITING;
+  host_cores[1].now_ns = host_cores[1].want_ns = host_me()->now_ns;
+  pthread_mutex_unlock(&host_lock);
+  pthread_create(&host_threads[1], NULL, host_core1_main, NULL);
+}
+
+/*
+ * host_core0_main
+ */
+static void *host_core0_main(void *arg) {
+  (void)arg;
+  host_core_num = 0;
+  pthread_mutex_lock(&host_lock);
+  host_wait_turn();
+  pthread_mutex_unlock(&host_lock);
+  pico_host_discard_cpu();
+  host_entry();
+  pthread_mutex_lock(&host_lock);
+  host_park();
+  return NULL;
+}
+
+/*
+ * host_stopped
+ *
+ * @brief Whether neither core can go on, being parked, not launched or
+ * blocked on a mutex; stuck if any is blocked.
+ */
+static bool host_stopped(bool *stuck) {
+  *stuck = false;
+  for (uint c = 0; c < PICO_HOST_CORES; c++) {
+    host_state_t state = host_cores[c].state;
+    if (state == HOST_RUNNING || state == HOST_WAITING) {
+      return false;
+    }
+    *stuck |= state == HOST_BLOCKED;
+  }
+  return true;
+}
+
+bool pico_host_run(int (*entry)(void), uint64_t end_ns) {
+  host_entry = entry;
+  pthread_mutex_lock(&host_lock);
+  host_end_ns = end_ns;
+  host_cores[0].want_ns = host_cores[0].now_ns;
+  host_cores[0].state = HOST_WAITING;
+  host_current = 0;
+  pthread_mutex_unlock(&host_lock);
+  pthread_create(&host_threads[0], NULL, host_core0_main, NULL);
+
+  bool stuck;
+  pthread_mutex_lock(&host_lock);
+  while (!host_stopped(&stuck)) {
+    pthread_cond_wait(&host_cond, &host_lock);
+  }
+  pthread_mutex_unlock(&host_lock);
+  return !stuck;
+}
+
+uint get_core_num(void) {
+  return host_core_num;
+}
+
+/*
+ * host_read_timer
+ *
+ * @brief The calling core's clock, as the timer reads it. Reading it
+ * again with nothing in between to move the clock on is polling it, and
+ * moves it on as spinning does, so a loop waiting on the time gets there.
+ */
+static uint64_t host_read_timer(void) {
+  uint64_t now = pico_host_now_ns();
+  if (now == host_timer_read_ns) {
+    host_advance_to(now + HOST_SPIN_NS);
+    now = host_me()->now_ns;
+  }
+  host_timer_read_ns = now;
+  return now;
+}
+
+uint32_t time_us_32(void) {
+  return (uint32_t)(host_read_timer() / 1000);
+}
+
+uint64_t time_us_64(void) {
+  return host_read_timer() / 1000;
+}
+
+void sleep_us(uint64_t us) {
+  host_counters.sleep_ns[host_core_num] += us * 1000;
+  pico_host_advance_ns(us * 1000);
+}
+
+void sleep_ms(uint32_t ms) {
+  sleep_us((uint64_t)ms * 1000);
+}
+
+void tight_loop_contents(void) {
+  // straight to whatever the spinning is waiting for, if it's soon
+  uint64_t now = pico_host_now_ns();
+  uint64_t next = now + HOST_SPIN_NS;
+  if (host_core_num == host_panel_core && host_spi_busy_until_ns > now && host_spi_busy_until_ns < next) {
+    next = host_spi_busy_until_ns;
+  }
+  host_advance_to(next);
+}
+
+bool stdio_init_all(void) {
+  return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+  uint64_t now = pico_host_now_ns();
+  if (host_console_head < host_console_n && host_console[host_console_head].at_ns <= now) {
+    host_console_line_t *l = &host_console[host_console_head];
+    char c = l->line[host_console_pos++];
+    if (c == '\0') {
+      free(l->line);
+      host_console_head++;
+      host_console_pos = 0;
+      return '\n';
+    }
+    return (unsigned char)c;
+  }
+  pico_host_advance_ns((uint64_t)timeout_us * 1000);
+  return PICO_ERROR_TIMEOUT;
+}
+
+void mutex_init(mutex_t *mtx) {
+  mtx->owner = 0;
+}
+
+void mutex_enter_blocking(mutex_t *mtx) {
+  host_core_t *me = host_me();
+  pthread_mutex_lock(&host_lock);
+  if (mtx->owner) {
+    host_counters.mutex_waits[host_core_num]++;
+  }
+  while (mtx->owner) {
+    // over to the owner, until mutex_exit lets this one go again
+    me->state = HOST_BLOCKED;
+    me->blocked_on = mtx;
+    host_pick();
+    while (me->state == HOST_BLOCKED) {
+      pthread_cond_wait(&host_cond, &host_lock);
+    }
+    host_wait_turn();
+  }
+  mtx->owner = (int)host_core_num + 1;
+  me->blocked_on = NULL;
+  pthread_mutex_unlock(&host_lock);
+}
+
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out) {
+  pthread_mutex_lock(&host_lock);
+  bool free = !mtx->owner;
+  if (free) {
+    mtx->owner = (int)host_core_num + 1;
+  } else if (owner_out) {
+    *owner_out = (uint32_t)mtx->owner - 1;
+  }
+  pthread_mutex_unlock(&host_lock);
+  return free;
+}
+
+void mutex_exit(mutex_t *mtx) {
+  host_core_t *me = host_me();
+  pthread_mutex_lock(&host_lock);
+  mtx->owner = 0;
+  // the core blocked on it carries on from now, once it's its turn
+  host_core_t *o = &host_cores[host_core_num ^ 1];
+  if (o->state == HOST_BLOCKED && o->blocked_on == mtx) {
+    o->state = HOST_WAITING;
+    o->want_ns = o->now_ns > me->now_ns ? o->now_ns : me->now_ns;
+  }
+  pthread_mutex_unlock(&host_lock);
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+  if (num == IO_IRQ_BANK0) {
+    host_bank0_enabled = enabled;
+  }
+}
+
+void gpio_init(uint gpio) {
+  host_irq_enabled[gpio] = 0;
+  host_irq_events[gpio] = 0;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+  (void)gpio;
+  (void)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+  (void)gpio;
+  (void)out;
+}
+
+void gpio_pull_up(uint gpio) {
+  host_levels[gpio] = true;
+}
+
+void gpio_pull_down(uint gpio) {
+  host_levels[gpio] = false;
+}
+
+void gpio_disable_pulls(uint gpio) {
+  (void)gpio;
+}
+
+void gpio_put(uint gpio, bool value) {
+  bool was = host_levels[gpio];
+  host_levels[gpio] = value;
+  if (!host_panel || was == value) {
+    return;
+  }
+  if ((gpio == PICO_HOST_ST7789_CS_PIN || gpio == PICO_HOST_ST7789_DC_PIN) && host_spi_busy_until_ns > host_me()->now_ns) {
+    host_counters.glitches++;
+  }
+  if (gpio == PICO_HOST_ST7789_CS_PIN) {
+    // active low
+    st7789_model_select(host_panel, !value);
+  } else if (gpio == PICO_HOST_ST7789_RES_PIN && !value) {
+    st7789_model_reset(host_panel);
+  }
+}
+
+bool gpio_get(uint gpio) {
+  return host_levels[gpio];
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+  if (enabled) {
+    host_irq_enabled[gpio] |= event_mask;
+  } else {
+    host_irq_enabled[gpio] &= ~event_mask;
+  }
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler) {
+  host_irq_handlers[gpio] = handler;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+  return host_irq_events[gpio] & host_irq_enabled[gpio];
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+  host_irq_events[gpio] &= ~event_mask;
+}
+
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+  // as the SDK divides clk_peri down: the smallest even prescale that
+  // gets under 256 post-dividers of the rate, then the slowest of those
+  // that's still faster than asked for
+  uint32_t freq_in = PICO_HOST_CLK_PERI_HZ;
+  uint prescale, postdiv;
+  for (prescale = 2; prescale <= 254; prescale += 2) {
+    if (freq_in < (prescale + 2) * 256 * (uint64_t)baudrate) {
+      break;
+    }
+  }
+  for (postdiv = 256; postdiv > 1; --postdiv) {
+    if (freq_in / (prescale * (postdiv - 1)) > baudrate) {
+      break;
+    }
+  }
+  uint actual = freq_in / (prescale * postdiv);
+  if (spi == spi0) {
+    host_spi_baud = actual;
+  }
+  return actual;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+  if (spi == spi0) {
+    host_spi_bits = 8;
+    host_panel_core = host_core_num;
+  }
+  return spi_set_baudrate(spi, baudrate);
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+  (void)cpol;
+  (void)cpha;
+  (void)order;
+  if (spi == spi0) {
+    host_spi_bits = data_bits;
+  }
+}
+
+/*
+ * host_spi_shift
+ *
+ * @brief Queue n frames on spi0 behind whatever is still going out: they
+ * reach the panel now, MSB first, and the bus is busy until they're out.
+ * Feeding the panel isn't the firmware's CPU time.
+ */
+static void host_spi_shift(const void *src, size_t n, uint size_bytes, bool incr) {
+  if (host_spi_baud == 0) {
+    return;
+  }
+  uint64_t now = pico_host_now_ns();
+  bool dc = host_levels[PICO_HOST_ST7789_DC_PIN];
+  const uint8_t *p = src;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t v = size_bytes == 2 ? *(const uint16_t *)p : size_bytes == 4 ? *(const uint32_t *)p : *p;
+    uint8_t bytes[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    if (host_panel) {
+      if (host_spi_bits > 8) {
+        st7789_model_write(host_panel, dc, bytes, 2);
+      } else {
+        st7789_model_write(host_panel, dc, &bytes[1], 1);
+      }
+    }
+    if (incr) {
+      p += size_bytes;
+    }
+  }
+  pico_host_discard_cpu();
+  uint64_t ns = (uint64_t)n * host_spi_bits * 1000000000ull / host_spi_baud;
+  uint64_t start = host_spi_busy_until_ns > now ? host_spi_busy_until_ns : now;
+  host_spi_busy_until_ns = start + ns;
+  host_counters.spi_bytes += n * (host_spi_bits > 8 ? 2 : 1);
+  host_counters.spi_busy_ns += ns;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+  if (spi == spi0) {
+    host_counters.spi_writes++;
+    host_spi_shift(src, len, 1, true);
+    host_advance_to(host_spi_busy_until_ns);
+  }
+  return (int)len;
+}
+
+int spi_write16_blocking(spi_inst_t *spi, const uint16_t *src, size_t len) {
+  if (spi == spi0) {
+    host_counters.spi_writes++;
+    host_spi_shift(src, len, 2, true);
+    host_advance_to(host_spi_busy_until_ns);
+  }
+  return (int)len;
+}
+
+bool spi_is_busy(const spi_inst_t *spi) {
+  return spi == spi0 && host_spi_busy_until_ns > pico_host_now_ns();
+}
+
+bool spi_is_readable(const spi_inst_t *spi) {
+  (void)spi;
+  return false;
+}
+
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx) {
+  // DREQ_SPI0_TX is 16, and RX, TX alternate from there
+  return 16 + spi_get_index(spi) * 2 + (is_tx ? 0 : 1);
+}
+
+int dma_claim_unused_channel(bool required) {
+  (void)required;
+  for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+    if (!host_dma_claimed[i]) {
+      host_dma_claimed[i] = true;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+  host_dma_claimed[channel] = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+  (void)channel;
+  dma_channel_config c = { DMA_SIZE_32, true, false, 0x3F };
+  return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+  c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+  c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+  c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+  c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+  const volatile void *read_addr, uint transfer_count, bool trigger) {
+  if (!trigger) {
+    return;
+  }
+  uint size_bytes = 1u << config->size;
+  if (write_addr == &pico_host_spi_hw[0].dr) {
+    host_counters.dma_transfers++;
+    host_spi_shift((const void *)read_addr, transfer_count, size_bytes, config->read_increment);
+    host_dma_done_ns[channel] = host_spi_busy_until_ns;
+    return;
+  }
+  // memory to memory, all at once
+  uint8_t *dst = (uint8_t *)write_addr;
+  const uint8_t *src = (const uint8_t *)read_addr;
+  for (uint i = 0; i < transfer_count; i++) {
+    memcpy(dst, src, size_bytes);
+    dst += config->write_increment ? size_bytes : 0;
+    src += config->read_increment ? size_bytes : 0;
+  }
+  host_dma_done_ns[channel] = pico_host_now_ns();
+}
+
+bool dma_channel_is_busy(uint channel) {
+  return host_dma_done_ns[channel] > pico_host_now_ns();
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+  host_advance_to(host_dma_done_ns[channel]);
+}
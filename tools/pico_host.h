@@ -0,0 +1,146 @@
+/*
+ * pico_host.h
+ *
+ * @brief The simulated hardware under the pico-sdk shims in tools/host,
+ * for running firmware sources on the host: two cores, a clock for each,
+ * GPIO, SPI and DMA, the IO bank interrupt, mutexes and the console. A
+ * virtual panel (st7789_model.h) can be wired up the way st7789.c drives
+ * it: chip select and DC pick what the bytes shifted out of spi0 are, the
+ * reset pin resets it, and its V-blank pulses come in on the TE pin at the
+ * refresh rate it was set to.
+ *
+ * Each core's clock only moves when it waits, so the time a run takes is
+ * bus and sleep time, not the host's, and the same every run. To count
+ * the work in between as well, the host CPU time a core's thread takes
+ * can be put on its clock, scaled to the RP2040, at the cost of runs no
+ * longer being the same.
+ *
+ * Core 1 is a thread of its own. The two take turns: the core whose clock
+ * is behind runs, core 0 on a tie, until it waits for a time past the
+ * other's or blocks on a mutex the other holds, so whatever one core does
+ * at a time the other sees by then, in the same order every run. Reading
+ * the time over and over with nothing in between moves the clock on as
+ * spinning does. A core that gets to the end of the run parks there.
+ *
+ * While a transfer is still shifting out, chip select and DC have to be
+ * left alone; each time they aren't is counted as a glitch.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _PICO_HOST_H
+#define _PICO_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "st7789_model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief The panel's pins, as st7789.c wires them.
+ */
+#define PICO_HOST_ST7789_CS_PIN 17
+#define PICO_HOST_ST7789_DC_PIN 20
+#define PICO_HOST_ST7789_RES_PIN 21
+#define PICO_HOST_ST7789_TE_PIN 22
+
+// clk_peri, which the SPI baud rate is divided down from
+#define PICO_HOST_CLK_PERI_HZ 125000000u
+#define PICO_HOST_CORES 2
+
+typedef struct {
+  uint64_t spi_bytes;     // shifted out of spi0
+  uint64_t spi_busy_ns;
+  uint32_t spi_writes;    // spi_write_blocking and spi_write16_blocking
+  uint32_t dma_transfers; // to spi0
+  uint32_t te_pulses;     // raised on the TE pin
+  uint32_t glitches;      // chip select or DC moved mid-transfer
+  uint64_t sleep_ns[PICO_HOST_CORES];    // in sleep_us and sleep_ms
+  uint64_t cpu_ns[PICO_HOST_CORES];      // put on the clock, scaled
+  uint32_t mutex_waits[PICO_HOST_CORES]; // found a mutex taken
+} pico_host_counters_t;
+
+/*
+ * @brief Called on the panel's core every period of its clock, e.g. to
+ * write what the panel shows.
+ */
+typedef void (*pico_host_tick_t)(void *ctx, uint64_t now_ns);
+
+/*
+ * pico_host_attach_st7789
+ *
+ * @brief Wire panel m up to spi0 and its pins. NULL takes it away.
+ */
+void pico_host_attach_st7789(st7789_model_t *m);
+/*
+ * pico_host_set_tick
+ *
+ * @brief Call fn on the core driving the panel every period_ns; 0 stops it.
+ */
+void pico_host_set_tick(uint64_t period_ns, pico_host_tick_t fn, void *ctx);
+/*
+ * pico_host_set_cpu_scale
+ *
+ * @brief Put the host CPU time each core takes on its clock, times scale
+ * (how much slower the RP2040 is). 0, the default, leaves it off.
+ */
+void pico_host_set_cpu_scale(double scale);
+/*
+ * pico_host_discard_cpu
+ *
+ * @brief Leave the CPU time the calling core's thread has taken since it
+ * was last put on the clock off it, e.g. time spent simulating a device
+ * rather than running firmware.
+ */
+void pico_host_discard_cpu(void);
+/*
+ * pico_host_console_feed
+ *
+ * @brief Queue line, and a newline, to be read on the console from at_ns.
+ */
+bool pico_host_console_feed(uint64_t at_ns, const char *line);
+/*
+ * pico_host_run
+ *
+ * @brief Run entry on core 0, and whatever it launches on core 1, until
+ * both clocks get to end_ns. Returns false if they got stuck before then,
+ * each blocked on a mutex the other holds. Only once.
+ */
+bool pico_host_run(int (*entry)(void), uint64_t end_ns);
+/*
+ * pico_host_now_ns
+ *
+ * @brief The calling core's clock.
+ */
+uint64_t pico_host_now_ns(void);
+/*
+ * pico_host_core_ns
+ */
+uint64_t pico_host_core_ns(uint32_t core);
+/*
+ * pico_host_advance_ns
+ *
+ * @brief Move the calling core's clock on, raising any interrupts due on
+ * the way.
+ */
+void pico_host_advance_ns(uint64_t ns);
+/*
+ * pico_host_spi_baud
+ *
+ * @brief The baud rate spi0 was really set to.
+ */
+uint32_t pico_host_spi_baud(void);
+/*
+ * pico_host_get_counters
+ */
+void pico_host_get_counters(pico_host_counters_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * pio_i2c_model.c
+ *
+ * @brief Builds the TX FIFO streams the PIO I2C master is fed for every
+ * kind of transaction the MLX90640 driver makes, runs them through the
+ * decoder and framing check in pio_i2c_frame.c, and reports what goes on
+ * the bus. Exits non-zero if any of them is malformed.
+ *
+ *   pio_i2c_model [-v]
+ *
+ * -v prints the bus events of each transaction.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mlx90640/pio_i2c_frame.h"
+
+#define MLX90640_ADDR 0x33
+#define MAX_WORDS 2048
+#define MAX_EVENTS 2048
+
+typedef struct {
+  const char *name;
+  bool write;
+  uint16_t reg;
+  uint16_t n_words;  // 16-bit registers to read, or the value to write
+} transaction_t;
+
+/*
+ * @brief What MLX90640_API.c asks of the bus.
+ */
+static const transaction_t transactions[] = {
+  { "status register read", false, 0x8000, 1 },
+  { "control register read", false, 0x800D, 1 },
+  { "control register write", true, 0x800D, 0x1901 },
+  { "status register clear", true, 0x8000, 0x0030 },
+  { "EEPROM dump", false, 0x2400, 832 },
+  { "frame read", false, 0x0400, 832 },
+};
+
+static const char *event_name(pio_i2c_event_type_t type) {
+  switch (type) {
+    case PIO_I2C_EVENT_START: return "START";
+    case PIO_I2C_EVENT_RSTART: return "RSTART";
+    case PIO_I2C_EVENT_STOP: return "STOP";
+    case PIO_I2C_EVENT_BYTE: return "BYTE";
+  }
+  return "?";
+}
+
+/*
+ * print_events
+ *
+ * @brief One line per event, runs of read bytes folded into one line.
+ */
+static void print_events(const pio_i2c_event_t *events, int n) {
+  for (int i = 0; i < n; i++) {
+    const pio_i2c_event_t *ev = &events[i];
+    if (ev->type != PIO_I2C_EVENT_BYTE) {
+      printf("    %s\n", event_name(ev->type));
+      continue;
+    }
+    int run = 1;
+    while (i + run < n && events[i + run].type == PIO_I2C_EVENT_BYTE && events[i + run].data == ev->data &&
+           events[i + run].nak == ev->nak && events[i + run].final == ev->final) {
+      run++;
+    }
+    printf("    BYTE 0x%02x%s%s", ev->data, ev->nak ? " nak" : " ack", ev->final ? " final" : "");
+    if (run > 1) {
+      printf(" x%d", run);
+    }
+    printf("\n");
+    i += run - 1;
+  }
+}
+
+static int model(const transaction_t *t, bool verbose) {
+  static uint16_t words[MAX_WORDS];
+  static pio_i2c_event_t events[MAX_EVENTS];
+  char err[128];
+  pio_i2c_frame_t f;
+  size_t first = 0;
+
+  pio_i2c_frame_init(&f, words, MAX_WORDS);
+  if (t->write) {
+    uint8_t payload[2] = { t->n_words >> 8, t->n_words & 0xFF };
+    pio_i2c_frame_mem_write(&f, MLX90640_ADDR, t->reg, payload, 2);
+  } else {
+    first = pio_i2c_frame_mem_read(&f, MLX90640_ADDR, t->reg, 2 * t->n_words);
+  }
+  if (f.overflow) {
+    printf("[ERROR] %s: frame doesn't fit in %d words.\n", t->name, MAX_WORDS);
+    return -1;
+  }
+
+  int n = pio_i2c_frame_decode(words, f.len, events, MAX_EVENTS, err, sizeof(err));
+  if (n < 0) {
+    printf("[ERROR] %s: %s.\n", t->name, err);
+    return -1;
+  }
+  if (n > MAX_EVENTS) {
+    printf("[ERROR] %s: %d events, only room for %d.\n", t->name, n, MAX_EVENTS);
+    return -1;
+  }
+  if (pio_i2c_frame_check(events, n, err, sizeof(err)) < 0) {
+    printf("[ERROR] %s: %s.\n", t->name, err);
+    return -1;
+  }
+
+  // every data word pushes a byte, so the RX stream has one per BYTE event
+  int n_bytes = 0;
+  for (int i = 0; i < n; i++) {
+    n_bytes += events[i].type == PIO_I2C_EVENT_BYTE;
+  }
+  if ((size_t)n_bytes != f.n_bytes) {
+    printf("[ERROR] %s: %d bytes on the bus, frame counted %zu.\n", t->name, n_bytes, f.n_bytes);
+    return -1;
+  }
+
+  printf("[INFO] %s at 0x%04x: %zu FIFO words, %zu bytes on the bus", t->name, t->reg, f.len, f.n_bytes);
+  if (!t->write) {
+    printf(", data from RX byte %zu", first);
+  }
+  printf(", %d events OK.\n", n);
+  if (verbose) {
+    print_events(events, n);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(transactions) / sizeof(transactions[0]); i++) {
+    failed += model(&transactions[i], verbose) < 0;
+  }
+  if (failed) {
+    printf("[ERROR] %d transaction(s) malformed.\n", failed);
+    return 1;
+  }
+  return 0;
+}
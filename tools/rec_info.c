@@ -0,0 +1,110 @@
+/*
+ * rec_info.c
+ *
+ * @brief Summarises a recording (see recording.h) and looks frames up in
+ * it:
+ *
+ *   rec_info [-c] [-f frame] [-t seconds] <recording.tcr>
+ *
+ * -c checks every chunk's CRC, -f prints frame n, -t the first frame at or
+ * after that many seconds from the start.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "recording.h"
+
+#define REC_INFO_WORDS_SHOWN 8
+
+static void print_frame(const recording_reader_t *r, uint64_t n) {
+  const recording_frame_t *f = recording_frame(r, n);
+  if (!f) {
+    printf("[ERROR] no frame %llu, the recording has %llu.\n", (unsigned long long)n, (unsigned long long)r->n_frames);
+    return;
+  }
+  uint64_t t0 = recording_frame(r, 0)->time_us;
+  printf("[INFO] frame %llu: seq %lu, sensor %u, subpage %u, at %.6fs, ctrl 0x%04x.\n", (unsigned long long)n,
+    (unsigned long)f->seq, f->sensor, f->subpage, (f->time_us - t0) / 1e6, f->words[832]);
+  printf("[INFO] words:");
+  for (int i = 0; i < REC_INFO_WORDS_SHOWN; i++) {
+    printf(" %u", f->words[i]);
+  }
+  printf(" ...\n");
+}
+
+int main(int argc, char **argv) {
+  int check = 0;
+  long long frame = -1;
+  double seconds = -1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "cf:t:")) != -1) {
+    switch (opt) {
+      case 'c': check = 1; break;
+      case 'f': frame = atoll(optarg); break;
+      case 't': seconds = atof(optarg); break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-c] [-f frame] [-t seconds] <recording.tcr>\n", argv[0]);
+    return 2;
+  }
+
+  recording_reader_t r;
+  if (!recording_open(&r, argv[optind])) {
+    return 1;
+  }
+
+  printf("[INFO] %llu frames in %u chunks of %u, %s.\n", (unsigned long long)r.n_frames, r.n_chunks,
+    r.header->frames_per_chunk, r.complete ? "indexed" : "index rebuilt");
+  for (uint8_t k = 0; k < RECORDING_MAX_SENSORS; k++) {
+    if (recording_eeprom(&r, k)) {
+      printf("[INFO] sensor %u: EEPROM present.\n", k);
+    }
+  }
+
+  int status = 0;
+  if (r.n_frames > 0) {
+    // counting per sensor touches every frame, the lookups below don't
+    uint64_t per_sensor[256] = { 0 };
+    for (uint64_t n = 0; n < r.n_frames; n++) {
+      per_sensor[recording_frame(&r, n)->sensor]++;
+    }
+    double duration = (recording_frame(&r, r.n_frames - 1)->time_us - recording_frame(&r, 0)->time_us) / 1e6;
+    printf("[INFO] %.2fs of camera time.\n", duration);
+    for (int k = 0; k < 256; k++) {
+      if (per_sensor[k]) {
+        printf("[INFO] sensor %d: %llu frames, %.2f frames/s.\n", k, (unsigned long long)per_sensor[k],
+          duration > 0 ? per_sensor[k] / duration : 0.0);
+      }
+    }
+  }
+
+  if (check) {
+    uint32_t bad = 0;
+    for (uint32_t k = 0; k < r.n_chunks; k++) {
+      if (!recording_check_chunk(&r, k)) {
+        printf("[ERROR] chunk %u: CRC doesn't match.\n", k);
+        bad++;
+      }
+    }
+    printf("[INFO] %u of %u chunks check out.\n", r.n_chunks - bad, r.n_chunks);
+    status = bad ? 1 : 0;
+  }
+  if (frame >= 0) {
+    print_frame(&r, (uint64_t)frame);
+  }
+  if (seconds >= 0 && r.n_frames > 0) {
+    uint64_t t = recording_frame(&r, 0)->time_us + (uint64_t)(seconds * 1e6);
+    uint64_t n = recording_find_time(&r, t);
+    print_frame(&r, n < r.n_frames ? n : r.n_frames - 1);
+  }
+
+  recording_close_reader(&r);
+  return status;
+}
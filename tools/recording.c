@@ -0,0 +1,343 @@
+/*
+ * recording.c
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "recording.h"
+#include "stream_proto.h"
+
+_Static_assert(sizeof(recording_header_t) == 64, "recording_header_t layout");
+_Static_assert(sizeof(recording_chunk_t) == 32, "recording_chunk_t layout");
+_Static_assert(sizeof(recording_frame_t) % 8 == 0, "recording_frame_t layout");
+_Static_assert(sizeof(recording_index_t) == 32, "recording_index_t layout");
+_Static_assert(sizeof(recording_footer_t) == 32, "recording_footer_t layout");
+_Static_assert(sizeof(recording_header_t) + RECORDING_MAX_SENSORS * RECORDING_EEPROM_WORDS * 2 <= RECORDING_HEADER_SIZE,
+  "EEPROM slots fit the header");
+
+static size_t recording_eeprom_offset(uint8_t sensor) {
+  return sizeof(recording_header_t) + (size_t)sensor * RECORDING_EEPROM_WORDS * sizeof(uint16_t);
+}
+
+static bool recording_pwrite(recording_writer_t *w, const void *buf, size_t n, uint64_t offset) {
+  const uint8_t *p = buf;
+  while (n > 0) {
+    ssize_t k = pwrite(w->fd, p, n, (off_t)offset);
+    if (k < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "[ERROR] recording: write failed: %s\n", strerror(errno));
+      return false;
+    }
+    p += k;
+    n -= (size_t)k;
+    offset += (uint64_t)k;
+  }
+  return true;
+}
+
+static uint64_t recording_chunk_offset(const recording_header_t *h, uint32_t k) {
+  return h->header_size + (uint64_t)k * h->chunk_size;
+}
+
+bool recording_create(recording_writer_t *w, const char *path) {
+  memset(w, 0, sizeof(*w));
+  w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (w->fd < 0) {
+    fprintf(stderr, "[ERROR] recording: can't create %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  recording_header_t *h = &w->header;
+  memcpy(h->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+  h->version = RECORDING_VERSION;
+  h->header_size = RECORDING_HEADER_SIZE;
+  h->frames_per_chunk = RECORDING_FRAMES_PER_CHUNK;
+  h->frame_size = sizeof(recording_frame_t);
+  h->chunk_size = sizeof(recording_chunk_t) + h->frames_per_chunk * h->frame_size;
+  h->frame_words = RECORDING_FRAME_WORDS;
+  h->eeprom_words = RECORDING_EEPROM_WORDS;
+  h->created = (uint64_t)time(NULL);
+
+  w->frames = calloc(h->frames_per_chunk, sizeof(recording_frame_t));
+  w->index_cap = 64;
+  w->index = malloc(w->index_cap * sizeof(recording_index_t));
+  if (!w->frames || !w->index) {
+    fprintf(stderr, "[ERROR] recording: out of memory.\n");
+    return false;
+  }
+  // the whole header area, so the first chunk lands where it should even
+  // if no EEPROM ever comes
+  static const uint8_t zeros[RECORDING_HEADER_SIZE];
+  return recording_pwrite(w, zeros, sizeof(zeros), 0) && recording_pwrite(w, h, sizeof(*h), 0);
+}
+
+bool recording_set_eeprom(recording_writer_t *w, uint8_t sensor, const uint16_t *ee_data) {
+  if (sensor >= RECORDING_MAX_SENSORS) {
+    return false;
+  }
+  if (!recording_pwrite(w, ee_data, RECORDING_EEPROM_WORDS * sizeof(uint16_t), recording_eeprom_offset(sensor))) {
+    return false;
+  }
+  w->header.eeprom_mask |= 1u << sensor;
+  return recording_pwrite(w, &w->header, sizeof(w->header), 0);
+}
+
+/*
+ * recording_flush_chunk
+ *
+ * @brief Write the chunk in progress, all its slots, and index it.
+ */
+static bool recording_flush_chunk(recording_writer_t *w) {
+  recording_chunk_t *c = &w->chunk;
+  if (c->n_frames == 0) {
+    return true;
+  }
+  const recording_header_t *h = &w->header;
+  c->magic = RECORDING_CHUNK_MAGIC;
+  c->index = w->n_chunks;
+  c->first_time_us = w->frames[0].time_us;
+  c->crc = stream_proto_crc32(0, w->frames, c->n_frames * sizeof(recording_frame_t));
+  uint64_t offset = recording_chunk_offset(h, w->n_chunks);
+  if (!recording_pwrite(w, c, sizeof(*c), offset) ||
+      !recording_pwrite(w, w->frames, h->frames_per_chunk * sizeof(recording_frame_t), offset + sizeof(*c))) {
+    return false;
+  }
+
+  if (w->n_chunks == w->index_cap) {
+    recording_index_t *grown = realloc(w->index, 2 * w->index_cap * sizeof(recording_index_t));
+    if (!grown) {
+      fprintf(stderr, "[ERROR] recording: out of memory.\n");
+      return false;
+    }
+    w->index = grown;
+    w->index_cap *= 2;
+  }
+  recording_index_t *e = &w->index[w->n_chunks++];
+  e->offset = offset;
+  e->first_frame = c->first_frame;
+  e->n_frames = c->n_frames;
+  e->first_time_us = c->first_time_us;
+  e->last_time_us = w->frames[c->n_frames - 1].time_us;
+
+  c->first_frame += c->n_frames;
+  c->n_frames = 0;
+  memset(w->frames, 0, h->frames_per_chunk * sizeof(recording_frame_t));
+  return true;
+}
+
+bool recording_append(recording_writer_t *w, uint64_t time_us, uint32_t seq, uint8_t sensor, uint8_t subpage,
+  const uint16_t *words) {
+  recording_frame_t *f = &w->frames[w->chunk.n_frames++];
+  f->time_us = time_us;
+  f->seq = seq;
+  f->sensor = sensor;
+  f->subpage = subpage;
+  memcpy(f->words, words, sizeof(f->words));
+  w->n_frames++;
+  if (w->chunk.n_frames == w->header.frames_per_chunk) {
+    return recording_flush_chunk(w);
+  }
+  return true;
+}
+
+bool recording_close(recording_writer_t *w) {
+  bool ok = recording_flush_chunk(w);
+  if (ok) {
+    recording_footer_t f;
+    memset(&f, 0, sizeof(f));
+    memcpy(f.magic, RECORDING_FOOTER_MAGIC, sizeof(RECORDING_FOOTER_MAGIC));
+    f.index_offset = recording_chunk_offset(&w->header, w->n_chunks);
+    f.n_frames = w->n_frames;
+    f.n_chunks = w->n_chunks;
+    f.crc = stream_proto_crc32(0, w->index, w->n_chunks * sizeof(recording_index_t));
+    size_t index_bytes = w->n_chunks * sizeof(recording_index_t);
+    ok = recording_pwrite(w, w->index, index_bytes, f.index_offset) &&
+      recording_pwrite(w, &f, sizeof(f), f.index_offset + index_bytes);
+  }
+  if (close(w->fd) != 0) {
+    ok = false;
+  }
+  free(w->frames);
+  free(w->index);
+  w->fd = -1;
+  return ok;
+}
+
+/*
+ * recording_use_footer
+ *
+ * @brief Take the index the footer points at, if the footer is there and
+ * it all adds up.
+ */
+static bool recording_use_footer(recording_reader_t *r) {
+  const recording_header_t *h = r->header;
+  if (r->size < h->header_size + sizeof(recording_footer_t)) {
+    return false;
+  }
+  const recording_footer_t *f = (const recording_footer_t *)(r->base + r->size - sizeof(recording_footer_t));
+  if (memcmp(f->magic, RECORDING_FOOTER_MAGIC, sizeof(RECORDING_FOOTER_MAGIC)) != 0) {
+    return false;
+  }
+  size_t index_bytes = (size_t)f->n_chunks * sizeof(recording_index_t);
+  if (f->index_offset != recording_chunk_offset(h, f->n_chunks) ||
+      f->index_offset + index_bytes + sizeof(*f) != r->size) {
+    return false;
+  }
+  const recording_index_t *index = (const recording_index_t *)(r->base + f->index_offset);
+  if (stream_proto_crc32(0, index, index_bytes) != f->crc) {
+    return false;
+  }
+  r->index = index;
+  r->n_chunks = f->n_chunks;
+  r->n_frames = f->n_frames;
+  return true;
+}
+
+/*
+ * recording_rebuild_index
+ *
+ * @brief For a recording that was never closed: walk the chunks from the
+ * start for as long as they are whole, in order and match their CRC.
+ */
+static bool recording_rebuild_index(recording_reader_t *r) {
+  const recording_header_t *h = r->header;
+  // a header that claims to be longer than the file holds no chunks
+  uint32_t cap = r->size > h->header_size ? (uint32_t)((r->size - h->header_size) / h->chunk_size) : 0;
+  r->rebuilt = calloc(cap ? cap : 1, sizeof(recording_index_t));
+  if (!r->rebuilt) {
+    return false;
+  }
+  uint32_t k = 0;
+  uint64_t n_frames = 0;
+  while (k < cap) {
+    uint64_t offset = recording_chunk_offset(h, k);
+    const recording_chunk_t *c = (const recording_chunk_t *)(r->base + offset);
+    if (c->magic != RECORDING_CHUNK_MAGIC || c->index != k || c->first_frame != n_frames || c->n_frames == 0 ||
+        c->n_frames > h->frames_per_chunk) {
+      break;
+    }
+    const recording_frame_t *frames = (const recording_frame_t *)(c + 1);
+    // a chunk cut off while it was being written can look fine up to here
+    if (stream_proto_crc32(0, frames, c->n_frames * sizeof(recording_frame_t)) != c->crc) {
+      break;
+    }
+    recording_index_t *e = &r->rebuilt[k++];
+    e->offset = offset;
+    e->first_frame = c->first_frame;
+    e->n_frames = c->n_frames;
+    e->first_time_us = c->first_time_us;
+    e->last_time_us = frames[c->n_frames - 1].time_us;
+    n_frames += c->n_frames;
+    if (c->n_frames < h->frames_per_chunk) {
+      // only the last chunk isn't full
+      break;
+    }
+  }
+  r->index = r->rebuilt;
+  r->n_chunks = k;
+  r->n_frames = n_frames;
+  return true;
+}
+
+bool recording_open(recording_reader_t *r, const char *path) {
+  memset(r, 0, sizeof(*r));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "[ERROR] recording: can't open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < RECORDING_HEADER_SIZE) {
+    fprintf(stderr, "[ERROR] recording: %s is too short.\n", path);
+    close(fd);
+    return false;
+  }
+  r->size = (size_t)st.st_size;
+  void *base = mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "[ERROR] recording: can't map %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  r->base = base;
+  r->header = (const recording_header_t *)r->base;
+
+  const recording_header_t *h = r->header;
+  if (memcmp(h->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 || h->version != RECORDING_VERSION ||
+      h->frame_size != sizeof(recording_frame_t) || h->frame_words != RECORDING_FRAME_WORDS ||
+      h->eeprom_words != RECORDING_EEPROM_WORDS || h->header_size < RECORDING_HEADER_SIZE ||
+      h->frames_per_chunk == 0 ||
+      h->chunk_size != sizeof(recording_chunk_t) + (uint64_t)h->frames_per_chunk * h->frame_size) {
+    fprintf(stderr, "[ERROR] recording: %s isn't a version %d recording.\n", path, RECORDING_VERSION);
+    recording_close_reader(r);
+    return false;
+  }
+  r->complete = recording_use_footer(r);
+  if (!r->complete && !recording_rebuild_index(r)) {
+    fprintf(stderr, "[ERROR] recording: out of memory.\n");
+    recording_close_reader(r);
+    return false;
+  }
+  if (!r->complete) {
+    fprintf(stderr, "[INFO] recording: %s wasn't closed, found %u whole chunks.\n", path, r->n_chunks);
+  }
+  return true;
+}
+
+const recording_frame_t *recording_frame(const recording_reader_t *r, uint64_t n) {
+  uint32_t fpc = r->header->frames_per_chunk;
+  uint64_t k = n / fpc;
+  uint32_t slot = (uint32_t)(n % fpc);
+  if (k >= r->n_chunks || slot >= r->index[k].n_frames) {
+    return NULL;
+  }
+  const uint8_t *chunk = r->base + r->index[k].offset;
+  return (const recording_frame_t *)(chunk + sizeof(recording_chunk_t) + (size_t)slot * r->header->frame_size);
+}
+
+uint64_t recording_find_time(const recording_reader_t *r, uint64_t time_us) {
+  uint64_t lo = 0, hi = r->n_frames;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (recording_frame(r, mid)->time_us < time_us) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+const uint16_t *recording_eeprom(const recording_reader_t *r, uint8_t sensor) {
+  if (sensor >= RECORDING_MAX_SENSORS || !(r->header->eeprom_mask & (1u << sensor))) {
+    return NULL;
+  }
+  return (const uint16_t *)(r->base + recording_eeprom_offset(sensor));
+}
+
+bool recording_check_chunk(const recording_reader_t *r, uint32_t k) {
+  if (k >= r->n_chunks) {
+    return false;
+  }
+  const recording_chunk_t *c = (const recording_chunk_t *)(r->base + r->index[k].offset);
+  return c->magic == RECORDING_CHUNK_MAGIC && c->n_frames == r->index[k].n_frames &&
+    stream_proto_crc32(0, c + 1, c->n_frames * sizeof(recording_frame_t)) == c->crc;
+}
+
+void recording_close_reader(recording_reader_t *r) {
+  if (r->base) {
+    munmap((void *)r->base, r->size);
+  }
+  free(r->rebuilt);
+  memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,205 @@
+/*
+ * recording.h
+ *
+ * @brief Recordings of raw MLX90640 frames (.tcr), written by stream_recv
+ * and read by rec_info and the reprocessing tools. Raw frames rather than
+ * To, so a recording can be calculated again later with another emissivity
+ * or reflected temperature.
+ *
+ * | offset                 | size          | what                          |
+ * |------------------------|---------------|-------------------------------|
+ * | 0                      | 64            | recording_header_t            |
+ * | 64 + k * 1664          | 1664          | sensor k's EEPROM dump        |
+ * | header_size            | chunk_size    | chunk 0                       |
+ * | ...                    |               |                               |
+ * | index_offset           | n * 32        | recording_index_t per chunk   |
+ * | file size - 32         | 32            | recording_footer_t            |
+ *
+ * A chunk is a recording_chunk_t then frames_per_chunk fixed-size
+ * recording_frame_t slots, and only the last chunk may have fewer frames
+ * in it, so frame n is in chunk n / frames_per_chunk, at slot
+ * n % frames_per_chunk: found without reading anything but the index.
+ * Chunks are written whole as they fill, so a recording cut short (the
+ * tool killed, the cable pulled) loses the index and the chunk in
+ * progress but nothing before it; the reader rebuilds the index by walking
+ * the chunks when the footer isn't there.
+ *
+ * Everything is little-endian and written as the structs are laid out,
+ * which the hosts these tools run on all are.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _RECORDING_H
+#define _RECORDING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECORDING_VERSION 1
+#define RECORDING_FRAME_WORDS 834
+#define RECORDING_EEPROM_WORDS 832
+#define RECORDING_MAX_SENSORS 4
+// EEPROM slots and all, rounded up to a page so chunks map page-aligned
+#define RECORDING_HEADER_SIZE 8192
+#define RECORDING_FRAMES_PER_CHUNK 64
+
+#define RECORDING_MAGIC "TCAMREC"
+#define RECORDING_CHUNK_MAGIC 0x4B484354u   // "TCHK"
+#define RECORDING_FOOTER_MAGIC "TCAMIDX"
+
+typedef struct {
+  char magic[8];              // RECORDING_MAGIC
+  uint32_t version;
+  uint32_t header_size;       // where chunk 0 starts
+  uint32_t frames_per_chunk;
+  uint32_t chunk_size;        // bytes, header and all the slots
+  uint32_t frame_size;        // bytes, sizeof(recording_frame_t)
+  uint32_t frame_words;       // RECORDING_FRAME_WORDS
+  uint32_t eeprom_words;      // RECORDING_EEPROM_WORDS
+  uint32_t eeprom_mask;       // which sensors' EEPROM slots are filled
+  uint64_t created;           // Unix time, seconds
+  uint8_t reserved[16];
+} recording_header_t;
+
+typedef struct {
+  uint32_t magic;             // RECORDING_CHUNK_MAGIC
+  uint32_t index;             // of the chunk
+  uint32_t first_frame;       // number of its first frame
+  uint32_t n_frames;          // slots used
+  uint64_t first_time_us;
+  uint32_t crc;               // CRC-32 of the n_frames used slots
+  uint32_t reserved;
+} recording_chunk_t;
+
+typedef struct {
+  uint64_t time_us;           // camera clock, unwrapped to 64 bits
+  uint32_t seq;               // stream sequence number
+  uint8_t sensor;
+  uint8_t subpage;
+  uint16_t reserved;
+  uint16_t words[RECORDING_FRAME_WORDS];  // as MLX90640_GetFrameData read them
+  uint16_t pad[2];            // to a multiple of 8 bytes
+} recording_frame_t;
+
+typedef struct {
+  uint64_t offset;            // of the chunk in the file
+  uint32_t first_frame;
+  uint32_t n_frames;
+  uint64_t first_time_us;
+  uint64_t last_time_us;
+} recording_index_t;
+
+typedef struct {
+  char magic[8];              // RECORDING_FOOTER_MAGIC
+  uint64_t index_offset;
+  uint64_t n_frames;
+  uint32_t n_chunks;
+  uint32_t crc;               // CRC-32 of the index
+} recording_footer_t;
+
+/*
+ * @brief A recording being written. Frames collect in a chunk in memory,
+ * which goes to the file when full.
+ */
+typedef struct {
+  int fd;
+  recording_header_t header;
+  recording_chunk_t chunk;
+  recording_frame_t *frames;  // frames_per_chunk of them
+  recording_index_t *index;
+  uint32_t n_chunks;
+  uint32_t index_cap;
+  uint64_t n_frames;
+} recording_writer_t;
+
+/*
+ * @brief A recording mapped for reading.
+ */
+typedef struct {
+  const uint8_t *base;
+  size_t size;
+  const recording_header_t *header;
+  const recording_index_t *index;
+  recording_index_t *rebuilt;  // the index, when it had to be rebuilt
+  uint32_t n_chunks;
+  uint64_t n_frames;
+  bool complete;               // had its footer
+} recording_reader_t;
+
+/*
+ * recording_create
+ *
+ * @brief Start a new recording at path, replacing what is there. Returns
+ * false, having printed why, if it can't.
+ */
+bool recording_create(recording_writer_t *w, const char *path);
+/*
+ * recording_set_eeprom
+ *
+ * @brief Store a sensor's EEPROM dump. The last one a sensor was given is
+ * what the recording keeps.
+ */
+bool recording_set_eeprom(recording_writer_t *w, uint8_t sensor, const uint16_t *ee_data);
+/*
+ * recording_append
+ *
+ * @brief Add a frame; time_us is the camera's, unwrapped by the caller.
+ */
+bool recording_append(recording_writer_t *w, uint64_t time_us, uint32_t seq, uint8_t sensor, uint8_t subpage,
+  const uint16_t *words);
+/*
+ * recording_close
+ *
+ * @brief Write the chunk in progress, the index and the footer, and close.
+ */
+bool recording_close(recording_writer_t *w);
+
+/*
+ * recording_open
+ *
+ * @brief Map the recording at path. Returns false, having printed why, if
+ * it isn't one.
+ */
+bool recording_open(recording_reader_t *r, const char *path);
+/*
+ * recording_frame
+ *
+ * @brief Frame n, or NULL past the end. Points into the mapping.
+ */
+const recording_frame_t *recording_frame(const recording_reader_t *r, uint64_t n);
+/*
+ * recording_find_time
+ *
+ * @brief The number of the first frame at or after time_us (n_frames if
+ * there is none), by binary search.
+ */
+uint64_t recording_find_time(const recording_reader_t *r, uint64_t time_us);
+/*
+ * recording_eeprom
+ *
+ * @brief A sensor's EEPROM dump, or NULL if the recording hasn't one.
+ */
+const uint16_t *recording_eeprom(const recording_reader_t *r, uint8_t sensor);
+/*
+ * recording_check_chunk
+ *
+ * @brief Whether chunk k's frames match its CRC.
+ */
+bool recording_check_chunk(const recording_reader_t *r, uint32_t k);
+/*
+ * recording_close_reader
+ */
+void recording_close_reader(recording_reader_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,506 @@
+/*
+ * reprocess.cpp
+ *
+ * @brief Calculates To for every frame of a recording (see recording.h),
+ * with whatever emissivity and reflected temperature the analysis wants
+ * rather than what the camera used, on all the host's cores:
+ *
+ *   reprocess [-e emissivity] [-t tr] [-b] [-s sensor] [-j threads]
+ *             [-k frames] [-f bin|csv|pgm] [-o out] <recording.tcr>
+ *
+ * -e is the emissivity (0.95, as the camera), -t the reflected temperature
+ * in degrees C (by default Ta - 8 for each frame, as the camera), -b
+ * corrects the pixels the EEPROM marks broken or outliers, -s only takes
+ * that sensor's frames. Every frame gives a whole image: the subpage it
+ * measured and the other one as it last was. Output, one image per frame
+ * in recording order:
+ *  - bin: 768 little-endian floats, degrees C, NaN where nothing has been
+ *    measured yet;
+ *  - csv: seq, time_us, sensor, subpage, then the 768 values;
+ *  - pgm: a 16-bit binary PGM (P5) per image, one after the other in the
+ *    file, in hundredths of a kelvin.
+ * With no -o the frames are only calculated, which times it.
+ *
+ * The recording is cut into tasks of -k frames, each worked through in
+ * order by one thread; a task starts by calculating the last frame of each
+ * subpage before it, so the images come out exactly as they would one
+ * frame at a time, whatever thread did what. bin and pgm images are a
+ * fixed size and written straight to their place in the file, csv lines
+ * are written in order as tasks finish.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "recording.h"
+
+extern "C" {
+#include "mlx90640/MLX90640_API.h"
+}
+
+namespace {
+
+constexpr int kPixels = 768;
+constexpr int kLineSize = 32;
+constexpr int kColumnSize = 24;
+constexpr int kCtrl = 832;
+constexpr uint16_t kCtrlChess = 0x1000;
+// the camera's reflected temperature, see sensor_calculate
+constexpr float kTaShift = 8.0f;
+constexpr char kPgmHeader[] = "P5\n32 24\n65535\n";
+constexpr size_t kPgmSize = sizeof(kPgmHeader) - 1 + kPixels * 2;
+
+enum class Format { kNone, kBin, kCsv, kPgm };
+
+struct Options {
+  float emissivity = 0.95f;
+  bool fixed_tr = false;
+  float tr = 0;
+  bool bad_pixels = false;
+  int sensor = -1;
+  unsigned threads = 0;
+  uint64_t task_frames = 256;
+  Format format = Format::kBin;
+  std::string out_path;
+};
+
+struct Calibration {
+  bool ok = false;
+  paramsMLX90640 params;
+};
+
+/*
+ * StealingPool
+ *
+ * @brief Runs tasks 0 to n - 1 on a set of threads. Tasks are dealt out
+ * round-robin, so they finish roughly in order; a thread works through its
+ * own from the lowest and, once out, takes the lowest another thread still
+ * has. Taking the lowest rather than the highest keeps the in-order csv
+ * writer from holding on to the later ones.
+ */
+class StealingPool {
+ public:
+  using Fn = std::function<void(uint64_t task, unsigned worker)>;
+
+  void start(unsigned threads, uint64_t n_tasks, Fn fn) {
+    fn_ = std::move(fn);
+    queues_ = std::vector<Queue>(threads);
+    for (uint64_t t = 0; t < n_tasks; t++) {
+      queues_[t % threads].tasks.push_back(t);
+    }
+    for (unsigned w = 0; w < threads; w++) {
+      threads_.emplace_back([this, w] { work(w); });
+    }
+  }
+
+  void wait() {
+    for (auto &t : threads_) {
+      t.join();
+    }
+    threads_.clear();
+  }
+
+  uint64_t done(unsigned w) const { return queues_[w].done; }
+  uint64_t stolen(unsigned w) const { return queues_[w].stolen; }
+
+ private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<uint64_t> tasks;
+    uint64_t done = 0;
+    uint64_t stolen = 0;  // by this worker, from others
+  };
+
+  bool take(unsigned w, uint64_t *task) {
+    Queue &q = queues_[w];
+    std::lock_guard<std::mutex> g(q.lock);
+    if (q.tasks.empty()) {
+      return false;
+    }
+    *task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+  }
+
+  void work(unsigned w) {
+    unsigned n = (unsigned)queues_.size();
+    uint64_t task;
+    for (;;) {
+      if (take(w, &task)) {
+        fn_(task, w);
+        queues_[w].done++;
+        continue;
+      }
+      // nothing is ever added, so once every queue is empty we're done
+      bool found = false;
+      for (unsigned i = 1; i < n && !found; i++) {
+        found = take((w + i) % n, &task);
+      }
+      if (!found) {
+        return;
+      }
+      queues_[w].stolen++;
+      fn_(task, w);
+      queues_[w].done++;
+    }
+  }
+
+  Fn fn_;
+  std::vector<Queue> queues_;
+  std::vector<std::thread> threads_;
+};
+
+class Reprocessor {
+ public:
+  Reprocessor(const recording_reader_t &rec, const Options &opt) : rec_(rec), opt_(opt) {
+    std::fill(&first_[0][0], &first_[0][0] + RECORDING_MAX_SENSORS * 2, UINT64_MAX);
+  }
+
+  bool prepare() {
+    for (uint8_t k = 0; k < RECORDING_MAX_SENSORS; k++) {
+      const uint16_t *ee = recording_eeprom(&rec_, k);
+      if (!ee) {
+        continue;
+      }
+      // ExtractParameters wants to be able to write to it
+      std::vector<uint16_t> ee_data(ee, ee + RECORDING_EEPROM_WORDS);
+      int err = MLX90640_ExtractParameters(ee_data.data(), &cal_[k].params);
+      if (err != 0) {
+        std::fprintf(stderr, "[ERROR] sensor %u: ExtractParameters returned %d.\n", k, err);
+        continue;
+      }
+      cal_[k].ok = true;
+    }
+    for (uint64_t n = 0; n < rec_.n_frames; n++) {
+      const recording_frame_t *f = recording_frame(&rec_, n);
+      if (f->sensor < RECORDING_MAX_SENSORS && f->subpage <= 1 && first_[f->sensor][f->subpage] > n) {
+        first_[f->sensor][f->subpage] = n;
+      }
+    }
+    if (opt_.sensor >= 0) {
+      if (opt_.sensor >= RECORDING_MAX_SENSORS || !cal_[opt_.sensor].ok) {
+        std::fprintf(stderr, "[ERROR] no calibration for sensor %d.\n", opt_.sensor);
+        return false;
+      }
+      for (uint64_t n = 0; n < rec_.n_frames; n++) {
+        if (recording_frame(&rec_, n)->sensor == opt_.sensor) {
+          selected_.push_back(n);
+        }
+      }
+    }
+    n_out_ = opt_.sensor >= 0 ? selected_.size() : rec_.n_frames;
+    return true;
+  }
+
+  uint64_t n_out() const { return n_out_; }
+  uint64_t uncalibrated() const { return uncalibrated_; }
+  // whether a write failed, after which the remaining tasks do nothing
+  bool failed() const { return failed_; }
+  void fail() { failed_ = true; }
+
+  /*
+   * run
+   *
+   * @brief Calculate output frames first to last - 1 into out_fd (bin and
+   * pgm) or csv.
+   */
+  void run(uint64_t first, uint64_t last, int out_fd, std::string *csv) {
+    if (failed_) {
+      return;
+    }
+    std::vector<float> images(RECORDING_MAX_SENSORS * kPixels, NAN);
+    seed(frame_number(first), images.data());
+    std::vector<uint8_t> pgm(kPgmSize);
+    const std::vector<float> none(kPixels, NAN);
+    for (uint64_t i = first; i < last; i++) {
+      const recording_frame_t *f = recording_frame(&rec_, frame_number(i));
+      const float *image = none.data();
+      if (wanted(f)) {
+        calculate(f, &images[f->sensor * kPixels]);
+        image = &images[f->sensor * kPixels];
+      } else {
+        uncalibrated_++;
+      }
+      switch (opt_.format) {
+        case Format::kBin:
+          if (!write_at(out_fd, image, kPixels * sizeof(float), i * kPixels * sizeof(float))) {
+            return;
+          }
+          break;
+        case Format::kPgm:
+          to_pgm(image, pgm.data());
+          if (!write_at(out_fd, pgm.data(), kPgmSize, i * kPgmSize)) {
+            return;
+          }
+          break;
+        case Format::kCsv:
+          to_csv(f, image, csv);
+          break;
+        case Format::kNone:
+          break;
+      }
+    }
+  }
+
+ private:
+  uint64_t frame_number(uint64_t i) const { return opt_.sensor >= 0 ? selected_[i] : i; }
+
+  bool wanted(const recording_frame_t *f) const {
+    return f->sensor < RECORDING_MAX_SENSORS && cal_[f->sensor].ok && (opt_.sensor < 0 || f->sensor == opt_.sensor);
+  }
+
+  /*
+   * seed
+   *
+   * @brief Calculate the last frame of each subpage of each sensor before
+   * frame n, oldest first, so the task's first images have both halves.
+   * However far back that is: stopping short would leave a half the
+   * sequential run has, and the output would depend on the task size.
+   */
+  void seed(uint64_t n, float *images) {
+    std::vector<uint64_t> found;
+    bool have[RECORDING_MAX_SENSORS][2] = {};
+    int needed = 0;
+    for (int k = 0; k < RECORDING_MAX_SENSORS; k++) {
+      for (int sp = 0; sp < 2; sp++) {
+        // only the subpages the recording has before n can be found
+        if (cal_[k].ok && (opt_.sensor < 0 || k == opt_.sensor) && first_[k][sp] < n) {
+          needed++;
+        }
+      }
+    }
+    for (uint64_t m = n; m > 0 && needed > 0; m--) {
+      const recording_frame_t *f = recording_frame(&rec_, m - 1);
+      if (!wanted(f) || f->subpage > 1 || have[f->sensor][f->subpage]) {
+        continue;
+      }
+      have[f->sensor][f->subpage] = true;
+      found.push_back(m - 1);
+      needed--;
+    }
+    for (auto it = found.rbegin(); it != found.rend(); ++it) {
+      const recording_frame_t *f = recording_frame(&rec_, *it);
+      calculate(f, &images[f->sensor * kPixels]);
+    }
+  }
+
+  void calculate(const recording_frame_t *f, float *image) {
+    const Calibration &c = cal_[f->sensor];
+    // the mapping is read-only and the API takes it non-const
+    uint16_t words[RECORDING_FRAME_WORDS];
+    std::memcpy(words, f->words, sizeof(words));
+    float tr = opt_.fixed_tr ? opt_.tr : MLX90640_GetTa(words, &c.params) - kTaShift;
+    MLX90640_CalculateTo(words, &c.params, opt_.emissivity, tr, image);
+    if (opt_.bad_pixels) {
+      int mode = (words[kCtrl] & kCtrlChess) ? 1 : 0;
+      // only reads the params and the pixel lists
+      paramsMLX90640 *p = const_cast<paramsMLX90640 *>(&c.params);
+      MLX90640_BadPixelsCorrection(p->brokenPixels, image, mode, p);
+      MLX90640_BadPixelsCorrection(p->outlierPixels, image, mode, p);
+    }
+  }
+
+  static void to_pgm(const float *image, uint8_t *out) {
+    std::memcpy(out, kPgmHeader, sizeof(kPgmHeader) - 1);
+    uint8_t *p = out + sizeof(kPgmHeader) - 1;
+    for (int i = 0; i < kLineSize * kColumnSize; i++) {
+      float ck = (image[i] + 273.15f) * 100.0f;
+      uint16_t v = std::isnan(ck) ? 0 : (uint16_t)std::clamp(ck + 0.5f, 0.0f, 65535.0f);
+      // big-endian, as PGM has it
+      *p++ = (uint8_t)(v >> 8);
+      *p++ = (uint8_t)v;
+    }
+  }
+
+  static void to_csv(const recording_frame_t *f, const float *image, std::string *csv) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%lu,%llu,%u,%u", (unsigned long)f->seq, (unsigned long long)f->time_us,
+      f->sensor, f->subpage);
+    *csv += buf;
+    for (int i = 0; i < kPixels; i++) {
+      std::snprintf(buf, sizeof(buf), ",%.2f", image[i]);
+      *csv += buf;
+    }
+    *csv += '\n';
+  }
+
+  /*
+   * write_at
+   *
+   * @brief pwrite all of buf. On failure, says why the first time and
+   * returns false; the main thread finds out from failed().
+   */
+  bool write_at(int fd, const void *buf, size_t n, uint64_t offset) {
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    while (n > 0) {
+      ssize_t k = pwrite(fd, p, n, (off_t)offset);
+      if (k < 0 && errno == EINTR) {
+        continue;
+      }
+      if (k < 0) {
+        if (!failed_.exchange(true)) {
+          std::fprintf(stderr, "[ERROR] write failed: %s\n", std::strerror(errno));
+        }
+        return false;
+      }
+      p += k;
+      n -= (size_t)k;
+      offset += (uint64_t)k;
+    }
+    return true;
+  }
+
+  const recording_reader_t &rec_;
+  const Options &opt_;
+  Calibration cal_[RECORDING_MAX_SENSORS];
+  std::vector<uint64_t> selected_;
+  // where each sensor's first frame of each subpage is, UINT64_MAX if none
+  uint64_t first_[RECORDING_MAX_SENSORS][2];
+  uint64_t n_out_ = 0;
+  std::atomic<uint64_t> uncalibrated_{0};
+  std::atomic<bool> failed_{false};
+};
+
+bool parse_format(const char *s, Format *f) {
+  if (std::strcmp(s, "bin") == 0) {
+    *f = Format::kBin;
+  } else if (std::strcmp(s, "csv") == 0) {
+    *f = Format::kCsv;
+  } else if (std::strcmp(s, "pgm") == 0) {
+    *f = Format::kPgm;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  bool usage = false;
+  int c;
+  while ((c = getopt(argc, argv, "e:t:bs:j:k:f:o:")) != -1) {
+    switch (c) {
+      case 'e': opt.emissivity = std::strtof(optarg, nullptr); break;
+      case 't': opt.fixed_tr = true; opt.tr = std::strtof(optarg, nullptr); break;
+      case 'b': opt.bad_pixels = true; break;
+      case 's': opt.sensor = std::atoi(optarg); break;
+      case 'j': opt.threads = (unsigned)std::atoi(optarg); break;
+      case 'k': opt.task_frames = std::strtoull(optarg, nullptr, 10); break;
+      case 'f': usage |= !parse_format(optarg, &opt.format); break;
+      case 'o': opt.out_path = optarg; break;
+      default: usage = true; break;
+    }
+  }
+  if (usage || optind != argc - 1 || opt.emissivity <= 0 || opt.emissivity > 1) {
+    std::fprintf(stderr,
+      "usage: %s [-e emissivity] [-t tr] [-b] [-s sensor] [-j threads] [-k frames] [-f bin|csv|pgm] [-o out] "
+      "<recording.tcr>\n", argv[0]);
+    return 2;
+  }
+  if (opt.threads == 0) {
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  opt.task_frames = std::max<uint64_t>(opt.task_frames, 1);
+  if (opt.out_path.empty()) {
+    opt.format = Format::kNone;
+  }
+
+  recording_reader_t rec;
+  if (!recording_open(&rec, argv[optind])) {
+    return 1;
+  }
+  Reprocessor rp(rec, opt);
+  if (!rp.prepare()) {
+    return 1;
+  }
+
+  int out_fd = -1;
+  if (!opt.out_path.empty()) {
+    out_fd = open(opt.out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+      std::fprintf(stderr, "[ERROR] can't write %s: %s\n", opt.out_path.c_str(), std::strerror(errno));
+      return 1;
+    }
+  }
+
+  uint64_t n_out = rp.n_out();
+  uint64_t n_tasks = (n_out + opt.task_frames - 1) / opt.task_frames;
+  std::vector<std::string> csv(opt.format == Format::kCsv ? n_tasks : 0);
+  std::vector<bool> finished(n_tasks);
+  std::mutex lock;
+  std::condition_variable cv;
+
+  auto t0 = std::chrono::steady_clock::now();
+  StealingPool pool;
+  pool.start(opt.threads, n_tasks, [&](uint64_t task, unsigned) {
+    uint64_t first = task * opt.task_frames;
+    uint64_t last = std::min(first + opt.task_frames, n_out);
+    rp.run(first, last, out_fd, csv.empty() ? nullptr : &csv[task]);
+    if (!csv.empty()) {
+      std::lock_guard<std::mutex> g(lock);
+      finished[task] = true;
+      cv.notify_one();
+    }
+  });
+  bool write_failed = false;
+  if (!csv.empty()) {
+    // in order, each task's lines as soon as the ones before are out
+    for (uint64_t t = 0; t < n_tasks && !write_failed; t++) {
+      std::string text;
+      {
+        std::unique_lock<std::mutex> g(lock);
+        cv.wait(g, [&] { return bool(finished[t]); });
+        text.swap(csv[t]);
+      }
+      if (write(out_fd, text.data(), text.size()) != (ssize_t)text.size()) {
+        std::fprintf(stderr, "[ERROR] write failed: %s\n", std::strerror(errno));
+        write_failed = true;
+        rp.fail();
+      }
+    }
+  }
+  // the workers finish whatever happened; a failed write stops them early
+  pool.wait();
+  if (write_failed || rp.failed()) {
+    close(out_fd);
+    recording_close_reader(&rec);
+    return 1;
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  if (out_fd >= 0 && close(out_fd) != 0) {
+    std::fprintf(stderr, "[ERROR] write failed: %s\n", std::strerror(errno));
+    return 1;
+  }
+  std::printf("[BENCH] %llu frames in %.3fs on %u threads, %.0f frames/s.\n", (unsigned long long)n_out, elapsed,
+    opt.threads, elapsed > 0 ? n_out / elapsed : 0.0);
+  for (unsigned w = 0; w < opt.threads; w++) {
+    std::printf("[BENCH] thread %u: %llu tasks, %llu stolen.\n", w, (unsigned long long)pool.done(w),
+      (unsigned long long)pool.stolen(w));
+  }
+  if (rp.uncalibrated() > 0) {
+    std::printf("[INFO] %llu frames from sensors with no calibration, written as NaN.\n",
+      (unsigned long long)rp.uncalibrated());
+  }
+  recording_close_reader(&rec);
+  return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * st7789_bench.c
+ *
+ * @brief Runs the display code (st7789.c, the frame buffer and the
+ * renderer, as built for the camera) against a virtual panel
+ * (st7789_model.h) on the simulated hardware (pico_host.h), drawing fake
+ * frames the way core1 does, and reports what each frame cost on the bus:
+ *
+ *   st7789_bench [-n frames] [-s sensors] [-v overlap] [-f 565|444] [-p]
+ *                [-r refresh_hz] [-S seed] [-m scene] [-c cpu_scale]
+ *                [-w out.ppm] [-P] [-g golden.ppm] [-u idle_us]
+ *
+ * -p paces flushes to the panel's V-blank. The scene is fake (moving
+ * frames from fake_frames.h, the default), one of the fixed frames
+ * gradient, flat, hot (one hot pixel), nan (a gradient with NaN and inf
+ * pixels in it) and dead (a gradient with the last sensor all NaN, as one
+ * that never came up), or loading, the start-up animation's ticks instead
+ * of frames. -w writes what the panel shows after the last frame, the way
+ * round the firmware draws it (-P for the panel's own 240x320), and -g
+ * compares it with a golden image, which has to match exactly. Bus time
+ * comes from the simulated clock, so a run gives the same numbers, and
+ * the same image, every time.
+ *
+ * -u runs an idle hook (st7789_set_idle) while flushes wait, costing
+ * idle_us each time, as core1 runs the USB stack, and reports how often it
+ * got to run.
+ *
+ * -c also puts the host CPU time drawing takes on the clock, times
+ * cpu_scale, to see what rendering costs next to flushing; the numbers
+ * then vary from run to run, and the FPS shown with them. st7789_bench is
+ * built with an RGB565 frame buffer, st7789_bench_indexed with the 8-bit
+ * indexed one.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "st7789.h"
+#include "st7789_framebuf.h"
+#include "sensor.h"
+#include "fake_frames.h"
+#include "pico_host.h"
+#include "st7789_model.h"
+
+typedef enum {
+  BENCH_FAKE,
+  BENCH_GRADIENT,
+  BENCH_FLAT,
+  BENCH_HOT,
+  BENCH_NAN,
+  BENCH_DEAD,
+  BENCH_LOADING,
+} bench_scene_t;
+
+#if ST7789_FRAMEBUF_INDEXED
+#define BENCH_FRAMEBUF "n indexed"
+#else
+#define BENCH_FRAMEBUF " RGB565"
+#endif
+
+static const char *const bench_scene_names[] = { "fake", "gradient", "flat", "hot", "nan", "dead", "loading" };
+
+/*
+ * @brief The idle hook's cost, how often it ran, and the longest it was kept
+ * waiting between runs (within a flush).
+ */
+static uint64_t bench_idle_ns = 0;
+static uint64_t bench_idle_last_ns = 0;
+static uint64_t bench_idle_gap_ns = 0;
+static uint32_t bench_idle_runs = 0;
+
+static void bench_idle(void) {
+  uint64_t now = pico_host_now_ns();
+  if (bench_idle_runs > 0 && now - bench_idle_last_ns > bench_idle_gap_ns) {
+    bench_idle_gap_ns = now - bench_idle_last_ns;
+  }
+  pico_host_advance_ns(bench_idle_ns);
+  bench_idle_last_ns = pico_host_now_ns();
+  bench_idle_runs++;
+}
+
+#define BENCH_FLAT_C 25.0f
+#define BENCH_HOT_C 60.0f
+
+/*
+ * bench_fixed_frame
+ *
+ * @brief Fill frame, n_sensors sensors' worth, with one of the fixed
+ * scenes: a gradient left to right and a little top to bottom across the
+ * whole panorama, the same temperature everywhere, or that with one hot
+ * pixel in the middle of the first sensor; or the gradient with a NaN, a
+ * +inf and a -inf in it, or with nothing from the last sensor.
+ */
+static void bench_fixed_frame(bench_scene_t scene, uint32_t n_sensors, float *frame) {
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    for (uint32_t i = 0; i < MLX90640_PIXEL_NUM; i++) {
+      uint32_t x = k * MLX90640_LINE_SIZE + i % MLX90640_LINE_SIZE;
+      uint32_t y = i / MLX90640_LINE_SIZE;
+      float t = BENCH_FLAT_C;
+      if (scene == BENCH_GRADIENT || scene == BENCH_NAN || scene == BENCH_DEAD) {
+        t = 15.0f + 20.0f * x / (n_sensors * MLX90640_LINE_SIZE - 1) + 0.25f * y;
+      }
+      frame[k * MLX90640_PIXEL_NUM + i] = t;
+    }
+  }
+  if (scene == BENCH_HOT) {
+    frame[MLX90640_PIXEL_NUM / 2 + MLX90640_LINE_SIZE / 2] = BENCH_HOT_C;
+  } else if (scene == BENCH_NAN) {
+    frame[0] = NAN;
+    frame[MLX90640_PIXEL_NUM / 2] = INFINITY;
+    frame[MLX90640_PIXEL_NUM - 1] = -INFINITY;
+  } else if (scene == BENCH_DEAD) {
+    for (uint32_t i = 0; i < MLX90640_PIXEL_NUM; i++) {
+      frame[(n_sensors - 1) * MLX90640_PIXEL_NUM + i] = NAN;
+    }
+  }
+}
+
+/*
+ * bench_compare
+ *
+ * @brief Compare what the panel shows with the PPM at path. Returns the
+ * number of pixels that differ, or -1 if it can't be read or is the wrong
+ * size.
+ */
+static long bench_compare(const st7789_model_t *m, st7789_model_view_t view, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    printf("[ERROR] can't open %s.\n", path);
+    return -1;
+  }
+  uint32_t w, h, gw, gh, maxval;
+  st7789_model_view_size(m, view, &w, &h);
+  if (fscanf(f, "P6 %u %u %u", &gw, &gh, &maxval) != 3 || fgetc(f) == EOF || maxval != 255) {
+    printf("[ERROR] %s isn't a binary PPM.\n", path);
+    fclose(f);
+    return -1;
+  }
+  if (gw != w || gh != h) {
+    printf("[ERROR] %s is %ux%u, the panel shows %ux%u.\n", path, gw, gh, w, h);
+    fclose(f);
+    return -1;
+  }
+  long differ = 0;
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint8_t rgb[3];
+      if (fread(rgb, 1, 3, f) != 3) {
+        printf("[ERROR] %s is short.\n", path);
+        fclose(f);
+        return -1;
+      }
+      uint32_t want = (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+      uint32_t got = st7789_model_pixel(m, view, x, y);
+      if (got != want && differ++ == 0) {
+        printf("[INFO] first difference at (%u, %u): %06x, golden %06x.\n", x, y, got, want);
+      }
+    }
+  }
+  fclose(f);
+  return differ;
+}
+
+int main(int argc, char **argv) {
+  uint32_t n = 8, n_sensors = 1, overlap = 0, refresh_hz = 0, seed = 1;
+  st7789_pixel_format_t format = ST7789_PIXEL_FORMAT_RGB565;
+  st7789_model_view_t view = ST7789_MODEL_VIEW_MADCTL;
+  bench_scene_t scene = BENCH_FAKE;
+  double cpu_scale = 0;
+  bool paced = false;
+  const char *out_path = NULL, *golden_path = NULL, *scene_name = bench_scene_names[BENCH_FAKE];
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:v:f:pr:S:m:c:w:Pg:u:")) != -1) {
+    switch (opt) {
+      case 'n': n = (uint32_t)atol(optarg); break;
+      case 's': n_sensors = (uint32_t)atol(optarg); break;
+      case 'v': overlap = (uint32_t)atol(optarg); break;
+      case 'f': format = atoi(optarg) == 444 ? ST7789_PIXEL_FORMAT_RGB444 : ST7789_PIXEL_FORMAT_RGB565; break;
+      case 'p': paced = true; break;
+      case 'r': refresh_hz = (uint32_t)atol(optarg); break;
+      case 'S': seed = (uint32_t)atol(optarg); break;
+      case 'm': scene_name = optarg; break;
+      case 'c': cpu_scale = atof(optarg); break;
+      case 'w': out_path = optarg; break;
+      case 'P': view = ST7789_MODEL_VIEW_PANEL; break;
+      case 'g': golden_path = optarg; break;
+      case 'u': bench_idle_ns = (uint64_t)(atof(optarg) * 1000); break;
+      default:
+        fprintf(stderr,
+          "usage: %s [-n frames] [-s sensors] [-v overlap] [-f 565|444] [-p]\n"
+          "       [-r refresh_hz] [-S seed] [-m fake|gradient|flat|hot|nan|dead|loading]\n"
+          "       [-c cpu_scale] [-w out.ppm] [-P] [-g golden.ppm] [-u idle_us]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (n_sensors < 1 || n_sensors > THERMAL_CAMERA_SENSORS || overlap >= MLX90640_LINE_SIZE) {
+    fprintf(stderr, "[ERROR] 1 to %d sensors, overlapping by less than %d columns.\n", THERMAL_CAMERA_SENSORS,
+      MLX90640_LINE_SIZE);
+    return 2;
+  }
+  for (scene = 0; scene < (bench_scene_t)count_of(bench_scene_names); scene++) {
+    if (strcmp(scene_name, bench_scene_names[scene]) == 0) {
+      break;
+    }
+  }
+  if (scene == (bench_scene_t)count_of(bench_scene_names)) {
+    fprintf(stderr, "[ERROR] no scene \"%s\".\n", scene_name);
+    return 2;
+  }
+
+  static st7789_model_t panel;
+  st7789_model_init(&panel);
+  pico_host_attach_st7789(&panel);
+
+  // as core1 brings the display up
+  st7789_init();
+  if (refresh_hz) {
+    refresh_hz = st7789_set_refresh_rate(refresh_hz);
+  }
+  if (paced) {
+    st7789_te_enable(true);
+    st7789_framebuf_set_paced(true);
+  }
+  st7789_framebuf_set_pixel_format(format);
+  uint64_t init_ns = pico_host_now_ns();
+
+  static fake_frames_t fake[THERMAL_CAMERA_SENSORS];
+  static float frame[SENSOR_PANORAMA_PIXELS(THERMAL_CAMERA_SENSORS)];
+  for (uint32_t k = 0; k < n_sensors; k++) {
+    fake_frames_init(&fake[k], seed + k);
+  }
+  if (scene != BENCH_FAKE && scene != BENCH_LOADING) {
+    bench_fixed_frame(scene, n_sensors, frame);
+  }
+  // from here on, drawing takes time
+  pico_host_set_cpu_scale(cpu_scale);
+  if (bench_idle_ns) {
+    st7789_set_idle(bench_idle);
+  }
+
+  pico_host_counters_t h0, h1;
+  st7789_model_counters_t p0 = panel.counters;
+  pico_host_get_counters(&h0);
+  uint64_t t0 = pico_host_now_ns();
+  uint64_t flush_us = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (scene == BENCH_LOADING) {
+      st7789_loading_ani_tick();
+      flush_us += st7789_framebuf_last_flush_us();
+      continue;
+    }
+    for (uint32_t k = 0; k < n_sensors && scene == BENCH_FAKE; k++) {
+      // both subpages, so every pixel is from this frame
+      fake_frames_to(&fake[k], 2 * i, &frame[k * MLX90640_PIXEL_NUM]);
+      fake_frames_to(&fake[k], 2 * i + 1, &frame[k * MLX90640_PIXEL_NUM]);
+    }
+    pico_host_discard_cpu();
+    st7789_fill_panorama(frame, n_sensors, overlap);
+    flush_us += st7789_framebuf_last_flush_us();
+  }
+  uint64_t run_ns = pico_host_now_ns() - t0;
+  pico_host_get_counters(&h1);
+  st7789_model_counters_t p1 = panel.counters;
+
+  uint32_t bytes_per_pixel_x2 = format == ST7789_PIXEL_FORMAT_RGB444 ? 3 : 4;
+  double least = (double)ST7789_LINE_SIZE * ST7789_COLUMN_SIZE * bytes_per_pixel_x2 / 2;
+  printf("[BENCH] start-up: %.1fms simulated, SPI at %.3fMHz, panel at %uHz.\n", init_ns / 1e6,
+    pico_host_spi_baud() / 1e6, 1000000 / st7789_model_refresh_us(&panel));
+  printf("[BENCH] %u frames of %u sensors, %s, RGB%s from a" BENCH_FRAMEBUF " frame buffer, %s, in %.1fms "
+    "simulated.\n", n, n_sensors, scene_name, format == ST7789_PIXEL_FORMAT_RGB444 ? "444" : "565",
+    paced ? "paced" : "unpaced", run_ns / 1e6);
+  if (n) {
+    double bytes = (double)(h1.spi_bytes - h0.spi_bytes) / n;
+    printf("[BENCH] per frame: %.0f bytes (%.3f of the pixels alone), %.1f chip selects, %.1f commands, "
+      "%.1f DMA transfers.\n", bytes, bytes / least, (double)(p1.selects - p0.selects) / n,
+      (double)(p1.commands - p0.commands) / n, (double)(h1.dma_transfers - h0.dma_transfers) / n);
+    printf("[BENCH] per frame: %.1fus on the bus, %.1fus flushing, %.1fus between frames.\n",
+      (double)(h1.spi_busy_ns - h0.spi_busy_ns) / n / 1000, (double)flush_us / n, (double)run_ns / n / 1000);
+    if (bench_idle_ns) {
+      printf("[BENCH] per frame: the idle hook ran %.1f times, at most %.1fus apart.\n", (double)bench_idle_runs / n,
+        bench_idle_gap_ns / 1000.0);
+    }
+    if (cpu_scale > 0) {
+      printf("[BENCH] per frame: %.1fus of CPU at x%.1f, %.1fus outside flushing.\n",
+        (double)(h1.cpu_ns[0] - h0.cpu_ns[0]) / n / 1000, cpu_scale, (double)run_ns / n / 1000 - (double)flush_us / n);
+    }
+  }
+
+  int status = 0;
+  if (h1.glitches || p1.dropped || p1.clipped || p1.unknown) {
+    printf("[ERROR] %u glitches, %u bytes dropped, %u pixels clipped, %u unknown commands.\n", h1.glitches,
+      p1.dropped, p1.clipped, p1.unknown);
+    status = 1;
+  }
+  if (paced && h1.te_pulses == h0.te_pulses) {
+    printf("[ERROR] no V-blank pulses while paced.\n");
+    status = 1;
+  }
+  if (out_path && !st7789_model_write_ppm(&panel, view, out_path)) {
+    status = 1;
+  }
+  if (golden_path) {
+    long differ = bench_compare(&panel, view, golden_path);
+    if (differ != 0) {
+      if (differ > 0) {
+        printf("[ERROR] %ld pixels differ from %s.\n", differ, golden_path);
+      }
+      status = 1;
+    } else {
+      printf("[INFO] matches %s.\n", golden_path);
+    }
+  }
+  return status;
+}
@@ -0,0 +1,396 @@
+/*
+ * st7789_model.c
+ *
+ * @brief A virtual ST7789, see st7789_model.h.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "st7789_model.h"
+
+/*
+ * @brief The commands the model interprets (datasheet: p 156).
+ */
+#define MODEL_CMD_SWRESET 0x01
+#define MODEL_CMD_SLPIN 0x10
+#define MODEL_CMD_SLPOUT 0x11
+#define MODEL_CMD_NORON 0x13
+#define MODEL_CMD_INVOFF 0x20
+#define MODEL_CMD_INVON 0x21
+#define MODEL_CMD_DISPOFF 0x28
+#define MODEL_CMD_DISPON 0x29
+#define MODEL_CMD_CASET 0x2A
+#define MODEL_CMD_RASET 0x2B
+#define MODEL_CMD_RAMWR 0x2C
+#define MODEL_CMD_VSCRDEF 0x33
+#define MODEL_CMD_TEOFF 0x34
+#define MODEL_CMD_TEON 0x35
+#define MODEL_CMD_MADCTL 0x36
+#define MODEL_CMD_VSCRSADD 0x37
+#define MODEL_CMD_COLMOD 0x3A
+#define MODEL_CMD_RAMWRC 0x3C
+#define MODEL_CMD_PORCTRL 0xB2
+#define MODEL_CMD_FRCTR2 0xC6
+
+#define MODEL_MADCTL_BGR 0x08
+// COLMOD after reset: 18 bits per pixel on the control interface
+#define MODEL_COLMOD_DEFAULT 0x66
+// FRCTR2 after reset: 60Hz
+#define MODEL_FRCTRL2_DEFAULT 0x0F
+// PORCTRL back and front porch after reset, and the lines they add to the
+// 320 of a frame; the FRCTR2 rates are for these
+#define MODEL_PORCH_DEFAULT 0x0C
+#define MODEL_FRAME_LINES 320
+
+/*
+ * @brief Refresh rate for each FRCTR2 RTNA setting, as in st7789.c.
+ */
+static const uint8_t model_frctrl2_hz[] = {
+  119, 111, 105, 99, 94, 90, 86, 82, 78, 75, 72, 69, 67, 64, 62, 60,
+  58, 57, 55, 53, 52, 50, 49, 48, 46, 45, 44, 43, 42, 41, 40, 39,
+};
+
+void st7789_model_reset(st7789_model_t *m) {
+  m->asleep = true;
+  m->display_on = false;
+  m->inverted = false;
+  m->te_on = false;
+  m->madctl = 0;
+  m->colmod = MODEL_COLMOD_DEFAULT;
+  m->frctrl2 = MODEL_FRCTRL2_DEFAULT;
+  m->porch_bp = MODEL_PORCH_DEFAULT;
+  m->porch_fp = MODEL_PORCH_DEFAULT;
+  m->xs = 0;
+  m->xe = ST7789_MODEL_W - 1;
+  m->ys = 0;
+  m->ye = ST7789_MODEL_H - 1;
+  m->x = 0;
+  m->y = 0;
+  m->tfa = 0;
+  m->vsa = ST7789_MODEL_H;
+  m->bfa = 0;
+  m->vsp = 0;
+  m->scrolling = false;
+  m->have_cmd = false;
+  m->n_params = 0;
+  m->acc_bits = 0;
+  m->writing = false;
+  m->counters.resets++;
+}
+
+void st7789_model_init(st7789_model_t *m) {
+  memset(m, 0, sizeof(*m));
+  st7789_model_reset(m);
+  m->panel_inverts = true;
+  m->counters.resets = 0;
+}
+
+void st7789_model_select(st7789_model_t *m, bool selected) {
+  if (selected && !m->selected) {
+    m->counters.selects++;
+  }
+  // the serial interface starts over, but the command and its parameters
+  // so far stand, so a RAMWR can carry on under the next chip select
+  if (!selected) {
+    m->acc_bits = 0;
+  }
+  m->selected = selected;
+}
+
+/*
+ * model_bits_per_pixel
+ *
+ * @brief Bits a pixel takes on the wire for COLMOD's control interface
+ * format. 18 bit pixels take three bytes, 6 bits in the top of each.
+ */
+static uint8_t model_bits_per_pixel(const st7789_model_t *m) {
+  switch (m->colmod & 0x07) {
+    case 0x03: return 12;
+    case 0x05: return 16;
+    default: return 24;
+  }
+}
+
+/*
+ * model_expand
+ *
+ * @brief A pixel as it came over the wire to the 6 bits a channel GRAM
+ * holds, low bits filled from the top as the panel does.
+ */
+static uint32_t model_expand(uint32_t v, uint8_t bits) {
+  uint32_t r, g, b;
+  if (bits == 12) {
+    r = (v >> 8) & 0x0F;
+    g = (v >> 4) & 0x0F;
+    b = v & 0x0F;
+    r = r << 2 | r >> 2;
+    g = g << 2 | g >> 2;
+    b = b << 2 | b >> 2;
+  } else if (bits == 16) {
+    r = (v >> 11) & 0x1F;
+    g = (v >> 5) & 0x3F;
+    b = v & 0x1F;
+    r = r << 1 | r >> 4;
+    b = b << 1 | b >> 4;
+  } else {
+    r = (v >> 18) & 0x3F;
+    g = (v >> 10) & 0x3F;
+    b = (v >> 2) & 0x3F;
+  }
+  return r << 18 | g << 10 | b << 2;
+}
+
+/*
+ * model_gram_index
+ *
+ * @brief Where (x, y), in MADCTL's terms, lands in GRAM: exchanged, then
+ * mirrored. -1 if outside it.
+ */
+static int model_gram_index(uint8_t madctl, uint32_t x, uint32_t y) {
+  uint32_t c = madctl & ST7789_MODEL_MADCTL_MV ? y : x;
+  uint32_t r = madctl & ST7789_MODEL_MADCTL_MV ? x : y;
+  if (c >= ST7789_MODEL_W || r >= ST7789_MODEL_H) {
+    return -1;
+  }
+  if (madctl & ST7789_MODEL_MADCTL_MX) {
+    c = ST7789_MODEL_W - 1 - c;
+  }
+  if (madctl & ST7789_MODEL_MADCTL_MY) {
+    r = ST7789_MODEL_H - 1 - r;
+  }
+  return (int)(r * ST7789_MODEL_W + c);
+}
+
+/*
+ * model_put_pixel
+ *
+ * @brief Write a pixel at the address counter and move it on, along the
+ * window's rows and back round to its start once past the end.
+ */
+static void model_put_pixel(st7789_model_t *m, uint32_t rgb) {
+  int i = model_gram_index(m->madctl, m->x, m->y);
+  if (i >= 0) {
+    m->gram[i] = rgb;
+  } else {
+    m->counters.clipped++;
+  }
+  m->counters.pixels++;
+  if (m->x++ >= m->xe) {
+    m->x = m->xs;
+    if (m->y++ >= m->ye) {
+      m->y = m->ys;
+    }
+  }
+}
+
+static void model_pixel_byte(st7789_model_t *m, uint8_t byte) {
+  uint8_t bits = model_bits_per_pixel(m);
+  m->counters.pixel_bytes++;
+  m->acc = m->acc << 8 | byte;
+  m->acc_bits += 8;
+  if (m->acc_bits >= bits) {
+    m->acc_bits -= bits;
+    model_put_pixel(m, model_expand(m->acc >> m->acc_bits, bits));
+  }
+}
+
+static uint16_t model_param16(const st7789_model_t *m, int i) {
+  return (uint16_t)(m->params[i] << 8 | m->params[i + 1]);
+}
+
+/*
+ * model_command
+ *
+ * @brief A command byte: those without parameters take effect here.
+ */
+static void model_command(st7789_model_t *m, uint8_t cmd) {
+  m->counters.commands++;
+  m->cmd = cmd;
+  m->have_cmd = true;
+  m->n_params = 0;
+  m->acc_bits = 0;
+  m->writing = false;
+  switch (cmd) {
+    case MODEL_CMD_SWRESET:
+      st7789_model_reset(m);
+      // the command is done with, anything after it is dropped
+      m->have_cmd = false;
+      break;
+    case MODEL_CMD_SLPIN: m->asleep = true; break;
+    case MODEL_CMD_SLPOUT: m->asleep = false; break;
+    case MODEL_CMD_NORON: m->scrolling = false; break;
+    case MODEL_CMD_INVOFF: m->inverted = false; break;
+    case MODEL_CMD_INVON: m->inverted = true; break;
+    case MODEL_CMD_DISPOFF: m->display_on = false; break;
+    case MODEL_CMD_DISPON: m->display_on = true; break;
+    case MODEL_CMD_TEOFF: m->te_on = false; break;
+    case MODEL_CMD_RAMWR:
+      m->counters.ramwr++;
+      m->x = m->xs;
+      m->y = m->ys;
+      m->writing = true;
+      break;
+    case MODEL_CMD_RAMWRC:
+      m->writing = true;
+      break;
+    case MODEL_CMD_CASET:
+    case MODEL_CMD_RASET:
+    case MODEL_CMD_VSCRDEF:
+    case MODEL_CMD_TEON:
+    case MODEL_CMD_MADCTL:
+    case MODEL_CMD_VSCRSADD:
+    case MODEL_CMD_COLMOD:
+    case MODEL_CMD_PORCTRL:
+    case MODEL_CMD_FRCTR2:
+      break;
+    default:
+      m->counters.unknown++;
+      break;
+  }
+}
+
+/*
+ * model_param
+ *
+ * @brief A parameter byte: commands take effect once they have them all.
+ */
+static void model_param(st7789_model_t *m, uint8_t byte) {
+  m->counters.param_bytes++;
+  if (m->n_params == ST7789_MODEL_MAX_PARAMS) {
+    return;
+  }
+  m->params[m->n_params++] = byte;
+  switch (m->cmd) {
+    case MODEL_CMD_CASET:
+      if (m->n_params == 4) {
+        m->xs = model_param16(m, 0);
+        m->xe = model_param16(m, 2);
+      }
+      break;
+    case MODEL_CMD_RASET:
+      if (m->n_params == 4) {
+        m->ys = model_param16(m, 0);
+        m->ye = model_param16(m, 2);
+      }
+      break;
+    case MODEL_CMD_VSCRDEF:
+      if (m->n_params == 6) {
+        m->tfa = model_param16(m, 0);
+        m->vsa = model_param16(m, 2);
+        m->bfa = model_param16(m, 4);
+      }
+      break;
+    case MODEL_CMD_VSCRSADD:
+      if (m->n_params == 2) {
+        m->vsp = model_param16(m, 0);
+        m->scrolling = true;
+      }
+      break;
+    case MODEL_CMD_TEON: m->te_on = true; break;
+    case MODEL_CMD_MADCTL: m->madctl = byte; break;
+    case MODEL_CMD_COLMOD: m->colmod = byte; break;
+    case MODEL_CMD_PORCTRL:
+      if (m->n_params == 2) {
+        m->porch_bp = m->params[0] & 0x7F;
+        m->porch_fp = m->params[1] & 0x7F;
+      }
+      break;
+    case MODEL_CMD_FRCTR2: m->frctrl2 = byte; break;
+    default: break;
+  }
+}
+
+void st7789_model_write(st7789_model_t *m, bool dc, const uint8_t *bytes, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (!m->selected) {
+      m->counters.dropped++;
+    } else if (!dc) {
+      model_command(m, bytes[i]);
+    } else if (m->writing) {
+      model_pixel_byte(m, bytes[i]);
+    } else if (m->have_cmd) {
+      model_param(m, bytes[i]);
+    } else {
+      m->counters.dropped++;
+    }
+  }
+}
+
+uint32_t st7789_model_refresh_us(const st7789_model_t *m) {
+  uint64_t lines = MODEL_FRAME_LINES + m->porch_bp + m->porch_fp;
+  return (uint32_t)(1000000ull * lines / ((uint64_t)model_frctrl2_hz[m->frctrl2 & 0x1F] *
+    (MODEL_FRAME_LINES + 2 * MODEL_PORCH_DEFAULT)));
+}
+
+void st7789_model_view_size(const st7789_model_t *m, st7789_model_view_t view, uint32_t *w, uint32_t *h) {
+  bool mv = view == ST7789_MODEL_VIEW_MADCTL && m->madctl & ST7789_MODEL_MADCTL_MV;
+  *w = mv ? ST7789_MODEL_H : ST7789_MODEL_W;
+  *h = mv ? ST7789_MODEL_W : ST7789_MODEL_H;
+}
+
+/*
+ * model_scan_row
+ *
+ * @brief The GRAM row shown on panel row r, with vertical scrolling: the
+ * scroll area starts at VSP and wraps round within itself.
+ */
+static uint32_t model_scan_row(const st7789_model_t *m, uint32_t r) {
+  if (!m->scrolling || m->tfa + m->vsa + m->bfa != ST7789_MODEL_H || m->vsa == 0) {
+    return r;
+  }
+  if (r < m->tfa || r >= (uint32_t)m->tfa + m->vsa || m->vsp < m->tfa) {
+    return r;
+  }
+  return m->tfa + (r - m->tfa + m->vsp - m->tfa) % m->vsa;
+}
+
+uint32_t st7789_model_pixel(const st7789_model_t *m, st7789_model_view_t view, uint32_t x, uint32_t y) {
+  if (!m->display_on || m->asleep) {
+    return 0;
+  }
+  int i = view == ST7789_MODEL_VIEW_MADCTL ? model_gram_index(m->madctl, x, y) : (int)(y * ST7789_MODEL_W + x);
+  if (i < 0) {
+    return 0;
+  }
+  uint32_t c = (uint32_t)i % ST7789_MODEL_W;
+  uint32_t r = model_scan_row(m, (uint32_t)i / ST7789_MODEL_W);
+  uint32_t rgb = m->gram[r * ST7789_MODEL_W + c];
+  if (m->inverted != m->panel_inverts) {
+    rgb ^= 0xFCFCFC;
+  }
+  if (m->madctl & MODEL_MADCTL_BGR) {
+    rgb = (rgb & 0x00FF00) | (rgb >> 16 & 0xFF) | (rgb & 0xFF) << 16;
+  }
+  // 6 bits a channel out to 8
+  return rgb | (rgb >> 6 & 0x030303);
+}
+
+bool st7789_model_write_ppm(const st7789_model_t *m, st7789_model_view_t view, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    printf("[ERROR] st7789_model: can't write %s.\n", path);
+    return false;
+  }
+  uint32_t w, h;
+  st7789_model_view_size(m, view, &w, &h);
+  fprintf(f, "P6\n%u %u\n255\n", w, h);
+  uint8_t row[ST7789_MODEL_H * 3];
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t rgb = st7789_model_pixel(m, view, x, y);
+      row[3 * x] = rgb >> 16;
+      row[3 * x + 1] = rgb >> 8;
+      row[3 * x + 2] = rgb;
+    }
+    fwrite(row, 3, w, f);
+  }
+  bool ok = !ferror(f);
+  if (fclose(f) != 0 || !ok) {
+    printf("[ERROR] st7789_model: failed writing %s.\n", path);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * st7789_model.h
+ *
+ * @brief A virtual ST7789 for the host tools: it takes the bytes the
+ * panel would see on the wire, with the level of DC for each, and keeps
+ * a 240x320 GRAM the way the controller does. The commands the firmware
+ * uses are interpreted:
+ *  - SWRESET, SLPIN/SLPOUT, DISPON/DISPOFF, INVON/INVOFF;
+ *  - COLMOD, for 12, 16 and 18 bits per pixel;
+ *  - MADCTL, the row/column exchange and mirroring;
+ *  - CASET, RASET, RAMWR and RAMWRC, writing the window and wrapping
+ *    round it as the address counters do;
+ *  - VSCRDEF and VSCRSADD, vertical scrolling;
+ *  - TEON/TEOFF, FRCTR2 and PORCTRL, for the V-blank pulses' timing.
+ * Anything else is counted and its parameters ignored.
+ *
+ * The GRAM is held at 6 bits a channel, as the panel holds it. What is
+ * shown can be written out as a PPM, as the panel shows it (240 wide,
+ * scrolled, inverted, blank when off or asleep) or read back through the
+ * current MADCTL, as the firmware thinks of the screen.
+ *
+ * Counters of bytes, commands and chip selects let a caller see what a
+ * frame costs on the bus.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#ifndef _ST7789_MODEL_H
+#define _ST7789_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ST7789_MODEL_W 240
+#define ST7789_MODEL_H 320
+#define ST7789_MODEL_MAX_PARAMS 16
+
+#define ST7789_MODEL_MADCTL_MY 0x80
+#define ST7789_MODEL_MADCTL_MX 0x40
+#define ST7789_MODEL_MADCTL_MV 0x20
+
+typedef enum {
+  ST7789_MODEL_VIEW_PANEL,   // 240x320, as the panel shows it
+  ST7789_MODEL_VIEW_MADCTL,  // read back through MADCTL, as written
+} st7789_model_view_t;
+
+typedef struct {
+  uint32_t selects;       // chip select asserted
+  uint32_t commands;
+  uint32_t unknown;       // commands not interpreted
+  uint32_t param_bytes;
+  uint32_t pixel_bytes;   // after RAMWR or RAMWRC
+  uint32_t pixels;
+  uint32_t dropped;       // bytes with chip select high, or data with no command
+  uint32_t clipped;       // pixels written outside GRAM
+  uint32_t ramwr;
+  uint32_t resets;        // SWRESET or the reset pin
+} st7789_model_counters_t;
+
+typedef struct {
+  // 0x00RRGGBB, 6 bits a channel in the top of each byte
+  uint32_t gram[ST7789_MODEL_W * ST7789_MODEL_H];
+  bool selected;
+  bool asleep;
+  bool display_on;
+  bool inverted;       // INVON
+  bool panel_inverts;  // IPS panels show the GRAM inverted without INVON
+  bool te_on;
+  uint8_t madctl;
+  uint8_t colmod;
+  uint8_t frctrl2;
+  uint8_t porch_bp, porch_fp;  // PORCTRL
+  uint16_t xs, xe, ys, ye;  // the window, in MADCTL's terms
+  uint16_t x, y;            // the address counter
+  uint16_t tfa, vsa, bfa, vsp;
+  bool scrolling;           // since VSCRSADD, until NORON
+  // the command being taken and its parameters so far
+  uint8_t cmd;
+  bool have_cmd;
+  uint8_t params[ST7789_MODEL_MAX_PARAMS];
+  uint8_t n_params;
+  // bits of the pixel being shifted in
+  uint32_t acc;
+  uint8_t acc_bits;
+  bool writing;
+  st7789_model_counters_t counters;
+} st7789_model_t;
+
+/*
+ * st7789_model_init
+ *
+ * @brief A panel just powered on, its GRAM full of noise-free black.
+ */
+void st7789_model_init(st7789_model_t *m);
+/*
+ * st7789_model_reset
+ *
+ * @brief The reset pin pulled low, or SWRESET. GRAM is kept.
+ */
+void st7789_model_reset(st7789_model_t *m);
+/*
+ * st7789_model_select
+ *
+ * @brief Chip select; deasserting it ends a pixel write part way through.
+ */
+void st7789_model_select(st7789_model_t *m, bool selected);
+/*
+ * st7789_model_write
+ *
+ * @brief n bytes off the wire, as command bytes (dc false) or data.
+ */
+void st7789_model_write(st7789_model_t *m, bool dc, const uint8_t *bytes, size_t n);
+/*
+ * st7789_model_refresh_us
+ *
+ * @brief The refresh period FRCTR2 and PORCTRL give, between V-blank
+ * pulses.
+ */
+uint32_t st7789_model_refresh_us(const st7789_model_t *m);
+/*
+ * st7789_model_view_size
+ */
+void st7789_model_view_size(const st7789_model_t *m, st7789_model_view_t view, uint32_t *w, uint32_t *h);
+/*
+ * st7789_model_pixel
+ *
+ * @brief What is shown at (x, y) of the view, as 0x00RRGGBB with 8 bits a
+ * channel.
+ */
+uint32_t st7789_model_pixel(const st7789_model_t *m, st7789_model_view_t view, uint32_t x, uint32_t y);
+/*
+ * st7789_model_write_ppm
+ *
+ * @brief Write the view as a binary PPM. Returns false, having printed
+ * why, if it can't.
+ */
+bool st7789_model_write_ppm(const st7789_model_t *m, st7789_model_view_t view, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * stream_fake.c
+ *
+ * @brief Stands in for the camera on the USB link: sends a made-up EEPROM
+ * dump, as the camera does first, then synthetic frames framed as in
+ * include/stream_proto.h at the sensor rate, so the receiver and the
+ * protocol can be tried on a Linux box with no hardware.
+ *
+ *   stream_fake [-r hz] [-n frames] [-t to|raw|packed] [-c every] [-p]
+ *
+ * -r is the subpage rate (16 by default), -n stops after that many frames
+ * (0, the default, runs until killed), -t picks the payload (packed is raw
+ * through frame_codec.h), -c corrupts a
+ * byte of every that many-th message to exercise resyncing. Frames go to
+ * stdout, for a pipe; with -p they go to a new pseudo-terminal instead,
+ * whose path is printed on stderr for stream_recv to open.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "stream_proto.h"
+#include "frame_codec.h"
+#include "fake_frames.h"
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until_us(uint64_t t_us) {
+  struct timespec ts = { (time_t)(t_us / 1000000), (long)(t_us % 1000000) * 1000 };
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t n) {
+  while (n > 0) {
+    ssize_t w = write(fd, buf, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    buf += w;
+    n -= (size_t)w;
+  }
+  return 0;
+}
+
+/*
+ * open_pty
+ *
+ * @brief A new pseudo-terminal in raw mode, so every byte goes through as
+ * it is. The far end is kept open here too, or writes would fail until the
+ * receiver opens it.
+ */
+static int open_pty(int *slave_fd) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    perror("[ERROR] posix_openpt");
+    return -1;
+  }
+  const char *path = ptsname(fd);
+  *slave_fd = open(path, O_RDWR | O_NOCTTY);
+  if (*slave_fd < 0) {
+    perror("[ERROR] open pty");
+    return -1;
+  }
+  struct termios tio;
+  tcgetattr(*slave_fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(*slave_fd, TCSANOW, &tio);
+  fprintf(stderr, "[INFO] streaming to %s\n", path);
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  double rate = 16;
+  long count = 0;
+  long corrupt_every = 0;
+  uint8_t type = STREAM_MSG_TO;
+  int use_pty = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:n:t:c:p")) != -1) {
+    switch (opt) {
+      case 'r': rate = atof(optarg); break;
+      case 'n': count = atol(optarg); break;
+      case 't':
+        type = strcmp(optarg, "raw") == 0 ? STREAM_MSG_RAW : strcmp(optarg, "packed") == 0 ? STREAM_MSG_RAW_PACKED : STREAM_MSG_TO;
+        break;
+      case 'c': corrupt_every = atol(optarg); break;
+      case 'p': use_pty = 1; break;
+      default:
+        fprintf(stderr, "usage: %s [-r hz] [-n frames] [-t to|raw|packed] [-c every] [-p]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (rate <= 0) {
+    rate = 16;
+  }
+
+  int slave_fd = -1;
+  int fd = use_pty ? open_pty(&slave_fd) : STDOUT_FILENO;
+  if (fd < 0) {
+    return 1;
+  }
+
+  static fake_frames_t fake;
+  static frame_codec_t codec;
+  static float temps[FAKE_PIXELS];
+  static uint16_t raw[FAKE_RAW_WORDS];
+  static uint8_t packed[FRAME_CODEC_MAX_BYTES];
+  fake_frames_init(&fake, 1);
+  frame_codec_init(&codec, FRAME_CODEC_KEY_INTERVAL);
+  static uint8_t msg[STREAM_PROTO_MAX_MSG];
+  uint64_t period_us = (uint64_t)(1e6 / rate);
+  uint64_t t_us = now_us();
+
+  // as the camera does when the port opens
+  static uint16_t ee_data[FAKE_EEPROM_WORDS];
+  fake_frames_eeprom(1, ee_data);
+  stream_header_t eh = { STREAM_MSG_EEPROM, 0, 0, 0, (uint32_t)t_us, sizeof(ee_data) };
+  if (write_all(fd, msg, stream_proto_encode(&eh, ee_data, msg, sizeof(msg))) < 0) {
+    return 1;
+  }
+
+  for (uint32_t n = 0; count == 0 || n < (uint32_t)count; n++) {
+    int subpage = n & 1;
+    stream_header_t h = { type, 0, (uint8_t)subpage, n, (uint32_t)t_us, 0 };
+    const void *payload;
+    if (type == STREAM_MSG_RAW) {
+      fake_frames_raw(&fake, n, raw);
+      h.payload_len = sizeof(raw);
+      payload = raw;
+    } else if (type == STREAM_MSG_RAW_PACKED) {
+      fake_frames_raw(&fake, n, raw);
+      h.payload_len = (uint16_t)frame_codec_encode(&codec, raw, packed, sizeof(packed));
+      payload = packed;
+    } else {
+      fake_frames_to(&fake, n, temps);
+      h.payload_len = sizeof(temps);
+      payload = temps;
+    }
+    size_t len = stream_proto_encode(&h, payload, msg, sizeof(msg));
+    if (corrupt_every > 0 && n % corrupt_every == corrupt_every - 1) {
+      msg[rand() % len] ^= 0x5A;
+    }
+    if (write_all(fd, msg, len) < 0) {
+      // the reader went away
+      break;
+    }
+    t_us += period_us;
+    sleep_until_us(t_us);
+  }
+
+  if (slave_fd >= 0) {
+    // let the receiver drain what is still in the pty before it goes
+    tcdrain(fd);
+    sleep(1);
+    close(slave_fd);
+  }
+  return 0;
+}
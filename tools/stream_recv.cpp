@@ -0,0 +1,303 @@
+/*
+ * stream_recv.cpp
+ *
+ * @brief Receives the frame stream from the camera's USB CDC port (or
+ * anything else speaking include/stream_proto.h: a pty from stream_fake, a
+ * pipe, a file), checks every message, and writes the frames out as CSV.
+ *
+ *   stream_recv [-o frames.csv] [-r recording.tcr] [-n frames] [-q] <device|file|->
+ *
+ * Each CSV line is seq, time_us, sensor, subpage, type, then the 768 To
+ * values in degrees C or the 834 raw words; packed raw frames are decoded
+ * and written as raw. -r records raw and packed frames, with the EEPROM
+ * dumps the camera sends first, as in recording.h; a sensor's frames are
+ * only recorded once its EEPROM has come. -n stops after that many frames,
+ * -q only prints the summary. Sequence gaps are frames the camera dropped
+ * or that were lost to CRC errors.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include "stream_proto.h"
+#include "frame_codec.h"
+#include "recording.h"
+
+namespace {
+
+// Ctrl-C finishes the recording rather than leaving it unindexed
+volatile std::sig_atomic_t stop = 0;
+
+void on_signal(int) {
+  stop = 1;
+}
+
+struct Stats {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  uint64_t skipped = 0;     // bytes thrown away looking for a message
+  uint64_t crc_errors = 0;
+  uint64_t gaps = 0;        // frames missing going by the sequence numbers
+  uint64_t undecoded = 0;   // packed frames lost waiting for a key frame
+  uint64_t packed_bytes = 0;
+  uint64_t packed_frames = 0;
+  uint64_t eeproms = 0;
+  uint64_t recorded = 0;
+  uint64_t not_recorded = 0;  // raw frames from a sensor with no EEPROM yet
+  uint32_t first_time_us = 0;
+  uint32_t last_time_us = 0;
+};
+
+/*
+ * open_input
+ *
+ * @brief Open the stream. A serial port is put in raw mode and has DTR
+ * raised, which is what tells the camera a host is listening.
+ */
+int open_input(const std::string &path) {
+  if (path == "-") {
+    return STDIN_FILENO;
+  }
+  int fd = open(path.c_str(), O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    std::fprintf(stderr, "[ERROR] can't open %s: %s\n", path.c_str(), std::strerror(errno));
+    return -1;
+  }
+  if (isatty(fd)) {
+    termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    int dtr = TIOCM_DTR;
+    // not every tty has modem lines, a pty doesn't
+    ioctl(fd, TIOCMBIS, &dtr);
+  }
+  return fd;
+}
+
+void write_csv(std::ofstream &out, const stream_header_t &h, const uint8_t *payload, const uint16_t *raw) {
+  out << h.seq << ',' << h.time_us << ',' << unsigned(h.sensor) << ',' << unsigned(h.subpage) << ','
+      << (h.type == STREAM_MSG_TO ? "to" : "raw");
+  if (h.type != STREAM_MSG_TO) {
+    for (size_t i = 0; i < FRAME_CODEC_WORDS; i++) {
+      out << ',' << raw[i];
+    }
+  } else {
+    char buf[16];
+    for (size_t i = 0; i + 3 < h.payload_len; i += 4) {
+      float t;
+      std::memcpy(&t, &payload[i], sizeof(t));
+      std::snprintf(buf, sizeof(buf), ",%.2f", t);
+      out << buf;
+    }
+  }
+  out << '\n';
+}
+
+void print_summary(const Stats &s, double elapsed_s) {
+  double device_s = (s.last_time_us - s.first_time_us) / 1e6;
+  std::printf("[INFO] %llu frames, %llu bytes in %.1fs (%.1f frames/s, %.1f kB/s).\n",
+    (unsigned long long)s.frames, (unsigned long long)s.bytes, elapsed_s,
+    elapsed_s > 0 ? s.frames / elapsed_s : 0.0, elapsed_s > 0 ? s.bytes / elapsed_s / 1000 : 0.0);
+  if (s.frames > 1 && device_s > 0) {
+    std::printf("[INFO] camera clock: %.2f frames/s.\n", (s.frames - 1) / device_s);
+  }
+  std::printf("[INFO] %llu sequence gaps, %llu CRC errors, %llu bytes skipped.\n",
+    (unsigned long long)s.gaps, (unsigned long long)s.crc_errors, (unsigned long long)s.skipped);
+  if (s.packed_frames > 0) {
+    std::printf("[INFO] packed frames: %.1f bytes on average, %.2f:1, %llu not decoded.\n",
+      (double)s.packed_bytes / s.packed_frames, 2.0 * FRAME_CODEC_WORDS * s.packed_frames / s.packed_bytes,
+      (unsigned long long)s.undecoded);
+  }
+  if (s.eeproms > 0 || s.recorded > 0 || s.not_recorded > 0) {
+    std::printf("[INFO] %llu EEPROM dumps, %llu frames recorded, %llu waiting for an EEPROM.\n",
+      (unsigned long long)s.eeproms, (unsigned long long)s.recorded, (unsigned long long)s.not_recorded);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string out_path;
+  std::string rec_path;
+  uint64_t max_frames = 0;
+  bool quiet = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:r:n:q")) != -1) {
+    switch (opt) {
+      case 'o': out_path = optarg; break;
+      case 'r': rec_path = optarg; break;
+      case 'n': max_frames = std::strtoull(optarg, nullptr, 10); break;
+      case 'q': quiet = true; break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc - 1) {
+    std::fprintf(stderr, "usage: %s [-o frames.csv] [-r recording.tcr] [-n frames] [-q] <device|file|->\n", argv[0]);
+    return 2;
+  }
+
+  int fd = open_input(argv[optind]);
+  if (fd < 0) {
+    return 1;
+  }
+  std::ofstream out;
+  if (!out_path.empty()) {
+    out.open(out_path);
+    if (!out) {
+      std::fprintf(stderr, "[ERROR] can't write %s\n", out_path.c_str());
+      return 1;
+    }
+  }
+  static recording_writer_t rec;
+  if (!rec_path.empty() && !recording_create(&rec, rec_path.c_str())) {
+    return 1;
+  }
+  uint32_t rec_eeproms = 0;
+  bool warned_to = false;
+
+  Stats stats;
+  // packed frames depend on the one before from the same sensor
+  std::map<uint8_t, frame_codec_t> codecs;
+  static uint16_t raw[FRAME_CODEC_WORDS];
+  std::vector<uint8_t> buf;
+  buf.reserve(4 * STREAM_PROTO_MAX_MSG);
+  bool have_seq = false;
+  uint32_t next_seq = 0;
+  // the camera's clock wraps every 71 minutes, recordings don't
+  uint64_t time_high = 0;
+  uint32_t last_time_us = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  struct sigaction sa = {};
+  sa.sa_handler = on_signal;
+  // no SA_RESTART, so the read below comes back
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  bool done = false;
+  while (!done && !stop) {
+    uint8_t chunk[4096];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // end of file, or EIO once the far end of a pty closes
+      break;
+    }
+    buf.insert(buf.end(), chunk, chunk + n);
+
+    size_t pos = 0;
+    while (!done) {
+      stream_header_t h;
+      const uint8_t *payload;
+      size_t consumed = 0;
+      stream_parse_t r = stream_proto_parse(buf.data() + pos, buf.size() - pos, &h, &payload, &consumed);
+      if (r == STREAM_PARSE_MORE) {
+        break;
+      }
+      pos += consumed;
+      if (r == STREAM_PARSE_SKIP) {
+        stats.skipped += consumed;
+        continue;
+      }
+      if (r == STREAM_PARSE_BAD_CRC) {
+        stats.crc_errors++;
+        stats.skipped += consumed;
+        continue;
+      }
+      if (h.type == STREAM_MSG_EEPROM) {
+        // sent when the port opens, not a frame
+        stats.eeproms++;
+        if (!rec_path.empty() && h.payload_len == RECORDING_EEPROM_WORDS * sizeof(uint16_t) &&
+            h.sensor < RECORDING_MAX_SENSORS) {
+          uint16_t ee[RECORDING_EEPROM_WORDS];
+          std::memcpy(ee, payload, sizeof(ee));
+          if (recording_set_eeprom(&rec, h.sensor, ee)) {
+            rec_eeproms |= 1u << h.sensor;
+          }
+        }
+        continue;
+      }
+
+      if (have_seq && h.seq != next_seq) {
+        stats.gaps += h.seq - next_seq;
+        if (!quiet) {
+          std::printf("[INFO] frames %lu to %lu missing.\n", (unsigned long)next_seq, (unsigned long)(h.seq - 1));
+        }
+      }
+      if (!have_seq) {
+        stats.first_time_us = h.time_us;
+      }
+      if (have_seq && h.time_us < last_time_us) {
+        time_high += 1ull << 32;
+      }
+      last_time_us = h.time_us;
+      have_seq = true;
+      next_seq = h.seq + 1;
+      stats.last_time_us = h.time_us;
+      stats.frames++;
+      stats.bytes += consumed;
+      if (h.type == STREAM_MSG_RAW_PACKED) {
+        auto it = codecs.find(h.sensor);
+        if (it == codecs.end()) {
+          it = codecs.emplace(h.sensor, frame_codec_t{}).first;
+          frame_codec_init(&it->second, 0);
+        }
+        stats.packed_frames++;
+        stats.packed_bytes += h.payload_len;
+        if (frame_codec_decode(&it->second, payload, h.payload_len, raw) != FRAME_CODEC_OK) {
+          stats.undecoded++;
+          continue;
+        }
+      } else if (h.type == STREAM_MSG_RAW) {
+        if (h.payload_len != sizeof(raw)) {
+          continue;
+        }
+        std::memcpy(raw, payload, sizeof(raw));
+      }
+      if (!rec_path.empty()) {
+        if (h.type == STREAM_MSG_TO) {
+          if (!warned_to) {
+            std::printf("[INFO] To frames aren't recorded, only raw and packed.\n");
+            warned_to = true;
+          }
+        } else if (h.sensor < RECORDING_MAX_SENSORS && (rec_eeproms & (1u << h.sensor))) {
+          if (!recording_append(&rec, time_high | h.time_us, h.seq, h.sensor, h.subpage, raw)) {
+            return 1;
+          }
+          stats.recorded++;
+        } else {
+          stats.not_recorded++;
+        }
+      }
+      if (out.is_open()) {
+        write_csv(out, h, payload, raw);
+      }
+      done = max_frames && stats.frames >= max_frames;
+    }
+    buf.erase(buf.begin(), buf.begin() + pos);
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (!rec_path.empty() && !recording_close(&rec)) {
+    std::fprintf(stderr, "[ERROR] recording %s wasn't finished.\n", rec_path.c_str());
+  }
+  print_summary(stats, elapsed);
+  return stats.frames > 0 ? 0 : 1;
+}
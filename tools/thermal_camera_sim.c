@@ -0,0 +1,288 @@
+/*
+ * thermal_camera_sim.c
+ *
+ * @brief The whole camera on the host: main.c and core1_main as built for
+ * the Pico, with the sensor loop, the frame scheduler and the display code,
+ * running on the simulated hardware (pico_host.h), the two cores as two
+ * threads. The sensors are simulated ones (mlx90640_model.h) at the
+ * addresses main.c looks for them, measuring fake scenes or playing back
+ * a recording, and the panel a virtual ST7789 (st7789_model.h):
+ *
+ *   thermal_camera_sim [-t seconds] [-r recording.tcr] [-S seed] [-c cpu_scale]
+ *                      [-w prefix] [-i snapshot_ms] [-x script]
+ *                      [-N nack] [-T timeout] [-L bad_line] [-A bad_aux]
+ *                      [-D dead_ms[:alive_ms]]
+ *
+ * A recording's frames play in order for each sensor, from its EEPROM
+ * dumps, and round again at the end. -w writes what the panel shows at the
+ * end to prefix.ppm, and every -i ms to prefix-<ms>.ppm. -x types lines
+ * "<ms> <command>" on the console at those times. Fault rates are per
+ * thousand, as for mlx90640_bench. -D has the last sensor stop answering
+ * at dead_ms, and start again at alive_ms if given.
+ *
+ * Both cores' time is simulated, so a run gives the same output every
+ * time, however loaded the host. -c puts the host CPU time each core takes
+ * on its clock, times cpu_scale (how much slower the RP2040 is), to see
+ * where the work would go; runs then vary with the host.
+ *
+ * Exits 1 if the cores got stuck on each other, the panel saw anything it
+ * shouldn't, or, after the start-up delay, no frames got to the display.
+ *
+ * @copyright Copyright (C) 2025 Simon J. Jones <github@simonjjones.com>
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mlx90640/MLX90640_I2C_Driver.h"
+#include "frame_sched.h"
+#include "pico_host.h"
+#include "st7789_model.h"
+#include "mlx90640_model.h"
+#include "recording.h"
+
+#define SIM_ADDR 0x33
+// main.c's INITIAL_DELAY_MS, before the sensors are set up
+#define SIM_START_US 6000000
+#define SIM_LINE_LEN 128
+
+// main.c's main, renamed where it's built for the simulator
+int thermal_camera_main(void);
+
+typedef struct {
+  const recording_reader_t *rec;
+  uint8_t sensor;
+  uint64_t next;  // where to look for its next frame
+} sim_playback_t;
+
+static st7789_model_t sim_panel;
+static const char *sim_prefix;
+
+static uint64_t sim_host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * sim_playback
+ *
+ * @brief The model's source for a recording: the sensor's next frame of
+ * the subpage it's measuring, from where the last one was.
+ */
+static void sim_playback(void *ctx, uint32_t n, uint8_t subpage, uint16_t *frame) {
+  (void)n;
+  sim_playback_t *p = ctx;
+  for (uint64_t i = 0; i < p->rec->n_frames; i++) {
+    uint64_t at = (p->next + i) % p->rec->n_frames;
+    const recording_frame_t *f = recording_frame(p->rec, at);
+    if (f->sensor == p->sensor && f->subpage == subpage) {
+      memcpy(frame, f->words, sizeof(f->words));
+      p->next = at + 1;
+      return;
+    }
+  }
+}
+
+/*
+ * sim_i2c_advance
+ *
+ * @brief The sensor bus on the calling core's clock. Simulating the
+ * sensor isn't the firmware's CPU time.
+ */
+static void sim_i2c_advance(uint64_t ns) {
+  pico_host_discard_cpu();
+  pico_host_advance_ns(ns);
+}
+
+/*
+ * sim_snapshot
+ */
+static void sim_snapshot(void *ctx, uint64_t now_ns) {
+  (void)ctx;
+  char path[256];
+  snprintf(path, sizeof(path), "%s-%06llu.ppm", sim_prefix, (unsigned long long)(now_ns / 1000000));
+  st7789_model_write_ppm(&sim_panel, ST7789_MODEL_VIEW_MADCTL, path);
+  pico_host_discard_cpu();
+}
+
+/*
+ * sim_load_script
+ *
+ * @brief Queue the console lines in path. Returns false, having printed
+ * why, if it can't.
+ */
+static bool sim_load_script(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    printf("[ERROR] can't open %s.\n", path);
+    return false;
+  }
+  char line[SIM_LINE_LEN];
+  uint32_t n = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    n++;
+    line[strcspn(line, "\r\n")] = '\0';
+    char *command;
+    unsigned long ms = strtoul(line, &command, 10);
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    if (command == line || *command != ' ') {
+      printf("[ERROR] %s:%u isn't \"<ms> <command>\".\n", path, n);
+      ok = false;
+    } else if (!pico_host_console_feed((uint64_t)ms * 1000000, command + 1)) {
+      printf("[ERROR] %s:%u: too many lines.\n", path, n);
+      ok = false;
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10, cpu_scale = 0;
+  uint32_t seed = 1, snapshot_ms = 0;
+  uint64_t dead_ns = 0, alive_ns = 0;
+  const char *rec_path = NULL, *script_path = NULL;
+  mlx90640_model_faults_t faults = { 0 };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "t:r:S:c:w:i:x:N:T:L:A:D:")) != -1) {
+    switch (opt) {
+      case 't': seconds = atof(optarg); break;
+      case 'r': rec_path = optarg; break;
+      case 'S': seed = (uint32_t)atol(optarg); break;
+      case 'c': cpu_scale = atof(optarg); break;
+      case 'w': sim_prefix = optarg; break;
+      case 'i': snapshot_ms = (uint32_t)atol(optarg); break;
+      case 'x': script_path = optarg; break;
+      case 'N': faults.nack = (uint16_t)atoi(optarg); break;
+      case 'T': faults.timeout = (uint16_t)atoi(optarg); break;
+      case 'L': faults.bad_line = (uint16_t)atoi(optarg); break;
+      case 'A': faults.bad_aux = (uint16_t)atoi(optarg); break;
+      case 'D': {
+        char *alive;
+        dead_ns = strtoull(optarg, &alive, 10) * 1000000;
+        alive_ns = *alive == ':' ? strtoull(alive + 1, NULL, 10) * 1000000 : 0;
+        break;
+      }
+      default:
+        fprintf(stderr,
+          "usage: %s [-t seconds] [-r recording.tcr] [-S seed] [-c cpu_scale]\n"
+          "       [-w prefix] [-i snapshot_ms] [-x script]\n"
+          "       [-N nack] [-T timeout] [-L bad_line] [-A bad_aux]\n"
+          "       [-D dead_ms[:alive_ms]]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (seconds <= 0 || (snapshot_ms && !sim_prefix)) {
+    fprintf(stderr, "[ERROR] a run takes some time, and snapshots need -w.\n");
+    return 2;
+  }
+  // the firmware's output and ours, in the order it happened
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  static recording_reader_t rec;
+  static sim_playback_t playback[THERMAL_CAMERA_SENSORS];
+  if (rec_path && !recording_open(&rec, rec_path)) {
+    return 1;
+  }
+
+  static mlx90640_model_t sensors[THERMAL_CAMERA_SENSORS];
+  faults.seed = seed;
+  for (uint8_t k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    mlx90640_model_t *m = &sensors[k];
+    mlx90640_model_init(m, MLX90640_I2C_ADDR(k % MLX90640_I2C_BUSES, SIM_ADDR + k / MLX90640_I2C_BUSES), seed + k, 0);
+    mlx90640_model_faults_t f = faults;
+    if (k == THERMAL_CAMERA_SENSORS - 1) {
+      f.dead_ns = dead_ns;
+      f.alive_ns = alive_ns;
+    }
+    mlx90640_model_set_faults(m, &f);
+    if (rec_path) {
+      const uint16_t *ee = recording_eeprom(&rec, k);
+      if (ee) {
+        memcpy(m->eeprom, ee, sizeof(m->eeprom));
+      } else {
+        printf("[INFO] %s has no EEPROM for sensor %u, its frames are calculated with a made-up one.\n", rec_path,
+          k);
+      }
+      playback[k] = (sim_playback_t){ &rec, k, 0 };
+      mlx90640_model_set_source(m, sim_playback, &playback[k]);
+    }
+    mlx90640_host_attach(m);
+  }
+  mlx90640_host_set_clock(pico_host_now_ns, sim_i2c_advance);
+
+  st7789_model_init(&sim_panel);
+  pico_host_attach_st7789(&sim_panel);
+  if (snapshot_ms) {
+    pico_host_set_tick((uint64_t)snapshot_ms * 1000000, sim_snapshot, NULL);
+  }
+  if (script_path && !sim_load_script(script_path)) {
+    return 1;
+  }
+  pico_host_set_cpu_scale(cpu_scale);
+
+  uint64_t end_ns = (uint64_t)(seconds * 1e9);
+  uint64_t host_t0 = sim_host_ns();
+  bool ok = pico_host_run(thermal_camera_main, end_ns);
+  uint64_t host_ns = sim_host_ns() - host_t0;
+
+  pico_host_counters_t h;
+  pico_host_get_counters(&h);
+  frame_sched_stats_t fs;
+  frame_sched_get_stats(&fs);
+  const st7789_model_counters_t *p = &sim_panel.counters;
+
+  printf("[BENCH] %.3fs simulated in %.3fs, %u sensors%s%s.\n", end_ns / 1e9, host_ns / 1e9, THERMAL_CAMERA_SENSORS,
+    rec_path ? " playing back " : "", rec_path ? rec_path : "");
+  for (uint c = 0; c < PICO_HOST_CORES; c++) {
+    printf("[BENCH] core%u: at %.3fs, %.3fs asleep, %.3fs CPU put on the clock, waited on a mutex %u times.\n", c,
+      pico_host_core_ns(c) / 1e9, h.sleep_ns[c] / 1e9, h.cpu_ns[c] / 1e9, h.mutex_waits[c]);
+  }
+  printf("[BENCH] frames produced %u consumed %u dropped %u, display ticks drawn %u idle %u late %u.\n", fs.produced,
+    fs.consumed, fs.dropped, fs.displayed, fs.idle, fs.late);
+  printf("[BENCH] spi0: %llu bytes, busy %.1f%%, %u RAMWRs, %u TE pulses.\n", (unsigned long long)h.spi_bytes,
+    100.0 * h.spi_busy_ns / end_ns, p->ramwr, h.te_pulses);
+  for (uint8_t bus = 0; bus < MLX90640_I2C_BUSES; bus++) {
+    mlx90640_i2c_stats_t b;
+    MLX90640_I2CGetStats(bus, &b);
+    printf("[BENCH] i2c%u: reads %u writes %u, nacks %u timeouts %u.\n", bus, b.reads, b.writes, b.nacks, b.timeouts);
+  }
+  for (uint k = 0; k < THERMAL_CAMERA_SENSORS; k++) {
+    const mlx90640_model_counters_t *c = &sensors[k].counters;
+    printf("[BENCH] sensor 0x%02x: %u measurements, %u overwritten, %u status polls without data.\n",
+      sensors[k].slave_addr, c->measurements, c->overwritten, c->not_ready);
+  }
+
+  int status = 0;
+  if (!ok) {
+    printf("[ERROR] the cores got stuck, each waiting on the other.\n");
+    status = 1;
+  }
+  if (h.glitches || p->dropped || p->clipped || p->unknown) {
+    printf("[ERROR] %u glitches, %u bytes dropped, %u pixels clipped, %u unknown commands.\n", h.glitches,
+      p->dropped, p->clipped, p->unknown);
+    status = 1;
+  }
+  if (end_ns > (uint64_t)SIM_START_US * 1000 + 1000000000ull && fs.displayed == 0) {
+    printf("[ERROR] no frames got to the display.\n");
+    status = 1;
+  }
+  if (sim_prefix) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s.ppm", sim_prefix);
+    if (!st7789_model_write_ppm(&sim_panel, ST7789_MODEL_VIEW_MADCTL, path)) {
+      status = 1;
+    }
+  }
+  // the cores are left parked
+  fflush(stdout);
+  _exit(status);
+}